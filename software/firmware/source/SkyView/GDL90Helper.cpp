@@ -32,14 +32,15 @@ extern "C" {
 #include <gdl90.h>
 }
 
-#define GDL90_RINGBUF_SIZE  sizeof(gdl_message_escaped_t)
+/* unescaped frame between two flag bytes: message ID, payload and FCS */
+#define GDL90_FRAME_MAX     (1 + GDL90_MSG_LEN_UPLINK_DATA + 2)
 
 static unsigned long GDL90_Data_TimeMarker = 0;
 static unsigned long GDL90_HeartBeat_TimeMarker = 0;
 static unsigned long GDL90_OwnShip_TimeMarker = 0;
-static unsigned char gdl90_ringbuf[GDL90_RINGBUF_SIZE];
-static unsigned int gdl90buf_head = 0;
-static unsigned char prev_c = 0;
+static size_t gdl90_frame_len = 0;
+static bool   gdl90_escape    = false;
+static bool   gdl90_overrun   = false;
 
 gdl_message_t message;
 
@@ -67,143 +68,160 @@ const uint8_t gdl90_to_aircraft_type[] PROGMEM = {
 	AIRCRAFT_TYPE_RESERVED
 };
 
-static void GDL90_Parse_Character(char c)
+/*
+ * A complete frame is in 'message', 'len' bytes from the message ID on.
+ * FCS is checked once here, then the message is handled by its ID.
+ */
+static void GDL90_Frame(size_t len)
 {
-    unsigned int gdl90buf_tail;
-    size_t msg_size;
-
-    if (c == GDL90_CONTROL_ESCAPE) {
-      prev_c = c;
-      return;
-    } else if (prev_c == GDL90_CONTROL_ESCAPE) {
-      prev_c = c;
-      c ^= GDL90_ESCAPE_BYTE;
-    } else {
-      prev_c = c;
-    }
+  uint8_t *frame = ((uint8_t *) &message) + 1 /* flag */;
 
-    gdl90_ringbuf[gdl90buf_head % GDL90_RINGBUF_SIZE] = c;
-    gdl90buf_head++;
+  if (len < 1 /* id */ + 2 /* FCS */) {
+    return;
+  }
 
-    msg_size = 1 /* flag */ + 1 /* id */ + GDL90_MSG_LEN_HEARTBEAT + 2 /* FC */ + 1 /* flag */;
-    gdl90buf_tail = gdl90buf_head - msg_size;
-    if (c == GDL90_FLAG_BYTE && 
-        gdl90_ringbuf[ gdl90buf_tail    % GDL90_RINGBUF_SIZE] == GDL90_FLAG_BYTE &&
-        gdl90_ringbuf[(gdl90buf_tail+1) % GDL90_RINGBUF_SIZE] == MSG_ID_HEARTBEAT) {
+  uint16_t fcs = frame[len - 2] | (frame[len - 1] << 8);
+  if (gdl90_crcCompute(frame, len - 2) != fcs) {
+    return;
+  }
 
-      unsigned char *buf = (unsigned char *) &message;
-      for (uint8_t i=0; i < msg_size; i++) {
-          buf[i] = gdl90_ringbuf[(gdl90buf_tail + i) % GDL90_RINGBUF_SIZE];
-      }
+  message.flag0 = GDL90_FLAG_BYTE;
+  size_t payload = len - 3;
 
-      if (decode_gdl90_heartbeat(&message, &heartbeat)) {
+  switch (message.messageId)
+  {
+  case MSG_ID_HEARTBEAT:
+    if (payload >= GDL90_MSG_LEN_HEARTBEAT) {
+      parse_gdl90_heartbeat(&message, &heartbeat);
 
-//      print_gdl90_heartbeat(&heartbeat);
+//    print_gdl90_heartbeat(&heartbeat);
 
-        GDL90_HeartBeat_TimeMarker = millis();
-      }
+      GDL90_HeartBeat_TimeMarker = millis();
     }
+    break;
 
-    msg_size = 1 /* flag */ + 1 /* id */ + GDL90_MSG_LEN_OWNSHIP_GEOMETRIC + 2 /* FC */ + 1 /* flag */;
-    gdl90buf_tail = gdl90buf_head - msg_size;
-    if (c == GDL90_FLAG_BYTE && 
-        gdl90_ringbuf[ gdl90buf_tail    % GDL90_RINGBUF_SIZE] == GDL90_FLAG_BYTE &&
-        gdl90_ringbuf[(gdl90buf_tail+1) % GDL90_RINGBUF_SIZE] == MSG_ID_OWNSHIP_GEOMETRIC) {
-
-      unsigned char *buf = (unsigned char *) &message;
-      for (uint8_t i=0; i < msg_size; i++) {
-          buf[i] = gdl90_ringbuf[(gdl90buf_tail + i) % GDL90_RINGBUF_SIZE];
-      }
-
-      decode_gdl90_ownship_geo_altitude(&message, &geo_altitude);
+  case MSG_ID_OWNSHIP_GEOMETRIC:
+    if (payload >= GDL90_MSG_LEN_OWNSHIP_GEOMETRIC) {
+      parse_gdl90_ownship_geo_altitude(&message, &geo_altitude);
 //    print_gdl90_ownship_geo_altitude(&geo_altitude);
     }
+    break;
 
-    msg_size = 1 /* flag */ + 1 /* id */ + GDL90_MSG_LEN_TRAFFIC_REPORT + 2 /* FC */ + 1 /* flag */;
-    gdl90buf_tail = gdl90buf_head - msg_size;
-    if (c == GDL90_FLAG_BYTE && 
-        gdl90_ringbuf[ gdl90buf_tail    % GDL90_RINGBUF_SIZE] == GDL90_FLAG_BYTE &&
-        gdl90_ringbuf[(gdl90buf_tail+1) % GDL90_RINGBUF_SIZE] == MSG_ID_TRAFFIC_REPORT) {
+  case MSG_ID_TRAFFIC_REPORT:
+    if (payload >= GDL90_MSG_LEN_TRAFFIC_REPORT) {
+      parse_gdl90_traffic_report(&message, &gdl_traffic);
 
-      unsigned char *buf = (unsigned char *) &message;
-      for (uint8_t i=0; i < msg_size; i++) {
-          buf[i] = gdl90_ringbuf[(gdl90buf_tail + i) % GDL90_RINGBUF_SIZE];
-      }
+//    print_gdl90_traffic_report(&gdl_traffic);
 
-      if (decode_gdl90_traffic_report(&message, &gdl_traffic)) {
+      fo = EmptyFO;
 
-//      print_gdl90_traffic_report(&gdl_traffic);
+      fo.ID          = gdl_traffic.address;
+      fo.IDType      = gdl_traffic.addressType == ADS_B_WITH_ICAO_ADDRESS ?
+                                        ADDR_TYPE_ICAO : ADDR_TYPE_ANONYMOUS;
 
-        fo = EmptyFO;
+      fo.latitude    = gdl_traffic.latitude;
+      fo.longitude   = gdl_traffic.longitude;
+      fo.altitude    = gdl_traffic.altitude  / _GPS_FEET_PER_METER;
 
-        fo.ID          = gdl_traffic.address;
-        fo.IDType      = gdl_traffic.addressType == ADS_B_WITH_ICAO_ADDRESS ?
-                                          ADDR_TYPE_ICAO : ADDR_TYPE_ANONYMOUS;
+      fo.AlarmLevel  = gdl_traffic.trafficAlertStatus == TRAFFIC_ALERT ?
+                                          ALARM_LEVEL_LOW : ALARM_LEVEL_NONE;
+      fo.Track       = gdl_traffic.trackOrHeading;           // degrees
+      fo.ClimbRate   = gdl_traffic.verticalVelocity/ (_GPS_FEET_PER_METER * 60.0);
+      fo.TurnRate    = 0;
+      fo.GroundSpeed = gdl_traffic.horizontalVelocity * _GPS_MPS_PER_KNOT;
+      fo.AcftType    = GDL90_TO_AT(gdl_traffic.emitterCategory);
 
-        fo.latitude    = gdl_traffic.latitude;
-        fo.longitude   = gdl_traffic.longitude;
-        fo.altitude    = gdl_traffic.altitude  / _GPS_FEET_PER_METER;
+      memcpy(fo.callsign, gdl_traffic.callsign, sizeof(fo.callsign));
 
-        fo.AlarmLevel  = gdl_traffic.trafficAlertStatus == TRAFFIC_ALERT ?
-                                            ALARM_LEVEL_LOW : ALARM_LEVEL_NONE;
-        fo.Track       = gdl_traffic.trackOrHeading;           // degrees
-        fo.ClimbRate   = gdl_traffic.verticalVelocity/ (_GPS_FEET_PER_METER * 60.0);
-        fo.TurnRate    = 0;
-        fo.GroundSpeed = gdl_traffic.horizontalVelocity * _GPS_MPS_PER_KNOT;
-        fo.AcftType    = GDL90_TO_AT(gdl_traffic.emitterCategory);
+      fo.timestamp   = now();
 
-        memcpy(fo.callsign, gdl_traffic.callsign, sizeof(fo.callsign));
+      Traffic_Update(&fo);
+      Traffic_Add();
+    }
+    break;
 
-        fo.timestamp   = now();
+  case MSG_ID_OWNSHIP_REPORT:
+    if (payload >= GDL90_MSG_LEN_OWNSHIP_REPORT) {
+      parse_gdl90_traffic_report(&message, &ownship);
 
-        Traffic_Update(&fo);
-        Traffic_Add();
-      }
-    }
+//    print_gdl90_traffic_report(&ownship);
 
-    msg_size = 1 /* flag */ + 1 /* id */ + GDL90_MSG_LEN_OWNSHIP_REPORT + 2 /* FC */ + 1 /* flag */;
-    gdl90buf_tail = gdl90buf_head - msg_size;
-    if (c == GDL90_FLAG_BYTE && 
-        gdl90_ringbuf[ gdl90buf_tail    % GDL90_RINGBUF_SIZE] == GDL90_FLAG_BYTE &&
-        gdl90_ringbuf[(gdl90buf_tail+1) % GDL90_RINGBUF_SIZE] == MSG_ID_OWNSHIP_REPORT) {
+      ThisAircraft.ID          = ownship.address;
+      ThisAircraft.IDType      = ownship.addressType == ADS_B_WITH_ICAO_ADDRESS ?
+                                        ADDR_TYPE_ICAO : ADDR_TYPE_ANONYMOUS;
 
-      unsigned char *buf = (unsigned char *) &message;
-      for (uint8_t i=0; i < msg_size; i++) {
-          buf[i] = gdl90_ringbuf[(gdl90buf_tail + i) % GDL90_RINGBUF_SIZE];
-      }
+      ThisAircraft.latitude    = ownship.latitude;
+      ThisAircraft.longitude   = ownship.longitude;
 
-      if (decode_gdl90_traffic_report(&message, &ownship)) {
+      if (ownship.altitude != 101375 /* 0xFFF */ ) {
+        ThisAircraft.altitude  = ownship.altitude / _GPS_FEET_PER_METER;
+      } else if (geo_altitude.ownshipGeoAltitude != 0) {
+        ThisAircraft.altitude  = geo_altitude.ownshipGeoAltitude / _GPS_FEET_PER_METER;
+      }
 
-//      print_gdl90_traffic_report(&ownship);
+      ThisAircraft.AlarmLevel  = ownship.trafficAlertStatus == TRAFFIC_ALERT ?
+                                          ALARM_LEVEL_LOW : ALARM_LEVEL_NONE;
+      ThisAircraft.Track       = ownship.trackOrHeading;           // degrees
+      ThisAircraft.ClimbRate   = ownship.verticalVelocity/ (_GPS_FEET_PER_METER * 60.0);
+      ThisAircraft.TurnRate    = 0;
+      ThisAircraft.GroundSpeed = ownship.horizontalVelocity * _GPS_MPS_PER_KNOT;
+      ThisAircraft.AcftType    = GDL90_TO_AT(ownship.emitterCategory);
 
-        ThisAircraft.ID          = ownship.address;
-        ThisAircraft.IDType      = ownship.addressType == ADS_B_WITH_ICAO_ADDRESS ?
-                                          ADDR_TYPE_ICAO : ADDR_TYPE_ANONYMOUS;
+      memcpy(ThisAircraft.callsign, ownship.callsign, sizeof(ThisAircraft.callsign));
 
-        ThisAircraft.latitude    = ownship.latitude;
-        ThisAircraft.longitude   = ownship.longitude;
+      ThisAircraft.timestamp   = now();
 
-        if (ownship.altitude != 101375 /* 0xFFF */ ) {
-          ThisAircraft.altitude  = ownship.altitude / _GPS_FEET_PER_METER;
-        } else if (geo_altitude.ownshipGeoAltitude != 0) {
-          ThisAircraft.altitude  = geo_altitude.ownshipGeoAltitude / _GPS_FEET_PER_METER;
-        }
+      GDL90_OwnShip_TimeMarker = millis();
+    }
+    break;
 
-        ThisAircraft.AlarmLevel  = ownship.trafficAlertStatus == TRAFFIC_ALERT ?
-                                            ALARM_LEVEL_LOW : ALARM_LEVEL_NONE;
-        ThisAircraft.Track       = ownship.trackOrHeading;           // degrees
-        ThisAircraft.ClimbRate   = ownship.verticalVelocity/ (_GPS_FEET_PER_METER * 60.0);
-        ThisAircraft.TurnRate    = 0;
-        ThisAircraft.GroundSpeed = ownship.horizontalVelocity * _GPS_MPS_PER_KNOT;
-        ThisAircraft.AcftType    = GDL90_TO_AT(ownship.emitterCategory);
+  case MSG_ID_INIT:
+  case MSG_ID_UPLINK_DATA:
+  case MSG_ID_HEIGHT_ABOVE_TERRAIN:
+  case MSG_ID_BASIC_REPORT:
+  case MSG_ID_LONG_REPORT:
+  default:
+    /* not used here */
+    break;
+  }
+}
 
-        memcpy(ThisAircraft.callsign, ownship.callsign, sizeof(ThisAircraft.callsign));
+/*
+ * Assemble flag delimited frames from a stream of bytes.
+ * Escapes are undone while the bytes are stored, a frame that
+ * does not fit is dropped up to the next flag.
+ */
+static void GDL90_Parse(const uint8_t *buf, size_t size)
+{
+  uint8_t *frame = ((uint8_t *) &message) + 1 /* flag */;
+  size_t len = gdl90_frame_len;
 
-        ThisAircraft.timestamp   = now();
+  for (size_t i = 0; i < size; i++) {
+    uint8_t c = buf[i];
 
-        GDL90_OwnShip_TimeMarker = millis();
+    if (c == GDL90_FLAG_BYTE) {
+      if (len > 0 && !gdl90_overrun) {
+        GDL90_Frame(len);
       }
+      len = 0;
+      gdl90_escape  = false;
+      gdl90_overrun = false;
+    } else if (c == GDL90_CONTROL_ESCAPE) {
+      gdl90_escape = true;
+    } else if (len < GDL90_FRAME_MAX) {
+      frame[len++] = gdl90_escape ? c ^ GDL90_ESCAPE_BYTE : c;
+      gdl90_escape = false;
+    } else {
+      gdl90_overrun = true;
     }
+  }
+
+  gdl90_frame_len = len;
+}
+
+static void GDL90_Parse_Character(char c)
+{
+  GDL90_Parse((const uint8_t *) &c, 1);
 }
 
 void GDL90_setup()
@@ -290,10 +308,7 @@ void GDL90_loop()
   case CON_WIFI_UDP:
     size = SoC->WiFi_Receive_UDP((uint8_t *) UDPpacketBuffer, sizeof(UDPpacketBuffer));
     if (size > 0) {
-      for (size_t i=0; i < size; i++) {
-//        Serial.print(UDPpacketBuffer[i]);
-        GDL90_Parse_Character(UDPpacketBuffer[i]);
-      }
+      GDL90_Parse((const uint8_t *) UDPpacketBuffer, size);
       GDL90_Data_TimeMarker = millis();
     }
     break;
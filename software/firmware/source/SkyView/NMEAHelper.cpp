@@ -29,196 +29,356 @@
 
 TinyGPSPlus nmea;
 
-TinyGPSCustom T_AlarmLevel      (nmea, "PFLAA", 1);
-TinyGPSCustom T_RelativeNorth   (nmea, "PFLAA", 2);
-TinyGPSCustom T_RelativeEast    (nmea, "PFLAA", 3);
-TinyGPSCustom T_RelativeVertical(nmea, "PFLAA", 4);
-TinyGPSCustom T_IDType          (nmea, "PFLAA", 5);
-TinyGPSCustom T_ID              (nmea, "PFLAA", 6);
-TinyGPSCustom T_Track           (nmea, "PFLAA", 7);
-TinyGPSCustom T_TurnRate        (nmea, "PFLAA", 8);
-TinyGPSCustom T_GroundSpeed     (nmea, "PFLAA", 9);
-TinyGPSCustom T_ClimbRate       (nmea, "PFLAA", 10);
-TinyGPSCustom T_AcftType        (nmea, "PFLAA", 11);
-
-TinyGPSCustom S_RX              (nmea, "PFLAU", 1);
-TinyGPSCustom S_TX              (nmea, "PFLAU", 2);
-TinyGPSCustom S_GPS             (nmea, "PFLAU", 3);
-TinyGPSCustom S_Power           (nmea, "PFLAU", 4);
-TinyGPSCustom S_AlarmLevel      (nmea, "PFLAU", 5);
-TinyGPSCustom S_RelativeBearing (nmea, "PFLAU", 6);
-TinyGPSCustom S_AlarmType       (nmea, "PFLAU", 7);
-TinyGPSCustom S_RelativeVertical(nmea, "PFLAU", 8);
-TinyGPSCustom S_RelativeDistance(nmea, "PFLAU", 9);
-TinyGPSCustom S_ID              (nmea, "PFLAU", 10);
-
 status_t NMEA_Status;
 
 static unsigned long NMEA_TimeMarker = 0;
+static unsigned long NMEA_Location_TimeMarker = 0;
+static unsigned long NMEA_Altitude_TimeMarker = 0;
+static unsigned long NMEA_Date_TimeMarker = 0;
+static unsigned long NMEA_Time_TimeMarker = 0;
+static unsigned long NMEA_FLARM_TimeMarker = 0;
 
-static void NMEA_Parse_Character(char c)
+/* Sentences known to the tokenizer */
+enum
 {
-    bool isValidSentence = nmea.encode(c);
-    if (isValidSentence) {
-      if (nmea.location.isUpdated()) {
-        ThisAircraft.latitude  = nmea.location.lat();
-        ThisAircraft.longitude = nmea.location.lng();
-      }
-      if (nmea.altitude.isUpdated()) {
-        ThisAircraft.altitude = nmea.altitude.meters();
-      }
-      if (nmea.course.isUpdated()) {
-        ThisAircraft.Track = nmea.course.deg();
-      }
-      if (nmea.speed.isUpdated()) {
-        ThisAircraft.GroundSpeed = nmea.speed.knots();
+  NMEA_S_UNKNOWN,
+  NMEA_S_PFLAA,
+  NMEA_S_PFLAU,
+  NMEA_S_GGA,
+  NMEA_S_RMC
+};
+
+/*
+ * One pass over the received characters: checksum is accumulated
+ * and every field is converted as it ends, into the staging copies
+ * below. Nothing is committed unless the checksum matches.
+ */
+typedef struct nmea_tokenizer_struct {
+  bool      active;     /* between '$' and the end of the checksum */
+  uint8_t   sentence;
+  uint8_t   field;      /* 0 - sentence tag */
+  uint8_t   cs;         /* XOR of all characters between '$' and '*' */
+  int8_t    cs_digits;  /* checksum digits received, -1 - before '*' */
+  uint8_t   cs_rx;
+
+  /* current field */
+  char      tag[5];
+  uint8_t   len;
+  char      first;
+  bool      neg;
+  bool      point;
+  uint8_t   frac;       /* digits after the decimal point */
+  uint32_t  dec;        /* decimal digits, fraction included */
+  uint32_t  hex;
+  bool      hex_end;    /* a non-hex character ended the hex digits */
+} nmea_tokenizer_t;
+
+#define NMEA_FRAC_MAX   5
+
+static const uint32_t NMEA_pow10[NMEA_FRAC_MAX + 1] = {
+  1, 10, 100, 1000, 10000, 100000
+};
+
+static nmea_tokenizer_t NMEA_Tok;
+
+static traffic_t nmea_traffic;
+static status_t  nmea_status;
+
+static struct {
+  float   latitude;
+  float   longitude;
+  float   altitude;
+  float   course;
+  float   speed;
+  bool    fix;
+  bool    has_altitude;
+} nmea_gnss;
+
+static int32_t NMEA_Int()
+{
+  int32_t value = NMEA_Tok.dec / NMEA_pow10[NMEA_Tok.frac];
+
+  return NMEA_Tok.neg ? -value : value;
+}
+
+static float NMEA_Float()
+{
+  float value = (float) NMEA_Tok.dec / NMEA_pow10[NMEA_Tok.frac];
+
+  return NMEA_Tok.neg ? -value : value;
+}
+
+/* (d)ddmm.mmmmm */
+static float NMEA_Coord()
+{
+  uint32_t scale   = NMEA_pow10[NMEA_Tok.frac];
+  uint32_t deg     = NMEA_Tok.dec / (100 * scale);
+  uint32_t minutes = NMEA_Tok.dec - deg * 100 * scale;
+
+  return deg + (float) minutes / (60 * scale);
+}
+
+static void NMEA_Field_Start()
+{
+  NMEA_Tok.len     = 0;
+  NMEA_Tok.first   = 0;
+  NMEA_Tok.neg     = false;
+  NMEA_Tok.point   = false;
+  NMEA_Tok.frac    = 0;
+  NMEA_Tok.dec     = 0;
+  NMEA_Tok.hex     = 0;
+  NMEA_Tok.hex_end = false;
+}
+
+static void NMEA_Sentence()
+{
+  const char *tag = NMEA_Tok.tag;
+
+  NMEA_Tok.sentence = NMEA_S_UNKNOWN;
+
+  if (NMEA_Tok.len != sizeof(NMEA_Tok.tag)) {
+    return;
+  }
+
+  if (memcmp(tag, "PFLAA", 5) == 0) {
+    NMEA_Tok.sentence = NMEA_S_PFLAA;
+    nmea_traffic = EmptyFO;
+  } else if (memcmp(tag, "PFLAU", 5) == 0) {
+    NMEA_Tok.sentence = NMEA_S_PFLAU;
+    nmea_status = NMEA_Status;
+  } else if (tag[0] == 'G' && memcmp(tag + 2, "GGA", 3) == 0) {
+    NMEA_Tok.sentence = NMEA_S_GGA;
+    nmea_gnss.fix = false;
+    nmea_gnss.has_altitude = false;
+  } else if (tag[0] == 'G' && memcmp(tag + 2, "RMC", 3) == 0) {
+    NMEA_Tok.sentence = NMEA_S_RMC;
+    nmea_gnss.fix = false;
+  }
+}
+
+static void NMEA_Field()
+{
+  nmea_tokenizer_t *t = &NMEA_Tok;
+
+  if (t->field == 0) {
+    NMEA_Sentence();
+    return;
+  }
+
+  switch (t->sentence)
+  {
+  case NMEA_S_PFLAA:
+    switch (t->field)
+    {
+    case 1:  nmea_traffic.AlarmLevel       = NMEA_Int();   break;
+    case 2:  nmea_traffic.RelativeNorth    = NMEA_Int();   break;
+    case 3:  nmea_traffic.RelativeEast     = NMEA_Int();   break;
+    case 4:  nmea_traffic.RelativeVertical = NMEA_Int();   break;
+    case 5:  nmea_traffic.IDType           = NMEA_Int();   break;
+    case 6:  nmea_traffic.ID               = t->hex;       break;
+    case 7:  nmea_traffic.Track            = NMEA_Int();   break;
+    case 8:  nmea_traffic.TurnRate         = NMEA_Int();   break;
+    case 9:  nmea_traffic.GroundSpeed      = NMEA_Int();   break;
+    case 10: nmea_traffic.ClimbRate        = NMEA_Float(); break;
+    case 11: nmea_traffic.AcftType         = t->hex;       break;
+    default: break;
+    }
+    break;
+
+  case NMEA_S_PFLAU:
+    switch (t->field)
+    {
+    case 1:  nmea_status.RX                = NMEA_Int();   break;
+    case 2:  nmea_status.TX                = NMEA_Int();   break;
+    case 3:  nmea_status.GPS               = NMEA_Int();   break;
+    case 4:  nmea_status.Power             = NMEA_Int();   break;
+    case 5:  nmea_status.AlarmLevel        = NMEA_Int();   break;
+    case 6:  nmea_status.RelativeBearing   = NMEA_Int();   break;
+    case 7:  nmea_status.AlarmType         = NMEA_Int();   break;
+    case 8:  nmea_status.RelativeVertical  = NMEA_Int();   break;
+    case 9:  nmea_status.RelativeDistance  = NMEA_Int();   break;
+    case 10: nmea_status.ID                = t->hex;       break;
+    default: break;
+    }
+    break;
+
+  case NMEA_S_GGA:
+    switch (t->field)
+    {
+    case 2:  nmea_gnss.latitude  = NMEA_Coord();                   break;
+    case 3:  if (t->first == 'S') nmea_gnss.latitude  = -nmea_gnss.latitude;  break;
+    case 4:  nmea_gnss.longitude = NMEA_Coord();                   break;
+    case 5:  if (t->first == 'W') nmea_gnss.longitude = -nmea_gnss.longitude; break;
+    case 6:  nmea_gnss.fix = t->len > 0 && t->first != '0';        break;
+    case 9:  nmea_gnss.altitude = NMEA_Float();
+             nmea_gnss.has_altitude = t->len > 0;                  break;
+    default: break;
+    }
+    break;
+
+  case NMEA_S_RMC:
+    switch (t->field)
+    {
+    case 2:  nmea_gnss.fix = t->first == 'A';                      break;
+    case 3:  nmea_gnss.latitude  = NMEA_Coord();                   break;
+    case 4:  if (t->first == 'S') nmea_gnss.latitude  = -nmea_gnss.latitude;  break;
+    case 5:  nmea_gnss.longitude = NMEA_Coord();                   break;
+    case 6:  if (t->first == 'W') nmea_gnss.longitude = -nmea_gnss.longitude; break;
+    case 7:  nmea_gnss.speed  = NMEA_Float();                      break;
+    case 8:  nmea_gnss.course = NMEA_Float();                      break;
+    default: break;
+    }
+    break;
+
+  case NMEA_S_UNKNOWN:
+  default:
+    break;
+  }
+}
+
+/* Checksum matched, take over what the sentence carried */
+static void NMEA_Commit()
+{
+  switch (NMEA_Tok.sentence)
+  {
+  case NMEA_S_PFLAA:
+    fo = nmea_traffic;
+    fo.timestamp = now();
+
+    Traffic_Add();
+    break;
+
+  case NMEA_S_PFLAU:
+    NMEA_Status = nmea_status;
+    NMEA_Status.timestamp = now();
+    NMEA_FLARM_TimeMarker = millis();
+    break;
+
+  case NMEA_S_GGA:
+    NMEA_Time_TimeMarker = millis();
+    if (nmea_gnss.fix) {
+      ThisAircraft.latitude  = nmea_gnss.latitude;
+      ThisAircraft.longitude = nmea_gnss.longitude;
+      NMEA_Location_TimeMarker = millis();
+      if (nmea_gnss.has_altitude) {
+        ThisAircraft.altitude = nmea_gnss.altitude;
+        NMEA_Altitude_TimeMarker = millis();
       }
-      if (T_ID.isUpdated()) {
-        fo = EmptyFO;
+    }
+    break;
 
-//        Serial.print(F(" ID=")); Serial.print(ID.value());
+  case NMEA_S_RMC:
+    NMEA_Time_TimeMarker = NMEA_Date_TimeMarker = millis();
+    if (nmea_gnss.fix) {
+      ThisAircraft.latitude    = nmea_gnss.latitude;
+      ThisAircraft.longitude   = nmea_gnss.longitude;
+      ThisAircraft.Track       = nmea_gnss.course;
+      ThisAircraft.GroundSpeed = nmea_gnss.speed;
+      NMEA_Location_TimeMarker = millis();
+    }
+    break;
 
-        fo.ID = strtol(T_ID.value(), NULL, 16);
+  case NMEA_S_UNKNOWN:
+  default:
+    break;
+  }
+}
 
-#if 0
-        Serial.print(F(" ID="));
-        Serial.print((fo.ID >> 16) & 0xFF, HEX);
-        Serial.print((fo.ID >>  8) & 0xFF, HEX);
-        Serial.print((fo.ID      ) & 0xFF, HEX);
-        Serial.println();
-#endif
+static void NMEA_Parse(const char *buf, size_t size)
+{
+  nmea_tokenizer_t *t = &NMEA_Tok;
 
-        if (T_AlarmLevel.isUpdated())
-        {
-//          Serial.print(F(" AlarmLevel=")); Serial.print(T_AlarmLevel.value());
-          fo.AlarmLevel = atoi(T_AlarmLevel.value());
-//          Serial.print(F(" AlarmLevel=")); Serial.println(fo.AlarmLevel);
-        }
-        if (T_RelativeNorth.isUpdated())
-        {
-//          Serial.print(F(" RelativeNorth=")); Serial.print(T_RelativeNorth.value());
-          fo.RelativeNorth = atoi(T_RelativeNorth.value());
-//          Serial.print(F(" RelativeNorth=")); Serial.println(fo.RelativeNorth);
-        }
-        if (T_RelativeEast.isUpdated())
-        {
-//          Serial.print(F(" RelativeEast=")); Serial.print(T_RelativeEast.value());
-          fo.RelativeEast = atoi(T_RelativeEast.value());
-//          Serial.print(F(" RelativeEast=")); Serial.println(fo.RelativeEast);
-        }
-        if (T_RelativeVertical.isUpdated())
-        {
-//          Serial.print(F(" RelativeVertical=")); Serial.print(T_RelativeVertical.value());
-          fo.RelativeVertical = atoi(T_RelativeVertical.value());
-//          Serial.print(F(" RelativeVertical=")); Serial.println(fo.RelativeVertical);
-        }
-        if (T_IDType.isUpdated())
-        {
-//          Serial.print(F(" IDType=")); Serial.print(T_IDType.value());
-          fo.IDType = atoi(T_IDType.value());
-//          Serial.print(F(" IDType=")); Serial.println(fo.IDType);
-        }
-        if (T_Track.isUpdated())
-        {
-//          Serial.print(F(" Track=")); Serial.print(T_Track.value());
-          fo.Track = atoi(T_Track.value());
-//          Serial.print(F(" Track=")); Serial.println(fo.Track);
-        }
-        if (T_TurnRate.isUpdated())
-        {
-//          Serial.print(F(" TurnRate=")); Serial.print(T_TurnRate.value());
-          fo.TurnRate = atoi(T_TurnRate.value());
-//          Serial.print(F(" TurnRate=")); Serial.println(fo.TurnRate);
-        }
-        if (T_GroundSpeed.isUpdated())
-        {
-//          Serial.print(F(" GroundSpeed=")); Serial.print(T_GroundSpeed.value());
-          fo.GroundSpeed = atoi(T_GroundSpeed.value());
-//          Serial.print(F(" GroundSpeed=")); Serial.println(fo.GroundSpeed);
-        }
-        if (T_ClimbRate.isUpdated())
-        {
-//          Serial.print(F(" ClimbRate=")); Serial.println(T_ClimbRate.value());
-          /* TBD */
-        }
-        if (T_AcftType.isUpdated())
-        {
-//          Serial.print(F(" AcftType=")); Serial.print(T_AcftType.value());
-          fo.AcftType = atoi(T_AcftType.value());
-//          Serial.print(F(" AcftType=")); Serial.println(fo.AcftType);
-        }
+  for (size_t i = 0; i < size; i++) {
+    char c = buf[i];
 
-        fo.timestamp = now();
+    if (c == '$') {
+      t->active    = true;
+      t->field     = 0;
+      t->cs        = 0;
+      t->cs_digits = -1;
+      NMEA_Field_Start();
+      continue;
+    }
 
-        Traffic_Add();
+    if (!t->active) {
+      continue;
+    }
 
-      } else if (S_RX.isUpdated()) {
+    if (t->cs_digits >= 0) {
+      uint8_t nibble;
 
-        NMEA_Status.timestamp = now();
-        NMEA_Status.RX = atoi(S_RX.value());
+      if      (c >= '0' && c <= '9') { nibble = c - '0';      }
+      else if (c >= 'A' && c <= 'F') { nibble = c - 'A' + 10; }
+      else if (c >= 'a' && c <= 'f') { nibble = c - 'a' + 10; }
+      else { t->active = false; continue; }
 
-        if (S_TX.isUpdated())
-        {
-//          Serial.print(F(" TX=")); Serial.print(S_TX.value());
-          NMEA_Status.TX = atoi(S_TX.value());
-//          Serial.print(F(" TX=")); Serial.println(NMEA_Status.TX);
-        }
-        if (S_GPS.isUpdated())
-        {
-//          Serial.print(F(" GPS=")); Serial.print(S_GPS.value());
-          NMEA_Status.GPS = atoi(S_GPS.value());
-//          Serial.print(F(" GPS=")); Serial.println(NMEA_Status.GPS);
-        }
-        if (S_Power.isUpdated())
-        {
-//          Serial.print(F(" Power=")); Serial.print(S_Power.value());
-          NMEA_Status.Power = atoi(S_Power.value());
-//          Serial.print(F(" Power=")); Serial.println(NMEA_Status.Power);
-        }
-        if (S_AlarmLevel.isUpdated())
-        {
-//          Serial.print(F(" AlarmLevel=")); Serial.print(S_AlarmLevel.value());
-          NMEA_Status.AlarmLevel = atoi(S_AlarmLevel.value());
-//          Serial.print(F(" AlarmLevel=")); Serial.println(NMEA_Status.AlarmLevel);
-        }
-        if (S_RelativeBearing.isUpdated())
-        {
-//          Serial.print(F(" RelativeBearing=")); Serial.print(S_RelativeBearing.value());
-          NMEA_Status.RelativeBearing = atoi(S_RelativeBearing.value());
-//          Serial.print(F(" RelativeBearing=")); Serial.println(NMEA_Status.RelativeBearing);
-        }
-        if (S_AlarmType.isUpdated())
-        {
-//          Serial.print(F(" AlarmType=")); Serial.print(S_AlarmType.value());
-          NMEA_Status.AlarmType = atoi(S_AlarmType.value());
-//          Serial.print(F(" AlarmType=")); Serial.println(NMEA_Status.AlarmType);
-        }
-        if (S_RelativeVertical.isUpdated())
-        {
-//          Serial.print(F(" RelativeVertical=")); Serial.print(S_RelativeVertical.value());
-          NMEA_Status.RelativeVertical = atoi(S_RelativeVertical.value());
-//          Serial.print(F(" RelativeVertical=")); Serial.println(NMEA_Status.RelativeVertical);
+      t->cs_rx = (t->cs_rx << 4) | nibble;
+      if (++t->cs_digits == 2) {
+        if (t->cs_rx == t->cs) {
+          NMEA_Commit();
         }
-        if (S_RelativeDistance.isUpdated())
-        {
-//          Serial.print(F(" RelativeDistance=")); Serial.print(S_RelativeDistance.value());
-          NMEA_Status.RelativeDistance = strtol(S_RelativeDistance.value(), NULL, 10);
-//          Serial.print(F(" RelativeDistance=")); Serial.println(NMEA_Status.RelativeDistance);
-        }
-        if (S_ID.isUpdated())
-        {
-//          Serial.print(F(" ID=")); Serial.print(S_ID.value());
-          NMEA_Status.ID = strtol(S_ID.value(), NULL, 16);
-#if 0
-          Serial.print(F(" ID="));
-          Serial.print((NMEA_Status.ID >> 16) & 0xFF, HEX);
-          Serial.print((NMEA_Status.ID >>  8) & 0xFF, HEX);
-          Serial.print((NMEA_Status.ID      ) & 0xFF, HEX);
-          Serial.println();
-#endif
+        t->active = false;
+      }
+      continue;
+    }
+
+    if (c == '*') {
+      NMEA_Field();
+      t->cs_digits = 0;
+      t->cs_rx     = 0;
+      continue;
+    }
+
+    if (c < ' ' || c > '~') {
+      /* line ended before the checksum */
+      t->active = false;
+      continue;
+    }
+
+    t->cs ^= c;
+
+    if (c == ',') {
+      NMEA_Field();
+      t->field++;
+      NMEA_Field_Start();
+      continue;
+    }
+
+    if (t->len == 0) {
+      t->first = c;
+    }
+
+    if (t->field == 0) {
+      if (t->len < sizeof(t->tag)) {
+        t->tag[t->len] = c;
+      }
+    } else {
+      if (c >= '0' && c <= '9') {
+        if (!t->point) {
+          t->dec = t->dec * 10 + (c - '0');
+        } else if (t->frac < NMEA_FRAC_MAX) {
+          t->dec = t->dec * 10 + (c - '0');
+          t->frac++;
         }
+      } else if (c == '.') {
+        t->point = true;
+      } else if (c == '-') {
+        t->neg = true;
+      }
+
+      /* SoftRF sends the PFLAA ID as "<ID>!<callsign>" */
+      if (!t->hex_end) {
+        if      (c >= '0' && c <= '9') { t->hex = (t->hex << 4) | (c - '0');      }
+        else if (c >= 'A' && c <= 'F') { t->hex = (t->hex << 4) | (c - 'A' + 10); }
+        else if (c >= 'a' && c <= 'f') { t->hex = (t->hex << 4) | (c - 'a' + 10); }
+        else                           { t->hex_end = true; }
       }
     }
+
+    if (t->len < UINT8_MAX) {
+      t->len++;
+    }
+  }
 }
 
 void NMEA_setup()
@@ -275,15 +435,20 @@ void NMEA_setup()
 
 void NMEA_loop()
 {
+  char buf[NMEA_CHUNK_SIZE];
   size_t size;
 
   switch (settings->connection)
   {
   case CON_SERIAL:
-    while (SerialInput.available() > 0) {
-      char c = SerialInput.read();
-      Serial.print(c);
-      NMEA_Parse_Character(c);
+    for (size = 0; size < sizeof(buf) && SerialInput.available() > 0; size++) {
+      buf[size] = SerialInput.read();
+    }
+    if (size > 0) {
+#if !defined(EXCLUDE_NMEA_ECHO)
+      Serial.write((uint8_t *) buf, size);
+#endif
+      NMEA_Parse(buf, size);
       NMEA_TimeMarker = millis();
     }
     /* read data from microUSB port */
@@ -291,10 +456,11 @@ void NMEA_loop()
     if ((void *) &Serial != (void *) &SerialInput)
 #endif
     {
-      while (Serial.available() > 0) {
-        char c = Serial.read();
-//        Serial.print(c);
-        NMEA_Parse_Character(c);
+      for (size = 0; size < sizeof(buf) && Serial.available() > 0; size++) {
+        buf[size] = Serial.read();
+      }
+      if (size > 0) {
+        NMEA_Parse(buf, size);
         NMEA_TimeMarker = millis();
       }
     }
@@ -302,20 +468,24 @@ void NMEA_loop()
   case CON_WIFI_UDP:
     size = SoC->WiFi_Receive_UDP((uint8_t *) UDPpacketBuffer, sizeof(UDPpacketBuffer));
     if (size > 0) {
-      for (size_t i=0; i < size; i++) {
-        Serial.print(UDPpacketBuffer[i]);
-        NMEA_Parse_Character(UDPpacketBuffer[i]);
-      }
+#if !defined(EXCLUDE_NMEA_ECHO)
+      Serial.write((uint8_t *) UDPpacketBuffer, size);
+#endif
+      NMEA_Parse(UDPpacketBuffer, size);
       NMEA_TimeMarker = millis();
     }
     break;
   case CON_BLUETOOTH_SPP:
   case CON_BLUETOOTH_LE:
     if (SoC->Bluetooth) {
-      while (SoC->Bluetooth->available() > 0) {
-        char c = SoC->Bluetooth->read();
-        Serial.print(c);
-        NMEA_Parse_Character(c);
+      for (size = 0; size < sizeof(buf) && SoC->Bluetooth->available() > 0; size++) {
+        buf[size] = SoC->Bluetooth->read();
+      }
+      if (size > 0) {
+#if !defined(EXCLUDE_NMEA_ECHO)
+        Serial.write((uint8_t *) buf, size);
+#endif
+        NMEA_Parse(buf, size);
         NMEA_TimeMarker = millis();
       }
     }
@@ -334,10 +504,23 @@ bool NMEA_isConnected()
 
 bool NMEA_hasGNSS()
 {
-  return (nmea.time.isValid() && nmea.time.age() < NMEA_EXP_TIME);
+  return (NMEA_Time_TimeMarker > 0 &&
+         (millis() - NMEA_Time_TimeMarker) < NMEA_EXP_TIME);
+}
+
+bool NMEA_hasFix()
+{
+  unsigned long ms = millis();
+
+  return (NMEA_Location_TimeMarker > 0 && NMEA_Altitude_TimeMarker > 0 &&
+          NMEA_Date_TimeMarker > 0                                     &&
+         (ms - NMEA_Location_TimeMarker) <= NMEA_EXP_TIME              &&
+         (ms - NMEA_Altitude_TimeMarker) <= NMEA_EXP_TIME              &&
+         (ms - NMEA_Date_TimeMarker)     <= NMEA_EXP_TIME);
 }
 
 bool NMEA_hasFLARM()
 {
-  return (S_RX.isValid() && S_RX.age() < NMEA_EXP_TIME);
+  return (NMEA_FLARM_TimeMarker > 0 &&
+         (millis() - NMEA_FLARM_TimeMarker) < NMEA_EXP_TIME);
 }
@@ -107,24 +107,23 @@ typedef struct nmea_status_struct {
 #define NMEA_UDP_PORT     10110
 #define NMEA_TCP_PORT     2000
 
+/* bytes taken from a serial or Bluetooth link per NMEA_loop() pass */
+#define NMEA_CHUNK_SIZE   128
+
 /*
  * Both GGA and RMC NMEA sentences are required.
  * No fix when any of them is missing or lost.
  * Valid date is critical for legacy protocol (only).
  */
 #define NMEA_EXP_TIME  4500 /* 4.5 seconds */
-#define isValidGNSSFix()  ( nmea.location.isValid()               && \
-                            nmea.altitude.isValid()               && \
-                            nmea.date.isValid()                   && \
-                           (nmea.location.age() <= NMEA_EXP_TIME) && \
-                           (nmea.altitude.age() <= NMEA_EXP_TIME) && \
-                           (nmea.date.age()     <= NMEA_EXP_TIME))
+#define isValidGNSSFix()  NMEA_hasFix()
 
 void NMEA_setup(void);
 void NMEA_loop(void);
 
 bool NMEA_isConnected(void);
 bool NMEA_hasGNSS(void);
+bool NMEA_hasFix(void);
 bool NMEA_hasFLARM(void);
 
 extern status_t NMEA_Status;
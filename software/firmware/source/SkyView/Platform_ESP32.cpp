@@ -30,6 +30,7 @@
 #include "EEPROMHelper.h"
 #include "WiFiHelper.h"
 #include "BluetoothHelper.h"
+#include "RegistryHelper.h"
 
 #include "SkyView.h"
 
@@ -116,6 +117,13 @@ static sqlite3 *fln_db  = NULL;
 static sqlite3 *ogn_db  = NULL;
 static sqlite3 *icao_db = NULL;
 
+/* prepared once per (database, idpref), kept until DB_fini() */
+static sqlite3_stmt *ESP32_DB_stmt[3][ID_MAM + 1];
+
+static registry_t ESP32_Registry;
+static File       RegistryFile;
+static bool       ESP32_Registry_ok = false;
+
 static uint8_t sdcard_files_to_open = 0;
 
 SPIClass uSD_SPI(HSPI);
@@ -432,6 +440,12 @@ static int ESP32_WiFi_clients_count()
   }
 }
 
+static bool ESP32_Registry_read(void *ctx, uint32_t offset, void *buf, size_t size)
+{
+  return RegistryFile.seek(offset) &&
+         RegistryFile.read((uint8_t *) buf, size) == size;
+}
+
 static bool ESP32_DB_init()
 {
   bool rval = false;
@@ -445,6 +459,7 @@ static bool ESP32_DB_init()
   sdcard_files_to_open += (settings->adb   == DB_FLN    ? 1 : 0);
   sdcard_files_to_open += (settings->adb   == DB_OGN    ? 1 : 0);
   sdcard_files_to_open += (settings->adb   == DB_ICAO   ? 1 : 0);
+  sdcard_files_to_open += (settings->adb   != DB_NONE   ? 1 : 0); /* registry */
   sdcard_files_to_open += (settings->voice != VOICE_OFF ? 1 : 0);
 
   if (!SD.begin(SOC_SD_PIN_SS_T5S, uSD_SPI, 4000000, "/sd", sdcard_files_to_open)) {
@@ -456,6 +471,16 @@ static bool ESP32_DB_init()
     return rval;
   }
 
+  /* one registry file, two sector reads per lookup */
+  RegistryFile = SD.open("/Aircrafts/" REGISTRY_FILE);
+  if (RegistryFile) {
+    if (Registry_open(&ESP32_Registry, ESP32_Registry_read, NULL)) {
+      ESP32_Registry_ok = true;
+      return true;
+    }
+    RegistryFile.close();
+  }
+
   sqlite3_initialize();
 
   if (settings->adb == DB_FLN) {
@@ -497,12 +522,11 @@ static bool ESP32_DB_init()
 
 static bool ESP32_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
 {
-  sqlite3_stmt *stmt;
-  char *query = NULL;
-  int error;
+  sqlite3_stmt **stmt;
   bool rval = false;
   const char *reg_key, *db_key;
   sqlite3 *db;
+  uint8_t idpref = settings->idpref <= ID_MAM ? settings->idpref : ID_REG;
 
   if (settings->adapter != ADAPTER_TTGO_T5S) {
     return false;
@@ -510,6 +534,10 @@ static bool ESP32_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
 
 #if !defined(BUILD_SKYVIEW_HD)
 
+  if (ESP32_Registry_ok) {
+    return Registry_query(&ESP32_Registry, type, id, idpref, buf, size);
+  }
+
   switch (type)
   {
   case DB_OGN:
@@ -528,6 +556,7 @@ static bool ESP32_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     }
     db_key  = "devices";
     db      = ogn_db;
+    stmt    = &ESP32_DB_stmt[1][idpref];
     break;
   case DB_ICAO:
     switch (settings->idpref)
@@ -545,6 +574,7 @@ static bool ESP32_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     }
     db_key  = "aircrafts";
     db      = icao_db;
+    stmt    = &ESP32_DB_stmt[2][idpref];
     break;
   case DB_FLN:
   default:
@@ -563,6 +593,7 @@ static bool ESP32_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     }
     db_key  = "aircrafts";
     db      = fln_db;
+    stmt    = &ESP32_DB_stmt[0][idpref];
     break;
   }
 
@@ -570,22 +601,28 @@ static bool ESP32_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     return false;
   }
 
-  error = asprintf(&query, "select %s from %s where id = %d",reg_key, db_key, id);
+  if (*stmt == NULL) {
+    char query[64];
 
-  if (error == -1) {
-    return false;
+    snprintf(query, sizeof(query), "select %s from %s where id = ?",
+             reg_key, db_key);
+
+    if (sqlite3_prepare_v2(db, query, -1, stmt, NULL) != SQLITE_OK) {
+      *stmt = NULL;
+      return false;
+    }
   }
 
-  sqlite3_prepare_v2(db, query, strlen(query), &stmt, NULL);
+  sqlite3_bind_int(*stmt, 1, id);
 
-  while (sqlite3_step(stmt) != SQLITE_DONE) {
-    if (sqlite3_column_type(stmt, 0) == SQLITE3_TEXT) {
+  while (sqlite3_step(*stmt) == SQLITE_ROW) {
+    if (sqlite3_column_type(*stmt, 0) == SQLITE3_TEXT) {
 
-      size_t len = strlen((char *) sqlite3_column_text(stmt, 0));
+      size_t len = strlen((char *) sqlite3_column_text(*stmt, 0));
 
       if (len > 0) {
         len = len > size ? size : len;
-        strncpy(buf, (char *) sqlite3_column_text(stmt, 0), len);
+        strncpy(buf, (char *) sqlite3_column_text(*stmt, 0), len);
         if (len < size) {
           buf[len] = 0;
         } else if (len == size) {
@@ -596,9 +633,7 @@ static bool ESP32_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     }
   }
 
-  sqlite3_finalize(stmt);
-
-  free(query);
+  sqlite3_reset(*stmt);
 
 #endif /* BUILD_SKYVIEW_HD */
 
@@ -610,7 +645,22 @@ static void ESP32_DB_fini()
 #if !defined(BUILD_SKYVIEW_HD)
   if (settings->adapter == ADAPTER_TTGO_T5S) {
 
+    if (ESP32_Registry_ok) {
+      Registry_close(&ESP32_Registry);
+      RegistryFile.close();
+      ESP32_Registry_ok = false;
+    }
+
     if (settings->adb != DB_NONE) {
+      for (int i = 0; i < 3; i++) {
+        for (int j = 0; j <= ID_MAM; j++) {
+          if (ESP32_DB_stmt[i][j] != NULL) {
+            sqlite3_finalize(ESP32_DB_stmt[i][j]);
+            ESP32_DB_stmt[i][j] = NULL;
+          }
+        }
+      }
+
       if (fln_db != NULL) {
         sqlite3_close(fln_db);
       }
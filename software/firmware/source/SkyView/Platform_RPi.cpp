@@ -31,6 +31,10 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sqlite3.h>
 
 #include <ArduinoJson.h>
@@ -45,6 +49,7 @@
 #include "JSONHelper.h"
 #include "EPDHelper.h"
 #include "OLEDHelper.h"
+#include "RegistryHelper.h"
 
 #include "SkyView.h"
 
@@ -101,6 +106,13 @@ static sqlite3 *fln_db;
 static sqlite3 *ogn_db;
 static sqlite3 *icao_db;
 
+/* prepared once per (database, idpref), kept until DB_fini() */
+static sqlite3_stmt *RPi_DB_stmt[3][ID_MAM + 1];
+
+static registry_t     RPi_Registry;
+static const uint8_t *RPi_Registry_map  = NULL;
+static size_t         RPi_Registry_size = 0;
+
 std::string input_line;
 
 //-------------------------------------------------------------------------
@@ -262,8 +274,59 @@ static int RPi_WiFi_clients_count()
   return 0;
 }
 
+static bool RPi_Registry_read(void *ctx, uint32_t offset, void *buf, size_t size)
+{
+  if (offset > RPi_Registry_size || size > RPi_Registry_size - offset) {
+    return false;
+  }
+
+  memcpy(buf, RPi_Registry_map + offset, size);
+
+  return true;
+}
+
+static bool RPi_Registry_open()
+{
+  struct stat st;
+  int fd = open("Aircrafts/" REGISTRY_FILE, O_RDONLY);
+
+  if (fd < 0) {
+    return false;
+  }
+
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if (map != MAP_FAILED) {
+      RPi_Registry_map  = (const uint8_t *) map;
+      RPi_Registry_size = st.st_size;
+    }
+  }
+  close(fd);
+
+  if (RPi_Registry_map == NULL) {
+    return false;
+  }
+
+  if (!Registry_open(&RPi_Registry, RPi_Registry_read, NULL)) {
+    printf("Bad aircraft registry " REGISTRY_FILE "\n");
+    munmap((void *) RPi_Registry_map, RPi_Registry_size);
+    RPi_Registry_map = NULL;
+    return false;
+  }
+
+  printf("Aircraft registry: %u records\n", RPi_Registry.hdr.records);
+
+  return true;
+}
+
 static bool RPi_DB_init()
 {
+  /* one mapped file instead of the three SQLite databases */
+  if (RPi_Registry_open()) {
+    return true;
+  }
+
   sqlite3_open("Aircrafts/fln.db", &fln_db);
 
   if (fln_db == NULL)
@@ -296,12 +359,15 @@ static bool RPi_DB_init()
 
 static bool RPi_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
 {
-  sqlite3_stmt *stmt;
-  char *query = NULL;
-  int error;
+  sqlite3_stmt **stmt;
   bool rval = false;
   const char *reg_key, *db_key;
   sqlite3 *db;
+  uint8_t idpref = settings->idpref <= ID_MAM ? settings->idpref : ID_REG;
+
+  if (RPi_Registry_map != NULL) {
+    return Registry_query(&RPi_Registry, type, id, idpref, buf, size);
+  }
 
   switch (type)
   {
@@ -321,6 +387,7 @@ static bool RPi_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     }
     db_key  = "devices";
     db      = ogn_db;
+    stmt    = &RPi_DB_stmt[1][idpref];
     break;
   case DB_ICAO:
     switch (settings->idpref)
@@ -338,6 +405,7 @@ static bool RPi_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     }
     db_key  = "aircrafts";
     db      = icao_db;
+    stmt    = &RPi_DB_stmt[2][idpref];
     break;
   case DB_FLN:
   default:
@@ -356,6 +424,7 @@ static bool RPi_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     }
     db_key  = "aircrafts";
     db      = fln_db;
+    stmt    = &RPi_DB_stmt[0][idpref];
     break;
   }
 
@@ -363,22 +432,28 @@ static bool RPi_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     return false;
   }
 
-  error = asprintf(&query, "select %s from %s where id = %d",reg_key, db_key, id);
+  if (*stmt == NULL) {
+    char query[64];
 
-  if (error == -1) {
-    return false;
+    snprintf(query, sizeof(query), "select %s from %s where id = ?",
+             reg_key, db_key);
+
+    if (sqlite3_prepare_v2(db, query, -1, stmt, NULL) != SQLITE_OK) {
+      *stmt = NULL;
+      return false;
+    }
   }
 
-  sqlite3_prepare_v2(db, query, strlen(query), &stmt, NULL);
+  sqlite3_bind_int(*stmt, 1, id);
 
-  while (sqlite3_step(stmt) != SQLITE_DONE) {
-    if (sqlite3_column_type(stmt, 0) == SQLITE3_TEXT) {
+  while (sqlite3_step(*stmt) == SQLITE_ROW) {
+    if (sqlite3_column_type(*stmt, 0) == SQLITE3_TEXT) {
 
-      size_t len = strlen((char *) sqlite3_column_text(stmt, 0));
+      size_t len = strlen((char *) sqlite3_column_text(*stmt, 0));
 
       if (len > 0) {
         len = len > size ? size : len;
-        strncpy(buf, (char *) sqlite3_column_text(stmt, 0), len);
+        strncpy(buf, (char *) sqlite3_column_text(*stmt, 0), len);
         if (len < size) {
           buf[len] = 0;
         } else if (len == size) {
@@ -389,14 +464,28 @@ static bool RPi_DB_query(uint8_t type, uint32_t id, char *buf, size_t size)
     }
   }
 
-  sqlite3_finalize(stmt);
-  free(query);
+  sqlite3_reset(*stmt);
 
   return rval;
 }
 
 static void RPi_DB_fini()
 {
+  if (RPi_Registry_map != NULL) {
+    Registry_close(&RPi_Registry);
+    munmap((void *) RPi_Registry_map, RPi_Registry_size);
+    RPi_Registry_map = NULL;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j <= ID_MAM; j++) {
+      if (RPi_DB_stmt[i][j] != NULL) {
+        sqlite3_finalize(RPi_DB_stmt[i][j]);
+        RPi_DB_stmt[i][j] = NULL;
+      }
+    }
+  }
+
   if (fln_db != NULL) {
     sqlite3_close(fln_db);
   }
@@ -0,0 +1,175 @@
+/*
+ * RegistryHelper.cpp
+ * Copyright (C) 2019-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SoCHelper.h"
+#include "RegistryHelper.h"
+
+#include "SkyView.h"
+
+/* last slot in keys[0 .. count) that is <= key, -1 if none */
+static int Registry_floor(const uint32_t *keys, int count, uint32_t key)
+{
+  int lo = 0, hi = count;
+
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+
+    if (keys[mid] <= key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return lo - 1;
+}
+
+bool Registry_open(registry_t *reg, registry_read_t read, void *ctx)
+{
+  reg->read = read;
+  reg->ctx  = ctx;
+  reg->top  = NULL;
+
+  if (!read(ctx, 0, &reg->hdr, sizeof(reg->hdr))          ||
+      memcmp(reg->hdr.magic, REGISTRY_MAGIC, 4) != 0        ||
+      reg->hdr.version     != REGISTRY_VERSION              ||
+      reg->hdr.record_size != sizeof(registry_record_t)     ||
+      reg->hdr.top_count   == 0                             ||
+      reg->hdr.top_count   >  REGISTRY_TOP_MAX) {
+    return false;
+  }
+
+  size_t top_size = reg->hdr.top_count * sizeof(uint32_t);
+
+  reg->top = (uint32_t *) malloc(top_size);
+  if (reg->top == NULL) {
+    return false;
+  }
+
+  if (!read(ctx, reg->hdr.top_offset, reg->top, top_size)) {
+    Registry_close(reg);
+    return false;
+  }
+
+  return true;
+}
+
+bool Registry_find(registry_t *reg, uint8_t db, uint32_t id,
+                   registry_record_t *rec)
+{
+  uint32_t keys[REGISTRY_KEYS_PER_SECTOR];
+  registry_record_t recs[REGISTRY_RECS_PER_SECTOR];
+  uint32_t key = REGISTRY_KEY(db, id);
+
+  if (reg->top == NULL) {
+    return false;
+  }
+
+  int i = Registry_floor(reg->top, reg->hdr.top_count, key);
+  if (i < 0) {
+    return false;
+  }
+
+  if (!reg->read(reg->ctx,
+                 reg->hdr.index_offset + i * REGISTRY_SECTOR_SIZE,
+                 keys, sizeof(keys))) {
+    return false;
+  }
+
+  int s = Registry_floor(keys, REGISTRY_KEYS_PER_SECTOR, key);
+  if (s < 0) {
+    return false;
+  }
+
+  uint32_t sector = i * REGISTRY_KEYS_PER_SECTOR + s;
+
+  if (!reg->read(reg->ctx,
+                 reg->hdr.data_offset + sector * REGISTRY_SECTOR_SIZE,
+                 recs, sizeof(recs))) {
+    return false;
+  }
+
+  for (int r = 0; r < (int) REGISTRY_RECS_PER_SECTOR; r++) {
+    if (recs[r].key == key) {
+      *rec = recs[r];
+      return true;
+    }
+    if (recs[r].key > key) {
+      break;
+    }
+  }
+
+  return false;
+}
+
+/* same columns as the SQLite lookups, by settings->idpref */
+bool Registry_query(registry_t *reg, uint8_t db, uint32_t id, uint8_t idpref,
+                    char *buf, size_t size)
+{
+  registry_record_t rec;
+  const char *field;
+  size_t field_size;
+
+  if (db != DB_OGN && db != DB_ICAO) {
+    db = DB_FLN;
+  }
+
+  if (size == 0 || !Registry_find(reg, db, id, &rec)) {
+    return false;
+  }
+
+  switch (idpref)
+  {
+  case ID_TAIL:
+    field = rec.tail;
+    field_size = sizeof(rec.tail);
+    break;
+  case ID_MAM:
+    field = rec.type;
+    field_size = sizeof(rec.type);
+    break;
+  case ID_REG:
+  default:
+    field = rec.registration;
+    field_size = sizeof(rec.registration);
+    break;
+  }
+
+  size_t len = strnlen(field, field_size);
+
+  if (len == 0) {
+    return false;
+  }
+
+  len = len < size ? len : size - 1;
+  memcpy(buf, field, len);
+  buf[len] = 0;
+
+  return true;
+}
+
+void Registry_close(registry_t *reg)
+{
+  if (reg->top != NULL) {
+    free(reg->top);
+    reg->top = NULL;
+  }
+}
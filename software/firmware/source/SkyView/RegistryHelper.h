@@ -0,0 +1,82 @@
+/*
+ * RegistryHelper.h
+ * Copyright (C) 2019-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REGISTRYHELPER_H
+#define REGISTRYHELPER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Aircraft registry, one file for FlarmNet, OGN and ICAO data.
+ * Built offline by software/utils/acreg.py, little endian.
+ *
+ *  0             header, padded to a sector
+ *  top_offset    first key of every index sector (kept in RAM)
+ *  index_offset  first key of every data sector, 128 keys per sector
+ *  data_offset   records sorted by key, 8 per sector
+ *
+ * A lookup reads one index sector and one data sector.
+ * Unused key slots and records in the last sectors are 0xFFFFFFFF.
+ */
+#define REGISTRY_FILE           "acreg.bin"
+#define REGISTRY_MAGIC          "SRFA"
+#define REGISTRY_VERSION        1
+#define REGISTRY_SECTOR_SIZE    512
+#define REGISTRY_KEYS_PER_SECTOR (REGISTRY_SECTOR_SIZE / sizeof(uint32_t))
+#define REGISTRY_RECS_PER_SECTOR (REGISTRY_SECTOR_SIZE / sizeof(registry_record_t))
+#define REGISTRY_TOP_MAX        4096
+
+/* database (DB_FLN, DB_OGN, DB_ICAO) in the top byte, address below */
+#define REGISTRY_KEY(db, id)    (((uint32_t) (db) << 24) | ((id) & 0xFFFFFF))
+
+typedef struct registry_header_struct {
+    char      magic[4];
+    uint16_t  version;
+    uint16_t  record_size;
+    uint32_t  records;
+    uint32_t  top_offset;
+    uint32_t  top_count;
+    uint32_t  index_offset;
+    uint32_t  data_offset;
+} registry_header_t;
+
+/* text fields are zero padded, not always terminated */
+typedef struct registry_record_struct {
+    uint32_t  key;
+    char      registration[12];
+    char      tail[16];         /* CN, or owner for ICAO */
+    char      type[32];
+} registry_record_t;
+
+/* reads size bytes at offset of the registry file */
+typedef bool (*registry_read_t)(void *, uint32_t, void *, size_t);
+
+typedef struct registry_struct {
+    registry_header_t hdr;
+    uint32_t          *top;
+    registry_read_t   read;
+    void              *ctx;
+} registry_t;
+
+bool Registry_open (registry_t *, registry_read_t, void *);
+bool Registry_find (registry_t *, uint8_t, uint32_t, registry_record_t *);
+bool Registry_query(registry_t *, uint8_t, uint32_t, uint8_t, char *, size_t);
+void Registry_close(registry_t *);
+
+#endif /* REGISTRYHELPER_H */
@@ -32,6 +32,95 @@ traffic_by_dist_t traffic[MAX_TRACKING_OBJECTS];
 static unsigned long UpdateTrafficTimeMarker = 0;
 static unsigned long Traffic_Voice_TimeMarker = 0;
 
+/* registrations already looked up, misses included */
+typedef struct traffic_db_cache_struct {
+  uint32_t  id;
+  uint8_t   db;
+  uint8_t   idpref;
+  bool      found;
+  uint32_t  used;
+  char      text[TEXT_VIEW_LINE_LENGTH];
+} traffic_db_cache_t;
+
+static traffic_db_cache_t Traffic_DB_Cache[TRAFFIC_DB_CACHE_SIZE];
+static uint32_t Traffic_DB_Clock = 0;
+
+uint8_t Traffic_DB(traffic_t *fop)
+{
+  if (settings->adb != DB_AUTO) {
+    return settings->adb;
+  }
+
+  switch (fop->IDType)
+  {
+  case ADDR_TYPE_RANDOM:
+    return DB_OGN;
+  case ADDR_TYPE_ICAO:
+    return DB_ICAO;
+  case ADDR_TYPE_FLARM:
+    return DB_FLN;
+  case ADDR_TYPE_ANONYMOUS:
+    return DB_OGN;
+  case ADDR_TYPE_P3I:
+    return DB_ICAO;
+  case ADDR_TYPE_FANET:
+    return DB_OGN;
+  default:
+    return settings->protocol == PROTOCOL_GDL90 ? DB_ICAO : DB_FLN;
+  }
+}
+
+/*
+ * Registration (or tail, or model) of the target, as chosen by
+ * settings->idpref. Storage is only touched on a cache miss.
+ */
+bool Traffic_Registration(traffic_t *fop, char *buf, size_t size)
+{
+  uint8_t db = Traffic_DB(fop);
+  traffic_db_cache_t *entry = NULL;
+  traffic_db_cache_t *lru   = &Traffic_DB_Cache[0];
+
+  for (int i=0; i < TRAFFIC_DB_CACHE_SIZE && entry == NULL; i++) {
+    traffic_db_cache_t *e = &Traffic_DB_Cache[i];
+
+    if (e->used && e->id == fop->ID && e->db == db &&
+        e->idpref == settings->idpref) {
+      entry = e;
+    } else if (e->used < lru->used) {
+      lru = e;
+    }
+  }
+
+  if (entry == NULL) {
+    entry = lru;
+    entry->id     = fop->ID;
+    entry->db     = db;
+    entry->idpref = settings->idpref;
+    entry->found  = SoC->DB_query(db, fop->ID, entry->text, sizeof(entry->text));
+  }
+
+  entry->used = ++Traffic_DB_Clock;
+
+  if (!entry->found) {
+    return false;
+  }
+
+  if (buf && size > 0) {
+    strncpy(buf, entry->text, size);
+    buf[size - 1] = 0;
+  }
+
+  return true;
+}
+
+/* new target, look it up now rather than when it is first drawn */
+static void Traffic_Insert(int ndx)
+{
+  Container[ndx] = fo;
+
+  Traffic_Registration(&Container[ndx], NULL, 0);
+}
+
 void Traffic_Add()
 {
     float fo_distance_sq = fo.RelativeNorth * fo.RelativeNorth +
@@ -63,7 +152,7 @@ void Traffic_Add()
 
       for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
         if (now() - Container[i].timestamp > ENTRY_EXPIRATION_TIME) {
-          Container[i] = fo;
+          Traffic_Insert(i);
           return;
         }
 
@@ -80,13 +169,13 @@ void Traffic_Add()
       }
 
       if (fo.AlarmLevel > Container[min_level_ndx].AlarmLevel) {
-        Container[min_level_ndx] = fo;
+        Traffic_Insert(min_level_ndx);
         return;
       }
 
       if (fo_distance_sq <  max_distance_sq &&
           fo.AlarmLevel  >= Container[max_dist_ndx].AlarmLevel) {
-        Container[max_dist_ndx] = fo;
+        Traffic_Insert(max_dist_ndx);
         return;
       }
     }
@@ -73,12 +73,16 @@ typedef struct traffic_by_dist_struct {
 
 #define TRAFFIC_ALERT_VOICE     1
 
+#define TRAFFIC_DB_CACHE_SIZE   64
+
 void Traffic_setup        (void);
 void Traffic_loop         (void);
 void Traffic_Add          (void);
 void Traffic_Update       (traffic_t *);
 void Traffic_ClearExpired (void);
 int  Traffic_Count        (void);
+uint8_t Traffic_DB        (traffic_t *);
+bool Traffic_Registration (traffic_t *, char *, size_t);
 
 int  traffic_cmp_by_distance(const void *, const void *);
 
@@ -51,7 +51,6 @@ static void EPD_Draw_Text()
 
   if (j > 0) {
 
-    uint8_t db;
     const char *u_dist, *u_alt, *u_spd;
     float disp_dist;
     int   disp_alt, disp_spd;
@@ -80,39 +79,6 @@ static void EPD_Draw_Text()
 
     int oclock = ((bearing + 15) % 360) / 30;
 
-    if (settings->adb == DB_AUTO) {
-      switch (traffic[EPD_current - 1].fop->IDType)
-      {
-      case ADDR_TYPE_RANDOM:
-        db = DB_OGN;
-        break;
-      case ADDR_TYPE_ICAO:
-        db = DB_ICAO;
-        break;
-      case ADDR_TYPE_FLARM:
-        db = DB_FLN;
-        break;
-      case ADDR_TYPE_ANONYMOUS:
-        db = DB_OGN;
-        break;
-      case ADDR_TYPE_P3I:
-        db = DB_ICAO;
-        break;
-      case ADDR_TYPE_FANET:
-        db = DB_OGN;
-        break;
-      default:
-        if (settings->protocol == PROTOCOL_GDL90) {
-          db = DB_ICAO;
-        } else {
-          db = DB_FLN;
-        }
-        break;
-      }
-    } else {
-      db = settings->adb;
-    }
-
     switch (settings->units)
     {
     case UNITS_IMPERIAL:
@@ -148,7 +114,7 @@ static void EPD_Draw_Text()
     uint32_t id = traffic[EPD_current - 1].fop->ID;
 
     long start = micros();
-    if (SoC->DB_query(db, id, id_text, sizeof(id_text))) {
+    if (Traffic_Registration(traffic[EPD_current - 1].fop, id_text, sizeof(id_text))) {
 #if 0
       Serial.print(F("Registration of "));
       Serial.print(id);
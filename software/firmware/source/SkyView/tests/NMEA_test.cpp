@@ -0,0 +1,110 @@
+/*
+ * NMEA_test.cpp
+ * Copyright (C) 2019-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host test of the NMEA tokenizer: make -f Makefile.RPi test
+ * The tokenizer is static, so NMEAHelper.cpp is built into this file.
+ */
+#include "../NMEAHelper.cpp"
+
+#include <stdio.h>
+
+traffic_t ThisAircraft, fo, EmptyFO;
+settings_t *settings = NULL;
+const SoC_ops_t *SoC = NULL;
+char UDPpacketBuffer[UDP_PACKET_BUFSIZE];
+TTYSerial SerialInput("/dev/null");
+
+lmic_pinmap lmic_pins = {
+    .nss  = LMIC_UNUSED_PIN,
+    .txe  = LMIC_UNUSED_PIN,
+    .rxe  = LMIC_UNUSED_PIN,
+    .rst  = LMIC_UNUSED_PIN,
+    .dio  = {LMIC_UNUSED_PIN, LMIC_UNUSED_PIN, LMIC_UNUSED_PIN},
+    .busy = LMIC_UNUSED_PIN,
+    .tcxo = LMIC_UNUSED_PIN,
+};
+
+void os_getArtEui (u1_t* buf) { }
+void os_getDevEui (u1_t* buf) { }
+void os_getDevKey (u1_t* buf) { }
+
+static traffic_t Test_Added;
+static int       Test_Adds;
+static int       Test_Failed;
+
+void Traffic_Add()
+{
+  Test_Added = fo;
+  Test_Adds++;
+}
+
+/* feeds "$<body>*<checksum>\r\n", with the checksum off by 'bad' */
+static void Test_Feed(const char *body, uint8_t bad)
+{
+  char buf[128];
+  uint8_t cs = 0;
+
+  for (const char *p = body; *p; p++) {
+    cs ^= *p;
+  }
+
+  int len = snprintf(buf, sizeof(buf), "$%s*%02X\r\n", body, cs ^ bad);
+  NMEA_Parse(buf, len);
+}
+
+static void Test_Check(const char *name, bool ok)
+{
+  printf("%-40s %s\n", name, ok ? "ok" : "FAILED");
+  if (!ok) {
+    Test_Failed++;
+  }
+}
+
+static void Test_PFLAA(const char *name, const char *body, uint32_t id)
+{
+  int adds = Test_Adds;
+
+  Test_Feed(body, 0);
+  Test_Check(name, Test_Adds == adds + 1 && Test_Added.ID == id);
+}
+
+int main()
+{
+  Test_PFLAA("PFLAA ID",
+             "PFLAA,0,100,-200,50,2,DD8F12,90,0,25,1.5,1", 0xDD8F12);
+  Test_PFLAA("PFLAA ID with !callsign",
+             "PFLAA,0,100,-200,50,2,3E5A1B!FLR_3E5A1B,90,0,25,1.5,1", 0x3E5A1B);
+  Test_PFLAA("PFLAA ID in lower case",
+             "PFLAA,0,100,-200,50,1,3e5a1b,90,0,25,1.5,8", 0x3E5A1B);
+
+  Test_Check("PFLAA other fields",
+             Test_Added.RelativeNorth == 100 && Test_Added.RelativeEast == -200 &&
+             Test_Added.RelativeVertical == 50 && Test_Added.Track == 90 &&
+             Test_Added.GroundSpeed == 25 && Test_Added.ClimbRate == 1.5f &&
+             Test_Added.AcftType == 8);
+
+  int adds = Test_Adds;
+  Test_Feed("PFLAA,0,100,-200,50,2,DD8F12,90,0,25,1.5,1", 0x01);
+  Test_Check("PFLAA with a bad checksum", Test_Adds == adds);
+
+  Test_Feed("PFLAU,3,1,2,1,2,-30,2,-32,755,3E5A1B!FLR_3E5A1B", 0);
+  Test_Check("PFLAU ID with !callsign", NMEA_Status.ID == 0x3E5A1B);
+
+  return Test_Failed ? 1 : 0;
+}
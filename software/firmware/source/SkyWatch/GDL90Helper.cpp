@@ -30,14 +30,15 @@ extern "C" {
 #include <gdl90.h>
 }
 
-#define GDL90_RINGBUF_SIZE  sizeof(gdl_message_escaped_t)
+/* unescaped frame between two flag bytes: message ID, payload and FCS */
+#define GDL90_FRAME_MAX     (1 + GDL90_MSG_LEN_UPLINK_DATA + 2)
 
 static unsigned long GDL90_Data_TimeMarker = 0;
 static unsigned long GDL90_HeartBeat_TimeMarker = 0;
 static unsigned long GDL90_OwnShip_TimeMarker = 0;
-static unsigned char gdl90_ringbuf[GDL90_RINGBUF_SIZE];
-static unsigned int gdl90buf_head = 0;
-static unsigned char prev_c = 0;
+static size_t gdl90_frame_len = 0;
+static bool   gdl90_escape    = false;
+static bool   gdl90_overrun   = false;
 
 gdl_message_t message;
 
@@ -65,158 +66,191 @@ const uint8_t gdl90_to_aircraft_type[] PROGMEM = {
 	AIRCRAFT_TYPE_RESERVED
 };
 
-static void GDL90_Parse_Character(char c)
+/* Pass a valid frame through, escaped again */
+static void GDL90_Out_Frame(size_t len)
 {
-    unsigned int gdl90buf_tail;
-    size_t msg_size;
-
-    if (c == GDL90_CONTROL_ESCAPE) {
-      prev_c = c;
-      return;
-    } else if (prev_c == GDL90_CONTROL_ESCAPE) {
-      prev_c = c;
+  static uint8_t out[1 /* flag */ + 2 * GDL90_FRAME_MAX + 1 /* flag */];
+  const uint8_t *frame = ((uint8_t *) &message) + 1 /* flag */;
+  size_t size = 0;
+
+  out[size++] = GDL90_FLAG_BYTE;
+  for (size_t i = 0; i < len; i++) {
+    uint8_t c = frame[i];
+
+    if (c == GDL90_FLAG_BYTE || c == GDL90_CONTROL_ESCAPE) {
+      out[size++] = GDL90_CONTROL_ESCAPE;
       c ^= GDL90_ESCAPE_BYTE;
-    } else {
-      prev_c = c;
     }
+    out[size++] = c;
+  }
+  out[size++] = GDL90_FLAG_BYTE;
 
-    gdl90_ringbuf[gdl90buf_head % GDL90_RINGBUF_SIZE] = c;
-    gdl90buf_head++;
-
-    msg_size = 1 /* flag */ + 1 /* id */ + GDL90_MSG_LEN_HEARTBEAT + 2 /* FC */ + 1 /* flag */;
-    gdl90buf_tail = gdl90buf_head - msg_size;
-    if (c == GDL90_FLAG_BYTE && 
-        gdl90_ringbuf[ gdl90buf_tail    % GDL90_RINGBUF_SIZE] == GDL90_FLAG_BYTE &&
-        gdl90_ringbuf[(gdl90buf_tail+1) % GDL90_RINGBUF_SIZE] == MSG_ID_HEARTBEAT) {
+  GDL90_Out(out, size);
+}
 
-      unsigned char *buf = (unsigned char *) &message;
-      for (uint8_t i=0; i < msg_size; i++) {
-          buf[i] = gdl90_ringbuf[(gdl90buf_tail + i) % GDL90_RINGBUF_SIZE];
-      }
+/*
+ * A complete frame is in 'message', 'len' bytes from the message ID on.
+ * FCS is checked once here, then the message is handled by its ID.
+ */
+static void GDL90_Frame(size_t len)
+{
+  uint8_t *frame = ((uint8_t *) &message) + 1 /* flag */;
 
-      GDL90_Out(buf, msg_size);
+  if (len < 1 /* id */ + 2 /* FCS */) {
+    return;
+  }
 
-      if (decode_gdl90_heartbeat(&message, &heartbeat)) {
+  uint16_t fcs = frame[len - 2] | (frame[len - 1] << 8);
+  if (gdl90_crcCompute(frame, len - 2) != fcs) {
+    return;
+  }
 
-//      print_gdl90_heartbeat(&heartbeat);
+  message.flag0 = GDL90_FLAG_BYTE;
+  size_t payload = len - 3;
 
-        GDL90_HeartBeat_TimeMarker = millis();
-      }
-    }
+  GDL90_Out_Frame(len);
 
-    msg_size = 1 /* flag */ + 1 /* id */ + GDL90_MSG_LEN_OWNSHIP_GEOMETRIC + 2 /* FC */ + 1 /* flag */;
-    gdl90buf_tail = gdl90buf_head - msg_size;
-    if (c == GDL90_FLAG_BYTE && 
-        gdl90_ringbuf[ gdl90buf_tail    % GDL90_RINGBUF_SIZE] == GDL90_FLAG_BYTE &&
-        gdl90_ringbuf[(gdl90buf_tail+1) % GDL90_RINGBUF_SIZE] == MSG_ID_OWNSHIP_GEOMETRIC) {
+  switch (message.messageId)
+  {
+  case MSG_ID_HEARTBEAT:
+    if (payload >= GDL90_MSG_LEN_HEARTBEAT) {
+      parse_gdl90_heartbeat(&message, &heartbeat);
 
-      unsigned char *buf = (unsigned char *) &message;
-      for (uint8_t i=0; i < msg_size; i++) {
-          buf[i] = gdl90_ringbuf[(gdl90buf_tail + i) % GDL90_RINGBUF_SIZE];
-      }
+//    print_gdl90_heartbeat(&heartbeat);
 
-      GDL90_Out(buf, msg_size);
+      GDL90_HeartBeat_TimeMarker = millis();
+    }
+    break;
 
-      decode_gdl90_ownship_geo_altitude(&message, &geo_altitude);
+  case MSG_ID_OWNSHIP_GEOMETRIC:
+    if (payload >= GDL90_MSG_LEN_OWNSHIP_GEOMETRIC) {
+      parse_gdl90_ownship_geo_altitude(&message, &geo_altitude);
 //    print_gdl90_ownship_geo_altitude(&geo_altitude);
     }
+    break;
 
-    msg_size = 1 /* flag */ + 1 /* id */ + GDL90_MSG_LEN_TRAFFIC_REPORT + 2 /* FC */ + 1 /* flag */;
-    gdl90buf_tail = gdl90buf_head - msg_size;
-    if (c == GDL90_FLAG_BYTE && 
-        gdl90_ringbuf[ gdl90buf_tail    % GDL90_RINGBUF_SIZE] == GDL90_FLAG_BYTE &&
-        gdl90_ringbuf[(gdl90buf_tail+1) % GDL90_RINGBUF_SIZE] == MSG_ID_TRAFFIC_REPORT) {
-
-      unsigned char *buf = (unsigned char *) &message;
-      for (uint8_t i=0; i < msg_size; i++) {
-          buf[i] = gdl90_ringbuf[(gdl90buf_tail + i) % GDL90_RINGBUF_SIZE];
-      }
-
-      GDL90_Out(buf, msg_size);
-
-      if (decode_gdl90_traffic_report(&message, &gdl_traffic)) {
+  case MSG_ID_TRAFFIC_REPORT:
+    if (payload >= GDL90_MSG_LEN_TRAFFIC_REPORT) {
+      parse_gdl90_traffic_report(&message, &gdl_traffic);
 
-//      print_gdl90_traffic_report(&gdl_traffic);
+//    print_gdl90_traffic_report(&gdl_traffic);
 
-        fo = EmptyFO;
+      fo = EmptyFO;
 
-        fo.ID          = gdl_traffic.address;
-        fo.IDType      = gdl_traffic.addressType == ADS_B_WITH_ICAO_ADDRESS ?
-                                          ADDR_TYPE_ICAO : ADDR_TYPE_ANONYMOUS;
+      fo.ID          = gdl_traffic.address;
+      fo.IDType      = gdl_traffic.addressType == ADS_B_WITH_ICAO_ADDRESS ?
+                                        ADDR_TYPE_ICAO : ADDR_TYPE_ANONYMOUS;
 
-        fo.latitude    = gdl_traffic.latitude;
-        fo.longitude   = gdl_traffic.longitude;
-        fo.altitude    = gdl_traffic.altitude  / _GPS_FEET_PER_METER;
+      fo.latitude    = gdl_traffic.latitude;
+      fo.longitude   = gdl_traffic.longitude;
+      fo.altitude    = gdl_traffic.altitude  / _GPS_FEET_PER_METER;
 
-        fo.AlarmLevel  = gdl_traffic.trafficAlertStatus == TRAFFIC_ALERT ?
-                                            ALARM_LEVEL_LOW : ALARM_LEVEL_NONE;
-        fo.Track       = gdl_traffic.trackOrHeading;           // degrees
-        fo.ClimbRate   = gdl_traffic.verticalVelocity/ (_GPS_FEET_PER_METER * 60.0);
-        fo.TurnRate    = 0;
-        fo.GroundSpeed = gdl_traffic.horizontalVelocity * _GPS_MPS_PER_KNOT;
-        fo.AcftType    = GDL90_TO_AT(gdl_traffic.emitterCategory);
+      fo.AlarmLevel  = gdl_traffic.trafficAlertStatus == TRAFFIC_ALERT ?
+                                          ALARM_LEVEL_LOW : ALARM_LEVEL_NONE;
+      fo.Track       = gdl_traffic.trackOrHeading;           // degrees
+      fo.ClimbRate   = gdl_traffic.verticalVelocity/ (_GPS_FEET_PER_METER * 60.0);
+      fo.TurnRate    = 0;
+      fo.GroundSpeed = gdl_traffic.horizontalVelocity * _GPS_MPS_PER_KNOT;
+      fo.AcftType    = GDL90_TO_AT(gdl_traffic.emitterCategory);
 
-        memcpy(fo.callsign, gdl_traffic.callsign, sizeof(fo.callsign));
+      memcpy(fo.callsign, gdl_traffic.callsign, sizeof(fo.callsign));
 
-        fo.timestamp   = now();
+      fo.timestamp   = now();
 
-        for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+      for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
 
-          if (Container[i].ID == fo.ID) {
+        if (Container[i].ID == fo.ID) {
+          Container[i] = fo;
+          Traffic_Update(i);
+          break;
+        } else {
+          if (now() - Container[i].timestamp > ENTRY_EXPIRATION_TIME) {
             Container[i] = fo;
             Traffic_Update(i);
             break;
-          } else {
-            if (now() - Container[i].timestamp > ENTRY_EXPIRATION_TIME) {
-              Container[i] = fo;
-              Traffic_Update(i);
-              break;
-            }
           }
         }
       }
     }
+    break;
 
-    msg_size = 1 /* flag */ + 1 /* id */ + GDL90_MSG_LEN_OWNSHIP_REPORT + 2 /* FC */ + 1 /* flag */;
-    gdl90buf_tail = gdl90buf_head - msg_size;
-    if (c == GDL90_FLAG_BYTE && 
-        gdl90_ringbuf[ gdl90buf_tail    % GDL90_RINGBUF_SIZE] == GDL90_FLAG_BYTE &&
-        gdl90_ringbuf[(gdl90buf_tail+1) % GDL90_RINGBUF_SIZE] == MSG_ID_OWNSHIP_REPORT) {
+  case MSG_ID_OWNSHIP_REPORT:
+    if (payload >= GDL90_MSG_LEN_OWNSHIP_REPORT) {
+      parse_gdl90_traffic_report(&message, &ownship);
 
-      unsigned char *buf = (unsigned char *) &message;
-      for (uint8_t i=0; i < msg_size; i++) {
-          buf[i] = gdl90_ringbuf[(gdl90buf_tail + i) % GDL90_RINGBUF_SIZE];
-      }
+//    print_gdl90_traffic_report(&ownship);
 
-      GDL90_Out(buf, msg_size);
+      ThisAircraft.ID          = ownship.address;
+      ThisAircraft.IDType      = ownship.addressType == ADS_B_WITH_ICAO_ADDRESS ?
+                                        ADDR_TYPE_ICAO : ADDR_TYPE_ANONYMOUS;
 
-      if (decode_gdl90_traffic_report(&message, &ownship)) {
+      ThisAircraft.latitude    = ownship.latitude;
+      ThisAircraft.longitude   = ownship.longitude;
+      ThisAircraft.altitude    = ownship.altitude  / _GPS_FEET_PER_METER;
 
-//      print_gdl90_traffic_report(&ownship);
+      ThisAircraft.AlarmLevel  = ownship.trafficAlertStatus == TRAFFIC_ALERT ?
+                                          ALARM_LEVEL_LOW : ALARM_LEVEL_NONE;
+      ThisAircraft.Track       = ownship.trackOrHeading;           // degrees
+      ThisAircraft.ClimbRate   = ownship.verticalVelocity/ (_GPS_FEET_PER_METER * 60.0);
+      ThisAircraft.TurnRate    = 0;
+      ThisAircraft.GroundSpeed = ownship.horizontalVelocity * _GPS_MPS_PER_KNOT;
+      ThisAircraft.AcftType    = GDL90_TO_AT(ownship.emitterCategory);
 
-        ThisAircraft.ID          = ownship.address;
-        ThisAircraft.IDType      = ownship.addressType == ADS_B_WITH_ICAO_ADDRESS ?
-                                          ADDR_TYPE_ICAO : ADDR_TYPE_ANONYMOUS;
+      memcpy(ThisAircraft.callsign, ownship.callsign, sizeof(ThisAircraft.callsign));
 
-        ThisAircraft.latitude    = ownship.latitude;
-        ThisAircraft.longitude   = ownship.longitude;
-        ThisAircraft.altitude    = ownship.altitude  / _GPS_FEET_PER_METER;
+      ThisAircraft.timestamp   = now();
 
-        ThisAircraft.AlarmLevel  = ownship.trafficAlertStatus == TRAFFIC_ALERT ?
-                                            ALARM_LEVEL_LOW : ALARM_LEVEL_NONE;
-        ThisAircraft.Track       = ownship.trackOrHeading;           // degrees
-        ThisAircraft.ClimbRate   = ownship.verticalVelocity/ (_GPS_FEET_PER_METER * 60.0);
-        ThisAircraft.TurnRate    = 0;
-        ThisAircraft.GroundSpeed = ownship.horizontalVelocity * _GPS_MPS_PER_KNOT;
-        ThisAircraft.AcftType    = GDL90_TO_AT(ownship.emitterCategory);
+      GDL90_OwnShip_TimeMarker = millis();
+    }
+    break;
+
+  case MSG_ID_INIT:
+  case MSG_ID_UPLINK_DATA:
+  case MSG_ID_HEIGHT_ABOVE_TERRAIN:
+  case MSG_ID_BASIC_REPORT:
+  case MSG_ID_LONG_REPORT:
+  default:
+    /* not used here */
+    break;
+  }
+}
 
-        memcpy(ThisAircraft.callsign, ownship.callsign, sizeof(ThisAircraft.callsign));
+/*
+ * Assemble flag delimited frames from a stream of bytes.
+ * Escapes are undone while the bytes are stored, a frame that
+ * does not fit is dropped up to the next flag.
+ */
+static void GDL90_Parse(const uint8_t *buf, size_t size)
+{
+  uint8_t *frame = ((uint8_t *) &message) + 1 /* flag */;
+  size_t len = gdl90_frame_len;
 
-        ThisAircraft.timestamp   = now();
+  for (size_t i = 0; i < size; i++) {
+    uint8_t c = buf[i];
 
-        GDL90_OwnShip_TimeMarker = millis();
+    if (c == GDL90_FLAG_BYTE) {
+      if (len > 0 && !gdl90_overrun) {
+        GDL90_Frame(len);
       }
+      len = 0;
+      gdl90_escape  = false;
+      gdl90_overrun = false;
+    } else if (c == GDL90_CONTROL_ESCAPE) {
+      gdl90_escape = true;
+    } else if (len < GDL90_FRAME_MAX) {
+      frame[len++] = gdl90_escape ? c ^ GDL90_ESCAPE_BYTE : c;
+      gdl90_escape = false;
+    } else {
+      gdl90_overrun = true;
     }
+  }
+
+  gdl90_frame_len = len;
+}
+
+static void GDL90_Parse_Character(char c)
+{
+  GDL90_Parse((const uint8_t *) &c, 1);
 }
 
 void GDL90_setup()
@@ -314,10 +348,7 @@ void GDL90_loop()
   case CON_WIFI_UDP:
     size = SoC->WiFi_Receive_UDP((uint8_t *) UDPpacketBuffer, sizeof(UDPpacketBuffer));
     if (size > 0) {
-      for (size_t i=0; i < size; i++) {
-//        Serial.print(UDPpacketBuffer[i]);
-        GDL90_Parse_Character(UDPpacketBuffer[i]);
-      }
+      GDL90_Parse((const uint8_t *) UDPpacketBuffer, size);
       GDL90_Data_TimeMarker = millis();
     }
     break;
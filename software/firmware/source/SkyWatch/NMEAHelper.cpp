@@ -28,34 +28,6 @@
 
 TinyGPSPlus nmea;
 
-TinyGPSCustom T_AlarmLevel      (nmea, "PFLAA", 1);
-TinyGPSCustom T_RelativeNorth   (nmea, "PFLAA", 2);
-TinyGPSCustom T_RelativeEast    (nmea, "PFLAA", 3);
-TinyGPSCustom T_RelativeVertical(nmea, "PFLAA", 4);
-TinyGPSCustom T_IDType          (nmea, "PFLAA", 5);
-TinyGPSCustom T_ID              (nmea, "PFLAA", 6);
-TinyGPSCustom T_Track           (nmea, "PFLAA", 7);
-TinyGPSCustom T_TurnRate        (nmea, "PFLAA", 8);
-TinyGPSCustom T_GroundSpeed     (nmea, "PFLAA", 9);
-TinyGPSCustom T_ClimbRate       (nmea, "PFLAA", 10);
-TinyGPSCustom T_AcftType        (nmea, "PFLAA", 11);
-
-TinyGPSCustom S_RX              (nmea, "PFLAU", 1);
-TinyGPSCustom S_TX              (nmea, "PFLAU", 2);
-TinyGPSCustom S_GPS             (nmea, "PFLAU", 3);
-TinyGPSCustom S_Power           (nmea, "PFLAU", 4);
-TinyGPSCustom S_AlarmLevel      (nmea, "PFLAU", 5);
-TinyGPSCustom S_RelativeBearing (nmea, "PFLAU", 6);
-TinyGPSCustom S_AlarmType       (nmea, "PFLAU", 7);
-TinyGPSCustom S_RelativeVertical(nmea, "PFLAU", 8);
-TinyGPSCustom S_RelativeDistance(nmea, "PFLAU", 9);
-TinyGPSCustom S_ID              (nmea, "PFLAU", 10);
-
-TinyGPSCustom H_Addr            (nmea, "PSRFH", 1);
-TinyGPSCustom H_Protocol        (nmea, "PSRFH", 2);
-TinyGPSCustom H_RxCnt           (nmea, "PSRFH", 3);
-TinyGPSCustom H_TxCnt           (nmea, "PSRFH", 4);
-
 #if !defined(USE_NMEA_CFG)
 
 TinyGPSCustom C_Version         (nmea, "PSRFC", 1);
@@ -86,6 +58,11 @@ uint32_t tx_packets_counter = 0;
 uint32_t rx_packets_counter = 0;
 
 static unsigned long NMEA_TimeMarker = 0;
+static unsigned long NMEA_Location_TimeMarker = 0;
+static unsigned long NMEA_Altitude_TimeMarker = 0;
+static unsigned long NMEA_Date_TimeMarker = 0;
+static unsigned long NMEA_Time_TimeMarker = 0;
+static unsigned long NMEA_FLARM_TimeMarker = 0;
 
 static bool RTC_sync = false;
 
@@ -115,314 +92,565 @@ void NMEA_add_checksum(char *buf, size_t limit)
   snprintf_P(csum_ptr, limit, PSTR("%02X\r\n"), cs);
 }
 
-static void NMEA_Parse_Character(char c)
+#if !defined(USE_NMEA_CFG)
+static void NMEA_Settings()
+{
+  if (C_Version.isUpdated()) {
+    if (atoi(C_Version.value()) == PSRFC_VERSION) {
+      bool cfg_is_updated = false;
+
+      if (C_Mode.isUpdated())
+      {
+        settings->s.mode = atoi(C_Mode.value());
+//            Serial.print(F("Mode = ")); Serial.println(settings->s.mode);
+        cfg_is_updated = true;
+      }
+      if (C_Protocol.isUpdated())
+      {
+        settings->s.rf_protocol = atoi(C_Protocol.value());
+//            Serial.print(F("Protocol = ")); Serial.println(settings->s.rf_protocol);
+        cfg_is_updated = true;
+      }
+      if (C_Band.isUpdated())
+      {
+        settings->s.band = atoi(C_Band.value());
+//            Serial.print(F("Region = ")); Serial.println(settings->s.band);
+        cfg_is_updated = true;
+      }
+      if (C_AcftType.isUpdated())
+      {
+        settings->s.aircraft_type = atoi(C_AcftType.value());
+//            Serial.print(F("AcftType = ")); Serial.println(settings->s.aircraft_type);
+        cfg_is_updated = true;
+      }
+      if (C_Alarm.isUpdated())
+      {
+        settings->s.alarm = atoi(C_Alarm.value());
+//            Serial.print(F("Alarm = ")); Serial.println(settings->s.alarm);
+        cfg_is_updated = true;
+      }
+      if (C_TxPower.isUpdated())
+      {
+        settings->s.txpower = atoi(C_TxPower.value());
+//            Serial.print(F("TxPower = ")); Serial.println(settings->s.txpower);
+        cfg_is_updated = true;
+      }
+      if (C_Volume.isUpdated())
+      {
+        settings->s.volume = atoi(C_Volume.value());
+//            Serial.print(F("Volume = ")); Serial.println(settings->s.volume);
+        cfg_is_updated = true;
+      }
+       if (C_Pointer.isUpdated())
+      {
+        settings->s.pointer = atoi(C_Pointer.value());
+//            Serial.print(F("Pointer = ")); Serial.println(settings->s.pointer);
+        cfg_is_updated = true;
+      }
+      if (C_NMEA_gnss.isUpdated())
+      {
+        settings->s.nmea_g = atoi(C_NMEA_gnss.value());
+//            Serial.print(F("NMEA_gnss = ")); Serial.println(settings->s.nmea_g);
+        cfg_is_updated = true;
+      }
+      if (C_NMEA_private.isUpdated())
+      {
+        settings->s.nmea_p = atoi(C_NMEA_private.value());
+//            Serial.print(F("NMEA_private = ")); Serial.println(settings->s.nmea_p);
+        cfg_is_updated = true;
+      }
+      if (C_NMEA_legacy.isUpdated())
+      {
+        settings->s.nmea_l = atoi(C_NMEA_legacy.value());
+//            Serial.print(F("NMEA_legacy = ")); Serial.println(settings->s.nmea_l);
+        cfg_is_updated = true;
+      }
+       if (C_NMEA_sensors.isUpdated())
+      {
+        settings->s.nmea_s = atoi(C_NMEA_sensors.value());
+//            Serial.print(F("NMEA_sensors = ")); Serial.println(settings->s.nmea_s);
+        cfg_is_updated = true;
+      }
+      if (C_NMEA_Output.isUpdated())
+      {
+        settings->s.nmea_out = atoi(C_NMEA_Output.value());
+//            Serial.print(F("NMEA_Output = ")); Serial.println(settings->s.nmea_out);
+        cfg_is_updated = true;
+      }
+      if (C_GDL90_Output.isUpdated())
+      {
+        settings->s.gdl90 = atoi(C_GDL90_Output.value());
+//            Serial.print(F("GDL90_Output = ")); Serial.println(settings->s.gdl90);
+        cfg_is_updated = true;
+      }
+      if (C_D1090_Output.isUpdated())
+      {
+        settings->s.d1090 = atoi(C_D1090_Output.value());
+//            Serial.print(F("D1090_Output = ")); Serial.println(settings->s.d1090);
+        cfg_is_updated = true;
+      }
+      if (C_Stealth.isUpdated())
+      {
+        settings->s.stealth = atoi(C_Stealth.value());
+//            Serial.print(F("Stealth = ")); Serial.println(settings->s.stealth);
+        cfg_is_updated = true;
+      }
+      if (C_noTrack.isUpdated())
+      {
+        settings->s.no_track = atoi(C_noTrack.value());
+//            Serial.print(F("noTrack = ")); Serial.println(settings->s.no_track);
+        cfg_is_updated = true;
+      }
+      if (C_PowerSave.isUpdated())
+      {
+        settings->s.power_save = atoi(C_PowerSave.value());
+//            Serial.print(F("PowerSave = ")); Serial.println(settings->s.power_save);
+        cfg_is_updated = true;
+      }
+
+      if (cfg_is_updated) {
+#if 0
+        SoC->WDT_fini();
+        if (SoC->Bluetooth_ops) { SoC->Bluetooth_ops->fini(); }
+        EEPROM_store();
+        nmea_cfg_restart();
+#endif
+      }
+    }
+  }
+}
+#endif /* USE_NMEA_CFG */
+
+/* Sentences known to the tokenizer */
+enum
+{
+  NMEA_S_UNKNOWN,
+  NMEA_S_PFLAA,
+  NMEA_S_PFLAU,
+  NMEA_S_GGA,
+  NMEA_S_RMC,
+  NMEA_S_PSRFH,
+  NMEA_S_PSRFC
+};
+
+/*
+ * One pass over the received characters: checksum is accumulated
+ * and every field is converted as it ends, into the staging copies
+ * below. Nothing is committed unless the checksum matches.
+ */
+typedef struct nmea_tokenizer_struct {
+  bool      active;     /* between '$' and the end of the checksum */
+  uint8_t   sentence;
+  uint8_t   field;      /* 0 - sentence tag */
+  uint8_t   cs;         /* XOR of all characters between '$' and '*' */
+  int8_t    cs_digits;  /* checksum digits received, -1 - before '*' */
+  uint8_t   cs_rx;
+
+  /* current field */
+  char      tag[5];
+  uint8_t   len;
+  char      first;
+  bool      neg;
+  bool      point;
+  uint8_t   frac;       /* digits after the decimal point */
+  uint32_t  dec;        /* decimal digits, fraction included */
+  uint32_t  hex;
+  bool      hex_end;    /* a non-hex character ended the hex digits */
+} nmea_tokenizer_t;
+
+#define NMEA_FRAC_MAX   5
+
+static const uint32_t NMEA_pow10[NMEA_FRAC_MAX + 1] = {
+  1, 10, 100, 1000, 10000, 100000
+};
+
+static nmea_tokenizer_t NMEA_Tok;
+
+static traffic_t nmea_traffic;
+static status_t  nmea_status;
+static ufo_t     nmea_device;
+static uint32_t  nmea_rx_packets;
+static uint32_t  nmea_tx_packets;
+
+static struct {
+  float   latitude;
+  float   longitude;
+  float   altitude;
+  float   course;
+  float   speed;
+  uint32_t time;   /* hhmmss */
+  uint32_t date;   /* ddmmyy */
+  bool    fix;
+  bool    has_altitude;
+} nmea_gnss;
+
+static uint32_t NMEA_Time;
+static uint32_t NMEA_Date;
+
+static int32_t NMEA_Int()
+{
+  int32_t value = NMEA_Tok.dec / NMEA_pow10[NMEA_Tok.frac];
+
+  return NMEA_Tok.neg ? -value : value;
+}
+
+static float NMEA_Float()
+{
+  float value = (float) NMEA_Tok.dec / NMEA_pow10[NMEA_Tok.frac];
+
+  return NMEA_Tok.neg ? -value : value;
+}
+
+/* (d)ddmm.mmmmm */
+static float NMEA_Coord()
+{
+  uint32_t scale   = NMEA_pow10[NMEA_Tok.frac];
+  uint32_t deg     = NMEA_Tok.dec / (100 * scale);
+  uint32_t minutes = NMEA_Tok.dec - deg * 100 * scale;
+
+  return deg + (float) minutes / (60 * scale);
+}
+
+static void NMEA_Field_Start()
+{
+  NMEA_Tok.len     = 0;
+  NMEA_Tok.first   = 0;
+  NMEA_Tok.neg     = false;
+  NMEA_Tok.point   = false;
+  NMEA_Tok.frac    = 0;
+  NMEA_Tok.dec     = 0;
+  NMEA_Tok.hex     = 0;
+  NMEA_Tok.hex_end = false;
+}
+
+static void NMEA_Sentence()
+{
+  const char *tag = NMEA_Tok.tag;
+
+  NMEA_Tok.sentence = NMEA_S_UNKNOWN;
+
+  if (NMEA_Tok.len != sizeof(NMEA_Tok.tag)) {
+    return;
+  }
+
+  if (memcmp(tag, "PFLAA", 5) == 0) {
+    NMEA_Tok.sentence = NMEA_S_PFLAA;
+    nmea_traffic = EmptyFO;
+  } else if (memcmp(tag, "PFLAU", 5) == 0) {
+    NMEA_Tok.sentence = NMEA_S_PFLAU;
+    nmea_status = NMEA_Status;
+  } else if (tag[0] == 'G' && memcmp(tag + 2, "GGA", 3) == 0) {
+    NMEA_Tok.sentence = NMEA_S_GGA;
+    nmea_gnss.fix = false;
+    nmea_gnss.has_altitude = false;
+  } else if (tag[0] == 'G' && memcmp(tag + 2, "RMC", 3) == 0) {
+    NMEA_Tok.sentence = NMEA_S_RMC;
+    nmea_gnss.fix = false;
+    nmea_gnss.date = 0;
+  } else if (memcmp(tag, "PSRFH", 5) == 0) {
+    NMEA_Tok.sentence = NMEA_S_PSRFH;
+    nmea_device = ThisDevice;
+    nmea_rx_packets = rx_packets_counter;
+    nmea_tx_packets = tx_packets_counter;
+  } else if (memcmp(tag, "PSRFC", 5) == 0) {
+    /* rare, left to TinyGPS++ on commit */
+    NMEA_Tok.sentence = NMEA_S_PSRFC;
+  }
+}
+
+static void NMEA_Field()
 {
-    int ndx;
-    bool isValidSentence;
+  nmea_tokenizer_t *t = &NMEA_Tok;
+
+  if (t->field == 0) {
+    NMEA_Sentence();
+    return;
+  }
 
-    if (c == -1) {
-      /* retry */
-      return;
+  switch (t->sentence)
+  {
+  case NMEA_S_PFLAA:
+    switch (t->field)
+    {
+    case 1:  nmea_traffic.AlarmLevel       = NMEA_Int();   break;
+    case 2:  nmea_traffic.RelativeNorth    = NMEA_Int();   break;
+    case 3:  nmea_traffic.RelativeEast     = NMEA_Int();   break;
+    case 4:  nmea_traffic.RelativeVertical = NMEA_Int();   break;
+    case 5:  nmea_traffic.IDType           = NMEA_Int();   break;
+    case 6:  nmea_traffic.ID               = t->hex;       break;
+    case 7:  nmea_traffic.Track            = NMEA_Int();   break;
+    case 8:  nmea_traffic.TurnRate         = NMEA_Int();   break;
+    case 9:  nmea_traffic.GroundSpeed      = NMEA_Int();   break;
+    case 10: nmea_traffic.ClimbRate        = NMEA_Float(); break;
+    case 11: nmea_traffic.AcftType         = t->hex;       break;
+    default: break;
     }
+    break;
 
-    if (isPrintable(c) || c == '\r' || c == '\n') {
-      NMEABuffer[NMEA_cnt] = c;
-    } else {
-      /* ignore */
-      return;
+  case NMEA_S_PFLAU:
+    switch (t->field)
+    {
+    case 1:  nmea_status.RX                = NMEA_Int();   break;
+    case 2:  nmea_status.TX                = NMEA_Int();   break;
+    case 3:  nmea_status.GPS               = NMEA_Int();   break;
+    case 4:  nmea_status.Power             = NMEA_Int();   break;
+    case 5:  nmea_status.AlarmLevel        = NMEA_Int();   break;
+    case 6:  nmea_status.RelativeBearing   = NMEA_Int();   break;
+    case 7:  nmea_status.AlarmType         = NMEA_Int();   break;
+    case 8:  nmea_status.RelativeVertical  = NMEA_Int();   break;
+    case 9:  nmea_status.RelativeDistance  = NMEA_Int();   break;
+    case 10: nmea_status.ID                = t->hex;       break;
+    default: break;
+    }
+    break;
+
+  case NMEA_S_GGA:
+    switch (t->field)
+    {
+    case 1:  nmea_gnss.time = NMEA_Int();                          break;
+    case 2:  nmea_gnss.latitude  = NMEA_Coord();                   break;
+    case 3:  if (t->first == 'S') nmea_gnss.latitude  = -nmea_gnss.latitude;  break;
+    case 4:  nmea_gnss.longitude = NMEA_Coord();                   break;
+    case 5:  if (t->first == 'W') nmea_gnss.longitude = -nmea_gnss.longitude; break;
+    case 6:  nmea_gnss.fix = t->len > 0 && t->first != '0';        break;
+    case 9:  nmea_gnss.altitude = NMEA_Float();
+             nmea_gnss.has_altitude = t->len > 0;                  break;
+    default: break;
     }
+    break;
 
-    isValidSentence = nmea.encode(NMEABuffer[NMEA_cnt]);
-    if (isValidSentence) {
+  case NMEA_S_RMC:
+    switch (t->field)
+    {
+    case 1:  nmea_gnss.time = NMEA_Int();                          break;
+    case 2:  nmea_gnss.fix = t->first == 'A';                      break;
+    case 3:  nmea_gnss.latitude  = NMEA_Coord();                   break;
+    case 4:  if (t->first == 'S') nmea_gnss.latitude  = -nmea_gnss.latitude;  break;
+    case 5:  nmea_gnss.longitude = NMEA_Coord();                   break;
+    case 6:  if (t->first == 'W') nmea_gnss.longitude = -nmea_gnss.longitude; break;
+    case 7:  nmea_gnss.speed  = NMEA_Float();                      break;
+    case 8:  nmea_gnss.course = NMEA_Float();                      break;
+    case 9:  nmea_gnss.date   = NMEA_Int();                        break;
+    default: break;
+    }
+    break;
+
+  case NMEA_S_PSRFH:
+    switch (t->field)
+    {
+    case 1:  nmea_device.addr     = t->hex;                        break;
+    case 2:  nmea_device.protocol = NMEA_Int();                    break;
+    case 3:  nmea_rx_packets      = NMEA_Int();                    break;
+    case 4:  nmea_tx_packets      = NMEA_Int();                    break;
+    default: break;
+    }
+    break;
+
+  case NMEA_S_UNKNOWN:
+  default:
+    break;
+  }
+}
+
+/* Checksum matched, take over what the sentence carried */
+static void NMEA_Commit()
+{
+  /* pass GNSS and private sentences through, '\r' included */
+  if (NMEA_cnt < (int) sizeof(NMEABuffer) &&
+      (NMEABuffer[1] == 'G' || NMEABuffer[1] == 'P')) {
+    NMEABuffer[NMEA_cnt] = '\r';
+    NMEA_Out(settings->m.data_dest, (byte *) NMEABuffer, NMEA_cnt + 1, true);
+  }
+
+  switch (NMEA_Tok.sentence)
+  {
+  case NMEA_S_PFLAA:
+    fo = nmea_traffic;
+    fo.timestamp = now();
 
-      for (ndx = NMEA_cnt - 4; ndx >= 0; ndx--) { // skip CS and *
-        if ( NMEABuffer[ndx]   == '$' &&
-            (NMEABuffer[ndx+1] == 'G' || NMEABuffer[ndx+1] == 'P')) {
+    for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
 
-          size_t write_size = NMEA_cnt - ndx + 1;
-          NMEA_Out(settings->m.data_dest, (byte *) &NMEABuffer[ndx], write_size, true);
+      if (Container[i].ID == fo.ID) {
+        Container[i] = fo;
+        break;
+      } else {
+        if (now() - Container[i].timestamp > ENTRY_EXPIRATION_TIME) {
+          Container[i] = fo;
           break;
         }
       }
+    }
+    break;
 
-      if (nmea.location.isUpdated()) {
-        ThisAircraft.latitude  = nmea.location.lat();
-        ThisAircraft.longitude = nmea.location.lng();
-      }
-      if (nmea.altitude.isUpdated()) {
-        ThisAircraft.altitude = nmea.altitude.meters();
-      }
-      if (nmea.course.isUpdated()) {
-        ThisAircraft.Track = nmea.course.deg();
-      }
-      if (nmea.speed.isUpdated()) {
-        ThisAircraft.GroundSpeed = nmea.speed.knots();
+  case NMEA_S_PFLAU:
+    NMEA_Status = nmea_status;
+    NMEA_Status.timestamp = now();
+    NMEA_FLARM_TimeMarker = millis();
+    break;
+
+  case NMEA_S_GGA:
+    NMEA_Time = nmea_gnss.time;
+    NMEA_Time_TimeMarker = millis();
+    if (nmea_gnss.fix) {
+      ThisAircraft.latitude  = nmea_gnss.latitude;
+      ThisAircraft.longitude = nmea_gnss.longitude;
+      NMEA_Location_TimeMarker = millis();
+      if (nmea_gnss.has_altitude) {
+        ThisAircraft.altitude = nmea_gnss.altitude;
+        NMEA_Altitude_TimeMarker = millis();
       }
-      if (T_ID.isUpdated()) {
-        fo = EmptyFO;
+    }
+    break;
 
-//        Serial.print(F(" ID=")); Serial.print(ID.value());
+  case NMEA_S_RMC:
+    NMEA_Time = nmea_gnss.time;
+    NMEA_Time_TimeMarker = millis();
+    if (nmea_gnss.date > 0) {
+      NMEA_Date = nmea_gnss.date;
+      NMEA_Date_TimeMarker = millis();
+    }
+    if (nmea_gnss.fix) {
+      ThisAircraft.latitude    = nmea_gnss.latitude;
+      ThisAircraft.longitude   = nmea_gnss.longitude;
+      ThisAircraft.Track       = nmea_gnss.course;
+      ThisAircraft.GroundSpeed = nmea_gnss.speed;
+      NMEA_Location_TimeMarker = millis();
+    }
+    break;
 
-        fo.ID = strtol(T_ID.value(), NULL, 16);
+  case NMEA_S_PSRFH:
+    ThisDevice.addr     = nmea_device.addr;
+    ThisDevice.protocol = nmea_device.protocol;
+    rx_packets_counter  = nmea_rx_packets;
+    tx_packets_counter  = nmea_tx_packets;
+    break;
 
-#if 0
-        Serial.print(F(" ID="));
-        Serial.print((fo.ID >> 16) & 0xFF, HEX);
-        Serial.print((fo.ID >>  8) & 0xFF, HEX);
-        Serial.print((fo.ID      ) & 0xFF, HEX);
-        Serial.println();
-#endif
+  case NMEA_S_PSRFC:
+#if !defined(USE_NMEA_CFG)
+    if (NMEA_cnt < (int) sizeof(NMEABuffer) - 1) {
+      NMEABuffer[NMEA_cnt]     = '\r';
+      NMEABuffer[NMEA_cnt + 1] = '\n';
+      for (int i = 0; i < NMEA_cnt + 2; i++) {
+        nmea.encode(NMEABuffer[i]);
+      }
+      NMEA_Settings();
+    }
+#endif /* USE_NMEA_CFG */
+    break;
 
-        if (T_AlarmLevel.isUpdated())
-        {
-          fo.AlarmLevel = atoi(T_AlarmLevel.value());
-        }
-        if (T_RelativeNorth.isUpdated())
-        {
-          fo.RelativeNorth = atoi(T_RelativeNorth.value());
-        }
-        if (T_RelativeEast.isUpdated())
-        {
-          fo.RelativeEast = atoi(T_RelativeEast.value());
-        }
-        if (T_RelativeVertical.isUpdated())
-        {
-          fo.RelativeVertical = atoi(T_RelativeVertical.value());
-        }
-        if (T_IDType.isUpdated())
-        {
-          fo.IDType = atoi(T_IDType.value());
-        }
-        if (T_Track.isUpdated())
-        {
-          fo.Track = atoi(T_Track.value());
-        }
-        if (T_TurnRate.isUpdated())
-        {
-          fo.TurnRate = atoi(T_TurnRate.value());
-        }
-        if (T_GroundSpeed.isUpdated())
-        {
-          fo.GroundSpeed = atoi(T_GroundSpeed.value());
-        }
-        if (T_ClimbRate.isUpdated())
-        {
-//          Serial.print(F(" ClimbRate=")); Serial.println(T_ClimbRate.value());
-          /* TBD */
-        }
-        if (T_AcftType.isUpdated())
-        {
-          fo.AcftType = atoi(T_AcftType.value());
-        }
+  case NMEA_S_UNKNOWN:
+  default:
+    break;
+  }
+}
 
-        fo.timestamp = now();
+static void NMEA_Parse(const char *buf, size_t size)
+{
+  nmea_tokenizer_t *t = &NMEA_Tok;
+
+  for (size_t i = 0; i < size; i++) {
+    char c = buf[i];
+
+    if (c == '$') {
+      NMEABuffer[0] = c;
+      NMEA_cnt      = 1;
+      t->active    = true;
+      t->field     = 0;
+      t->cs        = 0;
+      t->cs_digits = -1;
+      NMEA_Field_Start();
+      continue;
+    }
 
-        for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    if (!t->active) {
+      continue;
+    }
 
-          if (Container[i].ID == fo.ID) {
-            Container[i] = fo;
-            break;
-          } else {
-            if (now() - Container[i].timestamp > ENTRY_EXPIRATION_TIME) {
-              Container[i] = fo;
-              break;
-            }
-          }
-        }
+    if (NMEA_cnt < (int) sizeof(NMEABuffer)) {
+      NMEABuffer[NMEA_cnt] = c;
+    }
+    if (c >= ' ' && c <= '~' && NMEA_cnt < (int) sizeof(NMEABuffer)) {
+      NMEA_cnt++;
+    }
 
-      } else if (S_RX.isUpdated()) {
+    if (t->cs_digits >= 0) {
+      uint8_t nibble;
 
-        NMEA_Status.timestamp = now();
-        NMEA_Status.RX = atoi(S_RX.value());
+      if      (c >= '0' && c <= '9') { nibble = c - '0';      }
+      else if (c >= 'A' && c <= 'F') { nibble = c - 'A' + 10; }
+      else if (c >= 'a' && c <= 'f') { nibble = c - 'a' + 10; }
+      else { t->active = false; continue; }
 
-        if (S_TX.isUpdated())
-        {
-          NMEA_Status.TX = atoi(S_TX.value());
-        }
-        if (S_GPS.isUpdated())
-        {
-          NMEA_Status.GPS = atoi(S_GPS.value());
-        }
-        if (S_Power.isUpdated())
-        {
-          NMEA_Status.Power = atoi(S_Power.value());
-        }
-        if (S_AlarmLevel.isUpdated())
-        {
-          NMEA_Status.AlarmLevel = atoi(S_AlarmLevel.value());
-        }
-        if (S_RelativeBearing.isUpdated())
-        {
-          NMEA_Status.RelativeBearing = atoi(S_RelativeBearing.value());
-        }
-        if (S_AlarmType.isUpdated())
-        {
-          NMEA_Status.AlarmType = atoi(S_AlarmType.value());
-        }
-        if (S_RelativeVertical.isUpdated())
-        {
-          NMEA_Status.RelativeVertical = atoi(S_RelativeVertical.value());
-        }
-        if (S_RelativeDistance.isUpdated())
-        {
-          NMEA_Status.RelativeDistance = strtol(S_RelativeDistance.value(), NULL, 10);
-        }
-        if (S_ID.isUpdated())
-        {
-          NMEA_Status.ID = strtol(S_ID.value(), NULL, 16);
+      t->cs_rx = (t->cs_rx << 4) | nibble;
+      if (++t->cs_digits == 2) {
+        if (t->cs_rx == t->cs) {
+          NMEA_Commit();
         }
+        t->active = false;
+      }
+      continue;
+    }
 
-      } else if (H_Addr.isUpdated()) {
+    if (c == '*') {
+      NMEA_Field();
+      t->cs_digits = 0;
+      t->cs_rx     = 0;
+      continue;
+    }
 
-        ThisDevice.addr = strtol(H_Addr.value(), NULL, 16);
+    if (c < ' ' || c > '~') {
+      /* line ended before the checksum */
+      t->active = false;
+      continue;
+    }
 
-        if (H_Protocol.isUpdated())
-        {
-          ThisDevice.protocol = atoi(H_Protocol.value());
-        }
-        if (H_RxCnt.isUpdated())
-        {
-          rx_packets_counter = strtol(H_RxCnt.value(), NULL, 10);
-        }
-        if (H_TxCnt.isUpdated())
-        {
-          tx_packets_counter = strtol(H_TxCnt.value(), NULL, 10);
-        }
+    t->cs ^= c;
 
-#if !defined(USE_NMEA_CFG)
-      } else if (C_Version.isUpdated()) {
-        if (atoi(C_Version.value()) == PSRFC_VERSION) {
-          bool cfg_is_updated = false;
+    if (c == ',') {
+      NMEA_Field();
+      t->field++;
+      NMEA_Field_Start();
+      continue;
+    }
 
-          if (C_Mode.isUpdated())
-          {
-            settings->s.mode = atoi(C_Mode.value());
-//            Serial.print(F("Mode = ")); Serial.println(settings->s.mode);
-            cfg_is_updated = true;
-          }
-          if (C_Protocol.isUpdated())
-          {
-            settings->s.rf_protocol = atoi(C_Protocol.value());
-//            Serial.print(F("Protocol = ")); Serial.println(settings->s.rf_protocol);
-            cfg_is_updated = true;
-          }
-          if (C_Band.isUpdated())
-          {
-            settings->s.band = atoi(C_Band.value());
-//            Serial.print(F("Region = ")); Serial.println(settings->s.band);
-            cfg_is_updated = true;
-          }
-          if (C_AcftType.isUpdated())
-          {
-            settings->s.aircraft_type = atoi(C_AcftType.value());
-//            Serial.print(F("AcftType = ")); Serial.println(settings->s.aircraft_type);
-            cfg_is_updated = true;
-          }
-          if (C_Alarm.isUpdated())
-          {
-            settings->s.alarm = atoi(C_Alarm.value());
-//            Serial.print(F("Alarm = ")); Serial.println(settings->s.alarm);
-            cfg_is_updated = true;
-          }
-          if (C_TxPower.isUpdated())
-          {
-            settings->s.txpower = atoi(C_TxPower.value());
-//            Serial.print(F("TxPower = ")); Serial.println(settings->s.txpower);
-            cfg_is_updated = true;
-          }
-          if (C_Volume.isUpdated())
-          {
-            settings->s.volume = atoi(C_Volume.value());
-//            Serial.print(F("Volume = ")); Serial.println(settings->s.volume);
-            cfg_is_updated = true;
-          }
-           if (C_Pointer.isUpdated())
-          {
-            settings->s.pointer = atoi(C_Pointer.value());
-//            Serial.print(F("Pointer = ")); Serial.println(settings->s.pointer);
-            cfg_is_updated = true;
-          }
-          if (C_NMEA_gnss.isUpdated())
-          {
-            settings->s.nmea_g = atoi(C_NMEA_gnss.value());
-//            Serial.print(F("NMEA_gnss = ")); Serial.println(settings->s.nmea_g);
-            cfg_is_updated = true;
-          }
-          if (C_NMEA_private.isUpdated())
-          {
-            settings->s.nmea_p = atoi(C_NMEA_private.value());
-//            Serial.print(F("NMEA_private = ")); Serial.println(settings->s.nmea_p);
-            cfg_is_updated = true;
-          }
-          if (C_NMEA_legacy.isUpdated())
-          {
-            settings->s.nmea_l = atoi(C_NMEA_legacy.value());
-//            Serial.print(F("NMEA_legacy = ")); Serial.println(settings->s.nmea_l);
-            cfg_is_updated = true;
-          }
-           if (C_NMEA_sensors.isUpdated())
-          {
-            settings->s.nmea_s = atoi(C_NMEA_sensors.value());
-//            Serial.print(F("NMEA_sensors = ")); Serial.println(settings->s.nmea_s);
-            cfg_is_updated = true;
-          }
-          if (C_NMEA_Output.isUpdated())
-          {
-            settings->s.nmea_out = atoi(C_NMEA_Output.value());
-//            Serial.print(F("NMEA_Output = ")); Serial.println(settings->s.nmea_out);
-            cfg_is_updated = true;
-          }
-          if (C_GDL90_Output.isUpdated())
-          {
-            settings->s.gdl90 = atoi(C_GDL90_Output.value());
-//            Serial.print(F("GDL90_Output = ")); Serial.println(settings->s.gdl90);
-            cfg_is_updated = true;
-          }
-          if (C_D1090_Output.isUpdated())
-          {
-            settings->s.d1090 = atoi(C_D1090_Output.value());
-//            Serial.print(F("D1090_Output = ")); Serial.println(settings->s.d1090);
-            cfg_is_updated = true;
-          }
-          if (C_Stealth.isUpdated())
-          {
-            settings->s.stealth = atoi(C_Stealth.value());
-//            Serial.print(F("Stealth = ")); Serial.println(settings->s.stealth);
-            cfg_is_updated = true;
-          }
-          if (C_noTrack.isUpdated())
-          {
-            settings->s.no_track = atoi(C_noTrack.value());
-//            Serial.print(F("noTrack = ")); Serial.println(settings->s.no_track);
-            cfg_is_updated = true;
-          }
-          if (C_PowerSave.isUpdated())
-          {
-            settings->s.power_save = atoi(C_PowerSave.value());
-//            Serial.print(F("PowerSave = ")); Serial.println(settings->s.power_save);
-            cfg_is_updated = true;
-          }
+    if (t->len == 0) {
+      t->first = c;
+    }
 
-          if (cfg_is_updated) {
-#if 0
-            SoC->WDT_fini();
-            if (SoC->Bluetooth_ops) { SoC->Bluetooth_ops->fini(); }
-            EEPROM_store();
-            nmea_cfg_restart();
-#endif
-          }
+    if (t->field == 0) {
+      if (t->len < sizeof(t->tag)) {
+        t->tag[t->len] = c;
+      }
+    } else {
+      if (c >= '0' && c <= '9') {
+        if (!t->point) {
+          t->dec = t->dec * 10 + (c - '0');
+        } else if (t->frac < NMEA_FRAC_MAX) {
+          t->dec = t->dec * 10 + (c - '0');
+          t->frac++;
         }
-#endif /* USE_NMEA_CFG */
+      } else if (c == '.') {
+        t->point = true;
+      } else if (c == '-') {
+        t->neg = true;
+      }
+
+      /* SoftRF sends the PFLAA ID as "<ID>!<callsign>" */
+      if (!t->hex_end) {
+        if      (c >= '0' && c <= '9') { t->hex = (t->hex << 4) | (c - '0');      }
+        else if (c >= 'A' && c <= 'F') { t->hex = (t->hex << 4) | (c - 'A' + 10); }
+        else if (c >= 'a' && c <= 'f') { t->hex = (t->hex << 4) | (c - 'a' + 10); }
+        else                           { t->hex_end = true; }
       }
     }
 
-    if (NMEABuffer[NMEA_cnt] == '\n' || NMEA_cnt == sizeof(NMEABuffer)-1) {
-      NMEA_cnt = 0;
-    } else {
-      NMEA_cnt++;
+    if (t->len < UINT8_MAX) {
+      t->len++;
     }
+  }
 }
 
+
 void NMEA_setup()
 {
   if (settings->m.protocol == PROTOCOL_NMEA) {
@@ -499,39 +727,43 @@ void NMEA_setup()
 
 void NMEA_loop()
 {
-  char c;
+  char buf[NMEA_CHUNK_SIZE];
   size_t size;
 
   switch (settings->m.connection)
   {
   case CON_SERIAL_MAIN:
-    while (SerialInput.available() > 0) {
-      c = SerialInput.read();
-//      Serial.print(c);
-      NMEA_Parse_Character(c);
+    for (size = 0; size < sizeof(buf) && SerialInput.available() > 0; size++) {
+      buf[size] = SerialInput.read();
+    }
+    if (size > 0) {
+      NMEA_Parse(buf, size);
       NMEA_TimeMarker = millis();
     }
     break;
   case CON_SERIAL_AUX:
     /* read data from Type-C USB port */
-    while (Serial.available() > 0) {
-      c = Serial.read();
-//        Serial.print(c);
-      NMEA_Parse_Character(c);
+    for (size = 0; size < sizeof(buf) && Serial.available() > 0; size++) {
+      buf[size] = Serial.read();
+    }
+    if (size > 0) {
+      NMEA_Parse(buf, size);
       NMEA_TimeMarker = millis();
     }
     break;
   case CON_USB:
     /* read data from Type-C USB port in Host mode */
     if (SoC->USB_ops) {
-      while (SoC->USB_ops->available() > 0) {
-        c = SoC->USB_ops->read();
+      for (size = 0; size < sizeof(buf) && SoC->USB_ops->available() > 0; size++) {
+        buf[size] = SoC->USB_ops->read();
+      }
+      if (size > 0) {
 #if defined(ENABLE_USB_HOST_DEBUG)
         if (hw_info.gnss == GNSS_MODULE_NONE) {
-          Serial.print(c);
+          Serial.write((uint8_t *) buf, size);
         }
 #endif
-        NMEA_Parse_Character(c);
+        NMEA_Parse(buf, size);
         NMEA_TimeMarker = millis();
       }
     }
@@ -539,19 +771,23 @@ void NMEA_loop()
   case CON_WIFI_UDP:
     size = SoC->WiFi_Receive_UDP((uint8_t *) UDPpacketBuffer, sizeof(UDPpacketBuffer));
     if (size > 0) {
-      for (size_t i=0; i < size; i++) {
-        Serial.print(UDPpacketBuffer[i]);
-        NMEA_Parse_Character(UDPpacketBuffer[i]);
-      }
+#if !defined(EXCLUDE_NMEA_ECHO)
+      Serial.write((uint8_t *) UDPpacketBuffer, size);
+#endif
+      NMEA_Parse(UDPpacketBuffer, size);
       NMEA_TimeMarker = millis();
     }
     break;
   case CON_BLUETOOTH:
     if (SoC->Bluetooth_ops) {
-      while (SoC->Bluetooth_ops->available() > 0) {
-        c = SoC->Bluetooth_ops->read();
-        Serial.print(c);
-        NMEA_Parse_Character(c);
+      for (size = 0; size < sizeof(buf) && SoC->Bluetooth_ops->available() > 0; size++) {
+        buf[size] = SoC->Bluetooth_ops->read();
+      }
+      if (size > 0) {
+#if !defined(EXCLUDE_NMEA_ECHO)
+        Serial.write((uint8_t *) buf, size);
+#endif
+        NMEA_Parse(buf, size);
         NMEA_TimeMarker = millis();
       }
     }
@@ -579,14 +815,16 @@ void NMEA_loop()
 
 #if !defined(EXCLUDE_RTC)
   if (!RTC_sync) {
-    if (rtc &&
-        nmea.date.isValid()     &&
-        nmea.time.isValid()     &&
-        nmea.date.year() > 2018 &&
-        nmea.date.year() < 2030 ) {
-      rtc->setDateTime(nmea.date.year(),   nmea.date.month(),
-                       nmea.date.day(),    nmea.time.hour(),
-                       nmea.time.minute(), nmea.time.second());
+    uint16_t year = 2000 + NMEA_Date % 100;
+
+    if (rtc                       &&
+        NMEA_Date_TimeMarker > 0  &&
+        NMEA_Time_TimeMarker > 0  &&
+        year > 2018               &&
+        year < 2030 ) {
+      rtc->setDateTime(year,                  (NMEA_Date / 100) % 100,
+                       NMEA_Date / 10000,     NMEA_Time / 10000,
+                       (NMEA_Time / 100) % 100, NMEA_Time % 100);
       RTC_sync = true;
     }
   }
@@ -693,18 +931,30 @@ bool NMEA_isConnected()
 
 bool NMEA_hasGNSS()
 {
-  return (nmea.time.isValid() && nmea.time.age() < NMEA_EXP_TIME);
+  return (NMEA_Time_TimeMarker > 0 &&
+         (millis() - NMEA_Time_TimeMarker) < NMEA_EXP_TIME);
+}
+
+bool NMEA_hasFix()
+{
+  unsigned long ms = millis();
+
+  return (NMEA_Location_TimeMarker > 0 && NMEA_Altitude_TimeMarker > 0 &&
+          NMEA_Date_TimeMarker > 0                                     &&
+         (ms - NMEA_Location_TimeMarker) <= NMEA_EXP_TIME              &&
+         (ms - NMEA_Altitude_TimeMarker) <= NMEA_EXP_TIME              &&
+         (ms - NMEA_Date_TimeMarker)     <= NMEA_EXP_TIME);
 }
 
 bool NMEA_hasFLARM()
 {
-  return (S_RX.isValid() && S_RX.age() < NMEA_EXP_TIME);
+  return (NMEA_FLARM_TimeMarker > 0 &&
+         (millis() - NMEA_FLARM_TimeMarker) < NMEA_EXP_TIME);
 }
 
 bool NMEA_has3DFix()
 {
-  return (S_GPS.isValid()                       &&
-          S_GPS.age() < NMEA_EXP_TIME           &&
+  return (NMEA_hasFLARM() &&
           NMEA_Status.GPS == GNSS_STATUS_3D_MOVING);
 }
 
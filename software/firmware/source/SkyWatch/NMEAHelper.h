@@ -113,15 +113,13 @@ typedef struct nmea_status_struct {
  * Valid date is critical for legacy protocol (only).
  */
 #define NMEA_EXP_TIME  3500 /* 3.5 seconds */
-#define isValidNMEAFix()  ( nmea.location.isValid()               && \
-                            nmea.altitude.isValid()               && \
-                            nmea.date.isValid()                   && \
-                           (nmea.location.age() <= NMEA_EXP_TIME) && \
-                           (nmea.altitude.age() <= NMEA_EXP_TIME) && \
-                           (nmea.date.age()     <= NMEA_EXP_TIME))
+#define isValidNMEAFix()  NMEA_hasFix()
 
 #define NMEA_BUFFER_SIZE    128
 
+/* bytes taken from a serial, USB or Bluetooth link per NMEA_loop() pass */
+#define NMEA_CHUNK_SIZE     128
+
 #define PSRFC_VERSION       1
 
 void NMEA_setup(void);
@@ -132,6 +130,7 @@ bool NMEA_Save_Settings(void);
 
 bool NMEA_isConnected(void);
 bool NMEA_hasGNSS(void);
+bool NMEA_hasFix(void);
 bool NMEA_hasFLARM(void);
 bool NMEA_has3DFix(void);
 void NMEA_Out(uint8_t, byte *, size_t, bool);
@@ -68,6 +68,7 @@
 #define GDL90_DST_PORT    4000
 #define NMEA_UDP_PORT     10110
 #define NMEA_TCP_PORT     2000
+#define D1090_UDP_PORT    30002
 
 /*
  * Serial I/O default values.
@@ -141,6 +142,11 @@ typedef struct UFO {
     float     bearing;
     int8_t    alarm_level;
 
+    /* offset from own position in metres, see Traffic_Update() */
+    int32_t   north;
+    int32_t   east;
+    int32_t   up;
+
     /* bitmap of issued voice/tone/ble/... alerts */
     uint8_t   alert;
 
@@ -259,7 +265,14 @@ static inline uint32_t DevID_Mapper(uint32_t id)
   return id;
 }
 
-extern ufo_t ThisAircraft;
+#if defined(RASPBERRY_PI)
+/* radio, fusion and export threads keep their own copy of the shared state */
+#define SOFTRF_TLS  __thread
+#else
+#define SOFTRF_TLS
+#endif /* RASPBERRY_PI */
+
+extern SOFTRF_TLS ufo_t ThisAircraft;
 extern hardware_info_t hw_info;
 extern const float txrx_test_positions[90][2] PROGMEM;
 
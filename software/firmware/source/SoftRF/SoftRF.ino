@@ -395,7 +395,7 @@ void normal()
     }
 #endif /* EXCLUDE_EGM96 */
 
-    RF_Transmit(RF_Encode(&ThisAircraft), true);
+    RF_Transmit(RF_Encode(&ThisAircraft, true), true);
   }
 
   success = RF_Receive();
@@ -462,7 +462,7 @@ void uav()
     ThisAircraft.pressure_altitude = the_aircraft.location.baro_alt;
     ThisAircraft.hdop = the_aircraft.location.gps_hdop;
 
-    RF_Transmit(RF_Encode(&ThisAircraft), true);
+    RF_Transmit(RF_Encode(&ThisAircraft, true), true);
   }
 
   success = RF_Receive();
@@ -588,7 +588,7 @@ void txrx_test()
 #if DEBUG_TIMING
   tx_start_ms = millis();
 #endif
-  RF_Transmit(RF_Encode(&ThisAircraft), true);
+  RF_Transmit(RF_Encode(&ThisAircraft, true), true);
 #if DEBUG_TIMING
   tx_end_ms = millis();
   rx_start_ms = millis();
@@ -26,11 +26,68 @@
 
 unsigned long UpdateTrafficTimeMarker = 0;
 
-ufo_t fo, Container[MAX_TRACKING_OBJECTS], EmptyFO;
+ufo_t fo, EmptyFO;
+
+/*
+ * The index goes with the container it points into. On the RPi the fusion
+ * thread owns the live table, the export thread points Container at its
+ * snapshot copy and has no index, so Traffic_Find() there finds nothing.
+ */
+#if defined(USE_DYNAMIC_TRAFFIC_TABLE)
+SOFTRF_TLS ufo_t *Container = NULL;
+SOFTRF_TLS traffic_by_dist_t *traffic_by_dist = NULL;
+SOFTRF_TLS int Traffic_Capacity = 0;
+
+static SOFTRF_TLS traffic_slot_t *Traffic_Hash     = NULL;
+static SOFTRF_TLS traffic_slot_t *Traffic_Heap     = NULL;
+static SOFTRF_TLS traffic_slot_t *Traffic_Heap_Pos = NULL;
+static SOFTRF_TLS traffic_slot_t *Traffic_Free     = NULL;
+#else
+ufo_t Container[MAX_TRACKING_OBJECTS];
 traffic_by_dist_t traffic_by_dist[MAX_TRACKING_OBJECTS];
 
+static traffic_slot_t Traffic_Hash[TRAFFIC_HASH_SIZE(MAX_TRACKING_OBJECTS)];
+static traffic_slot_t Traffic_Heap[MAX_TRACKING_OBJECTS];
+static traffic_slot_t Traffic_Heap_Pos[MAX_TRACKING_OBJECTS];
+static traffic_slot_t Traffic_Free[MAX_TRACKING_OBJECTS];
+#endif /* USE_DYNAMIC_TRAFFIC_TABLE */
+
+static SOFTRF_TLS uint16_t Traffic_Hash_Mask  = 0;
+static SOFTRF_TLS int      Traffic_Hash_Count = 0;
+static SOFTRF_TLS int      Traffic_Heap_Size  = 0;
+static SOFTRF_TLS int      Traffic_Free_Count = 0;
+static SOFTRF_TLS bool     Traffic_Table_ready = false;
+static SOFTRF_TLS time_t   ClearExpiredTimeMarker = 0;
+static SOFTRF_TLS time_t   Traffic_No_Expired     = 0; /* last full scan in vain */
+
 static int8_t (*Alarm_Level)(ufo_t *, ufo_t *);
 
+/* sin() of 0...90 degrees, Q15 */
+static const uint16_t Traffic_Sine[91] PROGMEM = {
+      0,   572,  1144,  1715,  2286,  2856,  3425,  3993,  4560,  5126,
+   5690,  6252,  6813,  7371,  7927,  8481,  9032,  9580, 10126, 10668,
+  11207, 11743, 12275, 12803, 13328, 13848, 14365, 14876, 15384, 15886,
+  16384, 16877, 17364, 17847, 18324, 18795, 19261, 19720, 20174, 20622,
+  21063, 21498, 21926, 22348, 22763, 23170, 23571, 23965, 24351, 24730,
+  25102, 25466, 25822, 26170, 26510, 26842, 27166, 27482, 27789, 28088,
+  28378, 28660, 28932, 29197, 29452, 29698, 29935, 30163, 30382, 30592,
+  30792, 30983, 31164, 31336, 31499, 31651, 31795, 31928, 32052, 32166,
+  32270, 32365, 32449, 32524, 32588, 32643, 32688, 32723, 32748, 32763,
+  32768
+};
+
+/* sin() of an angle in whole degrees, Q15 */
+int32_t Traffic_sin_q15(int deg)
+{
+  deg %= 360;
+  if (deg < 0) deg += 360;
+
+  if (deg <= 90)  return  (int32_t) pgm_read_word(&Traffic_Sine[deg]);
+  if (deg <= 180) return  (int32_t) pgm_read_word(&Traffic_Sine[180 - deg]);
+  if (deg <= 270) return -(int32_t) pgm_read_word(&Traffic_Sine[deg - 180]);
+  return                 -(int32_t) pgm_read_word(&Traffic_Sine[360 - deg]);
+}
+
 /*
  * No any alarms issued by the firmware.
  * Rely upon high-level flight management software.
@@ -108,108 +165,710 @@ static int8_t Alarm_Vector(ufo_t *this_aircraft, ufo_t *fop)
 
 /*
  * "Legacy" method is based on short history of 2D velocity vectors (NS/EW)
+ *
+ * Both aircraft are flown ahead in 1 second steps along circular arcs,
+ * target's turn rate comes from its NS/EW samples and own turn rate from
+ * the change of own velocity vector between calls. Integer only:
+ * positions and velocities are Q4 (1/16 m, 1/16 m/s), rotations are Q15.
  */
+typedef struct alarm_motion_struct {
+  int32_t vn, ve;   /* velocity, Q4 m/s */
+  int32_t c, s;     /* rotation of velocity per step, Q15 */
+} alarm_motion_t;
+
+typedef struct alarm_ownship_struct {
+  time_t  timestamp;
+  int32_t vn, ve;   /* velocity at timestamp, Q4 m/s */
+  int32_t turn;     /* smoothed turn rate, Q15 rad/s, clockwise */
+} alarm_ownship_t;
+
+static SOFTRF_TLS alarm_ownship_t Alarm_Ownship;
+
+/*
+ * Q15 angle between two velocity vectors, clockwise.
+ * x = tan(a/2) = cross / (|u||v| + dot), with |u||v| taken as the mean
+ * of the squared lengths, and atan(x) ~ x / (1 + 0.28 x^2).
+ */
+static int32_t Alarm_Turn(int32_t n0, int32_t e0, int32_t n1, int32_t e1)
+{
+  int64_t cross = (int64_t) n0 * e1 - (int64_t) e0 * n1;
+  int64_t dot   = (int64_t) n0 * n1 + (int64_t) e0 * e1;
+  int64_t norm  = ((int64_t) n0 * n0 + (int64_t) e0 * e0 +
+                   (int64_t) n1 * n1 + (int64_t) e1 * e1) / 2;
+
+  if (norm + dot <= 0) {
+    return 0; /* no motion or turned half a circle */
+  }
+
+  int64_t x  = (cross << 15) / (norm + dot);
+  int64_t x2 = (x * x) >> 15;
+  return (int32_t) ((2 * x << 15) / (32768 + ((x2 * 9) >> 5)));
+}
+
+static inline int32_t Alarm_Turn_Rate(int32_t angle, int32_t seconds)
+{
+  angle /= seconds;
+
+  return constrain(angle, -ALARM_LEGACY_MAX_TURN, ALARM_LEGACY_MAX_TURN);
+}
+
+/* cos(a) and sin(a) to the second order, a is Q15 radians */
+static void Alarm_Rotation(alarm_motion_t *m, int32_t a)
+{
+  int32_t a2 = (a * a) >> 15;
+
+  m->c = 32768 - a2 / 2;
+  m->s = a - ((a2 * a) >> 15) / 6;
+}
+
+static inline void Alarm_Step(alarm_motion_t *m)
+{
+  int32_t vn = (m->vn * m->c - m->ve * m->s) >> 15;
+  int32_t ve = (m->ve * m->c + m->vn * m->s) >> 15;
+
+  m->vn = vn;
+  m->ve = ve;
+}
+
+/* CoG and GS into a Q4 m/s velocity vector */
+static void Alarm_Velocity(ufo_t *fop, int32_t *vn, int32_t *ve)
+{
+  int32_t speed = (int32_t) (fop->speed * _GPS_MPS_PER_KNOT * 16);
+  int     course = (int) fop->course;
+
+  *vn = (speed * Traffic_sin_q15(90 - course)) >> 15;
+  *ve = (speed * Traffic_sin_q15(course))      >> 15;
+}
+
 static int8_t Alarm_Legacy(ufo_t *this_aircraft, ufo_t *fop)
 {
 
   int8_t rval = ALARM_LEVEL_NONE;
+  alarm_ownship_t *own = &Alarm_Ownship;
+  alarm_motion_t o, t;
+
+  /* own turn rate, once per own position update */
+  if (this_aircraft->timestamp != own->timestamp) {
+    int32_t vn, ve;
+    time_t dt = this_aircraft->timestamp - own->timestamp;
+
+    Alarm_Velocity(this_aircraft, &vn, &ve);
+    if (dt > 0 && dt <= ALARM_LEGACY_TURN_HOLD) {
+      own->turn = (own->turn +
+                   Alarm_Turn_Rate(Alarm_Turn(own->vn, own->ve, vn, ve), dt)) / 2;
+    } else {
+      own->turn = 0;
+    }
+    own->timestamp = this_aircraft->timestamp;
+    own->vn = vn;
+    own->ve = ve;
+  }
+
+  int32_t alt_diff = (int32_t) (fop->altitude - this_aircraft->altitude);
+  int32_t distance = (int32_t) fop->distance;
+
+  /* too far to meet within the time horizon */
+  int32_t reach = (int32_t) ((this_aircraft->speed + fop->speed) * _GPS_MPS_PER_KNOT) *
+                  ALARM_LEGACY_HORIZON + ALARM_LEGACY_MISS_DISTANCE;
+  if (distance > reach || distance > ALARM_ZONE_NONE ||
+      abs(alt_diff) > VERTICAL_SEPARATION + ALARM_LEGACY_HORIZON * ALARM_LEGACY_MAX_VS) {
+    return rval;
+  }
+
+  o.vn = own->vn;
+  o.ve = own->ve;
+  Alarm_Rotation(&o, own->turn);
+
+  Alarm_Velocity(fop, &t.vn, &t.ve);
+  Alarm_Rotation(&t, 0);
+
+  /*
+   * Legacy packets carry 4 velocity samples, ALARM_LEGACY_VEC_INTERVAL
+   * apart, oldest first. CoG and GS are their average, so the current
+   * velocity is 1.5 intervals ahead of it along the turn.
+   */
+  if (fop->protocol == RF_PROTOCOL_LEGACY) {
+    int32_t turn = Alarm_Turn_Rate(
+                     Alarm_Turn(fop->ns[0], fop->ew[0], fop->ns[3], fop->ew[3]),
+                     3 * ALARM_LEGACY_VEC_INTERVAL);
+
+    Alarm_Rotation(&t, turn);
+    for (int i = 0; i < 3 * ALARM_LEGACY_VEC_INTERVAL / 2; i++) {
+      Alarm_Step(&t);
+    }
+  }
+
+  /* relative position and climb rate, Q4 */
+  int32_t pn = fop->north * 16;
+  int32_t pe = fop->east  * 16;
+  int32_t pz = alt_diff * 16;
+  int32_t vz = (int32_t) ((fop->vs - this_aircraft->vs) * 16 / (_GPS_FEET_PER_METER * 60.0));
+
+  for (int step = 0; step <= ALARM_LEGACY_HORIZON; step++) {
+    int32_t dn = pn >> 4;
+    int32_t de = pe >> 4;
+
+    if (dn * dn + de * de < ALARM_LEGACY_MISS_DISTANCE * ALARM_LEGACY_MISS_DISTANCE &&
+        abs(pz >> 4) < VERTICAL_SEPARATION) {
+      /* time limit values are compliant with FLARM data port specs */
+      if (step < 9) {
+        rval = ALARM_LEVEL_URGENT;
+      } else if (step < 13) {
+        rval = ALARM_LEVEL_IMPORTANT;
+      } else {
+        rval = ALARM_LEVEL_LOW;
+      }
+      break;
+    }
 
-  /* TBD */
+    Alarm_Step(&o);
+    Alarm_Step(&t);
+
+    pn += t.vn - o.vn;
+    pe += t.ve - o.ve;
+    pz += vz;
+  }
 
   return rval;
 }
 
+/*
+ * Hash index. Open addressing with linear probing,
+ * bucket holds a Container[] slot number or TRAFFIC_SLOT_NONE.
+ */
+static inline uint16_t Traffic_Hash_Home(uint32_t addr, uint8_t addr_type, uint8_t protocol)
+{
+  uint32_t h = (addr & 0x00FFFFFF) ^ ((uint32_t) addr_type << 24) ^
+               ((uint32_t) protocol << 28);
+
+  h *= 0x9E3779B1UL;
+  h ^= h >> 16;
+
+  return (uint16_t) (h & Traffic_Hash_Mask);
+}
+
+static inline bool Traffic_Key_Match(ufo_t *fop, uint32_t addr,
+                                     uint8_t addr_type, uint8_t protocol)
+{
+  return fop->addr      == addr      &&
+         fop->addr_type == addr_type &&
+         fop->protocol  == protocol;
+}
+
+static uint16_t Traffic_Hash_Lookup(uint32_t addr, uint8_t addr_type, uint8_t protocol)
+{
+  uint16_t i = Traffic_Hash_Home(addr, addr_type, protocol);
+
+  while (Traffic_Hash[i] != TRAFFIC_SLOT_NONE) {
+    if (Traffic_Key_Match(&Container[Traffic_Hash[i]], addr, addr_type, protocol)) {
+      return i;
+    }
+    i = (i + 1) & Traffic_Hash_Mask;
+  }
+
+  return TRAFFIC_SLOT_NONE;
+}
+
+static void Traffic_Hash_Insert(traffic_slot_t slot)
+{
+  ufo_t *fop = &Container[slot];
+  uint16_t i = Traffic_Hash_Home(fop->addr, fop->addr_type, fop->protocol);
+
+  while (Traffic_Hash[i] != TRAFFIC_SLOT_NONE) {
+    i = (i + 1) & Traffic_Hash_Mask;
+  }
+
+  Traffic_Hash[i] = slot;
+  Traffic_Hash_Count++;
+}
+
+/* backward shift deletion keeps probe sequences intact without tombstones */
+static void Traffic_Hash_Erase(uint16_t i)
+{
+  uint16_t j = i;
+
+  Traffic_Hash[i] = TRAFFIC_SLOT_NONE;
+  Traffic_Hash_Count--;
+
+  while (true) {
+    j = (j + 1) & Traffic_Hash_Mask;
+    if (Traffic_Hash[j] == TRAFFIC_SLOT_NONE) {
+      break;
+    }
+
+    ufo_t *fop = &Container[Traffic_Hash[j]];
+    uint16_t k = Traffic_Hash_Home(fop->addr, fop->addr_type, fop->protocol);
+
+    /* leave the entry in place if its home bucket is cyclically within (i, j] */
+    if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) {
+      continue;
+    }
+
+    Traffic_Hash[i] = Traffic_Hash[j];
+    Traffic_Hash[j] = TRAFFIC_SLOT_NONE;
+    i = j;
+  }
+}
+
+/*
+ * Eviction priority heap. Top of the heap is the entry
+ * to be replaced first when the table is full.
+ */
+static inline bool Traffic_Is_Less_Important(ufo_t *a, ufo_t *b)
+{
+  if (a->alarm_level != b->alarm_level) {
+    return a->alarm_level < b->alarm_level;
+  }
+
+  return a->distance > b->distance;
+}
+
+static inline void Traffic_Heap_Swap(int a, int b)
+{
+  traffic_slot_t tmp = Traffic_Heap[a];
+
+  Traffic_Heap[a] = Traffic_Heap[b];
+  Traffic_Heap[b] = tmp;
+  Traffic_Heap_Pos[Traffic_Heap[a]] = a;
+  Traffic_Heap_Pos[Traffic_Heap[b]] = b;
+}
+
+static void Traffic_Heap_Up(int n)
+{
+  while (n > 0) {
+    int parent = (n - 1) >> 1;
+
+    if (!Traffic_Is_Less_Important(&Container[Traffic_Heap[n]],
+                                   &Container[Traffic_Heap[parent]])) {
+      break;
+    }
+    Traffic_Heap_Swap(n, parent);
+    n = parent;
+  }
+}
+
+static void Traffic_Heap_Down(int n)
+{
+  while (true) {
+    int child = 2 * n + 1;
+
+    if (child >= Traffic_Heap_Size) {
+      break;
+    }
+    if (child + 1 < Traffic_Heap_Size &&
+        Traffic_Is_Less_Important(&Container[Traffic_Heap[child + 1]],
+                                  &Container[Traffic_Heap[child]])) {
+      child++;
+    }
+    if (!Traffic_Is_Less_Important(&Container[Traffic_Heap[child]],
+                                   &Container[Traffic_Heap[n]])) {
+      break;
+    }
+    Traffic_Heap_Swap(n, child);
+    n = child;
+  }
+}
+
+static void Traffic_Heap_Fix(traffic_slot_t slot)
+{
+  int n = Traffic_Heap_Pos[slot];
+
+  Traffic_Heap_Up(n);
+  Traffic_Heap_Down(Traffic_Heap_Pos[slot]);
+}
+
+static void Traffic_Slot_Release(traffic_slot_t slot)
+{
+  ufo_t *fop = &Container[slot];
+  int n = Traffic_Heap_Pos[slot];
+
+  if (n == TRAFFIC_SLOT_NONE) {
+    return;
+  }
+
+  if (fop->addr) {
+    uint16_t i = Traffic_Hash_Lookup(fop->addr, fop->addr_type, fop->protocol);
+    if (i != TRAFFIC_SLOT_NONE && Traffic_Hash[i] == slot) {
+      Traffic_Hash_Erase(i);
+    }
+  }
+
+  Traffic_Heap_Size--;
+  if (n != Traffic_Heap_Size) {
+    Traffic_Heap_Swap(n, Traffic_Heap_Size);
+    Traffic_Heap_Pos[slot] = TRAFFIC_SLOT_NONE;
+    Traffic_Heap_Fix(Traffic_Heap[n]);
+  } else {
+    Traffic_Heap_Pos[slot] = TRAFFIC_SLOT_NONE;
+  }
+
+  Traffic_Free[Traffic_Free_Count++] = slot;
+}
+
+static void Traffic_Table_init()
+{
+  int i;
+
+  for (i = 0; i < TRAFFIC_HASH_SIZE(MAX_TRACKING_OBJECTS); i++) {
+    Traffic_Hash[i] = TRAFFIC_SLOT_NONE;
+  }
+  Traffic_Hash_Mask  = TRAFFIC_HASH_SIZE(MAX_TRACKING_OBJECTS) - 1;
+  Traffic_Hash_Count = 0;
+  Traffic_Heap_Size  = 0;
+
+  /* lowest slots are handed out first */
+  Traffic_Free_Count = MAX_TRACKING_OBJECTS;
+  for (i = 0; i < MAX_TRACKING_OBJECTS; i++) {
+    Container[i] = EmptyFO;
+    Traffic_Heap_Pos[i] = TRAFFIC_SLOT_NONE;
+    Traffic_Free[i] = MAX_TRACKING_OBJECTS - 1 - i;
+  }
+
+  Traffic_Table_ready = true;
+}
+
+/*
+ * (Re)build the traffic table.
+ * Capacity is fixed at build time unless USE_DYNAMIC_TRAFFIC_TABLE is set.
+ */
+bool Traffic_Table_setup(int capacity)
+{
+#if defined(USE_DYNAMIC_TRAFFIC_TABLE)
+  if (capacity < 1) {
+    capacity = 1;
+  } else if (capacity > TRAFFIC_TABLE_LIMIT) {
+    capacity = TRAFFIC_TABLE_LIMIT;
+  }
+
+  if (Traffic_Table_ready && capacity == Traffic_Capacity) {
+    return true;
+  }
+
+  ufo_t *new_container = (ufo_t *) calloc(capacity, sizeof(ufo_t));
+  traffic_by_dist_t *new_by_dist = (traffic_by_dist_t *)
+                                   calloc(capacity, sizeof(traffic_by_dist_t));
+  traffic_slot_t *new_hash = (traffic_slot_t *)
+                             calloc(TRAFFIC_HASH_SIZE(capacity), sizeof(traffic_slot_t));
+  traffic_slot_t *new_heap = (traffic_slot_t *) calloc(capacity, sizeof(traffic_slot_t));
+  traffic_slot_t *new_pos  = (traffic_slot_t *) calloc(capacity, sizeof(traffic_slot_t));
+  traffic_slot_t *new_free = (traffic_slot_t *) calloc(capacity, sizeof(traffic_slot_t));
+
+  if (!new_container || !new_by_dist || !new_hash ||
+      !new_heap || !new_pos || !new_free) {
+    free(new_container); free(new_by_dist); free(new_hash);
+    free(new_heap);      free(new_pos);     free(new_free);
+    return false;
+  }
+
+  ufo_t          *old_container = Container;
+  traffic_slot_t *old_pos       = Traffic_Heap_Pos;
+  int             old_capacity  = Traffic_Table_ready ? Traffic_Capacity : 0;
+
+  free(traffic_by_dist); free(Traffic_Hash); free(Traffic_Heap); free(Traffic_Free);
+
+  Container        = new_container;
+  traffic_by_dist  = new_by_dist;
+  Traffic_Hash     = new_hash;
+  Traffic_Heap     = new_heap;
+  Traffic_Heap_Pos = new_pos;
+  Traffic_Free     = new_free;
+  Traffic_Capacity = capacity;
+
+  Traffic_Table_init();
+
+  /* carry live entries over, the least important ones drop out first */
+  for (int i = 0; i < old_capacity; i++) {
+    if (old_pos[i] != TRAFFIC_SLOT_NONE) {
+      Traffic_Insert(&old_container[i]);
+    }
+  }
+
+  free(old_container);
+  free(old_pos);
+#else
+  if (!Traffic_Table_ready) {
+    Traffic_Table_init();
+  }
+#endif /* USE_DYNAMIC_TRAFFIC_TABLE */
+
+  return true;
+}
+
+ufo_t *Traffic_Find(uint32_t addr, uint8_t addr_type, uint8_t protocol)
+{
+  if (!Traffic_Table_ready) {
+    return NULL;
+  }
+
+  uint16_t i = Traffic_Hash_Lookup(addr, addr_type, protocol);
+
+  return i == TRAFFIC_SLOT_NONE ? NULL : &Container[Traffic_Hash[i]];
+}
+
+/*
+ * A tracked entry past ENTRY_EXPIRATION_TIME, wherever it sits in the heap.
+ * Timestamps have 1 second resolution - a scan that found none holds
+ * until the next second.
+ */
+static traffic_slot_t Traffic_Find_Expired(time_t timestamp)
+{
+  if (timestamp == Traffic_No_Expired) {
+    return TRAFFIC_SLOT_NONE;
+  }
+
+  for (int n = 0; n < Traffic_Heap_Size; n++) {
+    traffic_slot_t slot = Traffic_Heap[n];
+
+    if (timestamp - Container[slot].timestamp > ENTRY_EXPIRATION_TIME) {
+      return slot;
+    }
+  }
+
+  Traffic_No_Expired = timestamp;
+
+  return TRAFFIC_SLOT_NONE;
+}
+
+/*
+ * Update an entry with the same (addr, addr_type, protocol) key
+ * or place a new one into a free slot, an expired slot or,
+ * when the table is full, instead of the least important entry.
+ *
+ * Entries without address (raw relay data) are not indexed.
+ *
+ * Returns NULL when the new entry is less important than any tracked one.
+ */
+ufo_t *Traffic_Insert(ufo_t *fop)
+{
+  traffic_slot_t slot;
+
+  if (fop->addr) {
+    uint16_t i = Traffic_Hash_Lookup(fop->addr, fop->addr_type, fop->protocol);
+
+    if (i != TRAFFIC_SLOT_NONE) {
+      slot = Traffic_Hash[i];
+
+      uint8_t alert_bak = Container[slot].alert;
+      Container[slot] = *fop;
+      Container[slot].alert = alert_bak;
+      Traffic_Heap_Fix(slot);
+
+      return &Container[slot];
+    }
+  }
+
+  if (Traffic_Free_Count == 0) {
+    time_t timestamp = now();
+
+    /* the room of an expired entry goes first, eviction by priority after */
+    slot = Traffic_Find_Expired(timestamp);
+
+    if (slot == TRAFFIC_SLOT_NONE) {
+      ufo_t *victim = &Container[Traffic_Heap[0]];
+
+      if (timestamp - victim->timestamp <= ENTRY_EXPIRATION_TIME) {
+#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
+        if (fop->addr == 0 || !Traffic_Is_Less_Important(victim, fop)) {
+          return NULL;
+        }
+#else
+        return NULL;
+#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
+      }
+
+      slot = Traffic_Heap[0];
+    }
+
+    Traffic_Slot_Release(slot);
+  }
+
+  slot = Traffic_Free[--Traffic_Free_Count];
+  Container[slot] = *fop;
+
+  if (fop->addr) {
+    Traffic_Hash_Insert(slot);
+  }
+
+  Traffic_Heap[Traffic_Heap_Size] = slot;
+  Traffic_Heap_Pos[slot] = Traffic_Heap_Size;
+  Traffic_Heap_Size++;
+  Traffic_Heap_Up(Traffic_Heap_Pos[slot]);
+
+  return &Container[slot];
+}
+
+void Traffic_Remove(ufo_t *fop)
+{
+  traffic_slot_t slot = fop - Container;
+
+  Traffic_Slot_Release(slot);
+  *fop = EmptyFO;
+}
+
+/*
+ * Local tangent plane anchored near own position. The anchor, and
+ * with it cos(latitude), only moves when own ship gets more than
+ * TRAFFIC_ENU_ANCHOR_RANGE away; in between a target costs a few
+ * multiply-adds instead of a great circle computation.
+ */
+typedef struct traffic_enu_struct {
+  bool    valid;
+  float   lat0, lon0;         /* anchor */
+  float   kn, ke;             /* metres per degree */
+  float   own_lat, own_lon;
+  float   own_n, own_e;       /* own position in the anchor frame */
+} traffic_enu_t;
+
+static SOFTRF_TLS traffic_enu_t Traffic_ENU;
+
+static inline float Traffic_dlon(float lon, float lon0)
+{
+  float dlon = lon - lon0;
+
+  if (dlon >  180.0f) dlon -= 360.0f;
+  if (dlon < -180.0f) dlon += 360.0f;
+
+  return dlon;
+}
+
+static void Traffic_ENU_Update(ufo_t *this_aircraft)
+{
+  traffic_enu_t *enu = &Traffic_ENU;
+
+  if (enu->valid &&
+      enu->own_lat == this_aircraft->latitude &&
+      enu->own_lon == this_aircraft->longitude) {
+    return;
+  }
+
+  for (int pass = 0; pass < 2; pass++) {
+    if (!enu->valid) {
+      enu->lat0  = this_aircraft->latitude;
+      enu->lon0  = this_aircraft->longitude;
+      enu->kn    = TRAFFIC_ENU_M_PER_DEG;
+      enu->ke    = TRAFFIC_ENU_M_PER_DEG * cosf(radians(enu->lat0));
+      enu->valid = true;
+    }
+
+    enu->own_lat = this_aircraft->latitude;
+    enu->own_lon = this_aircraft->longitude;
+    enu->own_n   = (enu->own_lat - enu->lat0) * enu->kn;
+    enu->own_e   = Traffic_dlon(enu->own_lon, enu->lon0) * enu->ke;
+
+    if (fabsf(enu->own_n) < TRAFFIC_ENU_ANCHOR_RANGE &&
+        fabsf(enu->own_e) < TRAFFIC_ENU_ANCHOR_RANGE) {
+      break;
+    }
+    enu->valid = false;
+  }
+}
+
+/* atan2() as a course, 0...360 degrees clockwise from north, within 0.3 degree */
+static float Traffic_Bearing(float n, float e)
+{
+  float an = fabsf(n);
+  float ae = fabsf(e);
+
+  if (an == 0 && ae == 0) {
+    return 0;
+  }
+
+  float r = an > ae ? ae / an : an / ae;
+  float a = r * (45.0f + 15.64f * (1.0f - r));
+
+  if (ae > an) a = 90.0f  - a;
+  if (n < 0)   a = 180.0f - a;
+  if (e < 0)   a = 360.0f - a;
+
+  return a;
+}
+
 void Traffic_Update(ufo_t *fop)
 {
-  fop->distance = gnss.distanceBetween( ThisAircraft.latitude,
-                                        ThisAircraft.longitude,
-                                        fop->latitude,
-                                        fop->longitude);
+  traffic_enu_t *enu = &Traffic_ENU;
 
-  fop->bearing  = gnss.courseTo( ThisAircraft.latitude,
-                                 ThisAircraft.longitude,
-                                 fop->latitude,
-                                 fop->longitude);
+  Traffic_ENU_Update(&ThisAircraft);
+
+  float n = (fop->latitude - enu->lat0) * enu->kn - enu->own_n;
+  float e = Traffic_dlon(fop->longitude, enu->lon0) * enu->ke - enu->own_e;
+
+  fop->north    = (int32_t) n;
+  fop->east     = (int32_t) e;
+  fop->up       = (int32_t) (fop->altitude - ThisAircraft.altitude);
+
+  fop->distance = sqrtf(n * n + e * e);
+  fop->bearing  = Traffic_Bearing(n, e);
 
   if (Alarm_Level) {
     fop->alarm_level = (*Alarm_Level)(&ThisAircraft, fop);
   }
+
+  /* keep eviction order of a tracked entry in sync */
+  if (fop >= Container && fop < Container + MAX_TRACKING_OBJECTS &&
+      Traffic_Heap_Pos[fop - Container] != TRAFFIC_SLOT_NONE) {
+    Traffic_Heap_Fix(fop - Container);
+  }
 }
 
-void ParseData()
+/* A diagnostic line goes out in one piece, the RPi radio thread shares StdOut */
+static void Traffic_println(const char *line)
+{
+#if defined(RASPBERRY_PI)
+  RPi_StdOut_println(line);
+#else
+  StdOut.println(line);
+#endif /* RASPBERRY_PI */
+}
+
+/*
+ * Decode the frame held in RxBuffer into 'fop'.
+ * Does not touch the traffic table, so that a radio thread can run it.
+ */
+bool Traffic_Decode(ufo_t *fop)
 {
     size_t rx_size = RF_Payload_Size(settings->rf_protocol);
-    rx_size = rx_size > sizeof(fo.raw) ? sizeof(fo.raw) : rx_size;
+    rx_size = rx_size > sizeof(fop->raw) ? sizeof(fop->raw) : rx_size;
 
 #if DEBUG
     Hex2Bin(TxDataTemplate, RxBuffer);
 #endif
 
-    memset(fo.raw, 0, sizeof(fo.raw));
-    memcpy(fo.raw, RxBuffer, rx_size);
+    memset(fop->raw, 0, sizeof(fop->raw));
+    memcpy(fop->raw, RxBuffer, rx_size);
 
     if (settings->nmea_p) {
-      StdOut.print(F("$PSRFI,"));
-      StdOut.print((unsigned long) now()); StdOut.print(F(","));
-      StdOut.print(Bin2Hex(fo.raw, rx_size)); StdOut.print(F(","));
-      StdOut.println(RF_last_rssi);
+      char line[sizeof(fop->raw) * 2 + 32];
+
+      snprintf(line, sizeof(line), "$PSRFI,%lu,%s,%d",
+               (unsigned long) now(), Bin2Hex(fop->raw, rx_size).c_str(),
+               (int) RF_last_rssi);
+      Traffic_println(line);
     }
 
     if (memcmp(RxBuffer, TxBuffer, rx_size) == 0) {
       if (settings->nmea_p) {
-        StdOut.println(F("$PSRFE,RF loopback is detected on Rx"));
+        Traffic_println("$PSRFE,RF loopback is detected on Rx");
       }
-      return;
+      return false;
     }
 
-    if (protocol_decode && (*protocol_decode)((void *) RxBuffer, &ThisAircraft, &fo)) {
-
-      int i;
+    if (protocol_decode && (*protocol_decode)((void *) RxBuffer, &ThisAircraft, fop)) {
 
-      fo.rssi = RF_last_rssi;
-
-      Traffic_Update(&fo);
-
-      for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-        if (Container[i].addr == fo.addr) {
-          uint8_t alert_bak = Container[i].alert;
-          Container[i] = fo;
-          Container[i].alert = alert_bak;
-          return;
-        }
-      }
+      fop->rssi = RF_last_rssi;
 
-      int max_dist_ndx = 0;
-      int min_level_ndx = 0;
+      return true;
+    }
 
-      for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-        if (now() - Container[i].timestamp > ENTRY_EXPIRATION_TIME) {
-          Container[i] = fo;
-          return;
-        }
-#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
-        if  (Container[i].distance > Container[max_dist_ndx].distance)  {
-          max_dist_ndx = i;
-        }
-        if  (Container[i].alarm_level < Container[min_level_ndx].alarm_level)  {
-          min_level_ndx = i;
-        }
-#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
-      }
+    return false;
+}
 
-#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
-      if (fo.alarm_level > Container[min_level_ndx].alarm_level) {
-        Container[min_level_ndx] = fo;
-        return;
-      }
+void ParseData()
+{
+    if (Traffic_Decode(&fo)) {
 
-      if (fo.distance    <  Container[max_dist_ndx].distance &&
-          fo.alarm_level >= Container[max_dist_ndx].alarm_level) {
-        Container[max_dist_ndx] = fo;
-        return;
-      }
-#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
+      Traffic_Update(&fo);
 
+      Traffic_Insert(&fo);
     }
 }
 
@@ -231,6 +890,12 @@ void Traffic_setup()
     Alarm_Level = &Alarm_Distance;
     break;
   }
+
+#if defined(USE_DYNAMIC_TRAFFIC_TABLE)
+  Traffic_Table_setup(Traffic_Capacity ? Traffic_Capacity : DEFAULT_TRACKING_OBJECTS);
+#else
+  Traffic_Table_setup(MAX_TRACKING_OBJECTS);
+#endif /* USE_DYNAMIC_TRAFFIC_TABLE */
 }
 
 void Traffic_loop()
@@ -248,7 +913,7 @@ void Traffic_loop()
           Container[i].alert |= TRAFFIC_ALERT_SOUND;
         }
       } else {
-        Container[i] = EmptyFO;
+        Traffic_Remove(&Container[i]);
       }
     }
 
@@ -258,24 +923,23 @@ void Traffic_loop()
 
 void ClearExpired()
 {
+  /* timestamps have 1 second resolution - no need to re-scan more often */
+  if (ThisAircraft.timestamp == ClearExpiredTimeMarker) {
+    return;
+  }
+
   for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
     if (Container[i].addr && (ThisAircraft.timestamp - Container[i].timestamp) > ENTRY_EXPIRATION_TIME) {
-      Container[i] = EmptyFO;
+      Traffic_Remove(&Container[i]);
     }
   }
+
+  ClearExpiredTimeMarker = ThisAircraft.timestamp;
 }
 
 int Traffic_Count()
 {
-  int count = 0;
-
-  for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-    if (Container[i].addr) {
-      count++;
-    }
-  }
-
-  return count;
+  return Traffic_Hash_Count;
 }
 
 int traffic_cmp_by_distance(const void *a, const void *b)
@@ -30,6 +30,16 @@
 #define VERTICAL_VISIBILITY_RANGE   500 /* value from Classic FLARM data port specs */
 #define VERTICAL_VISIBILITY_MAX    2000 /* limit for PowerFLARM */
 
+#define TRAFFIC_ENU_ANCHOR_RANGE    2000 /* metres, own travel before re-anchoring */
+#define TRAFFIC_ENU_M_PER_DEG       111226.3f /* TinyGPS++ earth radius */
+
+#define ALARM_LEGACY_HORIZON        18   /* seconds, FLARM low level limit */
+#define ALARM_LEGACY_MISS_DISTANCE  150  /* metres */
+#define ALARM_LEGACY_VEC_INTERVAL   4    /* seconds between NS/EW samples */
+#define ALARM_LEGACY_MAX_TURN       6000 /* Q15 rad/s, about 10 deg/s */
+#define ALARM_LEGACY_MAX_VS         30   /* m/s */
+#define ALARM_LEGACY_TURN_HOLD      4    /* seconds, own turn rate reset */
+
 #define TRAFFIC_VECTOR_UPDATE_INTERVAL 2 /* seconds */
 #define TRAFFIC_UPDATE_INTERVAL_MS (TRAFFIC_VECTOR_UPDATE_INTERVAL * 1000)
 #define isTimeToUpdateTraffic() (millis() - UpdateTrafficTimeMarker > \
@@ -40,6 +50,24 @@ typedef struct traffic_by_dist_struct {
   float distance;
 } traffic_by_dist_t;
 
+/*
+ * Traffic table is an arena of MAX_TRACKING_OBJECTS entries (Container[])
+ * with a hash index keyed by (addr, addr_type, protocol)
+ * and a binary heap of occupied slots ordered by eviction priority
+ * (lowest alarm level first, then the farthest one).
+ */
+typedef uint16_t traffic_slot_t;
+
+#define TRAFFIC_SLOT_NONE     0xFFFF
+#define TRAFFIC_TABLE_LIMIT   4096 /* max. capacity of a run time sized table */
+
+#define TRAFFIC_POW2_1(x)     ((x) | ((x) >> 1))
+#define TRAFFIC_POW2_2(x)     (TRAFFIC_POW2_1(x) | (TRAFFIC_POW2_1(x) >> 2))
+#define TRAFFIC_POW2_4(x)     (TRAFFIC_POW2_2(x) | (TRAFFIC_POW2_2(x) >> 4))
+#define TRAFFIC_POW2_8(x)     (TRAFFIC_POW2_4(x) | (TRAFFIC_POW2_4(x) >> 8))
+/* number of hash buckets - next power of two, at least twice the capacity */
+#define TRAFFIC_HASH_SIZE(n)  (TRAFFIC_POW2_8(2 * (n) - 1) + 1)
+
 enum
 {
 	TRAFFIC_ALARM_NONE,
@@ -56,10 +84,25 @@ void Traffic_loop(void);
 void ClearExpired(void);
 void Traffic_Update(ufo_t *);
 int  Traffic_Count(void);
+int32_t Traffic_sin_q15(int);
+
+bool   Traffic_Table_setup(int);
+ufo_t *Traffic_Find(uint32_t, uint8_t, uint8_t);
+ufo_t *Traffic_Insert(ufo_t *);
+void   Traffic_Remove(ufo_t *);
+bool   Traffic_Decode(ufo_t *);
 
 int  traffic_cmp_by_distance(const void *, const void *);
 
-extern ufo_t fo, Container[MAX_TRACKING_OBJECTS], EmptyFO;
+extern ufo_t fo, EmptyFO;
+
+#if defined(USE_DYNAMIC_TRAFFIC_TABLE)
+extern SOFTRF_TLS ufo_t *Container;
+extern SOFTRF_TLS traffic_by_dist_t *traffic_by_dist;
+extern SOFTRF_TLS int Traffic_Capacity;
+#else
+extern ufo_t Container[MAX_TRACKING_OBJECTS];
 extern traffic_by_dist_t traffic_by_dist[MAX_TRACKING_OBJECTS];
+#endif /* USE_DYNAMIC_TRAFFIC_TABLE */
 
 #endif /* TRAFFICHELPER_H */
@@ -65,6 +65,7 @@ bool   (*protocol_decode)(void *, ufo_t *, ufo_t *);
 
 static Slots_descr_t Time_Slots, *ts;
 static uint8_t       RF_timing = RF_TIMING_INTERVAL;
+static unsigned long RF_ref_time_ms = 0; /* start of current second, by RF_SetChannel() */
 
 extern const gnss_chip_ops_t *gnss_chip;
 
@@ -365,6 +366,7 @@ void RF_SetChannel(void)
     tm.Second = gnss.time.second();
 
     Time = makeTime(tm) + (gnss.time.age() - time_corr_neg) / 1000;
+    RF_ref_time_ms = ref_time_ms;
     break;
   }
 
@@ -400,6 +402,10 @@ void RF_SetChannel(void)
   Serial.print("Channel: "); Serial.println(chan);
 #endif
 
+  if (chan >= 0) {
+    RF_Tx_Budget_Select(RF_FreqPlan.Plan, RF_FreqPlan.getChanFrequency(chan), chan);
+  }
+
   if (RF_ready && rf_chip) {
     rf_chip->channel(chan);
   }
@@ -424,7 +430,7 @@ void RF_loop()
   }
 }
 
-size_t RF_Encode(ufo_t *fop)
+size_t RF_Encode(ufo_t *fop, bool wait)
 {
   size_t size = 0;
   if (RF_ready && protocol_encode) {
@@ -433,13 +439,59 @@ size_t RF_Encode(ufo_t *fop)
       return size;
     }
 
-    if (millis() > TxTimeMarker) {
+    if (!wait || millis() > TxTimeMarker) {
       size = (*protocol_encode)((void *) &TxBuffer[0], fop);
     }
   }
   return size;
 }
 
+/*
+ * Milliseconds left for one more packet in the time slot that is open
+ * now, 0 when the protocol has no time slots or none is open.
+ */
+unsigned long RF_Tx_Slot_Left()
+{
+  if (!RF_ready || ts == NULL || RF_timing != RF_TIMING_2SLOTS_PPS_SYNC) {
+    return 0;
+  }
+
+  unsigned long ms_since_boot = millis();
+  Slot_descr_t *slot[2] = { &ts->s0, &ts->s1 };
+
+  for (int i = 0; i < 2; i++) {
+    unsigned long elapsed = ms_since_boot - slot[i]->tmarker;
+
+    if (elapsed + ts->air_time < slot[i]->duration) {
+      return slot[i]->duration - elapsed - ts->air_time;
+    }
+  }
+
+  return 0;
+}
+
+static void RF_Tx_Schedule()
+{
+  Slot_descr_t *next;
+  unsigned long adj;
+
+  switch (RF_timing)
+  {
+  case RF_TIMING_2SLOTS_PPS_SYNC:
+    next = RF_FreqPlan.Channels == 1 ? &(ts->s0) :
+           ts->current          == 1 ? &(ts->s0) : &(ts->s1);
+    adj  = ts->current ? ts->adj   : 0;
+    TxTimeMarker = next->tmarker    +
+                   ts->interval_mid +
+                   SoC->random(adj, next->duration - ts->air_time);
+    break;
+  case RF_TIMING_INTERVAL:
+  default:
+    TxTimeMarker = millis() + SoC->random(ts->interval_min, ts->interval_max) - ts->air_time;
+    break;
+  }
+}
+
 bool RF_Transmit(size_t size, bool wait)
 {
   if (RF_ready && rf_chip && (size > 0)) {
@@ -453,10 +505,21 @@ bool RF_Transmit(size_t size, bool wait)
 
       time_t timestamp = now();
 
-      if (memcmp(TxBuffer, RxBuffer, RF_tx_size) != 0) {
+      if (RF_Tx_Budget_Left() < ts->air_time) {
+
+        /* skip this opportunity, the window has to slide first */
+        RF_Tx_Budget.deferred++;
+        RF_tx_size = 0;
+        RF_Tx_Schedule();
+
+        return false;
+
+      } else if (memcmp(TxBuffer, RxBuffer, RF_tx_size) != 0) {
 
         rf_chip->transmit();
 
+        RF_Tx_Budget_Charge(ts->air_time);
+
         if (settings->nmea_p) {
           StdOut.print(F("$PSRFO,"));
           StdOut.print((unsigned long) timestamp);
@@ -475,24 +538,7 @@ bool RF_Transmit(size_t size, bool wait)
 
       RF_tx_size = 0;
 
-      Slot_descr_t *next;
-      unsigned long adj;
-
-      switch (RF_timing)
-      {
-      case RF_TIMING_2SLOTS_PPS_SYNC:
-        next = RF_FreqPlan.Channels == 1 ? &(ts->s0) :
-               ts->current          == 1 ? &(ts->s0) : &(ts->s1);
-        adj  = ts->current ? ts->adj   : 0;
-        TxTimeMarker = next->tmarker    +
-                       ts->interval_mid +
-                       SoC->random(adj, next->duration - ts->air_time);
-        break;
-      case RF_TIMING_INTERVAL:
-      default:
-        TxTimeMarker = millis() + SoC->random(ts->interval_min, ts->interval_max) - ts->air_time;
-        break;
-      }
+      RF_Tx_Schedule();
 
       return true;
     }
@@ -500,6 +546,51 @@ bool RF_Transmit(size_t size, bool wait)
   return false;
 }
 
+/*
+ * Milliseconds until the radio has to be serviced for timing reasons:
+ * next channel hop, time slot switch or (when 'tx') Tx opportunity.
+ * Never more than one second.
+ */
+unsigned long RF_Time_To_Event(bool tx)
+{
+  unsigned long ms_since_boot = millis();
+  unsigned long ms = 1000 - ((ms_since_boot - RF_ref_time_ms) % 1000);
+
+  if (!RF_ready || ts == NULL) {
+    return ms;
+  }
+
+  if (RF_timing == RF_TIMING_2SLOTS_PPS_SYNC) {
+    Slot_descr_t *slot[2] = { &ts->s0, &ts->s1 };
+
+    for (int i = 0; i < 2; i++) {
+      long left = (long) (slot[i]->tmarker - ms_since_boot);
+
+      if (left <= 0) {
+        left += ts->interval_mid;
+      }
+      if (left <= 0) {
+        return 0;
+      }
+      ms = (unsigned long) left < ms ? left : ms;
+    }
+  }
+
+  if (tx && settings->txpower != RF_TX_POWER_OFF) {
+    long left = (long) (TxTimeMarker - ms_since_boot) + 1;
+
+    ms = left <= 0 ? 0 : ((unsigned long) left < ms ? left : ms);
+  }
+
+  return ms;
+}
+
+/* start of the current second the time slots are laid out from, 0 if none yet */
+unsigned long RF_Time_Reference()
+{
+  return RF_ref_time_ms;
+}
+
 bool RF_Receive(void)
 {
   bool rval = false;
@@ -1192,7 +1283,8 @@ static void sx12xx_rx_func (osjob_t* job) {
     sx12xx_receive_complete = true;
     break;
   case RF_CHECKSUM_TYPE_GALLAGER:
-    if (LDPC_Check((uint8_t  *) &LMIC.frame[0])) {
+    /* hard decision only, the SX12xx does Manchester decoding itself */
+    if (LDPC_Decode((uint8_t  *) &LMIC.frame[0])) {
 #if DEBUG
       Serial.printf(" %02x%02x%02x%02x%02x%02x is wrong FEC",
         LMIC.frame[i], LMIC.frame[i+1], LMIC.frame[i+2],
@@ -1643,12 +1735,14 @@ void cc13xx_Receive_callback(EasyLink_RxPacket *rxPacket_ptr, EasyLink_Status st
           (offset > 3 ? (rxPacket_ptr->payload[3] == cc13xx_protocol->syncword[7]) : true)) {
 
         uint8_t i, val1, val2;
+        uint8_t RxErr[sizeof(RxBuffer)]; /* Manchester errors, upper nibbles of ManchesterDecode */
         for (i = 0; i < size; i++) {
           val1 = pgm_read_byte(&ManchesterDecode[rxPacket_ptr->payload[i + offset]]);
           i++;
           val2 = pgm_read_byte(&ManchesterDecode[rxPacket_ptr->payload[i + offset]]);
           if ((i>>1) < sizeof(RxBuffer)) {
             RxBuffer[i>>1] = ((val1 & 0x0F) << 4) | (val2 & 0x0F);
+            RxErr[i>>1]    = (val1 & 0xF0) | (val2 >> 4);
 
             if (i < size - (cc13xx_protocol->crc_size + cc13xx_protocol->crc_size)) {
               switch (cc13xx_protocol->crc_type)
@@ -1669,7 +1763,7 @@ void cc13xx_Receive_callback(EasyLink_RxPacket *rxPacket_ptr, EasyLink_Status st
         switch (cc13xx_protocol->crc_type)
         {
         case RF_CHECKSUM_TYPE_GALLAGER:
-          if (LDPC_Check((uint8_t  *) &RxBuffer[0]) == 0) {
+          if (LDPC_Decode((uint8_t  *) &RxBuffer[0], RxErr) == 0) {
 
             success = true;
           }
@@ -2202,7 +2296,7 @@ static bool ognrf_receive()
     RxRSSI = TRX.ReadRSSI();
 
     TRX.ReadPacket(RxBuffer, Err);
-    if (LDPC_Check((uint8_t  *) RxBuffer) == 0) {
+    if (LDPC_Decode((uint8_t  *) RxBuffer, Err) == 0) {
       success = true;
     }
   }
@@ -35,6 +35,7 @@
 #include <freqplan.h>
 
 #include "GNSS.h"
+#include "../system/TxBudget.h"
 #include "../protocol/radio/Legacy.h"
 #include "../protocol/radio/OGNTP.h"
 #include "../protocol/radio/P3I.h"
@@ -110,9 +111,12 @@ uint8_t parity(uint32_t);
 byte    RF_setup(void);
 void    RF_SetChannel(void);
 void    RF_loop(void);
-size_t  RF_Encode(ufo_t *);
+size_t  RF_Encode(ufo_t *, bool);
 bool    RF_Transmit(size_t, bool);
 bool    RF_Receive(void);
+unsigned long RF_Time_To_Event(bool);
+unsigned long RF_Time_Reference(void);
+unsigned long RF_Tx_Slot_Left(void);
 void    RF_Shutdown(void);
 uint8_t RF_Payload_Size(uint8_t);
 
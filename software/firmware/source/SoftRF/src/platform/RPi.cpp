@@ -40,6 +40,11 @@
  *
  *  pi@raspberrypi $ wget -q -O - http://localhost:8080/data/aircraft.json | nc -N localhost 30007
  *
+ *  GDL90 and D1090 'TCP' output have listeners of their own,
+ *  on GDL90_TCP_PORT (4000) and D1090_TCP_PORT (30002):
+ *
+ *  pi@raspberrypi $ nc localhost 30002
+ *
  */
 
 #if defined(RASPBERRY_PI)
@@ -64,11 +69,19 @@
 #include "../driver/Battery.h"
 #include "../driver/Bluetooth.h"
 #include "../system/Time.h"
+#include "../system/Pipeline.h"
+#include "../system/Trace.h"
+#include "../system/Load.h"
+#include "../system/PPS.h"
 
 #include "TCPServer.h"
+#include "UDPFanout.h"
+#include "Reactor.h"
 
 #include <stdio.h>
-#include <sys/select.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include <iostream>
 
@@ -116,7 +129,8 @@ void onEvent (ev_t ev) {
 
 eeprom_t eeprom_block;
 settings_t *settings = &eeprom_block.field.settings;
-ufo_t ThisAircraft;
+SOFTRF_TLS ufo_t ThisAircraft;
+__thread int8_t Stage_Fix = -1;
 
 #if !defined(EXCLUDE_MAVLINK)
 aircraft the_aircraft;
@@ -146,7 +160,41 @@ unsigned long ExportTimeMarker = 0;
 
 std::string input_line;
 
+/*
+ * The main thread sleeps in Main_Reactor until standard input, a traffic
+ * TCP message, a pipeline stage or the PPS line has something for it,
+ * or until the next export deadline. The radio thread sleeps in
+ * Radio_Reactor until DIO0 (SX1276 PayloadReady) fires or until the
+ * next Tx, time slot or channel hop deadline.
+ */
+#define MAIN_TICK_MS      250 /* housekeeping: display, expiry, PGRMZ */
+#define RADIO_POLL_MS     5   /* when no DIO line is available */
+#define STDIN_LINE_MAX    65536
+
+static Reactor Main_Reactor;
+static Reactor Radio_Reactor;
+
+static int  Stdin_fd   = STDIN_FILENO;
+static bool Stdin_poll = false; /* regular file, epoll can not watch it */
+static std::string Stdin_pending;
+
+static int  DIO_fd     = -1;
+static int  UAT_fd     = -1; /* UAT receiver module serial port */
+static int  PPS_fd     = -1;
+
 TCPServer Traffic_TCP_Server;
+UDPFanout Traffic_UDP_Out;
+
+/* output only listeners, the traffic server above takes input only */
+static TCPServer GDL90_TCP_Server;
+static TCPServer D1090_TCP_Server;
+
+static void RPi_TCP_detach()
+{
+  GDL90_TCP_Server.detach();
+  D1090_TCP_Server.detach();
+  Traffic_TCP_Server.detach();
+}
 
 #if defined(USE_EPAPER)
 GxEPD2_BW<GxEPD2_270, GxEPD2_270::HEIGHT> __attribute__ ((common)) epd_waveshare(GxEPD2_270(/*CS=5*/ 8,
@@ -183,9 +231,120 @@ const char *Hardware_Rev[] = {
 
 #include "mode-s.h"
 #include "sdr/common.h"
+#include "sdr/wisdom.h"
+
+#if MODE_S_AIRCRAFT_MAX < TRAFFIC_TABLE_LIMIT
+#error "libmodes aircraft table is smaller than the largest traffic table"
+#endif
 
 mode_s_t state;
 
+/* The traffic table may have been resized, libmodes follows its capacity */
+static void RPi_Traffic_setup()
+{
+  Traffic_setup();
+
+  /* known aircraft are followed at any count, new ones while there is room */
+  state.aircraft_max = MAX_TRACKING_OBJECTS;
+}
+
+/*
+ * Normal mode runs as a pipeline of threads:
+ *
+ *  radio  - RF Tx of own ship, Rx and decode of traffic  -> Radio_Ring
+ *  demod  - Mode-S demodulation of SDR samples           -> ModeS_Ring
+ *  fusion - the main thread. GNSS and JSON input, traffic table,
+ *           display. Publishes snapshots of own ship and traffic.
+ *  export - NMEA, GDL90, D1090 and JSON output of the latest snapshot
+ *
+ * Relay and Tx/Rx test modes keep all the work in the main thread.
+ */
+typedef struct radio_item_struct {
+  ufo_t    fo;
+  uint32_t stamp; /* us */
+} radio_item_t;
+
+typedef struct traffic_snapshot_struct {
+  ufo_t    ownship;
+  bool     fix;
+  int      capacity;
+  ufo_t    *traffic;
+  uint32_t stamp;  /* us */
+  uint64_t sample; /* ms, oldest IQ samples behind it, 0 if none */
+  bool     last;   /* IQ replay: nothing is left to demodulate */
+} traffic_snapshot_t;
+
+static SPSC_Ring<radio_item_t, 64> Radio_Ring;
+
+static Stage_Stats_t Radio_Stats  = { "RADIO"  };
+static Stage_Stats_t Export_Stats = { "EXPORT" };
+
+#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR) || \
+    defined(ENABLE_IFILE)
+typedef struct modes_item_struct {
+  struct mode_s_msg mm;
+  uint32_t          stamp;  /* us */
+  uint64_t          sample; /* ms, system time of the IQ samples */
+} modes_item_t;
+
+#define MODES_RING_SIZE 256
+
+static SPSC_Ring<modes_item_t, MODES_RING_SIZE> ModeS_Ring;
+
+static Stage_Stats_t ModeS_Stats  = { "MODES"  };
+
+/* oldest IQ samples behind the messages since the last snapshot */
+static uint64_t ModeS_Sample = 0;
+/* the demodulator has run out of samples */
+static std::atomic<bool> ModeS_Done(false);
+static pthread_t ModeS_demod_thread;
+#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR || ENABLE_IFILE */
+
+#if defined(ENABLE_IFILE)
+/*
+ * IQ capture replay through the ES1090 path, totals over the whole run.
+ * End to end is from the system time of the samples to the NMEA export
+ * of the first snapshot that carries their messages.
+ */
+typedef struct replay_stats_struct {
+  std::atomic<uint32_t>      frames;    /* demodulated, good CRC or not */
+  std::atomic<uint32_t>      crc_ok;
+  std::atomic<uint32_t>      e2e_count;
+  std::atomic<uint32_t>      e2e_sum;   /* ms */
+  std::atomic<uint32_t>      e2e_max;   /* ms */
+  std::atomic<unsigned long> start;     /* millis() */
+  std::atomic<unsigned long> end;       /* millis(), set with ModeS_Done */
+} replay_stats_t;
+
+static replay_stats_t Replay_Stats;
+/* the last snapshot of the capture is out, the main thread shuts down */
+static std::atomic<bool> Replay_End(false);
+#endif /* ENABLE_IFILE */
+
+/* an IQ capture takes the place of the SDR receiver */
+static bool Replay = false;
+
+/* RF chip access; taken by the radio thread, relay/test loops and RF_setup() */
+static pthread_mutex_t Radio_lock  = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+/* 'gnss' is written by fusion and read by RF_loop() on the radio thread */
+static pthread_mutex_t GNSS_lock   = PTHREAD_MUTEX_INITIALIZER;
+/* export routines keep static buffers, StdOut is shared by all loops;
+ * relay and test loops hold it while they echo GNSS input */
+static pthread_mutex_t Export_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static pthread_mutex_t Ownship_lock = PTHREAD_MUTEX_INITIALIZER;
+static ufo_t Ownship;
+static bool  Ownship_Fix = false;
+
+/* triple buffer: fusion fills 'Back', export reads 'Front' */
+static traffic_snapshot_t Snapshot[3];
+static traffic_snapshot_t *Snapshot_Back  = &Snapshot[0];
+static traffic_snapshot_t *Snapshot_Ready = &Snapshot[1];
+static traffic_snapshot_t *Snapshot_Front = &Snapshot[2];
+static bool Snapshot_Fresh = false;
+static pthread_mutex_t Snapshot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  Snapshot_cond = PTHREAD_COND_INITIALIZER;
+
 //-------------------------------------------------------------------------
 //
 // The MIT License (MIT)
@@ -334,8 +493,26 @@ static bool prev_PPS_state = LOW;
 
 static void RPi_loop()
 {
+  uint64_t edge;
+
+  if (PPS_Source() != PPS_SOURCE_NONE) {
+    /* time of the edge by the kernel, however late this gets to see it */
+    if (PPS_Poll(&edge)) {
+      if (PPS_TimeMarker && RF_Time_Reference()) {
+        PPS_Align(RF_Time_Reference(), PPS_TimeMarker);
+      }
+      PPS_TimeMarker = (unsigned long) (edge / 1000);
+    }
+    return;
+  }
+
 #if SOC_GPIO_PIN_GNSS_PPS != SOC_UNUSED_PIN
-  if (digitalPinToInterrupt(SOC_GPIO_PIN_GNSS_PPS) == NOT_AN_INTERRUPT) {
+  if (PPS_fd >= 0) {
+    if (Main_Reactor.ready(PPS_fd)) {
+      Reactor::gpio_ack(PPS_fd);
+      PPS_TimeMarker = millis();
+    }
+  } else if (digitalPinToInterrupt(SOC_GPIO_PIN_GNSS_PPS) == NOT_AN_INTERRUPT) {
     bool PPS_state = digitalRead(SOC_GPIO_PIN_GNSS_PPS);
 
     if (PPS_state == HIGH && prev_PPS_state == LOW) {
@@ -373,9 +550,39 @@ static long RPi_random(long howsmall, long howBig)
   return howsmall + random() % (howBig - howsmall);
 }
 
+/*
+ * Sentences are only queued here, the export cycle sends them
+ * with one Traffic_UDP_Out.flush()
+ */
 static void RPi_WiFi_transmit_UDP(int port, byte *buf, size_t size)
 {
-  /* TBD */
+  Traffic_UDP_Out.queue(port, buf, size);
+}
+
+/*
+ * GDL90 and D1090 'TCP' output, each to the clients of its own listener
+ */
+void RPi_TCP_transmit(int port, byte *buf, size_t size)
+{
+  switch (port)
+  {
+  case GDL90_TCP_PORT:
+    GDL90_TCP_Server.Send(buf, size);
+    break;
+  case D1090_TCP_PORT:
+    D1090_TCP_Server.Send(buf, size);
+    break;
+  default:
+    break;
+  }
+}
+
+/* A complete line from a thread other than the export one */
+void RPi_StdOut_println(const char *line)
+{
+  pthread_mutex_lock(&Export_lock);
+  StdOut.println(line);
+  pthread_mutex_unlock(&Export_lock);
 }
 
 static void RPi_SPI_begin()
@@ -586,26 +793,56 @@ const SoC_ops_t RPi_ops = {
   NULL
 };
 
-static bool inputAvailable()
+/* Returns true when a complete line has been placed into input_line */
+static bool RPi_ReadLine()
 {
-  struct timeval tv;
-  fd_set fds;
-  tv.tv_sec = 0;
-  tv.tv_usec = 0;
-  FD_ZERO(&fds);
-  FD_SET(STDIN_FILENO, &fds);
-  select(STDIN_FILENO+1, &fds, NULL, NULL, &tv);
-  return (FD_ISSET(0, &fds));
+  size_t eol = Stdin_pending.find('\n');
+
+  if (eol == std::string::npos && Stdin_fd >= 0 &&
+      (Stdin_poll || Main_Reactor.ready(Stdin_fd))) {
+    char buf[4096];
+    ssize_t n = read(Stdin_fd, buf, sizeof(buf));
+
+    /* one read per wake up, the next one might block */
+    Main_Reactor.clear(Stdin_fd);
+
+    if (n > 0) {
+      Stdin_pending.append(buf, n);
+      eol = Stdin_pending.find('\n');
+    } else if (n == 0 || (errno != EINTR && errno != EAGAIN)) {
+      /* end of input */
+      if (!Stdin_poll) {
+        Main_Reactor.remove(Stdin_fd);
+      }
+      Stdin_fd = -1;
+    }
+  }
+
+  if (eol == std::string::npos) {
+    if (Stdin_pending.length() > STDIN_LINE_MAX) {
+      Stdin_pending.clear();
+    }
+    return false;
+  }
+
+  input_line.assign(Stdin_pending, 0, eol);
+  Stdin_pending.erase(0, eol + 1);
+
+  return true;
 }
 
 static void parseNMEA(const char *str, int len)
 {
   // NMEA input
+  pthread_mutex_lock(&GNSS_lock);
   for (int i=0; i < len; i++) {
     gnss.encode(str[i]);
   }
+  pthread_mutex_unlock(&GNSS_lock);
   if (settings->nmea_g) {
+    pthread_mutex_lock(&Export_lock);
     NMEA_Out(settings->nmea_out, (byte *) str, len, true);
+    pthread_mutex_unlock(&Export_lock);
   }
 
   GNSSTimeSync();
@@ -635,8 +872,7 @@ static void parseNMEA(const char *str, int len)
 
 static void RPi_PickGNSSFix()
 {
-  if (inputAvailable()) {
-    std::getline(std::cin, input_line);
+  while (RPi_ReadLine()) {
     const char *str = input_line.c_str();
     int len = input_line.length();
 
@@ -659,8 +895,11 @@ static void RPi_PickGNSSFix()
         } else if (!strcmp(msg_class_s,"SOFTRF")) {
           parseSettings(root);
 
+          pthread_mutex_lock(&Radio_lock);
           RF_setup();
-          Traffic_setup();
+          pthread_mutex_unlock(&Radio_lock);
+          Radio_Reactor.wakeup();
+          RPi_Traffic_setup();
         }
       }
 
@@ -685,16 +924,19 @@ static void RPi_PickGNSSFix()
 
 static void RPi_ReadTraffic()
 {
-  string traffic_input = Traffic_TCP_Server.getMessage();
-  if (traffic_input != "") {
-    const char *str = traffic_input.c_str();
-    int len = traffic_input.length();
+  char *str;
+  size_t len;
+  /* bounded by the queue depth so that a busy feeder can not starve us */
+  int budget = QUEUEDEPTH;
+
+  while (budget-- > 0 && (str = Traffic_TCP_Server.getMessage(&len)) != NULL) {
 
     if (str[0] == '{') {
       // JSON input
 
-//    cout << "Traffic message:" << traffic_input << endl;
+//    cout << "Traffic message:" << str << endl;
 
+      /* parse in place, the queue slot stays ours until clean() */
       JsonObject& root = jsonBuffer.parseObject(str);
 
       JsonVariant msg_class = root["class"];
@@ -705,8 +947,11 @@ static void RPi_ReadTraffic()
         if (!strcmp(msg_class_s,"SOFTRF")) {
           parseSettings(root);
 
+          pthread_mutex_lock(&Radio_lock);
           RF_setup();
-          Traffic_setup();
+          pthread_mutex_unlock(&Radio_lock);
+          Radio_Reactor.wakeup();
+          RPi_Traffic_setup();
         }
       }
 
@@ -732,7 +977,7 @@ static void RPi_ReadTraffic()
       jsonBuffer.clear();
     } else if (str[0] == 'q') {
       if (len >= 4 && str[1] == 'u' && str[2] == 'i' && str[3] == 't') {
-        Traffic_TCP_Server.detach();
+        RPi_TCP_detach();
         fprintf( stderr, "Program termination.\n" );
         exit(EXIT_SUCCESS);
       }
@@ -742,114 +987,194 @@ static void RPi_ReadTraffic()
   }
 }
 
-void normal_loop()
+static void RPi_Ownship_publish()
 {
-    /* Read GNSS data from standard input */
-    RPi_PickGNSSFix();
+  bool fix = isValidFix();
 
-    /* Read NMEA data from GNSS module on GPIO pins */
-//    PickGNSSFix();
+  pthread_mutex_lock(&Ownship_lock);
+  bool changed = (Ownship_Fix != fix);
+  Ownship     = ThisAircraft;
+  Ownship_Fix = fix;
+  pthread_mutex_unlock(&Ownship_lock);
 
-    RPi_ReadTraffic();
+  if (changed) {
+    /* start or stop own ship transmissions right away */
+    Radio_Reactor.wakeup();
+  }
+}
 
-    RF_loop();
+static void RPi_Radio_drain()
+{
+  radio_item_t item;
 
-    ThisAircraft.timestamp = now();
+  while (Radio_Ring.pop(item)) {
+    Radio_Stats.latency(micros() - item.stamp);
 
     if (isValidFix()) {
-      RF_Transmit(RF_Encode(&ThisAircraft), true);
-    }
+      fo = item.fo;
 
-    bool success = RF_Receive();
+      Traffic_Update(&fo);
 
-    if (success && isValidFix()) ParseData();
+      Traffic_Insert(&fo);
+    }
+  }
+}
 
-    if (isValidFix()) {
-      Traffic_loop();
+static void RPi_Snapshot_publish()
+{
+  traffic_snapshot_t *snap = Snapshot_Back;
+
+  if (snap->capacity != MAX_TRACKING_OBJECTS) {
+    ufo_t *traffic = (ufo_t *) realloc(snap->traffic,
+                                       MAX_TRACKING_OBJECTS * sizeof(ufo_t));
+    if (traffic == NULL) {
+      Export_Stats.drops++;
+      return;
     }
+    snap->traffic  = traffic;
+    snap->capacity = MAX_TRACKING_OBJECTS;
+  }
 
-    if (isTimeToExport()) {
+  memcpy(snap->traffic, Container, snap->capacity * sizeof(ufo_t));
+  snap->ownship = ThisAircraft;
+  snap->fix     = isValidFix();
+  snap->stamp   = micros();
+#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR) || \
+    defined(ENABLE_IFILE)
+  snap->sample  = ModeS_Sample;
+  snap->last    = Replay && ModeS_Done && ModeS_Ring.depth() == 0;
+  ModeS_Sample  = 0;
+#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR || ENABLE_IFILE */
+
+  pthread_mutex_lock(&Snapshot_lock);
+  if (Snapshot_Fresh) {
+    /* export thread did not keep up, previous snapshot is lost */
+    Export_Stats.drops++;
+  }
+  Snapshot_Back  = Snapshot_Ready;
+  Snapshot_Ready = snap;
+  Snapshot_Fresh = true;
+  pthread_cond_signal(&Snapshot_cond);
+  pthread_mutex_unlock(&Snapshot_lock);
+}
 
-#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR)
+/* ES1090 targets tracked by libmodes, into the traffic table */
+static void RPi_ModeS_traffic()
+{
   struct mode_s_aircraft *a;
-  int i = 0;
 
   for (a = state.aircrafts; a; a = a->next) {
-    if (a->even_cprtime && a->odd_cprtime &&
-        abs((long) (a->even_cprtime - a->odd_cprtime)) <= MODE_S_INTERACTIVE_TTL * 1000 ) {
+    if (a->seen_latlon && !a->latlon_provisional) {
       if (es1090_decode(a, &ThisAircraft, &fo)) {
         memset(fo.raw, 0, sizeof(fo.raw));
 
         Traffic_Update(&fo);
 
-        for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-          if (Container[i].addr == fo.addr) {
-            uint8_t alert_bak = Container[i].alert;
-            Container[i] = fo;
-            Container[i].alert = alert_bak;
-            break;
-          }
-        }
-        if (i < MAX_TRACKING_OBJECTS) continue;
-
-        int max_dist_ndx = 0;
-        int min_level_ndx = 0;
-
-        for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-          if (now() - Container[i].timestamp > ENTRY_EXPIRATION_TIME) {
-            Container[i] = fo;
-            break;
-          }
-#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
-          if (Container[i].distance > Container[max_dist_ndx].distance) {
-            max_dist_ndx = i;
-          }
-          if (Container[i].alarm_level < Container[min_level_ndx].alarm_level) {
-            min_level_ndx = i;
-          }
-#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
-        }
-        if (i < MAX_TRACKING_OBJECTS) continue;
-
-#if !defined(EXCLUDE_TRAFFIC_FILTER_EXTENSION)
-        if (fo.alarm_level > Container[min_level_ndx].alarm_level) {
-          Container[min_level_ndx] = fo;
-          continue;
-        }
-
-        if (fo.distance    <  Container[max_dist_ndx].distance &&
-            fo.alarm_level >= Container[max_dist_ndx].alarm_level) {
-          Container[max_dist_ndx] = fo;
-          continue;
-        }
-#endif /* EXCLUDE_TRAFFIC_FILTER_EXTENSION */
+        Traffic_Insert(&fo);
       }
     }
   }
 
   interactiveRemoveStaleAircrafts(&state);
-#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR */
+}
 
-      NMEA_Export();
+void normal_loop()
+{
+    /* Read GNSS data from standard input */
+    RPi_PickGNSSFix();
 
-      if (isValidFix()) {
-        GDL90_Export();
-        D1090_Export();
-        JSON_Export();
-      }
-      ExportTimeMarker = millis();
+    /* Read NMEA data from GNSS module on GPIO pins */
+//    PickGNSSFix();
+
+    RPi_ReadTraffic();
+
+    ThisAircraft.timestamp = now();
+
+    RPi_Ownship_publish();
+
+    /* Traffic decoded by the radio thread */
+    RPi_Radio_drain();
+
+    if (isValidFix()) {
+      Traffic_loop();
     }
 
-    // Handle Air Connect
-    NMEA_loop();
+    if (isTimeToExport()) {
+
+#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR) || \
+    defined(ENABLE_IFILE)
+      RPi_ModeS_traffic();
+#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR || ENABLE_IFILE */
+
+      RPi_Snapshot_publish();
+
+      ExportTimeMarker = millis();
+    }
 
     SoC->Display_loop();
 
     ClearExpired();
 }
 
+/*
+ * Next target to relay: highest alarm level first, then the nearest one.
+ * With the Tx budget running low only the traffic around us goes out.
+ */
+static ufo_t *RPi_Relay_Next(size_t size)
+{
+  ufo_t *best = NULL;
+  bool low = RF_Tx_Budget_Low();
+
+  for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    ufo_t *fop = &Container[i];
+
+    if (memcmp(fop->raw, EmptyFO.raw, size) == 0 &&
+        !(isValidFix() &&
+          fop->addr &&
+          fop->latitude  != 0.0 &&
+          fop->longitude != 0.0 &&
+          fop->altitude  != 0.0 &&
+          fop->distance < (ALARM_ZONE_NONE * 2))) {
+      continue;
+    }
+
+    if (low && fop->alarm_level == ALARM_LEVEL_NONE &&
+        fop->distance >= ALARM_ZONE_NONE) {
+      continue;
+    }
+
+    if (best == NULL ||
+        fop->alarm_level > best->alarm_level ||
+        (fop->alarm_level == best->alarm_level &&
+         fop->distance    <  best->distance)) {
+      best = fop;
+    }
+  }
+
+  return best;
+}
+
+static void RPi_TxB_report()
+{
+  char buf[80];
+  Tx_Budget_t *b = &RF_Tx_Budget;
+
+  snprintf(buf, sizeof(buf), "$PSRFS,TXB,%d,%s,%lu,%lu,%lu,%lu",
+           b->channel, RF_Subband_Name(b->subband),
+           RF_Tx_Budget_Spent(),
+           RF_Tx_Budget_Left(),
+           (unsigned long) b->packets,
+           (unsigned long) b->deferred);
+  b->packets  = 0;
+  b->deferred = 0;
+
+  StdOut.println(buf);
+}
+
 void relay_loop()
 {
+    static unsigned long StatsTimeMarker = 0;
+
     /* Read GNSS data from standard input */
     RPi_PickGNSSFix();
 
@@ -860,38 +1185,45 @@ void relay_loop()
 
     RF_loop();
 
-    for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      size_t size = RF_Payload_Size(settings->rf_protocol);
-      size = size > sizeof(Container[i].raw) ? sizeof(Container[i].raw) : size;
+    size_t size = RF_Payload_Size(settings->rf_protocol);
+    size = size > sizeof(EmptyFO.raw) ? sizeof(EmptyFO.raw) : size;
+
+    /*
+     * Follow duty cycle rule: the first packet waits for the Tx opportunity,
+     * the rest of the batch goes out in the same time slot while it is open.
+     */
+    for (int n = 0; n < RF_TX_BATCH_MAX; n++) {
+      bool wait = (n == 0);
+      bool sent;
+
+      if (!wait && RF_Tx_Slot_Left() == 0) {
+        break;
+      }
 
-      if (memcmp (Container[i].raw, EmptyFO.raw, size) != 0) {
+      ufo_t *fop = RPi_Relay_Next(size);
+      if (fop == NULL) {
+        break;
+      }
+
+      if (memcmp(fop->raw, EmptyFO.raw, size) != 0) {
         // Raw data
         size_t tx_size = sizeof(TxBuffer) > size ? size : sizeof(TxBuffer);
-        memcpy(TxBuffer, Container[i].raw, tx_size);
+        memcpy(TxBuffer, fop->raw, tx_size);
 
-        if (tx_size > 0) {
-          /* Follow duty cycle rule */
-          if (RF_Transmit(tx_size, true /* false */)) {
+        sent = RF_Transmit(tx_size, wait);
 #if 0
-            String str = Bin2Hex(TxBuffer, tx_size);
-            printf("%s\n", str.c_str());
-#endif
-            Container[i] = EmptyFO;
-          }
+        if (sent) {
+          String str = Bin2Hex(TxBuffer, tx_size);
+          printf("%s\n", str.c_str());
         }
-      } else if (isValidFix() &&
-                 Container[i].addr &&
-                 Container[i].latitude  != 0.0 &&
-                 Container[i].longitude != 0.0 &&
-                 Container[i].altitude  != 0.0 &&
-                 Container[i].distance < (ALARM_ZONE_NONE * 2) ) {
-
-        fo = Container[i];
+#endif
+      } else {
+        fo = *fop;
         fo.timestamp = now(); /* GNSS date&time */
 
-        /* Follow duty cycle rule */
-        if (RF_Transmit(RF_Encode(&fo), true /* false */)) {
+        sent = RF_Transmit(RF_Encode(&fo, wait), wait);
 #if 0
+        if (sent) {
           printf("%06X %f %f %f %d %d %d\n",
               fo.addr,
               fo.latitude,
@@ -900,10 +1232,21 @@ void relay_loop()
               fo.addr_type,
               (int) fo.vs,
               fo.aircraft_type);
-#endif
-          Container[i] = EmptyFO;
         }
+#endif
       }
+
+      if (!sent) {
+        break;
+      }
+
+      Traffic_Remove(fop);
+    }
+
+    if (settings->nmea_p &&
+        (millis() - StatsTimeMarker) > PIPELINE_STATS_INTERVAL) {
+      RPi_TxB_report();
+      StatsTimeMarker = millis();
     }
 }
 
@@ -945,7 +1288,7 @@ void txrx_test_loop()
   tx_start_ms = millis();
 #endif
 
-  RF_Transmit(RF_Encode(&ThisAircraft), true);
+  RF_Transmit(RF_Encode(&ThisAircraft, true), true);
 
 #if DEBUG_TIMING
   tx_end_ms = millis();
@@ -974,6 +1317,7 @@ void txrx_test_loop()
     NMEA_Export();
     GDL90_Export();
     D1090_Export();
+    Traffic_UDP_Out.flush();
     ExportTimeMarker = millis();
   }
 #if DEBUG_TIMING
@@ -1015,20 +1359,367 @@ void txrx_test_loop()
 }
 
 
+/* I/O loop of the TCPServer passed in 'm' */
 void * traffic_tcpserv_loop(void * m)
 {
   pthread_detach(pthread_self());
-  Traffic_TCP_Server.receive();
+  ((TCPServer *) m)->receive();
+  return NULL;
+}
+
+static void * radio_loop(void * m)
+{
+  radio_item_t item;
+
+  pthread_detach(pthread_self());
+
+  while (true) {
+    bool received = false;
+
+    pthread_mutex_lock(&Ownship_lock);
+    ThisAircraft = Ownship;
+    Stage_Fix    = Ownship_Fix ? 1 : 0;
+    pthread_mutex_unlock(&Ownship_lock);
+
+    pthread_mutex_lock(&Radio_lock);
+
+    bool active = (settings->mode == SOFTRF_MODE_NORMAL);
+
+    if (active) {
+      pthread_mutex_lock(&GNSS_lock);
+      RF_loop();
+      pthread_mutex_unlock(&GNSS_lock);
+
+      if (isValidFix()) {
+        RF_Transmit(RF_Encode(&ThisAircraft, true), true);
+      }
+
+      received = RF_Receive();
+
+      if (received) {
+        Trace_Packet(&ThisAircraft, isValidFix(), settings->rf_protocol,
+                     RF_last_rssi, RxBuffer,
+                     RF_Payload_Size(settings->rf_protocol));
+      }
+
+      if (received && isValidFix()) {
+        item.stamp = micros();
+        item.fo    = EmptyFO;
+
+        if (Traffic_Decode(&item.fo)) {
+          Radio_Ring.push(item, &Radio_Stats);
+          Main_Reactor.wakeup();
+        }
+      }
+    }
+
+    /* RF_setup() may have reopened the UAT module port */
+    if (hw_info.rf == RF_IC_UATM && UATSerial.fd() != UAT_fd) {
+      UAT_fd = UATSerial.fd();
+      if (UAT_fd >= 0 && !Radio_Reactor.add(UAT_fd, EPOLLIN)) {
+        UAT_fd = -1;
+      }
+    }
+
+    pthread_mutex_unlock(&Radio_lock);
+
+    int timeout = -1; /* idle until woken up by the main thread */
+
+    if (received) {
+      /* re-arm the receiver before going to sleep */
+      timeout = 0;
+    } else if (active) {
+      unsigned long ms = RF_Time_To_Event(isValidFix());
+      if (DIO_fd < 0 && UAT_fd < 0 && ms > RADIO_POLL_MS) {
+        ms = RADIO_POLL_MS;
+      }
+      timeout = (int) ms;
+    }
+
+    Radio_Reactor.wait(timeout);
+
+    if (DIO_fd >= 0 && Radio_Reactor.ready(DIO_fd)) {
+      Reactor::gpio_ack(DIO_fd);
+    }
+    if (UAT_fd >= 0 && Radio_Reactor.ready(UAT_fd)) {
+      pthread_mutex_lock(&Radio_lock);
+      UATSerial.fill();
+      pthread_mutex_unlock(&Radio_lock);
+    }
+  }
+
+  return NULL;
+}
+
+static void RPi_Stage_report(Stage_Stats_t *stats, uint32_t depth)
+{
+  char buf[80];
+  uint32_t count = stats->count.exchange(0);
+  uint32_t sum   = stats->latency_sum.exchange(0);
+
+  snprintf(buf, sizeof(buf), "$PSRFS,%s,%u,%u,%u,%u,%u,%u",
+           stats->name, depth,
+           stats->depth_max.exchange(0),
+           stats->drops.exchange(0),
+           count, count ? sum / count : 0,
+           stats->latency_max.exchange(0));
+
+  StdOut.println(buf);
+}
+
+static void RPi_TCP_report()
+{
+  char buf[80];
+  TCPServerStats *stats = &Traffic_TCP_Server.stats;
+  unsigned long short_sends = GDL90_TCP_Server.stats.short_sends.exchange(0) +
+                              D1090_TCP_Server.stats.short_sends.exchange(0);
+
+  snprintf(buf, sizeof(buf), "$PSRFS,TCP,%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu",
+           (unsigned int) Traffic_TCP_Server.pending(),
+           stats->accepted.exchange(0),
+           stats->refused.exchange(0),
+           stats->messages.exchange(0),
+           stats->oversize.exchange(0),
+           stats->truncated.exchange(0),
+           stats->stalls.exchange(0),
+           short_sends);
+
+  StdOut.println(buf);
+}
+
+static void RPi_UDP_report()
+{
+  char buf[80];
+  UDPFanoutStats *stats = &Traffic_UDP_Out.stats;
+
+  snprintf(buf, sizeof(buf), "$PSRFS,UDP,%d,%lu,%lu,%lu,%lu,%lu",
+           Traffic_UDP_Out.subscribers(),
+           stats->datagrams.exchange(0),
+           stats->bytes.exchange(0),
+           stats->syscalls.exchange(0),
+           stats->errors.exchange(0),
+           stats->overflows.exchange(0));
+
+  StdOut.println(buf);
+}
+
+static void RPi_TTY_report(const char *name, TTYSerial *port)
+{
+  char buf[80];
+
+  port->updateStats();
+
+  snprintf(buf, sizeof(buf), "$PSRFS,TTY,%s,%lu,%lu",
+           name,
+           port->stats.full.exchange(0),
+           port->stats.dropped.exchange(0));
+
+  StdOut.println(buf);
+}
+
+/*
+ * Interval error is edge to edge minus whole seconds, i.e. the jitter
+ * of the PPS time stamps; lag is how late the loop saw the edge; slot
+ * is the slot scheduler's start of second against the edge.
+ */
+static void RPi_PPS_report()
+{
+  char buf[128];
+  PPS_Stats_t stats;
+
+  PPS_Stats(&stats, true);
+
+  double mean = stats.intervals ? (double) stats.err_sum / stats.intervals : 0;
+  double var  = stats.intervals ? (double) stats.err_sq / stats.intervals -
+                                  mean * mean : 0;
+
+  snprintf(buf, sizeof(buf), "$PSRFS,PPS,%s,%u,%u,%d,%u,%d,%d,%u,%u,%d,%d",
+           PPS_Source_Name(),
+           stats.edges, stats.missed,
+           (int) lround(mean), (unsigned) lround(sqrt(var > 0 ? var : 0)),
+           stats.err_min, stats.err_max,
+           stats.edges ? stats.lag_sum / stats.edges : 0, stats.lag_max,
+           stats.slot_min, stats.slot_max);
+
+  StdOut.println(buf);
+}
+
+#if defined(ENABLE_IFILE)
+static void RPi_Replay_latency(uint32_t ms)
+{
+  Replay_Stats.e2e_count++;
+  Replay_Stats.e2e_sum += ms;
+  if (ms > Replay_Stats.e2e_max) {
+    Replay_Stats.e2e_max = ms;
+  }
+}
+
+static void RPi_Replay_report()
+{
+  char buf[80];
+  uint32_t frames = Replay_Stats.frames;
+  uint32_t crc_ok = Replay_Stats.crc_ok;
+  uint32_t count  = Replay_Stats.e2e_count;
+  unsigned long ms = (ModeS_Done ? Replay_Stats.end.load() : millis()) -
+                     Replay_Stats.start;
+
+  snprintf(buf, sizeof(buf), "$PSRFS,IQ,%u,%u,%u,%lu,%u,%u",
+           frames, crc_ok,
+           frames ? (uint32_t) ((uint64_t) crc_ok * 100 / frames) : 0,
+           ms ? (unsigned long) ((uint64_t) crc_ok * 1000 / ms) : 0,
+           count ? Replay_Stats.e2e_sum / count : 0,
+           (uint32_t) Replay_Stats.e2e_max);
+
+  StdOut.println(buf);
+}
+#endif /* ENABLE_IFILE */
+
+static void * export_loop(void * m)
+{
+  unsigned long StatsTimeMarker = millis();
+
+  pthread_detach(pthread_self());
+
+  while (true) {
+    pthread_mutex_lock(&Snapshot_lock);
+    while (!Snapshot_Fresh) {
+      pthread_cond_wait(&Snapshot_cond, &Snapshot_lock);
+    }
+    traffic_snapshot_t *snap = Snapshot_Ready;
+    Snapshot_Ready = Snapshot_Front;
+    Snapshot_Front = snap;
+    Snapshot_Fresh = false;
+    pthread_mutex_unlock(&Snapshot_lock);
+
+    ThisAircraft     = snap->ownship;
+    Stage_Fix        = snap->fix ? 1 : 0;
+    Container        = snap->traffic;
+    Traffic_Capacity = snap->capacity;
+
+    pthread_mutex_lock(&Export_lock);
+
+    NMEA_Export();
+
+#if defined(ENABLE_IFILE)
+    if (Replay && snap->sample) {
+      RPi_Replay_latency((uint32_t) (mstime() - snap->sample));
+    }
+#endif /* ENABLE_IFILE */
+
+    if (isValidFix()) {
+      GDL90_Export();
+      D1090_Export();
+      JSON_Export();
+    }
+
+    // Handle Air Connect
+    NMEA_loop();
+
+    Traffic_UDP_Out.flush();
+
+    if (settings->nmea_p &&
+        (millis() - StatsTimeMarker) > PIPELINE_STATS_INTERVAL) {
+      RPi_Stage_report(&Radio_Stats, Radio_Ring.depth());
+#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR) || \
+    defined(ENABLE_IFILE)
+      RPi_Stage_report(&ModeS_Stats, ModeS_Ring.depth());
+#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR || ENABLE_IFILE */
+      RPi_Stage_report(&Export_Stats, 0);
+      RPi_TCP_report();
+      RPi_UDP_report();
+      if (Serial_GNSS_In.fd() >= 0) {
+        RPi_TTY_report("GNSS", &Serial_GNSS_In);
+      }
+      if (UATSerial.fd() >= 0) {
+        RPi_TTY_report("UAT", &UATSerial);
+      }
+      if (PPS_Source() != PPS_SOURCE_NONE) {
+        RPi_PPS_report();
+      }
+#if defined(ENABLE_IFILE)
+      if (Replay) {
+        RPi_Replay_report();
+      }
+#endif /* ENABLE_IFILE */
+      StatsTimeMarker = millis();
+    }
+
+#if defined(ENABLE_IFILE)
+    if (snap->last) {
+      /* end of the capture, the totals go out regardless of nmea_p */
+      RPi_Replay_report();
+      Replay_End = true;
+      pthread_mutex_unlock(&Export_lock);
+      Main_Reactor.wakeup();
+      break;
+    }
+#endif /* ENABLE_IFILE */
+
+    pthread_mutex_unlock(&Export_lock);
+
+    Export_Stats.latency(micros() - snap->stamp);
+  }
+
+  return NULL;
 }
 
+#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR) || \
+    defined(ENABLE_IFILE)
 extern "C" void *readerThreadEntryPoint(void *arg);
-extern "C" void ModeS_demod_loop(mode_s_callback_t);
+extern "C" bool ModeS_demod_loop(mode_s_callback_t);
+extern "C" void ModeS_stop(void);
 
+/* Demodulator thread: hand good messages over to the main thread */
 void on_msg(mode_s_t *self, struct mode_s_msg *mm) {
 
-  MODES_NOTUSED(self);
+#if defined(ENABLE_IFILE)
+  if (Replay) {
+    Replay_Stats.frames++;
+    if (!mm->crcok) {
+      return;
+    }
+    Replay_Stats.crc_ok++;
+
+    /* a capture plays faster than real time, hold the demodulator back
+     * rather than drop messages */
+    while (ModeS_Ring.depth() >= MODES_RING_SIZE) {
+      Main_Reactor.wakeup();
+      usleep(1000);
+    }
+  }
+#endif /* ENABLE_IFILE */
+
+  if (self->check_crc == 0 || mm->crcok) {
+    modes_item_t item;
 
-  rx_packets_counter++;
+    item.mm     = *mm;
+    item.stamp  = micros();
+    item.sample = self->sample_stamp;
+
+    ModeS_Ring.push(item, &ModeS_Stats);
+    Main_Reactor.wakeup();
+  }
+}
+
+static void * demod_loop(void * m)
+{
+  /* a replay is joined at the end of the capture */
+  if (!Replay) {
+    pthread_detach(pthread_self());
+  }
+
+  while (ModeS_demod_loop(on_msg)) {
+  }
+
+  /* end of the IQ capture, or the SDR has gone away */
+#if defined(ENABLE_IFILE)
+  Replay_Stats.end = millis();
+#endif /* ENABLE_IFILE */
+  ModeS_Done = true;
+  Main_Reactor.wakeup();
+
+  return NULL;
+}
 
 /* When a new message is available, because it was decoded from the
  * SDR device, file, or received in the TCP input port, or any other
@@ -1037,25 +1728,360 @@ void on_msg(mode_s_t *self, struct mode_s_msg *mm) {
  *
  * Basically this function passes a raw message to the upper layers for
  * further processing and visualization. */
+static void RPi_ModeS_drain()
+{
+  modes_item_t item;
 
-    if (self->check_crc == 0 || mm->crcok) {
+  /* Own position as the reference for single message CPR decoding */
+  state.cpr_ref_valid = isValidFix();
+  state.cpr_ref_lat   = ThisAircraft.latitude;
+  state.cpr_ref_lon   = ThisAircraft.longitude;
 
-//    printf("%02d %03d %02x%02x%02x\r\n", mm->msgtype, mm->msgbits, mm->aa1, mm->aa2, mm->aa3);
+  while (ModeS_Ring.pop(item)) {
+    struct mode_s_msg *mm = &item.mm;
 
-        int acfts_in_sight = 0;
-        struct mode_s_aircraft *a = state.aircrafts;
+    ModeS_Stats.latency(micros() - item.stamp);
 
-        while (a) {
-          acfts_in_sight++;
-          a = a->next;
-        }
+    if (ModeS_Sample == 0) {
+      ModeS_Sample = item.sample;
+    }
 
-        if (acfts_in_sight < MAX_TRACKING_OBJECTS) {
-          interactiveReceiveData(self, mm);
-        }
+    rx_packets_counter++;
+
+//  printf("%02d %03d %02x%02x%02x\r\n", mm->msgtype, mm->msgbits, mm->aa1, mm->aa2, mm->aa3);
+
+    interactiveReceiveData(&state, mm);
+  }
+}
+#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR || ENABLE_IFILE */
+
+static int RPi_Main_timeout()
+{
+  unsigned long ms;
+
+  if ((Stdin_poll && Stdin_fd >= 0) ||
+      Stdin_pending.find('\n') != std::string::npos) {
+    return 0;
+  }
+
+  if (settings->mode == SOFTRF_MODE_TXRX_TEST ||
+      settings->mode == SOFTRF_MODE_RELAY) {
+    /* these modes drive the radio from the main thread */
+    ms = RF_Time_To_Event(true);
+    return (int) (ms < RADIO_POLL_MS ? ms : RADIO_POLL_MS);
+  }
+
+  ms = millis() - ExportTimeMarker;
+  ms = ms > 1000 ? 0 : 1000 - ms + 1;
+
+  return (int) (ms < MAIN_TICK_MS ? ms : MAIN_TICK_MS);
+}
+
+/*
+ * RF trace replay, in place of the radio and the pipeline threads:
+ *  SOFTRF_RFTRACE_REPLAY - trace recorded with SOFTRF_RFTRACE
+ *  SOFTRF_RFTRACE_SPEED  - N times real time, 0 for as fast as it goes
+ *
+ * millis() and now() follow the trace, so expiry, alarms and the export
+ * cadence see the time of the recording whatever the speed. The cost of
+ * ParseData() per packet and of a housekeeping tick (Traffic_loop() and,
+ * once a second, every exporter) is measured on the wall clock.
+ */
+static Stage_Stats_t Trace_Stats = { "TRACE" };
+static Stage_Stats_t Tick_Stats  = { "TICK"  };
+
+static uint64_t RPi_Wall_us()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool RPi_Trace_protocol(uint8_t protocol)
+{
+  switch (protocol)
+  {
+  case RF_PROTOCOL_LEGACY:   protocol_decode = &legacy_decode; break;
+  case RF_PROTOCOL_OGNTP:    protocol_decode = &ogntp_decode;  break;
+  case RF_PROTOCOL_P3I:      protocol_decode = &p3i_decode;    break;
+  case RF_PROTOCOL_FANET:    protocol_decode = &fanet_decode;  break;
+  case RF_PROTOCOL_ADSB_UAT: protocol_decode = &uat978_decode; break;
+  default:                   return false;
+  }
+
+  /* Traffic_Decode() takes the frame size from the settings */
+  settings->rf_protocol = protocol;
+
+  return true;
+}
+
+static void RPi_Trace_tick()
+{
+  uint64_t start = RPi_Wall_us();
+
+  /* a simulated PPS runs off the trace clock too */
+  RPi_loop();
+
+  if (isValidFix()) {
+    Traffic_loop();
+  }
+
+  if (isTimeToExport()) {
+    RPi_ModeS_traffic();
+
+    NMEA_Export();
+
+    if (isValidFix()) {
+      GDL90_Export();
+      D1090_Export();
+      JSON_Export();
     }
+
+    Traffic_UDP_Out.flush();
+
+    ExportTimeMarker = millis();
+  }
+
+  ClearExpired();
+
+  Tick_Stats.latency(RPi_Wall_us() - start);
+}
+
+/* an ES1090 squitter, straight into the libmodes tracker */
+static bool RPi_Trace_ModeS(const uint8_t *payload, size_t size)
+{
+  struct mode_s_msg mm;
+  unsigned char msg[MODE_S_LONG_MSG_BYTES];
+
+  if (size != MODE_S_LONG_MSG_BYTES) {
+    return false;
+  }
+
+  /* own ship is the reference for single message CPR decoding */
+  state.cpr_ref_valid = isValidFix();
+  state.cpr_ref_lat   = ThisAircraft.latitude;
+  state.cpr_ref_lon   = ThisAircraft.longitude;
+
+  memcpy(msg, payload, sizeof(msg));
+  mode_s_decode(&state, &mm, msg);
+
+  if (!mm.crcok) {
+    return false;
+  }
+
+  return interactiveReceiveData(&state, &mm) != NULL;
 }
 
+static void RPi_Trace_play(const char *what,
+                           bool (*next)(Trace_Record_t *, uint8_t *),
+                           float speed)
+{
+  Trace_Record_t rec;
+  uint8_t payload[TRACE_MAX_PAYLOAD];
+  uint32_t packets = 0;
+  uint32_t tick = 0; /* ms into the trace of the next housekeeping tick */
+
+  /* the virtual clock carries on from the real one, never goes back */
+  uint64_t base = ((uint64_t) millis() + 1) * 1000;
+  uint64_t wall = RPi_Wall_us();
+
+  setVirtualMicros(base);
+  unsigned long StatsTimeMarker = millis();
+
+  while (next(&rec, payload)) {
+    while (tick <= rec.ms) {
+      setVirtualMicros(base + (uint64_t) tick * 1000);
+      RPi_Trace_tick();
+      tick += MAIN_TICK_MS;
+    }
+
+    if (speed > 0) {
+      int64_t ahead = (int64_t) (rec.ms * 1000.0 / speed) -
+                      (int64_t) (RPi_Wall_us() - wall);
+      if (ahead > 0) {
+        usleep(ahead);
+      }
+    }
+
+    setVirtualMicros(base + (uint64_t) rec.ms * 1000);
+
+    if (rec.type == TRACE_OWNSHIP) {
+      bool fix;
+
+      if (Trace_Ownship(&rec, payload, &ThisAircraft, &fix)) {
+        setTime(ThisAircraft.timestamp);
+        hasValidGPSDFix = fix;
+      }
+    } else if (rec.type == TRACE_PACKET &&
+               rec.protocol == RF_PROTOCOL_ADSB_1090) {
+      uint64_t start = RPi_Wall_us();
+
+      if (!RPi_Trace_ModeS(payload, rec.size)) {
+        Trace_Stats.drops++;
+        continue;
+      }
+
+      Trace_Stats.latency(RPi_Wall_us() - start);
+      packets++;
+    } else if (rec.type == TRACE_PACKET) {
+      if (!RPi_Trace_protocol(rec.protocol)) {
+        Trace_Stats.drops++;
+        continue;
+      }
+
+      uint64_t start = RPi_Wall_us();
+
+      memset(RxBuffer, 0, sizeof(RxBuffer));
+      memcpy(RxBuffer, payload,
+             rec.size < sizeof(RxBuffer) ? rec.size : sizeof(RxBuffer));
+      RF_last_rssi = rec.rssi;
+      rx_packets_counter++;
+
+      ParseData();
+
+      Trace_Stats.latency(RPi_Wall_us() - start);
+      packets++;
+    }
+
+    if (settings->nmea_p &&
+        (millis() - StatsTimeMarker) > PIPELINE_STATS_INTERVAL) {
+      RPi_Stage_report(&Trace_Stats, 0);
+      RPi_Stage_report(&Tick_Stats, 0);
+      if (PPS_Source() != PPS_SOURCE_NONE) {
+        RPi_PPS_report();
+      }
+      StatsTimeMarker = millis();
+    }
+  }
+
+  /* let the last packets reach the exporters */
+  setVirtualMicros(base + (uint64_t) tick * 1000 + 1000);
+  RPi_Trace_tick();
+
+  RPi_Stage_report(&Trace_Stats, 0);
+  RPi_Stage_report(&Tick_Stats, 0);
+  if (PPS_Source() != PPS_SOURCE_NONE) {
+    RPi_PPS_report();
+  }
+
+  fprintf( stderr, "%s: %u packets, %u ms of traffic in %u ms\n", what,
+           packets, tick, (uint32_t) ((RPi_Wall_us() - wall) / 1000) );
+}
+
+static void RPi_Trace_replay(const char *path)
+{
+  const char *speed_s = getenv("SOFTRF_RFTRACE_SPEED");
+
+  if (!Trace_Replay_open(path)) {
+    fprintf( stderr, "Unable to open RF trace %s\n", path );
+    exit(EXIT_FAILURE);
+  }
+
+  RPi_Trace_play("RF trace replay", Trace_Next,
+                 speed_s ? atof(speed_s) : 1.0);
+
+  Trace_fini();
+}
+
+/*
+ * Synthetic traffic load, played through the same path as a trace:
+ *  SOFTRF_LOAD       - scenario, e.g. "gliders=200,ga=50,airliners=100"
+ *  SOFTRF_LOAD_POS   - "lat,lon[,alt]" of own ship, centre of the scenario
+ *  SOFTRF_LOAD_SPEED - N times real time, 0 (default) for as fast as it goes
+ */
+static void RPi_Load_run(const char *scenario)
+{
+  const char *pos     = getenv("SOFTRF_LOAD_POS");
+  const char *speed_s = getenv("SOFTRF_LOAD_SPEED");
+  float lat = 51.4934, lon = 0.0098, alt = 500;
+
+  if (pos != NULL && sscanf(pos, "%f,%f,%f", &lat, &lon, &alt) < 2) {
+    fprintf( stderr, "Traffic load: bad position %s\n", pos );
+    exit(EXIT_FAILURE);
+  }
+
+  ThisAircraft.latitude  = lat;
+  ThisAircraft.longitude = lon;
+  ThisAircraft.altitude  = alt;
+  ThisAircraft.timestamp = time(NULL);
+
+  if (!Load_setup(scenario, &ThisAircraft)) {
+    fprintf( stderr, "Traffic load: bad scenario %s\n", scenario );
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf( stderr, "Traffic load: %u aircraft\n", Load_Aircraft() );
+
+  RPi_Trace_play("Traffic load", Load_Next,
+                 speed_s ? atof(speed_s) : 0.0);
+
+  Load_fini();
+}
+
+#if defined(ENABLE_IFILE)
+/*
+ * IQ capture replay, set up from the environment:
+ *  SOFTRF_IFILE      - capture file, at the receiver sample rate
+ *  SOFTRF_IFORMAT    - uc8 (default), sc16 or sc16q11
+ *  SOFTRF_THROTTLE   - when set, play at the capture speed instead of
+ *                      as fast as the demodulator goes
+ *  SOFTRF_REPLAY_POS - "lat,lon[,alt]" of own ship, the reference for
+ *                      CPR decoding and traffic geometry
+ */
+static bool RPi_Replay_setup()
+{
+  const char *path   = getenv("SOFTRF_IFILE");
+  const char *format = getenv("SOFTRF_IFORMAT");
+  const char *pos    = getenv("SOFTRF_REPLAY_POS");
+  char *argv[5];
+  int argc = 0;
+
+  if (path == NULL) {
+    return false;
+  }
+
+  argv[argc++] = (char *) "--ifile";
+  argv[argc++] = (char *) path;
+  if (format != NULL) {
+    argv[argc++] = (char *) "--iformat";
+    argv[argc++] = (char *) format;
+  }
+  if (getenv("SOFTRF_THROTTLE") != NULL) {
+    argv[argc++] = (char *) "--throttle";
+  }
+
+  for (int j = 0; j < argc; j++) {
+    if (!sdrHandleOption(argc, argv, &j)) {
+      fprintf( stderr, "IQ replay: bad option %s\n", argv[j] );
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (!sdrOpen()) {
+    exit(EXIT_FAILURE);
+  }
+
+  float lat, lon, alt = 0;
+
+  if (pos != NULL && sscanf(pos, "%f,%f,%f", &lat, &lon, &alt) >= 2) {
+    ThisAircraft.latitude  = lat;
+    ThisAircraft.longitude = lon;
+    ThisAircraft.altitude  = alt;
+    hasValidGPSDFix = true;
+  }
+
+  /* let frames with a bad CRC through to on_msg() to be counted */
+  state.check_crc = 0;
+
+  Replay_Stats.start = millis();
+  Replay = true;
+
+  return true;
+}
+#endif /* ENABLE_IFILE */
+
 int main()
 {
   // Init GPIO bcm
@@ -1076,10 +2102,16 @@ int main()
   Serial.println(F("Copyright (C) 2015-2022 Linar Yusupov. All rights reserved."));
   Serial.flush();
 
-#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR)
   mode_s_init(&state);
+
+#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR) || \
+    defined(ENABLE_IFILE)
   sdrInitConfig();
 
+  /* pick the fastest DSP kernels for this CPU, benchmarked on first start */
+  const char *wisdom = getenv("SOFTRF_WISDOM");
+  wisdom_setup(wisdom ? wisdom : WISDOM_DEFAULT_PATH);
+
   // Allocate the various buffers used by Modes
   state.trailing_samples = (MODES_PREAMBLE_US + MODES_LONG_MSG_BITS + 16) * 1e-6 * state.sample_rate;
 
@@ -1087,7 +2119,13 @@ int main()
       fprintf(stderr, "Out of memory allocating FIFO\n");
       exit(EXIT_FAILURE);
   }
-#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR */
+#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR || ENABLE_IFILE */
+
+#if defined(ENABLE_IFILE)
+  if (RPi_Replay_setup()) {
+    /* the capture stands in for the receivers, no RF chip is needed */
+  } else
+#endif /* ENABLE_IFILE */
 
 #if defined(ENABLE_RTLSDR)
   if (state.sdr_type = SDR_RTLSDR, sdrOpen()) {
@@ -1109,18 +2147,29 @@ int main()
 
   hw_info.rf = RF_setup();
 
-  if (hw_info.rf == RF_IC_NONE) {
+  const char *rftrace_replay = getenv("SOFTRF_RFTRACE_REPLAY");
+  const char *load          = getenv("SOFTRF_LOAD");
+
+  if (hw_info.rf == RF_IC_NONE && !Replay &&
+      rftrace_replay == NULL && load == NULL) {
       exit(EXIT_FAILURE);
   }
 
-#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR)
-  if (hw_info.rf == RF_IC_R820T   ||
+#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR) || \
+    defined(ENABLE_IFILE)
+  if (Replay                      ||
+      hw_info.rf == RF_IC_R820T   ||
       hw_info.rf == RF_IC_MAX2837 ||
       hw_info.rf == RF_IC_MSI001) {
     // Create the thread that will read the data from the device.
     pthread_create(&state.reader_thread, NULL, readerThreadEntryPoint, NULL);
+
+    if ( pthread_create(&ModeS_demod_thread, NULL, demod_loop, (void *)0) != 0) {
+      fprintf( stderr, "pthread_create(demod_thread) Failed\n\n" );
+      exit(EXIT_FAILURE);
+    }
   }
-#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR */
+#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR || ENABLE_IFILE */
 
 #if defined(USE_EPAPER)
   Serial.print("Intializing E-ink display module (may take up to 10 seconds)... ");
@@ -1141,14 +2190,108 @@ int main()
 
 //  hw_info.gnss = GNSS_setup();
 
-  Traffic_setup();
+  RPi_Traffic_setup();
   NMEA_setup();
 
-  Traffic_TCP_Server.setup(JSON_SRV_TCP_PORT);
+  if (!Main_Reactor.setup() || !Radio_Reactor.setup()) {
+    fprintf( stderr, "epoll setup Failed\n\n" );
+    exit(EXIT_FAILURE);
+  }
+
+  if (!Main_Reactor.add(Stdin_fd, EPOLLIN)) {
+    Stdin_poll = (errno == EPERM);
+    if (!Stdin_poll) {
+      Stdin_fd = -1;
+    }
+  }
+
+  if (hw_info.rf == RF_IC_SX1276) {
+    DIO_fd = Reactor::gpio_edge(SOC_GPIO_PIN_DIO0, "rising");
+    if (DIO_fd >= 0 && !Radio_Reactor.add(DIO_fd, EPOLLPRI | EPOLLERR)) {
+      close(DIO_fd);
+      DIO_fd = -1;
+    }
+  }
+
+  /* kernel time stamped PPS, SOFTRF_PPS or whichever is there */
+  if (PPS_setup(getenv("SOFTRF_PPS"),
+                SOC_GPIO_PIN_GNSS_PPS != SOC_UNUSED_PIN ?
+                SOC_GPIO_PIN_GNSS_PPS : -1)) {
+    if (PPS_Event_fd() >= 0) {
+      /* woken up by an edge; else polled once per loop pass */
+      Main_Reactor.add(PPS_Event_fd(), EPOLLIN);
+    }
+  } else if (getenv("SOFTRF_PPS") != NULL) {
+    fprintf( stderr, "Unable to open PPS source %s\n", getenv("SOFTRF_PPS") );
+  }
+
+#if SOC_GPIO_PIN_GNSS_PPS != SOC_UNUSED_PIN
+  if (PPS_Source() == PPS_SOURCE_NONE) {
+    PPS_fd = Reactor::gpio_edge(SOC_GPIO_PIN_GNSS_PPS, "rising");
+    if (PPS_fd >= 0 && !Main_Reactor.add(PPS_fd, EPOLLPRI | EPOLLERR)) {
+      close(PPS_fd);
+      PPS_fd = -1;
+    }
+  }
+#endif
+
+  if (!Traffic_TCP_Server.setup(JSON_SRV_TCP_PORT)) {
+    fprintf( stderr, "Unable to listen on TCP port %d\n", JSON_SRV_TCP_PORT );
+  }
+  Traffic_TCP_Server.notify(Main_Reactor.notifier());
+
+  if (!GDL90_TCP_Server.setup(GDL90_TCP_PORT, false)) {
+    fprintf( stderr, "Unable to listen on TCP port %d\n", GDL90_TCP_PORT );
+  }
+  if (!D1090_TCP_Server.setup(D1090_TCP_PORT, false)) {
+    fprintf( stderr, "Unable to listen on TCP port %d\n", D1090_TCP_PORT );
+  }
+
+  /* NMEA_UDP, GDL90_UDP and D1090_UDP subscribers, comma separated */
+  const char *udp_dest = getenv("SOFTRF_UDP_DEST");
+  if (!Traffic_UDP_Out.setup(udp_dest ? udp_dest : "255.255.255.255")) {
+    fprintf( stderr, "Unable to set up UDP output\n" );
+  }
+
+  if (rftrace_replay != NULL) {
+    RPi_Trace_replay(rftrace_replay);
+    RPi_TCP_detach();
+    exit(EXIT_SUCCESS);
+  }
+
+  if (load != NULL) {
+    RPi_Load_run(load);
+    RPi_TCP_detach();
+    exit(EXIT_SUCCESS);
+  }
+
+  /* raw frames out of RxBuffer, for RPi_Trace_replay() */
+  const char *rftrace = getenv("SOFTRF_RFTRACE");
+  if (rftrace != NULL && !Trace_Record_open(rftrace)) {
+    fprintf( stderr, "Unable to open RF trace %s\n", rftrace );
+  }
+
+  TCPServer *tcp_servers[] = {
+    &Traffic_TCP_Server, &GDL90_TCP_Server, &D1090_TCP_Server
+  };
+  for (int i=0; i < sizeof(tcp_servers) / sizeof(tcp_servers[0]); i++) {
+    pthread_t traffic_tcpserv_thread;
+    if ( pthread_create(&traffic_tcpserv_thread, NULL, traffic_tcpserv_loop,
+                        (void *) tcp_servers[i]) != 0) {
+      fprintf( stderr, "pthread_create(traffic_tcpserv_thread) Failed\n\n" );
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  pthread_t radio_thread;
+  if ( pthread_create(&radio_thread, NULL, radio_loop, (void *)0) != 0) {
+    fprintf( stderr, "pthread_create(radio_thread) Failed\n\n" );
+    exit(EXIT_FAILURE);
+  }
 
-  pthread_t traffic_tcpserv_thread;
-  if ( pthread_create(&traffic_tcpserv_thread, NULL, traffic_tcpserv_loop, (void *)0) != 0) {
-    fprintf( stderr, "pthread_create(traffic_tcpserv_thread) Failed\n\n" );
+  pthread_t export_thread;
+  if ( pthread_create(&export_thread, NULL, export_loop, (void *)0) != 0) {
+    fprintf( stderr, "pthread_create(export_thread) Failed\n\n" );
     exit(EXIT_FAILURE);
   }
 
@@ -1157,13 +2300,35 @@ int main()
   SoC->WDT_setup();
 
   while (true) {
+    Main_Reactor.wait(RPi_Main_timeout());
+
+#if defined(ENABLE_IFILE)
+    if (Replay_End) {
+      /* stop the sample reader and wait for both SDR threads */
+      ModeS_stop();
+      pthread_join(ModeS_demod_thread, NULL);
+
+      RPi_TCP_detach();
+      fprintf( stderr, "IQ replay: end of file.\n" );
+      exit(EXIT_SUCCESS);
+    }
+#endif /* ENABLE_IFILE */
+
     switch (settings->mode)
     {
     case SOFTRF_MODE_TXRX_TEST:
+      pthread_mutex_lock(&Radio_lock);
+      pthread_mutex_lock(&Export_lock);
       txrx_test_loop();
+      pthread_mutex_unlock(&Export_lock);
+      pthread_mutex_unlock(&Radio_lock);
       break;
     case SOFTRF_MODE_RELAY:
+      pthread_mutex_lock(&Radio_lock);
+      pthread_mutex_lock(&Export_lock);
       relay_loop();
+      pthread_mutex_unlock(&Export_lock);
+      pthread_mutex_unlock(&Radio_lock);
       break;
     case SOFTRF_MODE_NORMAL:
     default:
@@ -1171,9 +2336,10 @@ int main()
       break;
     }
 
-#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR)
-    ModeS_demod_loop(on_msg);
-#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR */
+#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR) || \
+    defined(ENABLE_IFILE)
+    RPi_ModeS_drain();
+#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR || ENABLE_IFILE */
 
     SoC->loop();
 
@@ -1185,14 +2351,14 @@ int main()
 
       if (current_time == ((time_t)-1) ||
           localtime_r(&current_time, &timebuf) == NULL) {
-        Traffic_TCP_Server.detach();
+        RPi_TCP_detach();
         fprintf(stderr, "Failure to obtain the current time.\n");
         exit(EXIT_FAILURE);
       }
 
       /* shut SoftRF down at night time only */
       if (timebuf.tm_hour >= 2 && timebuf.tm_hour <= 5) {
-        Traffic_TCP_Server.detach();
+        RPi_TCP_detach();
         fprintf( stderr, "Program termination: millis() rollover prevention.\n" );
         exit(EXIT_SUCCESS);
       }
@@ -1200,7 +2366,7 @@ int main()
 #endif /* TAKE_CARE_OF_MILLIS_ROLLOVER */
   }
 
-  Traffic_TCP_Server.detach();
+  RPi_TCP_detach();
   return 0;
 }
 
@@ -1212,7 +2378,7 @@ void shutdown(int reason)
     SoC->Display_fini(reason);
   }
 
-  Traffic_TCP_Server.detach();
+  RPi_TCP_detach();
   fprintf( stderr, "Program termination. Reason code: %d.\n", reason );
   exit(EXIT_SUCCESS);
 }
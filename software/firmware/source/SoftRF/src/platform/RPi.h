@@ -21,8 +21,19 @@
 #ifndef PLATFORM_RPI_H
 #define PLATFORM_RPI_H
 
-/* Maximum of tracked flying objects is now SoC-specific constant */
-#define MAX_TRACKING_OBJECTS  8
+/*
+ * Traffic table is sized at run time on this platform.
+ * Use "traffic" key of SOFTRF class JSON settings message to adjust the capacity.
+ */
+#define USE_DYNAMIC_TRAFFIC_TABLE
+#define DEFAULT_TRACKING_OBJECTS  256
+#define MAX_TRACKING_OBJECTS  Traffic_Capacity
+
+/* formatted per-target export data, see NMEA.cpp and D1090.cpp */
+#define NMEA_TARGET_CACHE_SIZE    256
+#define NMEA_EXPORT_BUFFER_SIZE   1400
+#define D1090_TARGET_CACHE_SIZE   256
+#define D1090_BUFFER_SIZE         1400
 
 #define DEFAULT_SOFTRF_MODEL    SOFTRF_MODEL_RASPBERRY
 
@@ -36,7 +47,15 @@
 #define Serial_GNSS_Out       Serial_GNSS_In
 #define UATSerial             Serial2
 
-#define isValidFix()          (isValidGNSSFix() || isValidGPSDFix())
+/*
+ * Radio and export threads work from a snapshot of own ship
+ * and see the fix state latched with it (Stage_Fix >= 0).
+ */
+extern __thread int8_t Stage_Fix;
+
+#define isValidFix()          (Stage_Fix < 0 ?                              \
+                               (isValidGNSSFix() || isValidGPSDFix()) :    \
+                               Stage_Fix > 0)
 
 #define LED_STATE_ON          HIGH  // State when LED is litted
 
@@ -96,13 +115,20 @@ struct rst_info {
 
 #if defined(USE_SPI1)
 #define JSON_SRV_TCP_PORT     30008
+#define GDL90_TCP_PORT        4001
+#define D1090_TCP_PORT        30012
 #else
 #define JSON_SRV_TCP_PORT     30007
+#define GDL90_TCP_PORT        4000
+#define D1090_TCP_PORT        30002
 #endif
 
 extern TTYSerial Serial1;
 extern TTYSerial Serial2;
 
+extern void RPi_TCP_transmit(int, byte *, size_t);
+extern void RPi_StdOut_println(const char *);
+
 extern const char *Hardware_Rev[];
 
 #define EXCLUDE_WIFI
@@ -26,15 +26,127 @@
 #include "../../driver/EEPROM.h"
 #include "../../TrafficHelper.h"
 
-#define ADDR_TO_HEX_STR(s, c) (s += ((c) < 0x10 ? "0" : "") + String((c), HEX))
+/* "*<hex>;\r\n" */
+#define D1090_FRAME_SIZE          (1 + 2 * sizeof(frame_data_t) + 3)
+/* even and odd position, identification and velocity */
+#define D1090_TARGET_SIZE         (4 * D1090_FRAME_SIZE)
 
-#define DF17_FRAME_TO_HEX_STR(s)                        \
-      ({                                                \
-        for (int i=0; i < sizeof(frame_data_t); i++) {  \
-          byte c = df17.msg[i];                         \
-          s += (c < 0x10 ? "0" : "") + String(c, HEX);  \
-        }                                               \
-      })
+#if !defined(D1090_TARGET_CACHE_SIZE)
+#define D1090_TARGET_CACHE_SIZE   8   /* power of 2 */
+#endif /* D1090_TARGET_CACHE_SIZE */
+
+#if !defined(D1090_BUFFER_SIZE)
+#define D1090_BUFFER_SIZE         (2 * D1090_TARGET_SIZE)
+#endif /* D1090_BUFFER_SIZE */
+
+/*
+ * Frames last sent for a target. They are encoded again only when
+ * the identity or the position and velocity of the target change.
+ */
+typedef struct d1090_target_struct {
+  uint32_t  addr;
+  uint8_t   protocol;
+  uint8_t   aircraft_type;
+  bool      valid;      /* frames have been encoded for addr */
+  bool      moved;
+  float     latitude;
+  float     longitude;
+  float     altitude;   /* feet */
+  float     course;
+  float     speed;
+  float     vs;
+  char      frames[D1090_TARGET_SIZE];
+} d1090_target_t;
+
+static d1090_target_t D1090_Targets[D1090_TARGET_CACHE_SIZE];
+
+/* All targets of one D1090_Export() run go out in one D1090_Out() call */
+static char   D1090_Buffer[D1090_BUFFER_SIZE];
+static size_t D1090_BufLen = 0;
+
+static const char D1090_Hex[] = "0123456789ABCDEF";
+
+static void D1090_Frame(char *p, frame_data_t df17)
+{
+  *p++ = '*';
+  for (int i=0; i < sizeof(frame_data_t); i++) {
+    *p++ = D1090_Hex[df17.msg[i] >> 4];
+    *p++ = D1090_Hex[df17.msg[i] & 0xF];
+  }
+  *p++ = ';';
+  *p++ = '\r';
+  *p++ = '\n';
+}
+
+static d1090_target_t *D1090_Target(ufo_t *fop, float altitude)
+{
+  uint32_t hash = (fop->addr * 2654435761UL) >> 16;
+  d1090_target_t *t = &D1090_Targets[hash & (D1090_TARGET_CACHE_SIZE - 1)];
+
+  if (!t->valid                       ||
+      t->addr          != fop->addr     ||
+      t->protocol      != fop->protocol ||
+      t->aircraft_type != fop->aircraft_type) {
+    char callsign[12];
+    const char *prefix = GDL90_CallSign_Prefix[fop->protocol];
+    size_t len = strlen(prefix);
+
+    memcpy(callsign, prefix, len);
+    for (int i=0; i < 6; i++) {
+      callsign[len++] = D1090_Hex[(fop->addr >> (20 - 4 * i)) & 0xF];
+    }
+    callsign[len] = 0;
+
+    t->addr          = fop->addr;
+    t->protocol      = fop->protocol;
+    t->aircraft_type = fop->aircraft_type;
+    t->valid         = true;
+    t->moved         = true;
+
+    D1090_Frame(t->frames + 2 * D1090_FRAME_SIZE,
+      make_aircraft_identification_frame(fop->addr,
+        (unsigned char*) callsign,
+        Category_Set_D,
+        AT_TO_GDL90(fop->aircraft_type),
+        DF17));
+  }
+
+  if (t->moved                        ||
+      t->latitude  != fop->latitude   ||
+      t->longitude != fop->longitude  ||
+      t->altitude  != altitude        ||
+      t->course    != fop->course     ||
+      t->speed     != fop->speed      ||
+      t->vs        != fop->vs) {
+
+    t->latitude  = fop->latitude;
+    t->longitude = fop->longitude;
+    t->altitude  = altitude;
+    t->course    = fop->course;
+    t->speed     = fop->speed;
+    t->vs        = fop->vs;
+    t->moved     = false;
+
+    D1090_Frame(t->frames,
+      make_air_position_frame(11, fop->addr,
+        fop->latitude, fop->longitude,
+        altitude, CPR_EVEN, DF17));
+
+    D1090_Frame(t->frames + D1090_FRAME_SIZE,
+      make_air_position_frame(11, fop->addr,
+        fop->latitude, fop->longitude,
+        altitude, CPR_ODD, DF17));
+
+    D1090_Frame(t->frames + 3 * D1090_FRAME_SIZE,
+      make_velocity_frame(fop->addr,
+        fop->speed * cos(fop->course * PI / 180),
+        fop->speed * sin(fop->course * PI / 180),
+        fop->vs,
+        DF17));
+  }
+
+  return t;
+}
 
 static void D1090_Out(byte *buf, size_t size)
 {
@@ -62,7 +174,15 @@ static void D1090_Out(byte *buf, size_t size)
     }
     break;
   case D1090_UDP:
+    {
+      SoC->WiFi_transmit_UDP(D1090_UDP_PORT, buf, size);
+    }
+    break;
   case D1090_TCP:
+#if defined(RASPBERRY_PI)
+    RPi_TCP_transmit(D1090_TCP_PORT, buf, size);
+#endif /* RASPBERRY_PI */
+    break;
   case D1090_OFF:
   default:
     break;
@@ -71,9 +191,7 @@ static void D1090_Out(byte *buf, size_t size)
 
 void D1090_Export()
 {
-  frame_data_t df17;
   float distance;
-  String str;
   time_t this_moment = now();
 
   if (settings->d1090 != D1090_OFF) {
@@ -98,51 +216,21 @@ void D1090_Export()
           }
           altitude *= _GPS_FEET_PER_METER;
 
-          df17 = make_air_position_frame(11, Container[i].addr,
-            Container[i].latitude, Container[i].longitude,
-            altitude, CPR_EVEN, DF17);
-
-          str = "*";
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
-
-          df17 = make_air_position_frame(11, Container[i].addr,
-            Container[i].latitude, Container[i].longitude,
-            altitude, CPR_ODD, DF17);
-
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
-
-          String callsign = String(GDL90_CallSign_Prefix[Container[i].protocol]);
-        
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr >> 16) & 0xFF);
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr >>  8) & 0xFF);
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr      ) & 0xFF);
-
-          callsign.toUpperCase();
+          d1090_target_t *target = D1090_Target(&Container[i], altitude);
 
-          df17 = make_aircraft_identification_frame(Container[i].addr,
-            (unsigned char*) callsign.c_str(),
-            Category_Set_D,
-            AT_TO_GDL90(Container[i].aircraft_type),
-            DF17);
-
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
-
-          df17 = make_velocity_frame(Container[i].addr,
-            Container[i].speed * cos(Container[i].course * PI / 180),
-            Container[i].speed * sin(Container[i].course * PI / 180),
-            Container[i].vs,
-            DF17);
-
-          DF17_FRAME_TO_HEX_STR(str);
-          str.toUpperCase();
-          str += ";\r\n";
-
-          D1090_Out((byte *) str.c_str(), str.length());
+          if (D1090_BufLen + D1090_TARGET_SIZE > sizeof(D1090_Buffer)) {
+            D1090_Out((byte *) D1090_Buffer, D1090_BufLen);
+            D1090_BufLen = 0;
+          }
+          memcpy(D1090_Buffer + D1090_BufLen, target->frames, D1090_TARGET_SIZE);
+          D1090_BufLen += D1090_TARGET_SIZE;
         }
       }
     }
+
+    if (D1090_BufLen > 0) {
+      D1090_Out((byte *) D1090_Buffer, D1090_BufLen);
+      D1090_BufLen = 0;
+    }
   }
 }
@@ -461,6 +461,10 @@ static void GDL90_Out(byte *buf, size_t size)
       }
       break;
     case GDL90_TCP:
+#if defined(RASPBERRY_PI)
+      RPi_TCP_transmit(GDL90_TCP_PORT, buf, size);
+#endif /* RASPBERRY_PI */
+      break;
     case GDL90_OFF:
     default:
       break;
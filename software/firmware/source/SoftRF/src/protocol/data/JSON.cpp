@@ -48,6 +48,8 @@ extern settings_t *settings;
 #include <iomanip>
 
 StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
+/* JSON_Export() runs on the export thread, apart from the input parsers */
+static StaticJsonBuffer<JSON_BUFFER_SIZE> exportJsonBuffer;
 
 bool hasValidGPSDFix = false;
 
@@ -67,10 +69,10 @@ void JSON_Export()
 
   float distance;
   time_t this_moment = now();
-  char buffer[3 * 80 * MAX_TRACKING_OBJECTS];
+  std::string buffer;
   bool has_aircraft = false;
 
-  JsonObject& root = jsonBuffer.createObject();
+  JsonObject& root = exportJsonBuffer.createObject();
   JsonArray& aircraft_array = root.createNestedArray("aircraft");
 
   for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
@@ -83,6 +85,7 @@ void JSON_Export()
         char hexbuf[8];
         char callsign[8+1];
         char timebuf[32];
+        struct tm tmbuf;
         time_t timestamp = now(); /* GNSS date&time */
 
         snprintf(hexbuf, sizeof(hexbuf), "%06X", Container[i].addr);
@@ -111,7 +114,7 @@ void JSON_Export()
         aircraft["emitterType"] = AT_TO_GDL90(Container[i].aircraft_type); // Category type of the emitter
         aircraft["utcSync"] = 1; // UTC time flag
         /* Time packet was received at the pingStation ISO 8601 format: YYYY-MM-DDTHH:mm:ss:ffffffffZ */
-        strftime(timebuf, sizeof(timebuf), "%FT%T:00000000Z", gmtime(&timestamp));
+        strftime(timebuf, sizeof(timebuf), "%FT%T:00000000Z", gmtime_r(&timestamp, &tmbuf));
         aircraft["timeStamp"] = timebuf;
 
         has_aircraft = true;
@@ -121,10 +124,10 @@ void JSON_Export()
 
   if (has_aircraft) {
     root.printTo(buffer);
-    Serial.println(buffer);
+    Serial.println(buffer.c_str());
   }
 
-  jsonBuffer.clear();
+  exportJsonBuffer.clear();
 }
 
 void parsePING(JsonObject& root)
@@ -217,40 +220,7 @@ void parsePING(JsonObject& root)
 
         Traffic_Update(&fo);
 
-        int j;
-
-        /* Try to find and update an entry with the same aircraft ID */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == fo.addr && Container[j].protocol == fo.protocol) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Fill a free entry if able */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == 0 &&
-             memcmp(Container[j].raw, EmptyFO.raw, sizeof(EmptyFO.raw)) == 0) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Overwrite expired entry */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (timestamp - Container[j].timestamp > ENTRY_EXPIRATION_TIME) {
-            Container[j] = fo;
-            break;
-          }
-        }
+        Traffic_Insert(&fo);
       }
     }
 
@@ -414,40 +384,7 @@ void parseD1090(JsonObject& root)
 
         Traffic_Update(&fo);
 
-        int j;
-
-        /* Try to find and update an entry with the same aircraft ID */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == fo.addr && Container[j].protocol == fo.protocol) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Fill a free entry if able */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == 0 &&
-             memcmp(Container[j].raw, EmptyFO.raw, sizeof(EmptyFO.raw)) == 0) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Overwrite expired entry */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (timestamp - Container[j].timestamp > ENTRY_EXPIRATION_TIME) {
-            Container[j] = fo;
-            break;
-          }
-        }
+        Traffic_Insert(&fo);
       }
     }
 
@@ -507,28 +444,8 @@ void parseRAW(JsonObject& root)
         fo.timestamp = timestamp;
         fo.protocol = RF_PROTOCOL_ADSB_1090;
 
-        int j;
-
-        /* Fill a free entry if able */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == 0 &&
-             memcmp(Container[j].raw, EmptyFO.raw, sizeof(EmptyFO.raw)) == 0) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Overwrite expired entry */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (timestamp - Container[j].timestamp > ENTRY_EXPIRATION_TIME) {
-            Container[j] = fo;
-            break;
-          }
-        }
+        /* no address - takes a free or an expired entry only */
+        Traffic_Insert(&fo);
       }
     }
 
@@ -876,6 +793,13 @@ void parseSettings(JsonObject& root)
     eeprom_block.field.settings.no_track = no_track.as<bool>();
   }
 
+#if defined(USE_DYNAMIC_TRAFFIC_TABLE)
+  JsonVariant traffic = root["traffic"];
+  if (traffic.success()) {
+    Traffic_Table_setup(traffic.as<int>());
+  }
+#endif /* USE_DYNAMIC_TRAFFIC_TABLE */
+
   JsonVariant fcor = root["fcor"];
   if (fcor.success()) {
     int fc = fcor.as<signed int>();
@@ -28,8 +28,6 @@
 #include "../../driver/Baro.h"
 #include "../../TrafficHelper.h"
 
-#define ADDR_TO_HEX_STR(s, c) (s += ((c) < 0x10 ? "0" : "") + String((c), HEX))
-
 #if defined(NMEA_TCP_SERVICE)
 WiFiServer NmeaTCPServer(NMEA_TCP_PORT);
 NmeaTCP_t NmeaTCP[MAX_NMEATCP_CLIENTS];
@@ -37,8 +35,6 @@ NmeaTCP_t NmeaTCP[MAX_NMEATCP_CLIENTS];
 
 char NMEABuffer[NMEA_BUFFER_SIZE]; //buffer for NMEA data
 
-static char NMEA_Callsign[NMEA_CALLSIGN_SIZE];
-
 #if defined(USE_NMEALIB)
 #include <nmealib.h>
 
@@ -66,14 +62,160 @@ extern uint32_t tx_packets_counter, rx_packets_counter;
 unsigned long RPYL_TimeMarker = 0;
 #endif /* ENABLE_AHRS */
 
-static char *ltrim(char *s)
+#if !defined(NMEA_TARGET_CACHE_SIZE)
+#define NMEA_TARGET_CACHE_SIZE    8   /* power of 2 */
+#endif /* NMEA_TARGET_CACHE_SIZE */
+
+#if !defined(NMEA_EXPORT_BUFFER_SIZE)
+#define NMEA_EXPORT_BUFFER_SIZE   (2 * NMEA_BUFFER_SIZE)
+#endif /* NMEA_EXPORT_BUFFER_SIZE */
+
+/*
+ * PFLAA fields of a target which do not change from one export to the next:
+ * ",<addr type>,<ID>!<callsign>,". They are formatted again only when
+ * the slot is taken over by another aircraft or the callsign changes.
+ */
+typedef struct nmea_target_struct {
+  uint32_t  addr;
+  uint8_t   protocol;
+  uint8_t   addr_type;
+  uint8_t   callsign[8];
+  uint8_t   len;
+  uint8_t   cs;       /* XOR of frag[] */
+  char      frag[1 + 1 + 1 + 6 + 1 + NMEA_CALLSIGN_SIZE];
+} nmea_target_t;
+
+static nmea_target_t NMEA_Targets[NMEA_TARGET_CACHE_SIZE];
+
+/* All sentences of one NMEA_Export() run go out in one NMEA_Out() call */
+static char   NMEA_ExportBuffer[NMEA_EXPORT_BUFFER_SIZE];
+static size_t NMEA_ExportLen = 0;
+
+typedef struct nmea_writer_struct {
+  char     *ptr;
+  uint8_t   cs;
+} nmea_writer_t;
+
+static inline void NMEA_putc(nmea_writer_t *w, char c)
+{
+  *w->ptr++ = c;
+  w->cs ^= c;
+}
+
+static void NMEA_putu(nmea_writer_t *w, uint32_t val)
+{
+  char digits[10];
+  int n = 0;
+
+  do {
+    digits[n++] = '0' + (val % 10);
+    val /= 10;
+  } while (val);
+
+  while (n) {
+    NMEA_putc(w, digits[--n]);
+  }
+}
+
+static void NMEA_puti(nmea_writer_t *w, int32_t val)
+{
+  if (val < 0) {
+    NMEA_putc(w, '-');
+    val = -val;
+  }
+  NMEA_putu(w, (uint32_t) val);
+}
+
+static void NMEA_puthex(nmea_writer_t *w, uint32_t val, int digits)
+{
+  while (digits--) {
+    NMEA_putc(w, "0123456789ABCDEF"[(val >> (digits * 4)) & 0xF]);
+  }
+}
+
+/* '*', checksum and CR LF */
+static void NMEA_end(nmea_writer_t *w)
+{
+  uint8_t cs = w->cs;
+
+  *w->ptr++ = '*';
+  *w->ptr++ = "0123456789ABCDEF"[cs >> 4];
+  *w->ptr++ = "0123456789ABCDEF"[cs & 0xF];
+  *w->ptr++ = '\r';
+  *w->ptr++ = '\n';
+}
+
+static void NMEA_Export_flush()
+{
+  if (NMEA_ExportLen > 0) {
+    NMEA_Out(settings->nmea_out, (byte *) NMEA_ExportBuffer, NMEA_ExportLen, false);
+    NMEA_ExportLen = 0;
+  }
+}
+
+/* Room for one more sentence of up to NMEA_BUFFER_SIZE bytes */
+static char *NMEA_Export_reserve()
+{
+  if (NMEA_ExportLen + NMEA_BUFFER_SIZE > sizeof(NMEA_ExportBuffer)) {
+    NMEA_Export_flush();
+  }
+  return NMEA_ExportBuffer + NMEA_ExportLen;
+}
+
+static nmea_target_t *NMEA_Target(ufo_t *fop)
 {
-  if(s) {
-    while(*s && isspace(*s))
-      ++s;
+  uint32_t hash = (fop->addr * 2654435761UL) >> 16;
+  nmea_target_t *t = &NMEA_Targets[hash & (NMEA_TARGET_CACHE_SIZE - 1)];
+  uint8_t addr_type = fop->addr_type > ADDR_TYPE_ANONYMOUS ?
+                      ADDR_TYPE_ANONYMOUS : fop->addr_type;
+
+  if (t->len        != 0              &&
+      t->addr       == fop->addr      &&
+      t->protocol   == fop->protocol  &&
+      t->addr_type  == addr_type      &&
+      memcmp(t->callsign, fop->callsign, sizeof(t->callsign)) == 0) {
+    return t;
   }
 
-  return s;
+  t->addr      = fop->addr;
+  t->protocol  = fop->protocol;
+  t->addr_type = addr_type;
+  memcpy(t->callsign, fop->callsign, sizeof(t->callsign));
+
+  nmea_writer_t w = { t->frag, 0 };
+
+  NMEA_putc(&w, ',');
+  NMEA_putu(&w, addr_type);
+  NMEA_putc(&w, ',');
+  NMEA_puthex(&w, fop->addr, 6);
+  NMEA_putc(&w, '!');
+
+  /*
+   * When callsign is available - send it to a NMEA client.
+   * If it is not - generate a callsign substitute,
+   * based upon a protocol ID and the ICAO address
+   */
+  if (strnlen((char *) fop->callsign, sizeof(fop->callsign)) > 0) {
+    for (int j=0; j < sizeof(fop->callsign); j++) {
+      char c = fop->callsign[j];
+      if (c == 0 || c == ' ' || c == ',' || c == '*') {
+        break;
+      }
+      NMEA_putc(&w, c);
+    }
+  } else {
+    for (const char *s = NMEA_CallSign_Prefix[fop->protocol]; *s; s++) {
+      NMEA_putc(&w, *s);
+    }
+    NMEA_putc(&w, '_');
+    NMEA_puthex(&w, fop->addr, 6);
+  }
+  NMEA_putc(&w, ',');
+
+  t->len = w.ptr - t->frag;
+  t->cs  = w.cs;
+
+  return t;
 }
 
 void NMEA_add_checksum(char *buf, size_t limit)
@@ -228,18 +370,18 @@ void NMEA_Out(uint8_t dest, byte *buf, size_t size, bool nl)
     }
     break;
   case NMEA_UDP:
-    {
+    if (!nl) {
+      SoC->WiFi_transmit_UDP(NMEA_UDP_PORT, buf, size);
+    } else {
       size_t udp_size = size;
 
       if (size >= sizeof(UDPpacketBuffer))
         udp_size = sizeof(UDPpacketBuffer) - 1;
       memcpy(UDPpacketBuffer, buf, udp_size);
-
-      if (nl)
-        UDPpacketBuffer[udp_size] = '\n';
+      UDPpacketBuffer[udp_size] = '\n';
 
       SoC->WiFi_transmit_UDP(NMEA_UDP_PORT, (byte *) UDPpacketBuffer,
-                              nl ? udp_size + 1 : udp_size);
+                              udp_size + 1);
     }
     break;
   case NMEA_TCP:
@@ -323,66 +465,67 @@ void NMEA_Export()
 
               total_objects++;
 
-              char str_climb_rate[8] = "";
-              uint8_t addr_type = Container[i].addr_type > ADDR_TYPE_ANONYMOUS ?
-                                  ADDR_TYPE_ANONYMOUS : Container[i].addr_type;
-
               bearing = Container[i].bearing;
               alarm_level = Container[i].alarm_level;
-              alt_diff = (int) (Container[i].altitude - ThisAircraft.altitude);
-
-              if (!Container[i].stealth && !ThisAircraft.stealth) {
-                dtostrf(
-                  constrain(Container[i].vs / (_GPS_FEET_PER_METER * 60.0), -32.7, 32.7),
-                  5, 1, str_climb_rate);
-              }
-
-              /*
-               * When callsign is available - send it to a NMEA client.
-               * If it is not - generate a callsign substitute,
-               * based upon a protocol ID and the ICAO address
-               */
-              memset((void *) NMEA_Callsign, 0, sizeof(NMEA_Callsign));
-
-              if (strnlen((char *) Container[i].callsign, sizeof(Container[i].callsign)) > 0) {
-                memcpy(NMEA_Callsign, Container[i].callsign, sizeof(Container[i].callsign));
-                for (int j=0; j < sizeof(NMEA_Callsign); j++) {
-                  if (NMEA_Callsign[j] == ' ' || NMEA_Callsign[j] == ',' || NMEA_Callsign[j] == '*') {
-                    NMEA_Callsign[j] = 0;
-                    break;
-                  }
-                }
-              } else {
-                memcpy(NMEA_Callsign, NMEA_CallSign_Prefix[Container[i].protocol],
-                  strlen(NMEA_CallSign_Prefix[Container[i].protocol]));
-
-                String str = "_";
-
-                ADDR_TO_HEX_STR(str, (Container[i].addr >> 16) & 0xFF);
-                ADDR_TO_HEX_STR(str, (Container[i].addr >>  8) & 0xFF);
-                ADDR_TO_HEX_STR(str, (Container[i].addr      ) & 0xFF);
-
-                str.toUpperCase();
-                memcpy(NMEA_Callsign + strlen(NMEA_CallSign_Prefix[Container[i].protocol]),
-                  str.c_str(), str.length());
-              }
+              alt_diff = Container[i].up;
 
               data_source = (Container[i].protocol == RF_PROTOCOL_ADSB_UAT ||
                              Container[i].protocol == RF_PROTOCOL_ADSB_1090) ?
                             DATA_SOURCE_ADSB : DATA_SOURCE_FLARM;
 
-              snprintf_P(NMEABuffer, sizeof(NMEABuffer),
-                      PSTR("$PFLAA,%d,%d,%d,%d,%d,%06X!%s,%d,,%d,%s,%d" PFLAA_EXT1_FMT "*"),
-                      alarm_level,
-                      (int) (distance * cos(radians(bearing))), (int) (distance * sin(radians(bearing))),
-                      alt_diff, addr_type, Container[i].addr, NMEA_Callsign,
-                      (int) Container[i].course, (int) (Container[i].speed * _GPS_MPS_PER_KNOT),
-                      ltrim(str_climb_rate), Container[i].aircraft_type
-                      PFLAA_EXT1_ARGS );
+              nmea_target_t *target = NMEA_Target(&Container[i]);
+              char *sentence = NMEA_Export_reserve();
+              nmea_writer_t w = { sentence, 0 };
+
+              *w.ptr++ = '$';
+              for (const char *s = "PFLAA,"; *s; s++) {
+                NMEA_putc(&w, *s);
+              }
+              NMEA_puti(&w, alarm_level);
+              NMEA_putc(&w, ',');
+              NMEA_puti(&w, Container[i].north);
+              NMEA_putc(&w, ',');
+              NMEA_puti(&w, Container[i].east);
+              NMEA_putc(&w, ',');
+              NMEA_puti(&w, alt_diff);
+
+              memcpy(w.ptr, target->frag, target->len);
+              w.ptr += target->len;
+              w.cs  ^= target->cs;
+
+              NMEA_puti(&w, (int32_t) Container[i].course);
+              NMEA_putc(&w, ',');
+              NMEA_putc(&w, ',');
+              NMEA_puti(&w, (int32_t) (Container[i].speed * _GPS_MPS_PER_KNOT));
+              NMEA_putc(&w, ',');
+
+              if (!Container[i].stealth && !ThisAircraft.stealth) {
+                float climb_rate = constrain(Container[i].vs / (_GPS_FEET_PER_METER * 60.0),
+                                             -32.7, 32.7);
+                int tenths = (int) (climb_rate * 10 + (climb_rate < 0 ? -0.5 : 0.5));
 
-              NMEA_add_checksum(NMEABuffer, sizeof(NMEABuffer) - strlen(NMEABuffer));
+                if (tenths < 0) {
+                  NMEA_putc(&w, '-');
+                  tenths = -tenths;
+                }
+                NMEA_putu(&w, tenths / 10);
+                NMEA_putc(&w, '.');
+                NMEA_putc(&w, '0' + tenths % 10);
+              }
+              NMEA_putc(&w, ',');
+              NMEA_putu(&w, Container[i].aircraft_type);
+
+              if (sizeof(PFLAA_EXT1_FMT) > 1) {
+                char *ext = w.ptr;
+                w.ptr += snprintf_P(ext, NMEA_BUFFER_SIZE - (ext - sentence) - 5,
+                                    PSTR("%s" PFLAA_EXT1_FMT), "" PFLAA_EXT1_ARGS);
+                for (; ext < w.ptr; ext++) {
+                  w.cs ^= *ext;
+                }
+              }
 
-              NMEA_Out(settings->nmea_out, (byte *) NMEABuffer, strlen(NMEABuffer), false);
+              NMEA_end(&w);
+              NMEA_ExportLen += w.ptr - sentence;
 
               /* Most close traffic is treated as highest priority target */
               if (distance < HP_distance && abs(alt_diff) < VERTICAL_VISIBILITY_RANGE) {
@@ -406,11 +549,13 @@ void NMEA_Export()
                          voltage < Battery_threshold() ?
                          POWER_STATUS_BAD : POWER_STATUS_GOOD;
 
+      char *sentence = NMEA_Export_reserve();
+
       if (total_objects > 0) {
         int rel_bearing = HP_bearing - ThisAircraft.course;
         rel_bearing += (rel_bearing < -180 ? 360 : (rel_bearing > 180 ? -360 : 0));
 
-        snprintf_P(NMEABuffer, sizeof(NMEABuffer),
+        snprintf_P(sentence, NMEA_BUFFER_SIZE,
                 PSTR("$PFLAU,%d,%d,%d,%d,%d,%d,%d,%d,%u,%06X" PFLAU_EXT1_FMT "*"),
                 total_objects,
                 settings->txpower == RF_TX_POWER_OFF ? TX_STATUS_OFF : TX_STATUS_ON,
@@ -419,7 +564,7 @@ void NMEA_Export()
                 ALARM_TYPE_AIRCRAFT, HP_alt_diff, (int) HP_distance, HP_addr
                 PFLAU_EXT1_ARGS );
       } else {
-        snprintf_P(NMEABuffer, sizeof(NMEABuffer),
+        snprintf_P(sentence, NMEA_BUFFER_SIZE,
                 PSTR("$PFLAU,0,%d,%d,%d,%d,,0,,," PFLAU_EXT1_FMT "*"),
                 has_Fix && (settings->txpower != RF_TX_POWER_OFF) ?
                   TX_STATUS_ON : TX_STATUS_OFF,
@@ -428,21 +573,23 @@ void NMEA_Export()
                 PFLAU_EXT1_ARGS );
       }
 
-      NMEA_add_checksum(NMEABuffer, sizeof(NMEABuffer) - strlen(NMEABuffer));
-
-      NMEA_Out(settings->nmea_out, (byte *) NMEABuffer, strlen(NMEABuffer), false);
+      NMEA_add_checksum(sentence, NMEA_BUFFER_SIZE - strlen(sentence));
+      NMEA_ExportLen += strlen(sentence);
 
 #if !defined(EXCLUDE_SOFTRF_HEARTBEAT)
-      snprintf_P(NMEABuffer, sizeof(NMEABuffer),
+      sentence = NMEA_Export_reserve();
+
+      snprintf_P(sentence, NMEA_BUFFER_SIZE,
               PSTR("$PSRFH,%06X,%d,%d,%d,%d*"),
               ThisAircraft.addr,settings->rf_protocol,
               rx_packets_counter,tx_packets_counter,(int)(voltage*100));
 
-      NMEA_add_checksum(NMEABuffer, sizeof(NMEABuffer) - strlen(NMEABuffer));
-
-      NMEA_Out(settings->nmea_out, (byte *) NMEABuffer, strlen(NMEABuffer), false);
+      NMEA_add_checksum(sentence, NMEA_BUFFER_SIZE - strlen(sentence));
+      NMEA_ExportLen += strlen(sentence);
 #endif /* EXCLUDE_SOFTRF_HEARTBEAT */
     }
+
+    NMEA_Export_flush();
 }
 
 #if defined(USE_NMEALIB)
@@ -0,0 +1,570 @@
+/*
+ * Bench.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host side micro-benchmark of the radio protocol decoders and encoders.
+ * No radio, GNSS or GPIO is touched, it runs on any Linux box.
+ *
+ *  $ make bench
+ *  $ ./SoftRF-bench -n 4096 -r 5 -f ogntp
+ *  {"bench":"ogntp_decode","corpus":"valid","frames":4096,"repeats":5,"ok":4096,"ns_per_frame":...}
+ *  {"bench":"ogntp_decode","corpus":"corrupt",...}
+ *  {"bench":"ogntp_decode","corpus":"noise",...}
+ *  {"bench":"ogntp_encode","corpus":"traffic",...}
+ *
+ * Every decoder runs over three corpora built at start up from a fixed seed:
+ * valid frames made by the encoders, the same frames with 1 to 4 bits
+ * flipped, and random bytes. Each frame is copied into a scratch buffer
+ * first, like the radio drivers do, since most decoders work in place.
+ * Legacy, P3I and FANET leave integrity to the radio: the RF driver or the
+ * LoRa modem drops a frame with a bad CRC before it gets decoded. Their
+ * frames carry a CRC-16 CCITT that is checked ahead of the decoder
+ * ("radio_crc":true), so "ok" on the corrupt and noise corpora is what a
+ * receiver would really pass on, not what the decoder alone accepts.
+ * One JSON object is printed per run: the best pass gives ns_per_frame and
+ * frames_per_s, the allocation counters are averaged over all passes.
+ */
+
+#if defined(RASPBERRY_PI)
+
+#include "SoC.h"
+#include "../driver/RF.h"
+#include "../driver/EEPROM.h"
+#include "../protocol/data/GDL90.h"
+
+#include <fec.h>
+#include <fec/rs.h>
+#include <uat.h>
+#include <adsb_encoder.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <new>
+
+#define BENCH_FRAMES      4096
+#define BENCH_REPEATS     5
+#define BENCH_SEED        0x50465253
+#define BENCH_TRAFFIC     64   /* distinct addresses in the corpora */
+#define BENCH_FRAME_MAX   LONG_FRAME_BYTES
+#define BENCH_RADIO_CRC   2    /* bytes, stands in for the radio's own check */
+
+/*
+ * What the benchmarked objects need from the rest of the firmware.
+ * RPi.cpp, RF.cpp and GDL90.cpp provide these in the SoftRF binary.
+ */
+lmic_pinmap lmic_pins = {
+    .nss = LMIC_UNUSED_PIN,
+    .txe = LMIC_UNUSED_PIN,
+    .rxe = LMIC_UNUSED_PIN,
+    .rst = LMIC_UNUSED_PIN,
+    .dio = {LMIC_UNUSED_PIN, LMIC_UNUSED_PIN, LMIC_UNUSED_PIN},
+    .busy = LMIC_UNUSED_PIN,
+    .tcxo = LMIC_UNUSED_PIN,
+};
+
+#if defined(USE_BASICMAC)
+void os_getJoinEui (u1_t* buf) { }
+void os_getNwkKey (u1_t* buf) { }
+void os_getDevEui (u1_t* buf) { }
+#else
+void os_getArtEui (u1_t* buf) { }
+void os_getDevEui (u1_t* buf) { }
+void os_getDevKey (u1_t* buf) { }
+#endif
+
+static eeprom_t Bench_EEPROM;
+settings_t *settings = &Bench_EEPROM.field.settings;
+
+uint8_t parity(uint32_t x) {
+  return __builtin_parity(x);
+}
+
+const uint8_t gdl90_to_aircraft_type[] PROGMEM = {
+  AIRCRAFT_TYPE_UNKNOWN,
+  AIRCRAFT_TYPE_POWERED,
+  AIRCRAFT_TYPE_POWERED,
+  AIRCRAFT_TYPE_JET,
+  AIRCRAFT_TYPE_JET,
+  AIRCRAFT_TYPE_JET,
+  AIRCRAFT_TYPE_POWERED,
+  AIRCRAFT_TYPE_HELICOPTER,
+  AIRCRAFT_TYPE_RESERVED,
+  AIRCRAFT_TYPE_GLIDER,
+  AIRCRAFT_TYPE_BALLOON,
+  AIRCRAFT_TYPE_PARACHUTE,
+  AIRCRAFT_TYPE_HANGGLIDER,
+  AIRCRAFT_TYPE_RESERVED,
+  AIRCRAFT_TYPE_UAV,
+  AIRCRAFT_TYPE_RESERVED
+};
+
+/*
+ * Allocation counters. The bench is linked with --wrap for the malloc
+ * family, so every call made by the benchmarked objects lands here.
+ * Allocations made inside the shared C/C++ runtime itself are not seen.
+ */
+static unsigned long Bench_Allocs;
+static unsigned long Bench_Alloc_Bytes;
+
+extern "C" {
+void *__real_malloc(size_t);
+void *__real_calloc(size_t, size_t);
+void *__real_realloc(void *, size_t);
+
+void *__wrap_malloc(size_t size)
+{
+  Bench_Allocs++;
+  Bench_Alloc_Bytes += size;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+  Bench_Allocs++;
+  Bench_Alloc_Bytes += nmemb * size;
+  return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+  Bench_Allocs++;
+  Bench_Alloc_Bytes += size;
+  return __real_realloc(ptr, size);
+}
+}
+
+void *operator new(size_t size)
+{
+  Bench_Allocs++;
+  Bench_Alloc_Bytes += size;
+
+  void *ptr = __real_malloc(size ? size : 1);
+  if (ptr == NULL) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+  free(ptr);
+}
+
+/* Fixtures */
+
+static ufo_t    Bench_Own;
+static ufo_t    Bench_Traffic[BENCH_TRAFFIC];
+static ufo_t    Bench_fo;
+static mode_s_t Bench_ModeS;
+static void     *Bench_RS_long;
+static uint32_t Bench_Rand;
+
+/* xorshift32, the corpora must not depend on the C library */
+static uint32_t Bench_random()
+{
+  Bench_Rand ^= Bench_Rand << 13;
+  Bench_Rand ^= Bench_Rand >> 17;
+  Bench_Rand ^= Bench_Rand << 5;
+  return Bench_Rand;
+}
+
+static float Bench_uniform(float lo, float hi)
+{
+  return lo + (hi - lo) * (Bench_random() / 4294967296.0);
+}
+
+static void Bench_make_traffic()
+{
+  Bench_Own.addr              = 0xDD8F12;
+  Bench_Own.latitude          = 47.3977;
+  Bench_Own.longitude         = 8.5456;
+  Bench_Own.altitude          = 520.0;
+  Bench_Own.geoid_separation  = 48.0;
+  Bench_Own.timestamp         = 1700000000;
+  Bench_Own.aircraft_type     = AIRCRAFT_TYPE_GLIDER;
+
+  for (int i = 0; i < BENCH_TRAFFIC; i++) {
+    ufo_t *fop = &Bench_Traffic[i];
+
+    memset(fop, 0, sizeof(ufo_t));
+    fop->addr              = 0x3E0000 + i * 0x111;
+    fop->latitude          = Bench_Own.latitude  + Bench_uniform(-0.2, 0.2);
+    fop->longitude         = Bench_Own.longitude + Bench_uniform(-0.3, 0.3);
+    fop->altitude          = Bench_uniform(300, 3000);
+    fop->pressure_altitude = fop->altitude + Bench_uniform(-50, 50);
+    fop->course            = Bench_uniform(0, 359);
+    fop->speed             = Bench_uniform(20, 150);
+    fop->vs                = Bench_uniform(-500, 500);
+    fop->hdop              = 100;
+    fop->aircraft_type     = 1 + (i % AIRCRAFT_TYPE_STATIC);
+    fop->timestamp         = Bench_Own.timestamp;
+  }
+}
+
+static size_t Bench_legacy_make(uint8_t *frame, unsigned i)
+{
+  return legacy_encode(frame, &Bench_Traffic[i % BENCH_TRAFFIC]);
+}
+
+static size_t Bench_ogntp_make(uint8_t *frame, unsigned i)
+{
+  return ogntp_encode(frame, &Bench_Traffic[i % BENCH_TRAFFIC]);
+}
+
+static size_t Bench_p3i_make(uint8_t *frame, unsigned i)
+{
+  return p3i_encode(frame, &Bench_Traffic[i % BENCH_TRAFFIC]);
+}
+
+static size_t Bench_fanet_make(uint8_t *frame, unsigned i)
+{
+  return fanet_encode(frame, &Bench_Traffic[i % BENCH_TRAFFIC]);
+}
+
+static uint16_t Bench_crc(const uint8_t *frame, size_t size)
+{
+  uint16_t crc = 0xFFFF;
+
+  for (size_t k = 0; k < size; k++) {
+    crc = update_crc_ccitt(crc, frame[k]);
+  }
+  return crc;
+}
+
+/* A long ADS-B frame with random state vector bits */
+static size_t Bench_uat978_make(uint8_t *frame, unsigned i)
+{
+  ufo_t *fop = &Bench_Traffic[i % BENCH_TRAFFIC];
+
+  for (int k = 0; k < LONG_FRAME_DATA_BYTES; k++) {
+    frame[k] = Bench_random();
+  }
+  frame[0] = (1 << 3);                  /* payload type 1, ICAO address */
+  frame[1] = (fop->addr >> 16) & 0xFF;
+  frame[2] = (fop->addr >>  8) & 0xFF;
+  frame[3] = (fop->addr      ) & 0xFF;
+
+  encode_rs_char(Bench_RS_long, frame, frame + LONG_FRAME_DATA_BYTES);
+
+  return LONG_FRAME_BYTES;
+}
+
+static size_t Bench_es1090_make(uint8_t *frame, unsigned i)
+{
+  ufo_t *fop = &Bench_Traffic[i % BENCH_TRAFFIC];
+  frame_data_t fd;
+
+  if (i % 4 == 3) {
+    fd = make_velocity_frame(fop->addr, fop->speed, fop->speed / 2,
+                             fop->vs, DF17);
+  } else {
+    fd = make_air_position_frame(11, fop->addr, fop->latitude, fop->longitude,
+                                 fop->altitude * _GPS_FEET_PER_METER,
+                                 i & 1 ? CPR_ODD : CPR_EVEN, DF17);
+  }
+  memcpy(frame, fd.msg, MODE_S_LONG_MSG_BYTES);
+
+  return MODE_S_LONG_MSG_BYTES;
+}
+
+/* One frame through the same steps the Rx path takes */
+
+static bool Bench_legacy_decode(uint8_t *frame, unsigned i)
+{
+  return legacy_decode(frame, &Bench_Own, &Bench_fo);
+}
+
+static bool Bench_ldpc_check(uint8_t *frame, unsigned i)
+{
+  return LDPC_Check(frame) == 0;
+}
+
+static bool Bench_ogntp_decode(uint8_t *frame, unsigned i)
+{
+  return LDPC_Decode(frame) == 0 && ogntp_decode(frame, &Bench_Own, &Bench_fo);
+}
+
+static bool Bench_p3i_decode(uint8_t *frame, unsigned i)
+{
+  return p3i_decode(frame, &Bench_Own, &Bench_fo);
+}
+
+static bool Bench_fanet_decode(uint8_t *frame, unsigned i)
+{
+  return fanet_decode(frame, &Bench_Own, &Bench_fo);
+}
+
+static bool Bench_uat978_decode(uint8_t *frame, unsigned i)
+{
+  int rs_errors;
+
+  return correct_adsb_frame(frame, &rs_errors) > 0 &&
+         uat978_decode(frame, &Bench_Own, &Bench_fo);
+}
+
+static bool Bench_es1090_decode(uint8_t *frame, unsigned i)
+{
+  struct mode_s_msg mm;
+
+  mode_s_decode(&Bench_ModeS, &mm, frame);
+  if (mm.crcok) {
+    interactiveReceiveData(&Bench_ModeS, &mm);
+  }
+  return mm.crcok;
+}
+
+static bool Bench_legacy_encode(uint8_t *frame, unsigned i)
+{
+  return legacy_encode(frame, &Bench_Traffic[i % BENCH_TRAFFIC]) > 0;
+}
+
+static bool Bench_ogntp_encode(uint8_t *frame, unsigned i)
+{
+  return ogntp_encode(frame, &Bench_Traffic[i % BENCH_TRAFFIC]) > 0;
+}
+
+static bool Bench_p3i_encode(uint8_t *frame, unsigned i)
+{
+  return p3i_encode(frame, &Bench_Traffic[i % BENCH_TRAFFIC]) > 0;
+}
+
+static bool Bench_fanet_encode(uint8_t *frame, unsigned i)
+{
+  return fanet_encode(frame, &Bench_Traffic[i % BENCH_TRAFFIC]) > 0;
+}
+
+typedef struct {
+  const char *name;
+  size_t     size;                          /* bytes per frame */
+  size_t     (*make)(uint8_t *, unsigned);  /* valid frame number i */
+  bool       (*run)(uint8_t *, unsigned);   /* false when rejected */
+  bool       encoder;                       /* runs over the traffic list */
+  size_t     crc;                           /* radio CRC bytes after the frame */
+} bench_t;
+
+static const bench_t Bench_Cases[] = {
+  { "legacy_decode", LEGACY_PAYLOAD_SIZE,
+    Bench_legacy_make,  Bench_legacy_decode, false, BENCH_RADIO_CRC },
+  { "ldpc_check",    OGNTP_PAYLOAD_SIZE + OGNTP_CRC_SIZE,
+    Bench_ogntp_make,   Bench_ldpc_check,    false },
+  { "ogntp_decode",  OGNTP_PAYLOAD_SIZE + OGNTP_CRC_SIZE,
+    Bench_ogntp_make,   Bench_ogntp_decode,  false },
+  { "p3i_decode",    sizeof(p3i_packet_t),
+    Bench_p3i_make,     Bench_p3i_decode,    false, BENCH_RADIO_CRC },
+  { "fanet_decode",  sizeof(fanet_packet_t),
+    Bench_fanet_make,   Bench_fanet_decode,  false, BENCH_RADIO_CRC },
+  { "uat978_decode", LONG_FRAME_BYTES,
+    Bench_uat978_make,  Bench_uat978_decode, false },
+  { "es1090_decode", MODE_S_LONG_MSG_BYTES,
+    Bench_es1090_make,  Bench_es1090_decode, false },
+  { "legacy_encode", LEGACY_PAYLOAD_SIZE,
+    NULL,               Bench_legacy_encode, true  },
+  { "ogntp_encode",  OGNTP_PAYLOAD_SIZE + OGNTP_CRC_SIZE,
+    NULL,               Bench_ogntp_encode,  true  },
+  { "p3i_encode",    sizeof(p3i_packet_t),
+    NULL,               Bench_p3i_encode,    true  },
+  { "fanet_encode",  sizeof(fanet_packet_t),
+    NULL,               Bench_fanet_encode,  true  },
+};
+
+static uint64_t Bench_ns()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void Bench_run(const bench_t *b, const char *corpus,
+                      const uint8_t *frames, unsigned count, unsigned repeats)
+{
+  uint8_t work[BENCH_FRAME_MAX + BENCH_RADIO_CRC];
+  size_t stride = b->size + b->crc;
+  uint64_t best = UINT64_MAX;
+  unsigned long allocs = 0, bytes = 0;
+  unsigned ok = 0;
+
+  /* warm up caches and the Mode S aircraft list, not counted */
+  for (unsigned i = 0; i < count; i++) {
+    memcpy(work, frames + i * stride, stride);
+    b->run(work, i);
+  }
+
+  for (unsigned r = 0; r < repeats; r++) {
+    unsigned long allocs_0 = Bench_Allocs, bytes_0 = Bench_Alloc_Bytes;
+
+    ok = 0;
+    uint64_t start = Bench_ns();
+    for (unsigned i = 0; i < count; i++) {
+      memcpy(work, frames + i * stride, stride);
+      if (b->crc &&
+          Bench_crc(work, b->size) != (work[b->size] << 8 | work[b->size + 1])) {
+        continue;
+      }
+      if (b->run(work, i)) {
+        ok++;
+      }
+    }
+    uint64_t elapsed = Bench_ns() - start;
+
+    allocs += Bench_Allocs - allocs_0;
+    bytes  += Bench_Alloc_Bytes - bytes_0;
+    if (elapsed < best) {
+      best = elapsed;
+    }
+  }
+
+  double ns_per_frame = (double) best / count;
+  double total = (double) count * repeats;
+
+  printf("{\"bench\":\"%s\",\"corpus\":\"%s\",\"frames\":%u,\"repeats\":%u,"
+         "\"radio_crc\":%s,\"ok\":%u,\"ns_per_frame\":%.1f,\"frames_per_s\":%.0f,"
+         "\"allocs_per_frame\":%.3f,\"alloc_bytes_per_frame\":%.1f}\n",
+         b->name, corpus, count, repeats, b->crc ? "true" : "false", ok, ns_per_frame,
+         ns_per_frame > 0 ? 1e9 / ns_per_frame : 0.0,
+         allocs / total, bytes / total);
+  fflush(stdout);
+}
+
+static void Bench_usage(const char *argv0)
+{
+  fprintf(stderr, "Usage: %s [-n frames] [-r repeats] [-s seed] [-f filter]\n"
+                  "  -n frames   corpus size per run (default %u)\n"
+                  "  -r repeats  timed passes per run, the best one is reported (default %u)\n"
+                  "  -s seed     corpus seed (default 0x%X)\n"
+                  "  -f filter   only runs whose name contains this string\n",
+          argv0, BENCH_FRAMES, BENCH_REPEATS, BENCH_SEED);
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned count   = BENCH_FRAMES;
+  unsigned repeats = BENCH_REPEATS;
+  uint32_t seed     = BENCH_SEED;
+  const char *filter = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:r:s:f:h")) != -1) {
+    switch (opt)
+    {
+    case 'n': count   = strtoul(optarg, NULL, 0); break;
+    case 'r': repeats = strtoul(optarg, NULL, 0); break;
+    case 's': seed    = strtoul(optarg, NULL, 0); break;
+    case 'f': filter  = optarg; break;
+    default:
+      Bench_usage(argv[0]);
+      return (opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+  }
+  if (count == 0 || repeats == 0 || seed == 0) {
+    Bench_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Bench_Rand = seed;
+  Bench_make_traffic();
+
+  init_fec();
+  Bench_RS_long = init_rs_char(8, /* gfpoly */ 0x187, /* fcr */ 120,
+                               /* prim */ 1, /* nroots */ 14, /* pad */ 207);
+  adsb_encoder_init();
+
+  mode_s_init(&Bench_ModeS);
+  Bench_ModeS.cpr_ref_valid = 1;
+  Bench_ModeS.cpr_ref_lat   = Bench_Own.latitude;
+  Bench_ModeS.cpr_ref_lon   = Bench_Own.longitude;
+
+  uint8_t *valid   = (uint8_t *) calloc(count, BENCH_FRAME_MAX + BENCH_RADIO_CRC);
+  uint8_t *corrupt = (uint8_t *) calloc(count, BENCH_FRAME_MAX + BENCH_RADIO_CRC);
+  uint8_t *noise   = (uint8_t *) calloc(count, BENCH_FRAME_MAX + BENCH_RADIO_CRC);
+
+  if (!valid || !corrupt || !noise) {
+    fprintf(stderr, "bench: out of memory\n");
+    return EXIT_FAILURE;
+  }
+
+  for (unsigned n = 0; n < sizeof(Bench_Cases) / sizeof(Bench_Cases[0]); n++) {
+    const bench_t *b = &Bench_Cases[n];
+
+    if (filter && strstr(b->name, filter) == NULL) {
+      continue;
+    }
+
+    /* the same corpus for a case whatever the filter */
+    Bench_Rand = seed + (n + 1) * 0x9E3779B9;
+    if (Bench_Rand == 0) {
+      Bench_Rand = 1;
+    }
+
+    if (b->encoder) {
+      Bench_run(b, "traffic", valid, count, repeats);
+      continue;
+    }
+
+    size_t stride = b->size + b->crc;
+
+    for (unsigned i = 0; i < count; i++) {
+      uint8_t *v = valid   + i * stride;
+      uint8_t *c = corrupt + i * stride;
+      uint8_t *z = noise   + i * stride;
+
+      b->make(v, i);
+      if (b->crc) {
+        uint16_t crc = Bench_crc(v, b->size);
+
+        v[b->size]     = crc >> 8;
+        v[b->size + 1] = crc & 0xFF;
+      }
+
+      memcpy(c, v, stride);
+      for (unsigned flips = 1 + Bench_random() % 4; flips > 0; flips--) {
+        unsigned bit = Bench_random() % (stride * 8);
+        c[bit >> 3] ^= 0x80 >> (bit & 7);
+      }
+
+      for (unsigned k = 0; k < stride; k++) {
+        z[k] = Bench_random();
+      }
+    }
+
+    Bench_run(b, "valid",   valid,   count, repeats);
+    Bench_run(b, "corrupt", corrupt, count, repeats);
+    Bench_run(b, "noise",   noise,   count, repeats);
+  }
+
+  free(valid);
+  free(corrupt);
+  free(noise);
+
+  return EXIT_SUCCESS;
+}
+
+#endif /* RASPBERRY_PI */
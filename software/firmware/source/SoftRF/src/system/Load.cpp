@@ -0,0 +1,474 @@
+/*
+ * Load.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SoC.h"
+#include "Load.h"
+
+#if defined(RASPBERRY_PI)
+
+#include "../driver/RF.h"
+#include "../protocol/data/GDL90.h"
+
+#include <adsb_encoder.h>
+#include <uat.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <queue>
+#include <vector>
+#include <functional>
+
+enum
+{
+  LOAD_GLIDER,
+  LOAD_GA,
+  LOAD_AIRLINER
+};
+
+typedef struct load_aircraft_struct {
+  uint32_t addr;
+  uint8_t  kind;
+  uint8_t  protocol;
+  uint8_t  aircraft_type;
+  uint32_t seq;       /* frames sent so far */
+  uint32_t updated;   /* ms, last move */
+  float    x, y;      /* m, east and north of the centre */
+  float    altitude;  /* m */
+  float    course;    /* deg */
+  float    speed;     /* m/s */
+  float    vs;        /* m/s */
+  float    cx, cy, r; /* thermal, gliders only */
+  float    phase;     /* rad, position on the thermal circle */
+  float    area;      /* m, turns back beyond that */
+} load_aircraft_t;
+
+/* next event of each aircraft: ms << 16 | index, own ship is index 0 */
+static std::priority_queue<uint64_t, std::vector<uint64_t>,
+                           std::greater<uint64_t> > Load_Events;
+
+static load_aircraft_t *Load_Fleet = NULL;
+static unsigned        Load_Count  = 0;
+static load_aircraft_t Load_Own;
+static float           Load_Lat, Load_Lon;
+static float           Load_Lon_Scale; /* m per degree of longitude */
+static time_t          Load_Time0;
+static uint32_t        Load_Duration;  /* ms */
+static uint32_t        Load_Rand;
+
+static uint32_t Load_random()
+{
+  Load_Rand ^= Load_Rand << 13;
+  Load_Rand ^= Load_Rand >> 17;
+  Load_Rand ^= Load_Rand << 5;
+  return Load_Rand;
+}
+
+static float Load_uniform(float lo, float hi)
+{
+  return lo + (hi - lo) * (Load_random() / 4294967296.0);
+}
+
+static void Load_Thermal(load_aircraft_t *a)
+{
+  float d = Load_uniform(0, a->area);
+  float b = Load_uniform(0, 2 * PI);
+
+  a->cx       = d * sinf(b);
+  a->cy       = d * cosf(b);
+  a->r        = Load_uniform(80, 200);
+  a->phase    = Load_uniform(0, 2 * PI);
+  a->vs       = Load_uniform(0.5, 3.0);
+}
+
+/* enter the area at its edge, heading roughly across */
+static void Load_Entry(load_aircraft_t *a)
+{
+  float b = Load_uniform(0, 2 * PI);
+
+  a->x      = 0.99 * a->area * sinf(b);
+  a->y      = 0.99 * a->area * cosf(b);
+  a->course = fmodf(b * 180 / PI + 180 + Load_uniform(-30, 30) + 360, 360);
+}
+
+static void Load_Move(load_aircraft_t *a, uint32_t ms)
+{
+  float dt = (ms - a->updated) / 1000.0;
+
+  a->updated = ms;
+
+  if (a->kind == LOAD_GLIDER) {
+    a->phase    = fmodf(a->phase + a->speed / a->r * dt, 2 * PI);
+    a->x        = a->cx + a->r * sinf(a->phase);
+    a->y        = a->cy + a->r * cosf(a->phase);
+    a->course   = fmodf(a->phase * 180 / PI + 90, 360);
+    a->altitude += a->vs * dt;
+
+    /* cloud base, glide off to the next thermal */
+    if (a->altitude > 2500) {
+      a->altitude = Load_uniform(800, 1200);
+      if (a != &Load_Own) {
+        Load_Thermal(a);
+      }
+    }
+  } else {
+    a->x += a->speed * sinf(a->course * PI / 180) * dt;
+    a->y += a->speed * cosf(a->course * PI / 180) * dt;
+
+    if (a->x * a->x + a->y * a->y > a->area * a->area) {
+      Load_Entry(a);
+    }
+  }
+}
+
+static void Load_ufo(const load_aircraft_t *a, uint32_t ms, ufo_t *fop)
+{
+  memset(fop, 0, sizeof(ufo_t));
+
+  fop->addr              = a->addr;
+  fop->protocol          = a->protocol;
+  fop->latitude          = Load_Lat + a->y / 111132.954;
+  fop->longitude         = Load_Lon + a->x / Load_Lon_Scale;
+  fop->altitude          = a->altitude;
+  fop->pressure_altitude = a->altitude;
+  fop->course            = a->course;
+  fop->speed             = a->speed / _GPS_MPS_PER_KNOT;
+  fop->vs                = a->vs * (_GPS_FEET_PER_METER * 60.0);
+  fop->aircraft_type     = a->aircraft_type;
+  fop->hdop              = 100;
+  fop->timestamp         = Load_Time0 + ms / 1000;
+
+  snprintf((char *) fop->callsign, sizeof(fop->callsign), "SRF%04X",
+           a->addr & 0xFFFF);
+}
+
+/* base40 of uat_decode.cpp: digits, letters, space */
+static uint16_t Load_UAT_char(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+  return 36;
+}
+
+/*
+ * UAT978 has no encoder, the radios only receive it. Long ADS-B frame
+ * of payload type 1 (HDR, SV, MS), as it is once the FEC is off.
+ */
+static size_t Load_UAT(uint8_t *frame, const ufo_t *fop)
+{
+  float lat = fop->latitude  < 0 ? fop->latitude  + 180 : fop->latitude;
+  float lon = fop->longitude < 0 ? fop->longitude + 360 : fop->longitude;
+  uint32_t raw_lat = (uint32_t) (lat * 16777216.0 / 360.0) & 0x7FFFFF;
+  uint32_t raw_lon = (uint32_t) (lon * 16777216.0 / 360.0) & 0xFFFFFF;
+
+  int alt = (int) (fop->pressure_altitude * _GPS_FEET_PER_METER);
+  uint32_t raw_alt = constrain((alt + 1000) / 25 + 1, 1, 0xFFF);
+
+  float ns = fop->speed * cosf(fop->course * PI / 180);
+  float ew = fop->speed * sinf(fop->course * PI / 180);
+  uint32_t raw_ns = (ns < 0 ? 0x400 : 0) | ((uint32_t) (fabsf(ns) + 1) & 0x3FF);
+  uint32_t raw_ew = (ew < 0 ? 0x400 : 0) | ((uint32_t) (fabsf(ew) + 1) & 0x3FF);
+  uint32_t raw_vv = 0x400 /* baro */ | (fop->vs < 0 ? 0x200 : 0) |
+                    ((uint32_t) (fabsf(fop->vs) / 64 + 1) & 0x1FF);
+
+  memset(frame, 0, LONG_FRAME_DATA_BYTES);
+
+  frame[0]  = (1 << 3);  /* ICAO address */
+  frame[1]  = (fop->addr >> 16) & 0xFF;
+  frame[2]  = (fop->addr >>  8) & 0xFF;
+  frame[3]  = (fop->addr      ) & 0xFF;
+
+  frame[4]  = raw_lat >> 15;
+  frame[5]  = raw_lat >> 7;
+  frame[6]  = (raw_lat << 1) | (raw_lon >> 23);
+  frame[7]  = raw_lon >> 15;
+  frame[8]  = raw_lon >> 7;
+  frame[9]  = raw_lon << 1;   /* barometric altitude */
+  frame[10] = raw_alt >> 4;
+  frame[11] = (raw_alt << 4) | 8 /* NIC */;
+
+  frame[12] = (raw_ns >> 6) & 0x1F;  /* subsonic, airborne */
+  frame[13] = (raw_ns << 2) | (raw_ew >> 9);
+  frame[14] = raw_ew >> 1;
+  frame[15] = (raw_ew << 7) | ((raw_vv >> 4) & 0x7F);
+  frame[16] = raw_vv << 4;
+
+  const char *cs = (const char *) fop->callsign;
+  uint16_t v[3];
+
+  v[0] = AT_TO_GDL90(fop->aircraft_type) * 1600 +
+         Load_UAT_char(cs[0]) * 40 + Load_UAT_char(cs[1]);
+  v[1] = Load_UAT_char(cs[2]) * 1600 + Load_UAT_char(cs[3]) * 40 +
+         Load_UAT_char(cs[4]);
+  v[2] = Load_UAT_char(cs[5]) * 1600 + Load_UAT_char(cs[6]) * 40 +
+         Load_UAT_char(cs[7]);
+
+  for (int i = 0; i < 3; i++) {
+    frame[17 + 2 * i] = v[i] >> 8;
+    frame[18 + 2 * i] = v[i] & 0xFF;
+  }
+
+  return LONG_FRAME_DATA_BYTES;
+}
+
+/* DF17 squitters: even, velocity, odd, velocity, ident every 5 s */
+static size_t Load_ES(uint8_t *frame, const ufo_t *fop, uint32_t seq)
+{
+  frame_data_t fd;
+  float alt = fop->pressure_altitude * _GPS_FEET_PER_METER;
+
+  if (seq % 20 == 19) {
+    fd = make_aircraft_identification_frame(fop->addr,
+           (unsigned char *) fop->callsign, Category_Set_A, 3, DF17);
+  } else if (seq & 1) {
+    fd = make_velocity_frame(fop->addr,
+           fop->speed * cosf(fop->course * PI / 180),
+           fop->speed * sinf(fop->course * PI / 180),
+           fop->vs, DF17);
+  } else {
+    fd = make_air_position_frame(11, fop->addr,
+           fop->latitude, fop->longitude, alt,
+           seq & 2 ? CPR_ODD : CPR_EVEN, DF17);
+  }
+
+  memcpy(frame, fd.msg, sizeof(fd.msg));
+
+  return sizeof(fd.msg);
+}
+
+static uint32_t Load_Period(const load_aircraft_t *a)
+{
+  return a->protocol == RF_PROTOCOL_ADSB_1090 ? 250 : 1000;
+}
+
+static void Load_Add(uint8_t kind, unsigned n, float radius)
+{
+  static const uint8_t glider_protos[] = {
+    RF_PROTOCOL_LEGACY, RF_PROTOCOL_OGNTP, RF_PROTOCOL_FANET
+  };
+  static const uint8_t ga_protos[] = {
+    RF_PROTOCOL_LEGACY, RF_PROTOCOL_OGNTP, RF_PROTOCOL_P3I, RF_PROTOCOL_ADSB_UAT
+  };
+
+  for (unsigned i = 0; i < n && Load_Count < LOAD_MAX_AIRCRAFT; i++) {
+    load_aircraft_t *a = &Load_Fleet[Load_Count++];
+
+    memset(a, 0, sizeof(load_aircraft_t));
+    a->addr = 0xA00000 + (kind << 16) + i;
+    a->kind = kind;
+
+    switch (kind)
+    {
+    case LOAD_GLIDER:
+      a->protocol      = glider_protos[i % sizeof(glider_protos)];
+      a->aircraft_type = a->protocol == RF_PROTOCOL_FANET ?
+                         AIRCRAFT_TYPE_HANGGLIDER : AIRCRAFT_TYPE_GLIDER;
+      a->area          = radius;
+      a->speed         = Load_uniform(20, 28);
+      a->altitude      = Load_uniform(800, 2500);
+      Load_Thermal(a);
+      break;
+    case LOAD_GA:
+      a->protocol      = ga_protos[i % sizeof(ga_protos)];
+      a->aircraft_type = AIRCRAFT_TYPE_POWERED;
+      a->area          = radius;
+      a->speed         = Load_uniform(45, 75);
+      a->altitude      = Load_uniform(600, 2500);
+      Load_Entry(a);
+      break;
+    case LOAD_AIRLINER:
+    default:
+      a->protocol      = i % 4 == 3 ? RF_PROTOCOL_ADSB_UAT : RF_PROTOCOL_ADSB_1090;
+      a->aircraft_type = AIRCRAFT_TYPE_JET;
+      a->area          = 4 * radius;
+      a->speed         = Load_uniform(120, 250);
+      a->altitude      = Load_uniform(3000, 11500);
+      Load_Entry(a);
+      break;
+    }
+
+    /* start anywhere on the way in, not all on the edge */
+    if (kind != LOAD_GLIDER) {
+      float d = Load_uniform(0, 1.8 * a->area);
+      a->x += d * sinf(a->course * PI / 180);
+      a->y += d * cosf(a->course * PI / 180);
+    }
+
+    Load_Events.push(((uint64_t) (Load_random() % Load_Period(a)) << 16) |
+                     Load_Count);
+  }
+}
+
+/* ownship: centre of the scenario on input, current state on output */
+bool Load_setup(const char *scenario, ufo_t *ownship)
+{
+  unsigned gliders = 0, ga = 0, airliners = 0;
+  float radius = LOAD_RADIUS, duration = LOAD_TIME;
+  unsigned seed = LOAD_SEED;
+  char spec[256];
+  char *save = NULL;
+
+  snprintf(spec, sizeof(spec), "%s", scenario);
+  for (char *tok = strtok_r(spec, ", ", &save); tok;
+       tok = strtok_r(NULL, ", ", &save)) {
+    if      (sscanf(tok, "gliders=%u",   &gliders)   == 1) {}
+    else if (sscanf(tok, "ga=%u",        &ga)        == 1) {}
+    else if (sscanf(tok, "airliners=%u", &airliners) == 1) {}
+    else if (sscanf(tok, "radius=%f",    &radius)    == 1) {}
+    else if (sscanf(tok, "time=%f",      &duration)  == 1) {}
+    else if (sscanf(tok, "seed=%u",      &seed)      == 1) {}
+    else {
+      fprintf(stderr, "Load: unknown scenario item %s\n", tok);
+      return false;
+    }
+  }
+
+  if (gliders + ga + airliners == 0 || radius <= 0 || duration <= 0) {
+    return false;
+  }
+
+  Load_fini();
+
+  Load_Fleet = (load_aircraft_t *) calloc(LOAD_MAX_AIRCRAFT, sizeof(load_aircraft_t));
+  if (Load_Fleet == NULL) {
+    return false;
+  }
+
+  Load_Rand      = seed ? seed : LOAD_SEED;
+  Load_Lat       = ownship->latitude;
+  Load_Lon       = ownship->longitude;
+  Load_Lon_Scale = 111319.49 * cos(Load_Lat * PI / 180);
+  Load_Time0     = ownship->timestamp ? ownship->timestamp : time(NULL);
+  Load_Duration  = (uint32_t) (duration * 1000);
+
+  adsb_encoder_init();
+
+  /* own ship thermals in the middle of it all */
+  memset(&Load_Own, 0, sizeof(Load_Own));
+  Load_Own.kind     = LOAD_GLIDER;
+  Load_Own.r        = 150;
+  Load_Own.speed    = 22;
+  Load_Own.vs       = 1.5;
+  Load_Own.altitude = ownship->altitude > 0 ? ownship->altitude : 1000;
+  Load_Events.push(0);
+
+  Load_Add(LOAD_GLIDER,   gliders,   radius * 1000);
+  Load_Add(LOAD_GA,       ga,        radius * 1000);
+  Load_Add(LOAD_AIRLINER, airliners, radius * 1000);
+
+  return true;
+}
+
+/* payload needs room for TRACE_MAX_PAYLOAD bytes */
+bool Load_Next(Trace_Record_t *rec, uint8_t *payload)
+{
+  ufo_t fo;
+
+  while (!Load_Events.empty()) {
+    uint64_t event = Load_Events.top();
+    uint32_t ms    = event >> 16;
+    unsigned ndx   = event & 0xFFFF;
+
+    if (ms >= Load_Duration) {
+      break;
+    }
+    Load_Events.pop();
+
+    rec->ms = ms;
+
+    if (ndx == 0) {
+      Trace_Ownship_t own;
+
+      Load_Move(&Load_Own, ms);
+      Load_ufo(&Load_Own, ms, &fo);
+
+      own.timestamp = fo.timestamp;
+      own.latitude  = fo.latitude;
+      own.longitude = fo.longitude;
+      own.altitude  = fo.altitude;
+      own.course    = fo.course;
+      own.speed     = fo.speed;
+      own.fix       = 1;
+      memcpy(payload, &own, sizeof(own));
+
+      rec->type     = TRACE_OWNSHIP;
+      rec->protocol = 0;
+      rec->rssi     = 0;
+      rec->size     = sizeof(own);
+
+      Load_Events.push((uint64_t) (ms + 1000) << 16);
+      return true;
+    }
+
+    load_aircraft_t *a = &Load_Fleet[ndx - 1];
+    size_t size = 0;
+
+    Load_Move(a, ms);
+    Load_ufo(a, ms, &fo);
+
+    switch (a->protocol)
+    {
+    case RF_PROTOCOL_LEGACY:    size = legacy_encode(payload, &fo); break;
+    case RF_PROTOCOL_OGNTP:     size = ogntp_encode(payload, &fo);  break;
+    case RF_PROTOCOL_P3I:       size = p3i_encode(payload, &fo);    break;
+    case RF_PROTOCOL_FANET:     size = fanet_encode(payload, &fo);  break;
+    case RF_PROTOCOL_ADSB_UAT:  size = Load_UAT(payload, &fo);      break;
+    case RF_PROTOCOL_ADSB_1090: size = Load_ES(payload, &fo, a->seq); break;
+    default:                    break;
+    }
+
+    a->seq++;
+    Load_Events.push(((uint64_t) (ms + Load_Period(a)) << 16) | ndx);
+
+    if (size == 0 || size > TRACE_MAX_PAYLOAD) {
+      continue;
+    }
+
+    float dx = a->x - Load_Own.x, dy = a->y - Load_Own.y;
+
+    rec->type     = TRACE_PACKET;
+    rec->protocol = a->protocol;
+    rec->rssi     = constrain(-40 - (int) (sqrtf(dx * dx + dy * dy) / 1000), -120, -40);
+    rec->size     = size;
+
+    return true;
+  }
+
+  return false;
+}
+
+unsigned Load_Aircraft()
+{
+  return Load_Count;
+}
+
+void Load_fini()
+{
+  while (!Load_Events.empty()) {
+    Load_Events.pop();
+  }
+
+  free(Load_Fleet);
+  Load_Fleet = NULL;
+  Load_Count = 0;
+}
+
+#endif /* RASPBERRY_PI */
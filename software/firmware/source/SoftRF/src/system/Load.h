@@ -0,0 +1,47 @@
+/*
+ * Load.h
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOADHELPER_H
+#define LOADHELPER_H
+
+#include "Trace.h"
+
+/*
+ * Synthetic traffic: a scenario of N aircraft flying around own ship,
+ * encoded by the protocol encoders and handed out as RF trace records,
+ * so that the trace replay feeds them to the receive path.
+ *
+ * Scenario: comma separated key=value pairs, all optional.
+ *  gliders=N    thermalling, Legacy / OGNTP / FANET
+ *  ga=N         straight crossings, Legacy / OGNTP / P3I / UAT
+ *  airliners=N  straight and fast, ES1090 and some UAT
+ *  radius=KM    size of the area, airliners use four times that
+ *  time=S       length of the scenario
+ *  seed=N
+ */
+#define LOAD_MAX_AIRCRAFT   4096
+#define LOAD_RADIUS         10    /* km */
+#define LOAD_TIME           60    /* s */
+#define LOAD_SEED           1
+
+bool Load_setup(const char *, ufo_t *);
+bool Load_Next(Trace_Record_t *, uint8_t *);
+unsigned Load_Aircraft(void);
+void Load_fini(void);
+
+#endif /* LOADHELPER_H */
@@ -0,0 +1,378 @@
+/*
+ * PPS.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SoC.h"
+#include "PPS.h"
+
+#if defined(RASPBERRY_PI)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+
+#include <linux/pps.h>
+#include <linux/gpio.h>
+
+static uint8_t     PPS_Src      = PPS_SOURCE_NONE;
+static int         PPS_fd       = -1;
+static uint32_t    PPS_Sequence = 0; /* Linux PPS API: last assert event */
+static uint64_t    PPS_Last     = 0; /* us, last edge */
+static PPS_Stats_t PPS_Totals;
+/* edges come in on the main thread, the report goes out on the export one */
+static pthread_mutex_t PPS_Totals_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t    PPS_Sim_Jitter = 0; /* us */
+static int32_t     PPS_Sim_Offset = 0; /* us */
+static uint64_t    PPS_Sim_Count  = 0; /* edges so far */
+static uint64_t    PPS_Sim_Next   = 0; /* us, when the next one is due */
+static uint32_t    PPS_Sim_Rand   = 1;
+
+static const char *PPS_Source_Names[] = {
+  [PPS_SOURCE_NONE] = "NONE",
+  [PPS_SOURCE_KPPS] = "KPPS",
+  [PPS_SOURCE_LINE] = "LINE",
+  [PPS_SOURCE_SIM]  = "SIM"
+};
+
+static void PPS_Edge(uint64_t us, uint32_t count)
+{
+  uint64_t now = micros64();
+  uint32_t lag = now > us ? (uint32_t) (now - us) : 0;
+
+  pthread_mutex_lock(&PPS_Totals_lock);
+
+  PPS_Totals.edges += count;
+  PPS_Totals.lag_sum += lag;
+  if (lag > PPS_Totals.lag_max) {
+    PPS_Totals.lag_max = lag;
+  }
+
+  if (PPS_Last != 0 && us > PPS_Last) {
+    uint64_t interval = us - PPS_Last;
+    uint32_t periods  = (interval + PPS_PERIOD / 2) / PPS_PERIOD;
+
+    if (periods > 0) {
+      int32_t err = (int32_t) ((int64_t) interval -
+                               (int64_t) periods * PPS_PERIOD);
+
+      if (periods > count) {
+        PPS_Totals.missed += periods - count;
+      }
+
+      if (PPS_Totals.intervals == 0 || err < PPS_Totals.err_min) {
+        PPS_Totals.err_min = err;
+      }
+      if (PPS_Totals.intervals == 0 || err > PPS_Totals.err_max) {
+        PPS_Totals.err_max = err;
+      }
+      PPS_Totals.err_sum += err;
+      PPS_Totals.err_sq  += (int64_t) err * err;
+      PPS_Totals.intervals++;
+    }
+  }
+
+  pthread_mutex_unlock(&PPS_Totals_lock);
+
+  PPS_Last = us;
+}
+
+/* assert_tu is CLOCK_REALTIME, taken over to CLOCK_MONOTONIC as of now */
+static bool PPS_KPPS_fetch(uint32_t *sequence, uint64_t *us)
+{
+  struct pps_fdata fdata;
+  struct timespec rt, mono;
+
+  /* zero timeout: the last event, without waiting for the next one */
+  memset(&fdata, 0, sizeof(fdata));
+  if (ioctl(PPS_fd, PPS_FETCH, &fdata) < 0) {
+    return false;
+  }
+
+  clock_gettime(CLOCK_REALTIME, &rt);
+  clock_gettime(CLOCK_MONOTONIC, &mono);
+
+  int64_t ns = (int64_t) fdata.info.assert_tu.sec * 1000000000 +
+               fdata.info.assert_tu.nsec -
+               ((int64_t) rt.tv_sec - mono.tv_sec) * 1000000000 -
+               ((int64_t) rt.tv_nsec - mono.tv_nsec);
+
+  *sequence = fdata.info.assert_sequence;
+  *us = ns > 0 ? monotonicToMicros(ns) : 0;
+
+  return true;
+}
+
+static bool PPS_KPPS_open(const char *dev)
+{
+  struct pps_kparams params;
+  int caps;
+  uint64_t us;
+
+  PPS_fd = open(dev, O_RDWR | O_CLOEXEC);
+  if (PPS_fd < 0) {
+    return false;
+  }
+
+  if (ioctl(PPS_fd, PPS_GETCAP, &caps) < 0 || !(caps & PPS_CAPTUREASSERT) ||
+      ioctl(PPS_fd, PPS_GETPARAMS, &params) < 0) {
+    PPS_fini();
+    return false;
+  }
+
+  /* pps-gpio captures assert by default, changing it takes root */
+  if (!(params.mode & PPS_CAPTUREASSERT)) {
+    params.mode |= PPS_CAPTUREASSERT;
+    if (ioctl(PPS_fd, PPS_SETPARAMS, &params) < 0) {
+      PPS_fini();
+      return false;
+    }
+  }
+
+  /* whatever came before now is not an edge of ours */
+  if (!PPS_KPPS_fetch(&PPS_Sequence, &us)) {
+    PPS_fini();
+    return false;
+  }
+
+  PPS_Src = PPS_SOURCE_KPPS;
+
+  return true;
+}
+
+static bool PPS_Line_open(const char *chip, int line)
+{
+#if defined(GPIO_V2_GET_LINE_IOCTL)
+  struct gpio_v2_line_request req;
+  int fd;
+
+  if (line < 0 || (fd = open(chip, O_RDONLY | O_CLOEXEC)) < 0) {
+    return false;
+  }
+
+  /* event time stamps default to CLOCK_MONOTONIC */
+  memset(&req, 0, sizeof(req));
+  req.offsets[0]   = line;
+  req.num_lines    = 1;
+  req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING;
+  strncpy(req.consumer, "SoftRF PPS", sizeof(req.consumer) - 1);
+
+  int rval = ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &req);
+  close(fd);
+
+  if (rval < 0) {
+    return false;
+  }
+
+  PPS_fd = req.fd;
+  fcntl(PPS_fd, F_SETFL, fcntl(PPS_fd, F_GETFL) | O_NONBLOCK);
+  PPS_Src = PPS_SOURCE_LINE;
+
+  return true;
+#else
+  return false;
+#endif /* GPIO_V2_GET_LINE_IOCTL */
+}
+
+static uint32_t PPS_Sim_random()
+{
+  PPS_Sim_Rand ^= PPS_Sim_Rand << 13;
+  PPS_Sim_Rand ^= PPS_Sim_Rand >> 17;
+  PPS_Sim_Rand ^= PPS_Sim_Rand << 5;
+  return PPS_Sim_Rand;
+}
+
+/* Box-Muller, sdev of PPS_Sim_Jitter */
+static int32_t PPS_Sim_jitter()
+{
+  double u1 = (PPS_Sim_random() + 1.0) / 4294967297.0;
+  double u2 = PPS_Sim_random() / 4294967296.0;
+
+  return (int32_t) (PPS_Sim_Jitter * sqrt(-2.0 * log(u1)) * cos(2 * M_PI * u2));
+}
+
+static void PPS_Sim_schedule()
+{
+  int64_t next = (int64_t) PPS_Sim_Count * PPS_PERIOD + PPS_Sim_Offset +
+                 PPS_Sim_jitter();
+
+  PPS_Sim_Next = next > 0 ? next : 0;
+}
+
+static bool PPS_Sim_open(const char *spec)
+{
+  unsigned jitter = 0;
+  int offset = 0;
+
+  if (sscanf(spec, "sim:%u:%d", &jitter, &offset) < 1 && strcmp(spec, "sim")) {
+    return false;
+  }
+
+  PPS_Sim_Jitter = jitter;
+  PPS_Sim_Offset = offset % PPS_PERIOD;
+  PPS_Sim_Count  = micros64() / PPS_PERIOD + 1;
+  PPS_Sim_schedule();
+  PPS_Src = PPS_SOURCE_SIM;
+
+  return true;
+}
+
+bool PPS_setup(const char *spec, int pin)
+{
+  char chip[32];
+  int line = pin;
+
+  memset(&PPS_Totals, 0, sizeof(PPS_Totals));
+  PPS_Last = 0;
+
+  if (spec == NULL) {
+    return PPS_KPPS_open(PPS_DEVICE) || PPS_Line_open(PPS_GPIOCHIP, pin);
+  }
+
+  if (strncmp(spec, "sim", 3) == 0) {
+    return PPS_Sim_open(spec);
+  }
+
+  if (strncmp(spec, "/dev/gpiochip", 13) == 0) {
+    snprintf(chip, sizeof(chip), "%s", spec);
+    char *colon = strchr(chip, ':');
+    if (colon != NULL) {
+      *colon = 0;
+      line = atoi(colon + 1);
+    }
+    return PPS_Line_open(chip, line);
+  }
+
+  return PPS_KPPS_open(spec);
+}
+
+uint8_t PPS_Source()
+{
+  return PPS_Src;
+}
+
+const char *PPS_Source_Name()
+{
+  return PPS_Source_Names[PPS_Src];
+}
+
+/* to be watched for EPOLLIN, -1 if PPS_Poll() has to be called anyway */
+int PPS_Event_fd()
+{
+  return PPS_Src == PPS_SOURCE_LINE ? PPS_fd : -1;
+}
+
+/* true and the time of the latest edge when there is a new one */
+bool PPS_Poll(uint64_t *us)
+{
+  bool rval = false;
+
+  switch (PPS_Src)
+  {
+  case PPS_SOURCE_KPPS:
+    {
+      uint32_t sequence;
+      uint64_t edge;
+
+      if (PPS_KPPS_fetch(&sequence, &edge) && sequence != PPS_Sequence &&
+          edge != 0) {
+        PPS_Edge(edge, sequence - PPS_Sequence);
+        PPS_Sequence = sequence;
+        *us = edge;
+        rval = true;
+      }
+    }
+    break;
+#if defined(GPIO_V2_GET_LINE_IOCTL)
+  case PPS_SOURCE_LINE:
+    {
+      struct gpio_v2_line_event event;
+
+      while (read(PPS_fd, &event, sizeof(event)) == sizeof(event)) {
+        *us = monotonicToMicros(event.timestamp_ns);
+        PPS_Edge(*us, 1);
+        rval = true;
+      }
+    }
+    break;
+#endif /* GPIO_V2_GET_LINE_IOCTL */
+  case PPS_SOURCE_SIM:
+    while (PPS_Sim_Next <= micros64()) {
+      *us = PPS_Sim_Next;
+      PPS_Edge(*us, 1);
+      PPS_Sim_Count++;
+      PPS_Sim_schedule();
+      rval = true;
+    }
+    break;
+  default:
+    break;
+  }
+
+  return rval;
+}
+
+/*
+ * Start of the second the slot scheduler works from, against the edge
+ * it should have been taken from. Whole seconds apart are aligned.
+ */
+void PPS_Align(unsigned long ref_ms, unsigned long edge_ms)
+{
+  int32_t err = (int32_t) ((ref_ms - edge_ms) % 1000);
+
+  if (err >= 500) {
+    err -= 1000;
+  }
+
+  pthread_mutex_lock(&PPS_Totals_lock);
+  if (PPS_Totals.slots == 0 || err < PPS_Totals.slot_min) {
+    PPS_Totals.slot_min = err;
+  }
+  if (PPS_Totals.slots == 0 || err > PPS_Totals.slot_max) {
+    PPS_Totals.slot_max = err;
+  }
+  PPS_Totals.slots++;
+  pthread_mutex_unlock(&PPS_Totals_lock);
+}
+
+void PPS_Stats(PPS_Stats_t *stats, bool clear)
+{
+  pthread_mutex_lock(&PPS_Totals_lock);
+  *stats = PPS_Totals;
+
+  if (clear) {
+    memset(&PPS_Totals, 0, sizeof(PPS_Totals));
+  }
+  pthread_mutex_unlock(&PPS_Totals_lock);
+}
+
+void PPS_fini()
+{
+  if (PPS_fd >= 0) {
+    close(PPS_fd);
+  }
+  PPS_fd  = -1;
+  PPS_Src = PPS_SOURCE_NONE;
+}
+
+#endif /* RASPBERRY_PI */
@@ -0,0 +1,74 @@
+/*
+ * PPS.h
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PPSHELPER_H
+#define PPSHELPER_H
+
+#include <stdint.h>
+
+/*
+ * GNSS PPS edges time stamped by the kernel, on the micros64() time
+ * base, so that the time of an edge does not depend on how late the
+ * main loop gets around to looking at it.
+ *
+ * Source:
+ *  /dev/ppsN          Linux PPS API, e.g. the pps-gpio overlay
+ *  /dev/gpiochipN[:L] line event on line L, the PPS pin by default
+ *  sim[:J[:O]]        simulated, one edge a second with J us (sdev) of
+ *                     jitter and O us of offset; runs off the same clock
+ *                     as millis(), the trace replay one included
+ * With none given /dev/pps0 is tried, then the PPS pin on gpiochip0.
+ */
+#define PPS_DEVICE          "/dev/pps0"
+#define PPS_GPIOCHIP        "/dev/gpiochip0"
+#define PPS_PERIOD          1000000 /* us */
+
+enum
+{
+  PPS_SOURCE_NONE,
+  PPS_SOURCE_KPPS,
+  PPS_SOURCE_LINE,
+  PPS_SOURCE_SIM
+};
+
+/* since the last PPS_Stats(.., true) */
+typedef struct PPS_Stats_struct {
+  uint32_t edges;
+  uint32_t missed;    /* periods without an edge */
+  uint32_t intervals;
+  int32_t  err_min;   /* us, edge to edge minus whole periods */
+  int32_t  err_max;
+  int64_t  err_sum;
+  uint64_t err_sq;
+  uint32_t lag_sum;   /* us, edge to PPS_Poll() */
+  uint32_t lag_max;
+  uint32_t slots;
+  int32_t  slot_min;  /* ms, slot scheduler reference minus edge */
+  int32_t  slot_max;
+} PPS_Stats_t;
+
+bool        PPS_setup(const char *, int);
+uint8_t     PPS_Source(void);
+const char *PPS_Source_Name(void);
+int         PPS_Event_fd(void);
+bool        PPS_Poll(uint64_t *);
+void        PPS_Align(unsigned long, unsigned long);
+void        PPS_Stats(PPS_Stats_t *, bool);
+void        PPS_fini(void);
+
+#endif /* PPSHELPER_H */
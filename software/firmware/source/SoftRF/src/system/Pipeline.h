@@ -0,0 +1,108 @@
+/*
+ * Pipeline.h
+ * Copyright (C) 2018-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define PIPELINE_STATS_INTERVAL 10000 /* ms */
+
+/*
+ * Counters of one pipeline stage.
+ * Updated by the stage's threads, read and cleared by the reporter.
+ */
+typedef struct Stage_Stats_struct {
+  const char            *name;
+  std::atomic<uint32_t> count;
+  std::atomic<uint32_t> drops;
+  std::atomic<uint32_t> depth_max;
+  std::atomic<uint32_t> latency_sum; /* us */
+  std::atomic<uint32_t> latency_max; /* us */
+
+  void depth(uint32_t d) {
+    uint32_t m = depth_max.load(std::memory_order_relaxed);
+    while (d > m &&
+           !depth_max.compare_exchange_weak(m, d, std::memory_order_relaxed));
+  }
+
+  void latency(uint32_t us) {
+    count.fetch_add(1, std::memory_order_relaxed);
+    latency_sum.fetch_add(us, std::memory_order_relaxed);
+    uint32_t m = latency_max.load(std::memory_order_relaxed);
+    while (us > m &&
+           !latency_max.compare_exchange_weak(m, us, std::memory_order_relaxed));
+  }
+} Stage_Stats_t;
+
+/*
+ * Lock-free single producer / single consumer ring.
+ * N has to be a power of two.
+ */
+template <typename T, uint32_t N>
+class SPSC_Ring {
+  static_assert((N & (N - 1)) == 0, "SPSC_Ring size is not a power of 2");
+
+public:
+  SPSC_Ring() : head(0), tail(0) {}
+
+  /* producer side; a full ring drops the item */
+  bool push(const T &item, Stage_Stats_t *stats) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+
+    if (h - t >= N) {
+      stats->drops.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    slot[h & (N - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    stats->depth(h + 1 - t);
+
+    return true;
+  }
+
+  /* consumer side */
+  bool pop(T &item) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+
+    if (h == t) {
+      return false;
+    }
+
+    item = slot[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  uint32_t depth() const {
+    return head.load(std::memory_order_acquire) -
+           tail.load(std::memory_order_acquire);
+  }
+
+private:
+  alignas(64) std::atomic<uint32_t> head;
+  alignas(64) std::atomic<uint32_t> tail;
+  T slot[N];
+};
+
+#endif /* PIPELINE_H */
@@ -0,0 +1,171 @@
+/*
+ * Trace.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SoC.h"
+#include "Trace.h"
+
+#if defined(RASPBERRY_PI)
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+static FILE          *Trace_File = NULL;
+static unsigned long Trace_Start;
+static time_t        Trace_Own_Time;
+static bool          Trace_Own_Fix;
+static uint8_t       Trace_Version = TRACE_VERSION; /* of the replayed file */
+
+static bool Trace_Write(uint8_t type, uint8_t protocol, int8_t rssi,
+                        const void *payload, size_t size)
+{
+  Trace_Record_t rec;
+
+  rec.ms       = millis() - Trace_Start;
+  rec.type     = type;
+  rec.protocol = protocol;
+  rec.rssi     = rssi;
+  rec.size     = size;
+
+  return fwrite(&rec, sizeof(rec), 1, Trace_File) == 1 &&
+         (size == 0 || fwrite(payload, size, 1, Trace_File) == 1);
+}
+
+bool Trace_Record_open(const char *path)
+{
+  uint8_t header[8] = { 0, 0, 0, 0, TRACE_VERSION, 0, 0, 0 };
+
+  memcpy(header, TRACE_MAGIC, 4);
+
+  Trace_File = fopen(path, "wb");
+  if (Trace_File == NULL) {
+    return false;
+  }
+
+  if (fwrite(header, sizeof(header), 1, Trace_File) != 1) {
+    Trace_fini();
+    return false;
+  }
+
+  Trace_Start    = millis();
+  Trace_Own_Time = 0;
+  Trace_Own_Fix  = false;
+
+  return true;
+}
+
+/* Called by the receiving thread for every frame that made it to RxBuffer */
+void Trace_Packet(ufo_t *ownship, bool fix, uint8_t protocol, int8_t rssi,
+                  const uint8_t *buf, size_t size)
+{
+  if (Trace_File == NULL) {
+    return;
+  }
+
+  if (ownship->timestamp != Trace_Own_Time || fix != Trace_Own_Fix) {
+    Trace_Ownship_t own;
+
+    own.timestamp = ownship->timestamp;
+    own.latitude  = ownship->latitude;
+    own.longitude = ownship->longitude;
+    own.altitude  = ownship->altitude;
+    own.course    = ownship->course;
+    own.speed     = ownship->speed;
+    own.fix       = fix;
+
+    Trace_Write(TRACE_OWNSHIP, 0, 0, &own, sizeof(own));
+    Trace_Own_Time = ownship->timestamp;
+    Trace_Own_Fix  = fix;
+
+    /* about once a second, what is on disk stays usable after a crash */
+    fflush(Trace_File);
+  }
+
+  if (size > TRACE_MAX_PAYLOAD) {
+    size = TRACE_MAX_PAYLOAD;
+  }
+
+  Trace_Write(TRACE_PACKET, protocol, rssi, buf, size);
+}
+
+bool Trace_Replay_open(const char *path)
+{
+  uint8_t header[8];
+
+  Trace_File = fopen(path, "rb");
+  if (Trace_File == NULL) {
+    return false;
+  }
+
+  if (fread(header, sizeof(header), 1, Trace_File) != 1 ||
+      memcmp(header, TRACE_MAGIC, 4) != 0               ||
+      header[4] < 1 || header[4] > TRACE_VERSION) {
+    Trace_fini();
+    return false;
+  }
+
+  Trace_Version = header[4];
+
+  return true;
+}
+
+/* payload needs room for TRACE_MAX_PAYLOAD bytes */
+bool Trace_Next(Trace_Record_t *rec, uint8_t *payload)
+{
+  if (Trace_File == NULL) {
+    return false;
+  }
+
+  return fread(rec, sizeof(*rec), 1, Trace_File) == 1 &&
+         (rec->size == 0 || fread(payload, rec->size, 1, Trace_File) == 1);
+}
+
+/* 'fix' tells whether the recorded own position was valid */
+bool Trace_Ownship(const Trace_Record_t *rec, const uint8_t *payload,
+                   ufo_t *ownship, bool *fix)
+{
+  Trace_Ownship_t own;
+  size_t size = Trace_Version < 2 ? offsetof(Trace_Ownship_t, fix) : sizeof(own);
+
+  if (rec->type != TRACE_OWNSHIP || rec->size != size) {
+    return false;
+  }
+
+  own.fix = 1;
+  memcpy(&own, payload, size);
+
+  ownship->timestamp = own.timestamp;
+  ownship->latitude  = own.latitude;
+  ownship->longitude = own.longitude;
+  ownship->altitude  = own.altitude;
+  ownship->course    = own.course;
+  ownship->speed     = own.speed;
+  *fix               = own.fix != 0;
+
+  return true;
+}
+
+void Trace_fini()
+{
+  if (Trace_File != NULL) {
+    fclose(Trace_File);
+    Trace_File = NULL;
+  }
+}
+
+#endif /* RASPBERRY_PI */
@@ -0,0 +1,76 @@
+/*
+ * Trace.h
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACEHELPER_H
+#define TRACEHELPER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../../SoftRF.h"
+
+/*
+ * RF packet trace: the raw payloads out of RxBuffer, with the own ship
+ * state the decoders need to make sense of them (position for relative
+ * geometry, UTC time for the Legacy key).
+ *
+ * File:    "SRFT", version, 3 reserved bytes, then records.
+ * Record:  8 byte header, 'size' bytes of payload. Little endian.
+ *          An OWNSHIP record precedes the packets whenever own ship
+ *          time has moved on or the fix has come or gone.
+ *
+ * Version 1 OWNSHIP records end before 'fix', they are taken as fixed.
+ */
+#define TRACE_MAGIC         "SRFT"
+#define TRACE_VERSION       2
+#define TRACE_MAX_PAYLOAD   255
+
+enum
+{
+  TRACE_OWNSHIP = 1,
+  TRACE_PACKET  = 2
+};
+
+typedef struct __attribute__((packed)) Trace_Record_struct {
+  uint32_t ms;       /* since the start of the recording */
+  uint8_t  type;
+  uint8_t  protocol; /* RF_PROTOCOL_*, packets only */
+  int8_t   rssi;     /* dBm, packets only */
+  uint8_t  size;
+} Trace_Record_t;
+
+typedef struct __attribute__((packed)) Trace_Ownship_struct {
+  uint32_t timestamp; /* UTC, s */
+  float    latitude;
+  float    longitude;
+  float    altitude;  /* m */
+  float    course;    /* deg */
+  float    speed;     /* kts */
+  uint8_t  fix;       /* own position was valid, version 2 on */
+} Trace_Ownship_t;
+
+bool Trace_Record_open(const char *);
+void Trace_Packet(ufo_t *, bool, uint8_t, int8_t, const uint8_t *, size_t);
+
+bool Trace_Replay_open(const char *);
+bool Trace_Next(Trace_Record_t *, uint8_t *);
+bool Trace_Ownship(const Trace_Record_t *, const uint8_t *, ufo_t *, bool *);
+
+void Trace_fini(void);
+
+#endif /* TRACEHELPER_H */
@@ -0,0 +1,129 @@
+/*
+ * TxBudget.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <freqplan.h>
+
+#include "SoC.h"
+#include "TxBudget.h"
+
+Tx_Budget_t RF_Tx_Budget;
+
+static const struct {
+  uint32_t    low;      /* Hz */
+  uint32_t    high;     /* Hz */
+  uint16_t    permille; /* duty cycle limit */
+  const char *name;
+} RF_Subbands[RF_SUBBAND_COUNT] = {
+  {         0,         0, 1000, "other" },
+  { 863000000, 865000000,    1, "h1.3"  },
+  { 865000000, 868000000,   10, "h1.4"  },
+  { 868000000, 868600000,   10, "g1"    },
+  { 868700000, 869200000,    1, "g2"    },
+  { 869400000, 869650000,  100, "g3"    },
+  { 869700000, 870000000,   10, "g4"    },
+};
+
+/* Sub-band of a channel's centre frequency, for the ETSI plans only */
+uint8_t RF_Subband(uint8_t plan, uint32_t freq)
+{
+  if (plan == RF_BAND_EU || plan == RF_BAND_UK) {
+    for (uint8_t i = RF_SUBBAND_OTHER + 1; i < RF_SUBBAND_COUNT; i++) {
+      if (freq >= RF_Subbands[i].low && freq < RF_Subbands[i].high) {
+        return i;
+      }
+    }
+  }
+
+  return RF_SUBBAND_OTHER;
+}
+
+const char *RF_Subband_Name(uint8_t subband)
+{
+  return RF_Subbands[subband < RF_SUBBAND_COUNT ? subband : RF_SUBBAND_OTHER].name;
+}
+
+/* Charge the following transmissions to the sub-band of this channel */
+void RF_Tx_Budget_Select(uint8_t plan, uint32_t freq, int8_t channel)
+{
+  RF_Tx_Budget.channel = channel;
+  RF_Tx_Budget.subband = RF_Subband(plan, freq);
+}
+
+unsigned long RF_Tx_Budget_Limit()
+{
+  return RF_TX_BUDGET_WINDOW_MS / 1000 *
+         RF_Subbands[RF_Tx_Budget.subband].permille;
+}
+
+/* Slide the window up to now, return buckets of the current sub-band */
+static uint32_t *RF_Tx_Budget_Buckets()
+{
+  Tx_Budget_t *b = &RF_Tx_Budget;
+  unsigned long ms_since_boot = millis();
+
+  if (ms_since_boot - b->bucket_start >= RF_TX_BUDGET_WINDOW_MS) {
+    memset(b->spent, 0, sizeof(b->spent));
+    b->bucket_start = ms_since_boot;
+  }
+
+  while (ms_since_boot - b->bucket_start >= RF_TX_BUDGET_BUCKET_MS) {
+    b->head = (b->head + 1) % RF_TX_BUDGET_BUCKETS;
+    for (int c = 0; c < RF_SUBBAND_COUNT; c++) {
+      b->spent[c][b->head] = 0;
+    }
+    b->bucket_start += RF_TX_BUDGET_BUCKET_MS;
+  }
+
+  return b->spent[b->subband];
+}
+
+void RF_Tx_Budget_Charge(uint16_t air_time)
+{
+  uint32_t *spent = RF_Tx_Budget_Buckets();
+
+  spent[RF_Tx_Budget.head] += air_time;
+  RF_Tx_Budget.packets++;
+}
+
+unsigned long RF_Tx_Budget_Spent()
+{
+  uint32_t *spent = RF_Tx_Budget_Buckets();
+  unsigned long sum = 0;
+
+  for (int i = 0; i < RF_TX_BUDGET_BUCKETS; i++) {
+    sum += spent[i];
+  }
+
+  return sum;
+}
+
+unsigned long RF_Tx_Budget_Left()
+{
+  unsigned long limit = RF_Tx_Budget_Limit();
+  unsigned long spent = RF_Tx_Budget_Spent();
+
+  return limit > spent ? limit - spent : 0;
+}
+
+/* Less than a quarter left: keep it for the nearby traffic */
+bool RF_Tx_Budget_Low()
+{
+  return RF_Tx_Budget_Left() < RF_Tx_Budget_Limit() / 4;
+}
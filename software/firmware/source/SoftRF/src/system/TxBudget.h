@@ -0,0 +1,69 @@
+/*
+ * TxBudget.h
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TXBUDGETHELPER_H
+#define TXBUDGETHELPER_H
+
+#include <stdint.h>
+
+/*
+ * On-air time spent per regulatory sub-band over a sliding window of
+ * RF_TX_BUDGET_BUCKETS x RF_TX_BUDGET_BUCKET_MS. The duty cycle limit
+ * is one for the whole sub-band, channels in the same one (868.2 and
+ * 868.4 MHz of the EU plan are both in g1) share it.
+ */
+#define RF_TX_BUDGET_BUCKETS    12
+#define RF_TX_BUDGET_BUCKET_MS  300000UL /* 12 x 5 min = 1 hour */
+#define RF_TX_BUDGET_WINDOW_MS  (RF_TX_BUDGET_BUCKETS * RF_TX_BUDGET_BUCKET_MS)
+#define RF_TX_BATCH_MAX         4        /* packets in one time slot */
+
+/* ETSI EN 300 220 sub-bands, used with the EU and UK frequency plans */
+enum
+{
+  RF_SUBBAND_OTHER, /* anything else, accounted only */
+  RF_SUBBAND_H13,   /* 863.0 - 865.0  MHz, 0.1% */
+  RF_SUBBAND_H14,   /* 865.0 - 868.0  MHz, 1%   */
+  RF_SUBBAND_G1,    /* 868.0 - 868.6  MHz, 1%   */
+  RF_SUBBAND_G2,    /* 868.7 - 869.2  MHz, 0.1% */
+  RF_SUBBAND_G3,    /* 869.4 - 869.65 MHz, 10%  */
+  RF_SUBBAND_G4,    /* 869.7 - 870.0  MHz, 1%   */
+  RF_SUBBAND_COUNT
+};
+
+typedef struct Tx_Budget_struct {
+  uint32_t      spent[RF_SUBBAND_COUNT][RF_TX_BUDGET_BUCKETS]; /* ms */
+  uint8_t       head;
+  unsigned long bucket_start;
+  int8_t        channel;
+  uint8_t       subband;
+  uint32_t      packets;
+  uint32_t      deferred;  /* Tx opportunities skipped, no budget left */
+} Tx_Budget_t;
+
+uint8_t       RF_Subband(uint8_t, uint32_t);
+const char   *RF_Subband_Name(uint8_t);
+void          RF_Tx_Budget_Select(uint8_t, uint32_t, int8_t);
+void          RF_Tx_Budget_Charge(uint16_t);
+unsigned long RF_Tx_Budget_Limit(void);
+unsigned long RF_Tx_Budget_Spent(void);
+unsigned long RF_Tx_Budget_Left(void);
+bool          RF_Tx_Budget_Low(void);
+
+extern Tx_Budget_t RF_Tx_Budget;
+
+#endif /* TXBUDGETHELPER_H */
@@ -0,0 +1,137 @@
+/*
+ * TxBudget_test.cpp
+ * Copyright (C) 2016-2022 Linar Yusupov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host test of the Tx duty cycle budget: make test
+ * The clock is the virtual one of the raspi glue, so an hour takes no time.
+ */
+#include "../src/system/SoC.h"
+#include "../src/system/TxBudget.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <freqplan.h>
+
+lmic_pinmap lmic_pins = {
+    .nss = LMIC_UNUSED_PIN,
+    .txe = LMIC_UNUSED_PIN,
+    .rxe = LMIC_UNUSED_PIN,
+    .rst = LMIC_UNUSED_PIN,
+    .dio = {LMIC_UNUSED_PIN, LMIC_UNUSED_PIN, LMIC_UNUSED_PIN},
+    .busy = LMIC_UNUSED_PIN,
+    .tcxo = LMIC_UNUSED_PIN,
+};
+
+#if defined(USE_BASICMAC)
+void os_getJoinEui (u1_t* buf) { }
+void os_getNwkKey (u1_t* buf) { }
+void os_getDevEui (u1_t* buf) { }
+#else
+void os_getArtEui (u1_t* buf) { }
+void os_getDevEui (u1_t* buf) { }
+void os_getDevKey (u1_t* buf) { }
+#endif
+
+#define TEST_AIR_TIME   10  /* ms, about a Legacy packet */
+#define TEST_PERIOD     500 /* ms between Tx opportunities */
+
+static int Test_Failed;
+
+static void Test_Check(const char *name, bool ok)
+{
+  printf("%-48s %s\n", name, ok ? "ok" : "FAILED");
+  if (!ok) {
+    Test_Failed++;
+  }
+}
+
+static uint64_t Test_Clock;
+
+static void Test_Reset()
+{
+  memset(&RF_Tx_Budget, 0, sizeof(RF_Tx_Budget));
+  Test_Clock += 2 * RF_TX_BUDGET_WINDOW_MS * 1000ULL;
+  setVirtualMicros(Test_Clock);
+}
+
+/*
+ * Transmit on the given channels in turn for an hour, as RF_Transmit()
+ * does, return the air time that went out.
+ */
+static unsigned long Test_Hour(FreqPlan *plan, const uint8_t *chan, int n)
+{
+  unsigned long sent = 0;
+
+  Test_Reset();
+
+  for (unsigned long t = 0, i = 0; t < RF_TX_BUDGET_WINDOW_MS; t += TEST_PERIOD, i++) {
+    uint8_t c = chan[i % n];
+
+    setVirtualMicros(Test_Clock + t * 1000ULL);
+    RF_Tx_Budget_Select(plan->Plan, plan->getChanFrequency(c), c);
+
+    if (RF_Tx_Budget_Left() >= TEST_AIR_TIME) {
+      RF_Tx_Budget_Charge(TEST_AIR_TIME);
+      sent += TEST_AIR_TIME;
+    } else {
+      RF_Tx_Budget.deferred++;
+    }
+  }
+
+  return sent;
+}
+
+int main()
+{
+  FreqPlan plan;
+  const uint8_t one[]  = { 0 };
+  const uint8_t both[] = { 0, 1 };
+
+  plan.setPlan(RF_BAND_EU);
+  Test_Check("EU 868.2 MHz is in g1",
+             RF_Subband(plan.Plan, plan.getChanFrequency(0)) == RF_SUBBAND_G1);
+  Test_Check("EU 868.4 MHz is in g1",
+             RF_Subband(plan.Plan, plan.getChanFrequency(1)) == RF_SUBBAND_G1);
+
+  unsigned long limit = RF_TX_BUDGET_WINDOW_MS / 100;
+
+  Test_Check("EU one channel, 1% an hour",
+             Test_Hour(&plan, one, 1) == limit);
+  Test_Check("EU two channels in turn, still 1% an hour",
+             Test_Hour(&plan, both, 2) == limit &&
+             RF_Tx_Budget.spent[RF_SUBBAND_OTHER][0] == 0);
+
+  plan.setPlan(RF_BAND_UK);
+  RF_Tx_Budget_Select(plan.Plan, plan.getChanFrequency(0), 0);
+  Test_Check("UK 869.525 MHz is in g3, 10% an hour",
+             RF_Tx_Budget.subband == RF_SUBBAND_G3 &&
+             RF_Tx_Budget_Limit() == RF_TX_BUDGET_WINDOW_MS / 10);
+
+  plan.setPlan(RF_BAND_US);
+  unsigned long sent = Test_Hour(&plan, both, 2);
+  Test_Check("US is accounted only",
+             RF_Tx_Budget.subband == RF_SUBBAND_OTHER &&
+             RF_Tx_Budget.deferred == 0 &&
+             sent == RF_TX_BUDGET_WINDOW_MS / TEST_PERIOD * TEST_AIR_TIME);
+
+  plan.setPlan(RF_BAND_RU);
+  Test_Check("RU 868.8 MHz is not charged to g2",
+             RF_Subband(plan.Plan, plan.getChanFrequency(0)) == RF_SUBBAND_OTHER);
+
+  return Test_Failed ? 1 : 0;
+}
@@ -423,15 +423,29 @@ void loop() {
 #endif
       }
 
-      if (settings->rf_protocol == RF_PROTOCOL_LEGACY) {
+      bool nearby = true;
+
+      /* With the Tx budget running low relay only the traffic around */
+      if (RF_Tx_Budget_Low()) {
+        nearby = false;
+        if (isValidFix()) {
+          Traffic_Update(&fo);
+          nearby = fo.alarm_level > ALARM_LEVEL_NONE ||
+                   fo.distance    < ALARM_ZONE_NONE;
+        }
+      }
+
+      if (!nearby) {
+        /* keep what is left of the budget */
+      } else if (settings->rf_protocol == RF_PROTOCOL_LEGACY) {
         /*
          * "Legacy" needs some accurate timing for proper operation
          */
         if (isValidFix()) {
-          RF_Transmit(RF_Encode(&fo), false /* true */);
+          RF_Transmit(RF_Encode(&fo, true), false /* true */);
         }
       } else {
-        RF_Transmit(RF_Encode(&fo), false /* true */);
+        RF_Transmit(RF_Encode(&fo, true), false /* true */);
       }
     } else {
 #if defined(DEBUG_UAT)
@@ -767,3 +767,118 @@ uint8_t LDPC_Check_n354k160(const uint32_t *Data) { return LDPC_Check_n354k160(D
 
 #endif // __AVR__
 
+// ===================================================================================================================
+// Error correction: hard-decision bit flipping first, it is cheap and clears the usual one or two bad bits,
+// then (on the bigger targets) the min-sum LDPC_Decoder with the Manchester errors as erasures.
+// Random data fails about half of the 48 checks and carries Manchester errors all over, while a packet
+// that bit flipping can fix rarely fails more than 15 and one that min-sum can fix more than a dozen:
+// noise is turned away before either. This runs in the radio callback on MCUs, min-sum iterations are
+// capped there.
+
+#if !defined(__AVR__) && !defined(ESP8266) && !defined(__ASR6501__) && !defined(ARDUINO_ARCH_ASR650X) && \
+    !defined(ENERGIA_ARCH_CC13XX)
+#define LDPC_WITH_MINSUM
+#endif
+
+#define LDPC_MAX_CHECKS        16   // failed checks on input, above that the packet is taken for noise
+#define LDPC_MINSUM_MAX_CHECKS 12   // likewise, for min-sum
+#define LDPC_MINSUM_MAX_ERASED 32   // bits with Manchester errors, likewise
+
+#if defined(RASPBERRY_PI)
+#define LDPC_MINSUM_MAX_ITER   32
+#else
+#define LDPC_MINSUM_MAX_ITER    8
+#endif
+
+#if defined(__AVR__) || defined(ESP8266) || defined(ESP32) || defined(__ASR6501__) || defined(ARDUINO_ARCH_ASR650X) || \
+    defined(ENERGIA_ARCH_CC13XX) || defined(ENERGIA_ARCH_CC13X2)
+#define LDPC_CHECK_BYTE(Ptr) pgm_read_byte(Ptr)
+#else
+#define LDPC_CHECK_BYTE(Ptr) (*(Ptr))
+#endif
+
+#ifdef __AVR__
+#define LDPC_INDEX_BYTE(Ptr) pgm_read_byte(Ptr)
+#else
+#define LDPC_INDEX_BYTE(Ptr) (*(Ptr))
+#endif
+
+static int8_t LDPC_FlipScore(const uint8_t *Fails, const uint8_t *Err, uint8_t Bit) // failed minus passed checks of a bit,
+{ int8_t Score = 2*Fails[Bit]-LDPC_INDEX_BYTE(LDPC_BitWeight_n208k160+Bit);     // +1 for a Manchester error on it
+  if(Err && (Err[Bit>>3]&(1<<(Bit&7)))) Score++;
+  return Score; }
+
+static uint8_t LDPC_BitFlip(uint8_t *Data, const uint8_t *Err, uint8_t Iter)
+{ uint8_t Fails[208];                                            // failed checks per code bit
+  uint8_t Count=0;
+  for( ; Iter; Iter--)
+  { for(uint8_t Bit=0; Bit<208; Bit++) Fails[Bit]=0;
+    Count=0;
+    for(uint8_t Row=0; Row<48; Row++)                            // syndrome, like LDPC_Check()
+    { uint8_t Ones=0;
+      const uint8_t *Check = (const uint8_t *)LDPC_ParityCheck_n208k160[Row];
+      for(uint8_t Idx=0; Idx<26; Idx++)
+      { uint8_t And = Data[Idx]&LDPC_CHECK_BYTE(Check+Idx); Ones+=Count1s(And); }
+      if((Ones&1)==0) continue;
+      Count++;
+      const uint8_t *CheckIndex = LDPC_ParityCheckIndex_n208k160[Row];
+      uint8_t CheckWeight = LDPC_INDEX_BYTE(CheckIndex++);
+      for(uint8_t Bit=0; Bit<CheckWeight; Bit++)
+        Fails[LDPC_INDEX_BYTE(CheckIndex+Bit)]++;
+    }
+    if(Count==0) break;
+    int8_t MaxScore=0;
+    for(uint8_t Bit=0; Bit<208; Bit++)
+    { if(Fails[Bit]==0) continue;
+      int8_t Score=LDPC_FlipScore(Fails, Err, Bit);
+      if(Score>MaxScore) MaxScore=Score; }
+    if(MaxScore<=0) break;                                       // no bit is more wrong than right: give up
+    for(uint8_t Bit=0; Bit<208; Bit++)                           // flip the worst bits
+    { if(Fails[Bit] && LDPC_FlipScore(Fails, Err, Bit)==MaxScore)
+        Data[Bit>>3]^=1<<(Bit&7); }
+  }
+  return Count; }
+
+// The code has low weight codewords: a packet with many bit errors can land on a wrong but valid codeword.
+// Corrections that change more than this many bits not marked by the Manchester decoder are refused.
+#define LDPC_MAX_HARD_FLIPS 3
+
+static uint8_t LDPC_HardFlips(const uint8_t *Data, const uint8_t *Corr, const uint8_t *Err)
+{ uint8_t Count=0;
+  for(uint8_t Idx=0; Idx<26; Idx++)
+  { uint8_t Diff = Data[Idx]^Corr[Idx];
+    if(Err) Diff&=~Err[Idx];
+    Count+=Count1s(Diff); }
+  return Count; }
+
+uint8_t LDPC_Decode(uint8_t *Data, const uint8_t *Err, uint8_t Iter)
+{ uint8_t Count=LDPC_Check(Data);
+  if(Count==0 || Count>LDPC_MAX_CHECKS) return Count;
+#ifdef LDPC_WITH_MINSUM
+  bool MinSum = Count<=LDPC_MINSUM_MAX_CHECKS;
+  if(MinSum && Err)
+  { uint8_t Erased=0;
+    for(uint8_t Idx=0; Idx<26; Idx++) Erased+=Count1s(Err[Idx]);
+    MinSum = Erased<=LDPC_MINSUM_MAX_ERASED; }
+  if(Iter>LDPC_MINSUM_MAX_ITER) Iter=LDPC_MINSUM_MAX_ITER;
+#endif
+  uint8_t Corr[26];
+  for(uint8_t Idx=0; Idx<26; Idx++) Corr[Idx]=Data[Idx];
+  Count=LDPC_BitFlip(Corr, Err, 8);
+#ifdef LDPC_WITH_MINSUM
+  if(Count && MinSum)
+  { static LDPC_Decoder Decoder;                                 // too big for small stacks
+    uint8_t NoErr[26];
+    if(Err==0)
+    { for(uint8_t Idx=0; Idx<26; Idx++) NoErr[Idx]=0;
+      Err=NoErr; }
+    Decoder.Input(Data, (uint8_t *)Err);
+    for( ; Iter; Iter--)
+    { Count=Decoder.ProcessChecks();
+      if(Count==0) break; }
+    if(Count==0) Decoder.Output(Corr); }
+#endif
+  if(Count) return Count;                                        // Data is left as received if not corrected
+  if(LDPC_HardFlips(Data, Corr, Err)>LDPC_MAX_HARD_FLIPS) return LDPC_Check(Data);
+  for(uint8_t Idx=0; Idx<26; Idx++) Data[Idx]=Corr[Idx];
+  return 0; }
@@ -76,6 +76,9 @@ uint8_t LDPC_Check_n354k160(const uint32_t *Data);
 #endif
 
 #endif // __AVR__
+                                          // correct bit errors in place: 20 data bytes followed by 6 parity bytes,
+                                          // Err (optional) marks bits with Manchester decoding errors;
+uint8_t LDPC_Decode(uint8_t *Data, const uint8_t *Err=0, uint8_t Iter=32); // returns number of failed checks (0 => good)
 
 #ifndef __AVR__
 
@@ -11,9 +11,10 @@ void * loop(void * m)
 		srand(time(NULL));
 		char ch = 'a' + rand() % 26;
 		string s(1,ch);
-		string str = tcp.getMessage();
-		if( str != "" )
+		char *msg;
+		while( (msg = tcp.getMessage()) != NULL )
 		{
+			string str(msg);
 			cout << "Message:" << str << endl;
 			tcp.Send(" [client message: "+str+"] "+s);
 			tcp.clean();
@@ -0,0 +1,145 @@
+#include "Reactor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+
+Reactor::Reactor() : epfd(-1), evfd(-1), nready(0)
+{
+}
+
+bool Reactor::setup()
+{
+	if (epfd >= 0)
+		return true;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0)
+		return false;
+
+	evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (evfd < 0 || !add(evfd, EPOLLIN)) {
+		fini();
+		return false;
+	}
+	return true;
+}
+
+bool Reactor::add(int fd, uint32_t events)
+{
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events  = events;
+	ev.data.fd = fd;
+	return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+void Reactor::remove(int fd)
+{
+	epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+	clear(fd);
+}
+
+void Reactor::wakeup()
+{
+	uint64_t one = 1;
+
+	if (evfd >= 0 && write(evfd, &one, sizeof(one)) < 0) {
+		/* counter is already non-zero, a wake up is pending */
+	}
+}
+
+int Reactor::wait(int timeout_ms)
+{
+	nready = epoll_wait(epfd, events, REACTOR_MAX_EVENTS, timeout_ms);
+	if (nready < 0) {
+		nready = 0;
+		return errno == EINTR ? 0 : -1;
+	}
+
+	if (ready(evfd)) {
+		uint64_t count;
+		if (read(evfd, &count, sizeof(count)) < 0) {
+			/* spurious */
+		}
+	}
+	return nready;
+}
+
+bool Reactor::ready(int fd)
+{
+	for (int i = 0; i < nready; i++) {
+		if (events[i].data.fd == fd)
+			return true;
+	}
+	return false;
+}
+
+/* mark a ready descriptor as served until the next wait() */
+void Reactor::clear(int fd)
+{
+	for (int i = 0; i < nready; i++) {
+		if (events[i].data.fd == fd)
+			events[i].data.fd = -1;
+	}
+}
+
+void Reactor::fini()
+{
+	if (evfd >= 0)
+		close(evfd);
+	if (epfd >= 0)
+		close(epfd);
+	evfd = epfd = -1;
+	nready = 0;
+}
+
+static bool sysfs_write(const char *path, const char *value)
+{
+	int fd = open(path, O_WRONLY);
+	if (fd < 0)
+		return false;
+
+	bool ok = write(fd, value, strlen(value)) == (ssize_t) strlen(value);
+	close(fd);
+	return ok;
+}
+
+int Reactor::gpio_edge(int pin, const char *edge)
+{
+	char path[64];
+	char num[8];
+
+	snprintf(num, sizeof(num), "%d", pin);
+	snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/value", pin);
+
+	if (access(path, F_OK) != 0) {
+		/* fails with EBUSY when already exported */
+		sysfs_write("/sys/class/gpio/export", num);
+	}
+
+	snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/edge", pin);
+	if (!sysfs_write(path, edge))
+		return -1;
+
+	snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/value", pin);
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd >= 0)
+		gpio_ack(fd);
+	return fd;
+}
+
+/* edge events are signalled as EPOLLPRI until the value is re-read */
+void Reactor::gpio_ack(int fd)
+{
+	char value[4];
+
+	lseek(fd, 0, SEEK_SET);
+	if (read(fd, value, sizeof(value)) < 0) {
+		/* nothing to do */
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#define REACTOR_MAX_EVENTS 16
+
+/*
+ * Minimal epoll based event loop helper.
+ * wait() sleeps until a registered descriptor is ready, another
+ * thread calls wakeup(), or the timeout expires.
+ */
+class Reactor
+{
+	public:
+	Reactor();
+
+	bool setup();
+	bool add(int fd, uint32_t events);
+	void remove(int fd);
+	void wakeup();
+	int  notifier() { return evfd; }
+	int  wait(int timeout_ms);
+	bool ready(int fd);
+	void clear(int fd);
+	void fini();
+
+	/* sysfs GPIO line with edge notification, -1 if unavailable */
+	static int  gpio_edge(int pin, const char *edge);
+	static void gpio_ack(int fd);
+
+	private:
+	int epfd;
+	int evfd;
+	int nready;
+	struct epoll_event events[REACTOR_MAX_EVENTS];
+};
+
+#endif
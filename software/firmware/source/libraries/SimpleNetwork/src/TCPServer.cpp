@@ -1,70 +1,440 @@
 #include "TCPServer.h" 
 
-string TCPServer::Message;
+#include <fcntl.h>
+#include <errno.h>
+#include <ctype.h>
 
-void* TCPServer::Task(void *arg)
+TCPServer::TCPServer() : sockfd(-1), notify_fd(-1), ingest(true), head(0), tail(0), reserved(0)
 {
-	int n;
-	int newsockfd = (long)arg;
-	char msg[MAXPACKETSIZE];
-	pthread_detach(pthread_self());
-	while(1)
-	{
-		n=recv(newsockfd,msg,MAXPACKETSIZE,0);
-		if(n==0)
-		{
-		   close(newsockfd);
-		   break;
-		}
-		msg[n]=0;
-		//send(newsockfd,msg,n,0);
-		Message = string(msg);
-	}
-	return 0;
+	pthread_mutex_init(&clients_lock, NULL);
+	pthread_mutex_init(&queue_lock, NULL);
+	for (int i = 0; i < QUEUEDEPTH; i++)
+		queue[i].ready = false;
 }
 
-void TCPServer::setup(int port)
+bool TCPServer::setup(int port, bool ingest)
 {
-	sockfd=socket(AF_INET,SOCK_STREAM,0);
+	struct sockaddr_in serverAddress;
+	int one = 1;
+
+	this->ingest = ingest;
+
+	if (!reactor.setup())
+		return false;
+
+	sockfd=socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+	if (sockfd < 0)
+		return false;
+	setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
 	memset(&serverAddress,0,sizeof(serverAddress));
 	serverAddress.sin_family=AF_INET;
 	serverAddress.sin_addr.s_addr=htonl(INADDR_ANY);
 	serverAddress.sin_port=htons(port);
-	bind(sockfd,(struct sockaddr *)&serverAddress, sizeof(serverAddress));
-	listen(sockfd,5);
+	if (bind(sockfd,(struct sockaddr *)&serverAddress, sizeof(serverAddress)) < 0 ||
+	    listen(sockfd,5) < 0 ||
+	    !reactor.add(sockfd, EPOLLIN)) {
+		close(sockfd);
+		sockfd = -1;
+		return false;
+	}
+	return true;
+}
+
+/* eventfd to signal when a new message is available */
+void TCPServer::notify(int fd)
+{
+	notify_fd = fd;
 }
 
-string TCPServer::receive()
+/* I/O loop, does not return until detach() */
+void TCPServer::receive()
 {
-	string str;
-	while(1)
+	while (sockfd >= 0)
 	{
-		socklen_t sosize  = sizeof(clientAddress);
-		newsockfd = accept(sockfd,(struct sockaddr*)&clientAddress,&sosize);
-		str = inet_ntoa(clientAddress.sin_addr);
-		pthread_create(&serverThread,NULL,&Task,(void *)newsockfd);
+		if (reactor.wait(-1) < 0)
+			break;
+
+		if (sockfd >= 0 && reactor.ready(sockfd))
+			accept_clients();
+
+		for (size_t i = 0; i < clients.size(); ) {
+			Client *c = clients[i];
+			if (reactor.ready(c->fd) && !c->stalled &&
+			    !read_client(c))
+				continue; // closed, clients[i] is the next one now
+			i++;
+		}
+
+		resume();
 	}
-	return str;
 }
 
-string TCPServer::getMessage()
+void TCPServer::accept_clients()
 {
-	return Message;
+	while (1)
+	{
+		int fd = accept4(sockfd, NULL, NULL, SOCK_NONBLOCK|SOCK_CLOEXEC);
+		if (fd < 0)
+			return;
+
+		if (clients.size() >= MAXCLIENTS) {
+			close(fd);
+			stats.refused++;
+			continue;
+		}
+
+		Client *c = new Client();
+		c->fd    = fd;
+		c->buf   = (char *) malloc(MAXPACKETSIZE);
+		c->state = FRAME_IDLE;
+		if (c->buf == NULL || !reactor.add(fd, EPOLLIN|EPOLLRDHUP)) {
+			free(c->buf);
+			delete c;
+			close(fd);
+			stats.refused++;
+			continue;
+		}
+
+		pthread_mutex_lock(&clients_lock);
+		clients.push_back(c);
+		pthread_mutex_unlock(&clients_lock);
+		stats.accepted++;
+	}
 }
 
-void TCPServer::Send(string msg)
+/* Returns false when the connection is gone and 'c' is freed */
+bool TCPServer::read_client(Client *c)
+{
+	while (1)
+	{
+		if (c->len == MAXPACKETSIZE)
+			overflow(c);
+
+		ssize_t n = recv(c->fd, c->buf + c->len, MAXPACKETSIZE - c->len, 0);
+
+		if (n > 0) {
+			if (!ingest)
+				continue; // output only, the next recv() overwrites it
+			c->len += n;
+			if (!frame(c))
+				return true; // queue is full
+			continue;
+		}
+
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return true;
+		if (n < 0 && errno == EINTR)
+			continue;
+
+		/* peer has closed, an unterminated line is still a message */
+		if (c->state == FRAME_LINE && c->len > 0) {
+			if (!push(c->buf, c->len)) {
+				stats.truncated++;
+			}
+		} else if ((c->state == FRAME_JSON && !c->discard) ||
+		           c->state == FRAME_LENGTH) {
+			stats.truncated++;
+		}
+		close_client(c);
+		return false;
+	}
+}
+
+/* the buffer is full and holds no frame boundary */
+void TCPServer::overflow(Client *c)
+{
+	stats.oversize++;
+	c->len = c->pos = 0;
+	if (c->state == FRAME_JSON) {
+		c->discard = true;
+	} else {
+		c->state = FRAME_SKIP;
+		c->need  = 0;
+	}
+}
+
+/*
+ * Cut complete frames off the client's buffer.
+ * Returns false when the queue is full; scanning resumes later.
+ */
+bool TCPServer::frame(Client *c)
+{
+	size_t start = 0;
+	size_t i = c->pos;
+	bool rval = true;
+
+	while (i < c->len)
+	{
+		char ch = c->buf[i];
+
+		switch (c->state)
+		{
+		case FRAME_IDLE:
+			if (isspace((unsigned char) ch)) {
+				start = ++i;
+				continue;
+			}
+			if (ch == '{') {
+				c->state   = FRAME_JSON;
+				c->depth   = 0;
+				c->quoted  = false;
+				c->escaped = false;
+				c->discard = false;
+			} else {
+				c->state = FRAME_LINE;
+			}
+			continue; // re-examine in the new state
+
+		case FRAME_JSON:
+			if (c->quoted) {
+				if (c->escaped)
+					c->escaped = false;
+				else if (ch == '\\')
+					c->escaped = true;
+				else if (ch == '"')
+					c->quoted = false;
+			} else if (ch == '"') {
+				c->quoted = true;
+			} else if (ch == '{') {
+				c->depth++;
+			} else if (ch == '}' && --c->depth == 0) {
+				if (!c->discard && !push(c->buf + start, i + 1 - start)) {
+					rval = false;
+					goto out;
+				}
+				c->state = FRAME_IDLE;
+				start = i + 1;
+			}
+			break;
+
+		case FRAME_LINE:
+			if (ch == '\n') {
+				size_t len = i - start;
+				bool digits = len > 0;
+
+				if (len > 0 && c->buf[start + len - 1] == '\r')
+					len--;
+				for (size_t j = 0; j < len && digits; j++)
+					digits = isdigit((unsigned char) c->buf[start + j]);
+
+				if (digits && len < 9) {
+					c->need  = strtoul(c->buf + start, NULL, 10);
+					c->state = c->need == 0 ? FRAME_IDLE :
+					           c->need > MAXPACKETSIZE ? FRAME_SKIP : FRAME_LENGTH;
+					if (c->state == FRAME_SKIP)
+						stats.oversize++;
+				} else {
+					if (!push(c->buf + start, len)) {
+						rval = false;
+						goto out;
+					}
+					c->state = FRAME_IDLE;
+				}
+				start = i + 1;
+			}
+			break;
+
+		case FRAME_LENGTH:
+			if (c->len - start < c->need) {
+				i = c->len;
+				continue;
+			}
+			if (!push(c->buf + start, c->need)) {
+				rval = false;
+				goto out;
+			}
+			start += c->need;
+			i = start;
+			c->state = FRAME_IDLE;
+			continue;
+
+		case FRAME_SKIP:
+		default:
+			if (c->need > 0) {
+				size_t n = c->len - i < c->need ? c->len - i : c->need;
+				c->need -= n;
+				i += n;
+				start = i;
+				if (c->need == 0)
+					c->state = FRAME_IDLE;
+				continue;
+			}
+			/* skip up to the end of the line */
+			if (ch == '\n')
+				c->state = FRAME_IDLE;
+			start = i + 1;
+			break;
+		}
+		i++;
+	}
+
+out:
+	if (!rval) {
+		/* resume from the start of the frame that did not fit */
+		c->stalled = true;
+		stats.stalls++;
+		reactor.remove(c->fd);
+		i = start;
+		if (c->state == FRAME_LINE || c->state == FRAME_JSON)
+			c->state = FRAME_IDLE;
+	}
+
+	if (start > 0) {
+		memmove(c->buf, c->buf + start, c->len - start);
+		c->len -= start;
+		i -= start;
+	}
+	c->pos = i;
+
+	return rval;
+}
+
+void TCPServer::close_client(Client *c)
+{
+	pthread_mutex_lock(&clients_lock);
+	for (size_t i = 0; i < clients.size(); i++) {
+		if (clients[i] == c) {
+			clients.erase(clients.begin() + i);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&clients_lock);
+
+	if (!c->stalled)
+		reactor.remove(c->fd);
+	close(c->fd);
+	free(c->buf);
+	delete c;
+}
+
+/* pick up stalled clients once the consumer has made room */
+void TCPServer::resume()
 {
-	send(newsockfd,msg.c_str(),msg.length(),0);
+	for (size_t i = 0; i < clients.size(); ) {
+		Client *c = clients[i];
+
+		if (c->stalled) {
+			pthread_mutex_lock(&queue_lock);
+			bool room = reserved < QUEUEDEPTH;
+			pthread_mutex_unlock(&queue_lock);
+			if (!room)
+				return;
+
+			c->stalled = false;
+			if (!frame(c))
+				return;
+			reactor.add(c->fd, EPOLLIN|EPOLLRDHUP);
+			/* data may have arrived while the socket was not watched */
+			if (!read_client(c))
+				continue;
+		}
+		i++;
+	}
+}
+
+/* MPSC: reserve a slot, fill it outside of the lock, then publish */
+bool TCPServer::push(const char *msg, size_t len)
+{
+	pthread_mutex_lock(&queue_lock);
+	if (reserved == QUEUEDEPTH) {
+		pthread_mutex_unlock(&queue_lock);
+		return false;
+	}
+	Slot *slot = &queue[head++ % QUEUEDEPTH];
+	reserved++;
+	pthread_mutex_unlock(&queue_lock);
+
+	slot->data.assign(msg, len);
+
+	pthread_mutex_lock(&queue_lock);
+	slot->ready = true;
+	pthread_mutex_unlock(&queue_lock);
+
+	stats.messages++;
+
+	if (notify_fd >= 0) {
+		uint64_t one = 1;
+		if (write(notify_fd, &one, sizeof(one)) < 0) {
+			/* a wake up is pending already */
+		}
+	}
+	return true;
+}
+
+/*
+ * Oldest complete message, NUL terminated and writable in place,
+ * or NULL. It stays valid until clean().
+ */
+char *TCPServer::getMessage(size_t *len)
+{
+	char *msg = NULL;
+
+	pthread_mutex_lock(&queue_lock);
+	if (tail != head && queue[tail % QUEUEDEPTH].ready) {
+		string &data = queue[tail % QUEUEDEPTH].data;
+		msg = &data[0];
+		if (len)
+			*len = data.length();
+	}
+	pthread_mutex_unlock(&queue_lock);
+
+	return msg;
 }
 
 void TCPServer::clean()
 {
-	Message = "";
-//	memset(msg, 0, MAXPACKETSIZE);
+	bool was_full;
+
+	pthread_mutex_lock(&queue_lock);
+	if (tail == head || !queue[tail % QUEUEDEPTH].ready) {
+		pthread_mutex_unlock(&queue_lock);
+		return;
+	}
+	queue[tail++ % QUEUEDEPTH].ready = false;
+	was_full = (reserved-- == QUEUEDEPTH);
+	pthread_mutex_unlock(&queue_lock);
+
+	if (was_full)
+		reactor.wakeup();
+}
+
+size_t TCPServer::pending()
+{
+	pthread_mutex_lock(&queue_lock);
+	size_t n = head - tail;
+	pthread_mutex_unlock(&queue_lock);
+
+	return n;
+}
+
+/* best effort, to every connected client */
+void TCPServer::Send(string msg)
+{
+	Send(msg.c_str(), msg.length());
+}
+
+/* a client that does not keep up loses the rest, it is not waited for */
+void TCPServer::Send(const void *buf, size_t len)
+{
+	pthread_mutex_lock(&clients_lock);
+	for (size_t i = 0; i < clients.size(); i++)
+		if (send(clients[i]->fd, buf, len, MSG_NOSIGNAL|MSG_DONTWAIT) != (ssize_t) len)
+			stats.short_sends++;
+	pthread_mutex_unlock(&clients_lock);
 }
 
 void TCPServer::detach()
 {
-	close(sockfd);
-	close(newsockfd);
-} 
+	pthread_mutex_lock(&clients_lock);
+	for (size_t i = 0; i < clients.size(); i++)
+		shutdown(clients[i]->fd, SHUT_RDWR);
+	pthread_mutex_unlock(&clients_lock);
+
+	if (sockfd >= 0) {
+		int fd = sockfd;
+		sockfd = -1;
+		close(fd);
+	}
+	reactor.wakeup();
+}
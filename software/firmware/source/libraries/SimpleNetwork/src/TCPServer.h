@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <vector>
+#include <atomic>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,29 +15,95 @@
 #include <arpa/inet.h>
 #include <pthread.h>
 
+#include "Reactor.h"
+
 using namespace std;
 
-#define MAXPACKETSIZE 65536 // 4096
+#define MAXPACKETSIZE 65536 // longest message, also a client's receive buffer
+#define MAXCLIENTS    8
+#define QUEUEDEPTH    32    // messages
+
+/*
+ * Multi-client, non-blocking TCP ingestion server.
+ *
+ * Every connection is framed independently. A frame is one of:
+ *  - a JSON object, possibly spread over several lines ("{ ... }")
+ *  - a decimal length on a line of its own, followed by that many bytes
+ *  - any other newline terminated line
+ *
+ * Complete frames go into a bounded queue. When it is full the server
+ * stops reading from the sockets, so TCP flow control pushes back on
+ * the senders. Messages are handed to the consumer in place.
+ *
+ * Set up with ingest false, the server only accepts clients for Send()
+ * and drops whatever they write.
+ */
+typedef struct TCPServerStats {
+	std::atomic<unsigned long> accepted;
+	std::atomic<unsigned long> refused;   // over MAXCLIENTS
+	std::atomic<unsigned long> messages;
+	std::atomic<unsigned long> oversize;  // dropped, longer than MAXPACKETSIZE
+	std::atomic<unsigned long> truncated; // dropped, connection closed mid-frame
+	std::atomic<unsigned long> stalls;    // queue full, reading suspended
+	std::atomic<unsigned long> short_sends; // Send() that a client took only in part
+} TCPServerStats;
 
 class TCPServer
 {
 	public:
-	int sockfd, newsockfd, n, pid;
-	struct sockaddr_in serverAddress;
-	struct sockaddr_in clientAddress;
-	pthread_t serverThread;
-//	char msg[ MAXPACKETSIZE ];
-	static string Message;
-
-	void setup(int port);
-	string receive();
-	string getMessage();
+	TCPServerStats stats;
+
+	TCPServer();
+	bool setup(int port, bool ingest = true);
+	void notify(int fd);
+	void receive();
+	char *getMessage(size_t *len = NULL);
+	void clean();
+	size_t pending();
 	void Send(string msg);
+	void Send(const void *buf, size_t len);
 	void detach();
-	void clean();
 
 	private:
-	static void * Task(void * argv);
+	enum { FRAME_IDLE, FRAME_LINE, FRAME_JSON, FRAME_LENGTH, FRAME_SKIP };
+
+	struct Client {
+		int    fd;
+		char   *buf;
+		size_t len;     // bytes held
+		size_t pos;     // scanned so far
+		int    state;
+		int    depth;   // JSON nesting
+		bool   quoted;
+		bool   escaped;
+		bool   discard; // oversize JSON, track it but do not keep it
+		size_t need;    // FRAME_LENGTH payload / FRAME_SKIP bytes left
+		bool   stalled;
+	};
+
+	struct Slot {
+		string data;
+		bool   ready;
+	};
+
+	int sockfd;
+	int notify_fd;
+	bool ingest;    // false: an output only listener, client input is dropped
+	Reactor reactor;
+	vector<Client *> clients;
+	pthread_mutex_t clients_lock;
+
+	Slot queue[QUEUEDEPTH];
+	unsigned int head, tail, reserved;
+	pthread_mutex_t queue_lock;
+
+	bool push(const char *msg, size_t len);
+	void accept_clients();
+	bool read_client(Client *c);
+	bool frame(Client *c);
+	void overflow(Client *c);
+	void close_client(Client *c);
+	void resume();
 };
 
 #endif
@@ -0,0 +1,172 @@
+#include "UDPFanout.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+
+UDPFanout::UDPFanout() : sockfd(-1), ndest(0)
+{
+	pthread_mutex_init(&lock, NULL);
+	memset(ports, 0, sizeof(ports));
+}
+
+/* dests: comma or space separated IPv4 addresses or host names */
+bool UDPFanout::setup(const char *dests)
+{
+	int on = 1;
+	unsigned char ttl = 1;
+	char list[256];
+	char *save = NULL;
+
+	sockfd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (sockfd < 0)
+		return false;
+	setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+	setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+	snprintf(list, sizeof(list), "%s", dests);
+	for (char *host = strtok_r(list, ", ", &save);
+	     host && ndest < UDPFANOUT_MAXDEST;
+	     host = strtok_r(NULL, ", ", &save)) {
+		struct addrinfo hints, *res;
+
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family   = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		if (getaddrinfo(host, NULL, &hints, &res) != 0) {
+			fprintf(stderr, "UDP: unknown destination %s\n", host);
+			continue;
+		}
+		dest[ndest++] = ((struct sockaddr_in *) res->ai_addr)->sin_addr;
+		freeaddrinfo(res);
+	}
+
+	return ndest > 0;
+}
+
+UDPFanout::Port *UDPFanout::find(int port)
+{
+	Port *unused = NULL;
+
+	for (int i = 0; i < UDPFANOUT_MAXPORTS; i++) {
+		if (ports[i].port == port)
+			return &ports[i];
+		if (!unused && ports[i].len == 0)
+			unused = &ports[i];
+	}
+	if (unused) {
+		unused->port = port;
+		unused->ndgrams = 0;
+		unused->cut[0] = 0;
+	}
+	return unused;
+}
+
+void UDPFanout::queue(int port, const void *buf, size_t len)
+{
+	if (sockfd < 0 || len == 0)
+		return;
+	if (len > UDPFANOUT_MTU)
+		len = UDPFANOUT_MTU;
+
+	pthread_mutex_lock(&lock);
+
+	Port *p = find(port);
+	if (!p) {
+		stats.overflows++;
+		send_all();
+		p = find(port);
+	}
+
+	/* Close the open datagram when this message does not fit into it */
+	if (p->len - p->cut[p->ndgrams] + len > UDPFANOUT_MTU) {
+		if (p->ndgrams + 1 == UDPFANOUT_MAXDGRAMS) {
+			stats.overflows++;
+			send_all();
+			p = find(port);
+		} else {
+			p->cut[++p->ndgrams] = p->len;
+		}
+	}
+
+	memcpy(p->buf + p->len, buf, len);
+	p->len += len;
+
+	pthread_mutex_unlock(&lock);
+}
+
+void UDPFanout::flush()
+{
+	pthread_mutex_lock(&lock);
+	send_all();
+	pthread_mutex_unlock(&lock);
+}
+
+/* Called with the lock held */
+void UDPFanout::send_all()
+{
+	unsigned n = 0;
+
+	for (int i = 0; i < UDPFANOUT_MAXPORTS; i++) {
+		Port *p = &ports[i];
+		if (p->len == 0)
+			continue;
+		p->cut[p->ndgrams + 1] = p->len;
+
+		for (unsigned d = 0; d <= p->ndgrams; d++) {
+			for (int k = 0; k < ndest; k++) {
+				memset(&addrs[n], 0, sizeof(addrs[n]));
+				addrs[n].sin_family = AF_INET;
+				addrs[n].sin_port   = htons(p->port);
+				addrs[n].sin_addr   = dest[k];
+
+				iov[n].iov_base = p->buf + p->cut[d];
+				iov[n].iov_len  = p->cut[d + 1] - p->cut[d];
+
+				memset(&msgs[n], 0, sizeof(msgs[n]));
+				msgs[n].msg_hdr.msg_name    = &addrs[n];
+				msgs[n].msg_hdr.msg_namelen = sizeof(addrs[n]);
+				msgs[n].msg_hdr.msg_iov     = &iov[n];
+				msgs[n].msg_hdr.msg_iovlen  = 1;
+				n++;
+			}
+		}
+		p->len = 0;
+		p->ndgrams = 0;
+		p->cut[0] = 0;
+		p->port = 0;
+	}
+
+	/* One syscall for the cycle, unless the kernel stops half way */
+	unsigned done = 0;
+	while (done < n) {
+		int ret = sendmmsg(sockfd, &msgs[done], n - done, MSG_DONTWAIT);
+		stats.syscalls++;
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			/* skip the datagram that failed, EAGAIN included */
+			stats.errors++;
+			done++;
+			continue;
+		}
+		for (int i = 0; i < ret; i++)
+			stats.bytes += msgs[done + i].msg_len;
+		stats.datagrams += ret;
+		done += ret;
+	}
+}
+
+void UDPFanout::fini()
+{
+	flush();
+	if (sockfd >= 0) {
+		close(sockfd);
+		sockfd = -1;
+	}
+	ndest = 0;
+}
@@ -0,0 +1,68 @@
+#ifndef UDP_FANOUT_H
+#define UDP_FANOUT_H
+
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#define UDPFANOUT_MAXDEST   8    // subscribers
+#define UDPFANOUT_MAXPORTS  4    // distinct destination ports in one cycle
+#define UDPFANOUT_MAXDGRAMS 8    // datagrams per port in one cycle
+#define UDPFANOUT_MTU       1472 // payload of one datagram, no IP fragmentation on Ethernet
+#define UDPFANOUT_MAXMSGS   (UDPFANOUT_MAXDEST * UDPFANOUT_MAXPORTS * UDPFANOUT_MAXDGRAMS)
+
+/*
+ * Batched UDP output to a set of subscribers (unicast, broadcast or
+ * multicast IPv4 addresses).
+ *
+ * queue() only appends to the datagram being built for that port,
+ * starting a new one when the MTU would be exceeded. flush() sends
+ * every pending datagram to every subscriber with one sendmmsg() call.
+ */
+typedef struct UDPFanoutStats {
+	std::atomic<unsigned long> datagrams;
+	std::atomic<unsigned long> bytes;
+	std::atomic<unsigned long> syscalls;
+	std::atomic<unsigned long> errors;    // datagrams the kernel refused
+	std::atomic<unsigned long> overflows; // early flushes, a cycle did not fit
+} UDPFanoutStats;
+
+class UDPFanout
+{
+	public:
+	UDPFanoutStats stats;
+
+	UDPFanout();
+	bool setup(const char *dests);
+	int  subscribers() { return ndest; }
+	void queue(int port, const void *buf, size_t len);
+	void flush();
+	void fini();
+
+	private:
+	struct Port {
+		int      port;
+		size_t   len;
+		unsigned ndgrams;                        // closed datagrams
+		size_t   cut[UDPFANOUT_MAXDGRAMS + 1];   // datagram boundaries in buf
+		char     buf[UDPFANOUT_MAXDGRAMS * UDPFANOUT_MTU];
+	};
+
+	int sockfd;
+	int ndest;
+	struct in_addr dest[UDPFANOUT_MAXDEST];
+	Port ports[UDPFANOUT_MAXPORTS];
+	pthread_mutex_t lock;
+
+	struct sockaddr_in addrs[UDPFANOUT_MAXMSGS];
+	struct iovec       iov[UDPFANOUT_MAXMSGS];
+	struct mmsghdr     msgs[UDPFANOUT_MAXMSGS];
+
+	Port *find(int port);
+	void send_all();
+};
+
+#endif
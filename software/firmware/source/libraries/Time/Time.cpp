@@ -39,6 +39,18 @@
 
 #include "TimeLib.h"
 
+#if defined(RASPBERRY_PI)
+#include <pthread.h>
+
+/* now() and setTime() are shared by the radio, fusion and export threads */
+static pthread_mutex_t time_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+#define TIME_LOCK()   pthread_mutex_lock(&time_lock)
+#define TIME_UNLOCK() pthread_mutex_unlock(&time_lock)
+#else
+#define TIME_LOCK()
+#define TIME_UNLOCK()
+#endif /* RASPBERRY_PI */
+
 static tmElements_t tm;          // a cache of time elements
 static time_t cacheTime;   // the time the cache was updated
 static uint32_t syncInterval = 300;  // time sync will be attempted after this many seconds
@@ -252,6 +264,9 @@ time_t sysUnsyncedTime = 0; // the time sysTime unadjusted by sync
 
 
 time_t now() {
+  time_t t;
+
+  TIME_LOCK();
 	// calculate number of seconds passed since last call to now()
   while (millis() - prevMillis >= 1000) {
 		// millis() and prevMillis are both unsigned ints thus the subtraction will always be the absolute value of the difference
@@ -272,10 +287,14 @@ time_t now() {
       }
     }
   }  
-  return (time_t)sysTime;
+  t = (time_t)sysTime;
+  TIME_UNLOCK();
+
+  return t;
 }
 
 void setTime(time_t t) { 
+  TIME_LOCK();
 #ifdef TIME_DRIFT_INFO
  if(sysUnsyncedTime == 0) 
    sysUnsyncedTime = t;   // store the time of the first call to set a valid Time   
@@ -285,6 +304,7 @@ void setTime(time_t t) {
   nextSyncTime = (uint32_t)t + syncInterval;
   Status = timeSet;
   prevMillis = millis();  // restart counting from now (thanks to Korman for this fix)
+  TIME_UNLOCK();
 } 
 
 void setTime(int hr,int min,int sec,int dy, int mnth, int yr){
@@ -294,6 +314,7 @@ void setTime(int hr,int min,int sec,int dy, int mnth, int yr){
       yr = yr - 1970;
   else
       yr += 30;  
+  TIME_LOCK();
   tm.Year = yr;
   tm.Month = mnth;
   tm.Day = dy;
@@ -301,10 +322,13 @@ void setTime(int hr,int min,int sec,int dy, int mnth, int yr){
   tm.Minute = min;
   tm.Second = sec;
   setTime(makeTime(tm));
+  TIME_UNLOCK();
 }
 
 void adjustTime(long adjustment) {
+  TIME_LOCK();
   sysTime += adjustment;
+  TIME_UNLOCK();
 }
 
 // indicates if time has been set and recently synchronized
@@ -11,15 +11,25 @@
 #include <errno.h>
 #include <termios.h>
 #include <sys/ioctl.h>
+#include <linux/serial.h>
 #include <sys/select.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <stdlib.h>
 
 #include "TTYSerial.h"
 
 TTYSerial::TTYSerial(const char* deviceName)
     : _deviceName(deviceName),
-      _device(-1)
+      _device(-1),
+      _rxHead(0),
+      _rxTail(0),
+      _txLen(0),
+      _overruns(~0UL)
 {
+    stats.full    = 0;
+    stats.dropped = 0;
+
     // Override device name from environment
     char* e = getenv("TTYSERIAL_DEVICE_NAME");
     if (e)
@@ -39,45 +49,155 @@ void TTYSerial::end()
 
 void TTYSerial::flush()
 {
+    txSend(NULL, 0);
     tcdrain(_device);
 }
 
+int TTYSerial::fill()
+{
+    if (_device == -1)
+      return 0;
+
+    // Whatever is pending goes out before we look for an answer
+    if (_txLen)
+	txSend(NULL, 0);
+
+    if (_rxHead == _rxTail)
+	_rxHead = _rxTail = 0;
+    else if (_rxTail == sizeof(_rx))
+    {
+	memmove(_rx, _rx + _rxHead, _rxTail - _rxHead);
+	_rxTail -= _rxHead;
+	_rxHead = 0;
+    }
+
+    // Nobody has been reading: the rest waits in the kernel
+    if (_rxTail == sizeof(_rx))
+	stats.full++;
+    else
+    {
+	ssize_t result = ::read(_device, _rx + _rxTail, sizeof(_rx) - _rxTail);
+	if (result > 0)
+	    _rxTail += result;
+	else if (result < 0 && errno != EAGAIN && errno != EINTR)
+	    fprintf(stderr, "TTYSerial::fill read failed: %s\n", strerror(errno));
+    }
+
+    return _rxTail - _rxHead;
+}
+
+void TTYSerial::updateStats()
+{
+    struct serial_icounter_struct icount;
+
+    if (_device == -1 || ioctl(_device, TIOCGICOUNT, &icount) < 0)
+	return;
+
+    unsigned long overruns = (unsigned long) icount.overrun + icount.buf_overrun;
+    // The first reading, or one after the driver reset its counts, is only the base
+    if (overruns >= _overruns)
+	stats.dropped += overruns - _overruns;
+    _overruns = overruns;
+}
+
 int TTYSerial::peek(void)
 {
-    printf("TTYSerial::peek not implemented\n");
-    return 0;
+    if (_rxHead == _rxTail && fill() == 0)
+	return -1;
+    return _rx[_rxHead];
 }
 
 int TTYSerial::available()
 {
-    int bytes;
+    if (_rxHead != _rxTail)
+	return _rxTail - _rxHead;
+    return fill();
+}
 
-    if (_device == -1)
-      return 0;
+int TTYSerial::read()
+{
+    if (_rxHead == _rxTail && fill() == 0)
+	return -1;
+    return _rx[_rxHead++];
+}
 
-    if (ioctl(_device, FIONREAD, &bytes) != 0)
-    {
-	fprintf(stderr, "TTYSerial::available ioctl failed: %s\n", strerror(errno));
-	return 0;
-    }
-    return bytes;
+size_t TTYSerial::read(uint8_t* buf, size_t len)
+{
+    if (_rxHead == _rxTail)
+	fill();
+
+    size_t n = _rxTail - _rxHead;
+    if (n > len)
+	n = len;
+    memcpy(buf, _rx + _rxHead, n);
+    _rxHead += n;
+    return n;
 }
 
-int TTYSerial::read()
+// Send the collected bytes followed by s in one go.
+// Waits for the device while its queue is full, as a UART would.
+size_t TTYSerial::txSend(const unsigned char* s, size_t len)
 {
-    uint8_t data;
+    struct iovec iov[2];
+    int cnt = 0;
 
     if (_device == -1)
-      return 0;
-
-    ssize_t result = ::read(_device, &data, 1);
-    if (result != 1)
     {
-	fprintf(stderr, "TTYSerial::read read failed: %s\n", strerror(errno));
+	_txLen = 0;
 	return 0;
     }
-//    printf("got: %02x\n", data);
-    return data;
+
+    if (_txLen)
+    {
+	iov[cnt].iov_base = _tx;
+	iov[cnt].iov_len  = _txLen;
+	cnt++;
+    }
+    if (len)
+    {
+	iov[cnt].iov_base = (void*) s;
+	iov[cnt].iov_len  = len;
+	cnt++;
+    }
+
+    int idx = 0;
+    while (idx < cnt)
+    {
+	ssize_t result = ::writev(_device, iov + idx, cnt - idx);
+	if (result < 0)
+	{
+	    if (errno == EINTR)
+		continue;
+	    if (errno == EAGAIN)
+	    {
+		struct pollfd pfd = { _device, POLLOUT, 0 };
+		if (poll(&pfd, 1, 1000) > 0)
+		    continue;
+	    }
+	    fprintf(stderr, "TTYSerial::write failed: %s\n", strerror(errno));
+	    _txLen = 0;
+	    return 0;
+	}
+	while (idx < cnt && (size_t) result >= iov[idx].iov_len)
+	    result -= iov[idx++].iov_len;
+	if (idx < cnt)
+	{
+	    iov[idx].iov_base = (uint8_t*) iov[idx].iov_base + result;
+	    iov[idx].iov_len -= result;
+	}
+    }
+
+    _txLen = 0;
+    return len;
+}
+
+// True for printable text that does not end a line, the only data that is held back
+static bool isPartialLine(const unsigned char* s, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+	if ((s[i] < ' ' && s[i] != '\t' && s[i] != '\r') || s[i] > '~')
+	    return false;
+    return true;
 }
 
 size_t TTYSerial::write(uint8_t ch)
@@ -85,45 +205,31 @@ size_t TTYSerial::write(uint8_t ch)
     if (_device == -1)
       return 0;
 
-    size_t result = ::write(_device, &ch, 1);
-    if (result != 1)
-    {
-	fprintf(stderr, "TTYSerial::write failed: %s\n", strerror(errno));
-	return 0;
-    }
-//    printf("sent: %02x\n", ch);
+    _tx[_txLen++] = ch;
+    if (!isPartialLine(&ch, 1) || _txLen == sizeof(_tx))
+	txSend(NULL, 0);
     return 1; // OK
 }
 
-size_t TTYSerial::write(unsigned char* s, size_t len) {
+size_t TTYSerial::write(const unsigned char* s, size_t len) {
 
     if (_device == -1)
       return 0;
 
-    size_t result = ::write(_device, s, len);
-    if (result != len)
+    // Pieces of a text line are collected until it is complete,
+    // binary data goes out at once
+    if (_txLen + len < sizeof(_tx) && isPartialLine(s, len))
     {
-	fprintf(stderr, "TTYSerial::write failed: %s\n", strerror(errno));
-	return 0;
+	memcpy(_tx + _txLen, s, len);
+	_txLen += len;
+	return len;
     }
-//    printf("sent: %02x\n", ch);
-    return result; // OK
+
+    return txSend(s, len);
 }
 
 size_t TTYSerial::write(const char* s) {
-    size_t len = strlen(s);
-
-    if (_device == -1)
-      return 0;
-
-    size_t result = ::write(_device, s, len);
-    if (result != len)
-    {
-	fprintf(stderr, "TTYSerial::write failed: %s\n", strerror(errno));
-	return 0;
-    }
-//    printf("sent: %02x\n", ch);
-    return result; // OK
+    return write((const unsigned char*) s, strlen(s));
 }
 
 bool TTYSerial::openDevice()
@@ -138,15 +244,20 @@ bool TTYSerial::openDevice()
 	return false;
     }
 
-    // Device opened
-    fcntl(_device, F_SETFL, 0);
+    // Device opened, keep it non-blocking
+    fcntl(_device, F_SETFL, O_NONBLOCK);
+    _rxHead = _rxTail = 0;
+    _txLen = 0;
     return true;
 }
 
 bool TTYSerial::closeDevice()
 {
     if (_device != -1)
+    {
+	txSend(NULL, 0);
 	close(_device);
+    }
     _device = -1;
     return true;
 }
@@ -314,6 +425,9 @@ bool TTYSerial::waitAvailableTimeout(uint16_t timeout)
     fd_set         input;
     int            result;
 
+    if (available())
+	return true;
+
     FD_ZERO(&input);
     FD_SET(_device, &input);
     max_fd = _device + 1;
@@ -7,6 +7,16 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#define TTYSERIAL_RX_BUFSIZE 4096
+#define TTYSERIAL_TX_BUFSIZE 512
+
+typedef struct TTYSerialStats {
+    std::atomic<unsigned long> full;    // fill() found the receive buffer full
+    std::atomic<unsigned long> dropped; // lost by the driver to overruns
+} TTYSerialStats;
 
 /////////////////////////////////////////////////////////////////////
 /// \class HardwareSerial HardwareSerial.h <RHutil/HardwareSerial.h>
@@ -24,6 +34,17 @@
 ///
 /// Device naming conventions vary from OS to OS. ON linux, an FTDI serial port may have a name like
 /// /dev/ttyUSB0. On OSX, it might be something like /dev/tty.usbserial-A501YSWL
+/// \par Buffering
+///
+/// The port is non-blocking. Received data is pulled into an internal buffer with one read(2)
+/// per call of fill(), so read() and available() only make a syscall once that buffer runs empty.
+/// fd() can be registered with an event loop and fill() called when it is readable.
+/// Once that buffer is full fill() leaves further data in the kernel until the caller catches up,
+/// nothing that has been received is thrown away.
+/// Short pieces of text are collected and go out with a single writev(2) when a newline or
+/// binary data is written, the collected data would not fit any more, or before the port
+/// is read or flushed. A write() of binary data is never held back.
+///
 /// \par errors
 ///
 /// A number of these methods print error messages to stderr in the event of an IO error.
@@ -55,7 +76,7 @@ public:
     void flush();
 
     /// Peek at the nex available character without consuming it.
-    /// CAUTION: Not implemented.
+    /// \return The next available character, -1 if none
     int peek(void);
 
     /// Returns the number of bytes immediately available to be read from the
@@ -64,10 +85,27 @@ public:
     int available();
 
     /// Read and return the next available character.
-    /// If no character is available prints a message to stderr and returns 0;
+    /// If no character is available returns -1;
     /// \return The next available character
     int read();
 
+    /// Copy up to len buffered or immediately available bytes to buf.
+    /// \return The number of bytes copied
+    size_t read(uint8_t* buf, size_t len);
+
+    /// Pull whatever the device has into the receive buffer, without blocking.
+    /// \return The number of bytes in the receive buffer
+    int fill();
+
+    /// The device file descriptor, -1 if the port is not open.
+    int fd() { return _device; }
+
+    /// Add the characters the driver has lost to overruns since the last call to stats.dropped.
+    /// Not every driver keeps these counts, those report none.
+    void updateStats();
+
+    TTYSerialStats stats;
+
     /// Transmit a single character oin the serial port.
     /// Returns immediately.
     /// IO errors are repored by printing aa message to stderr.
@@ -75,7 +113,7 @@ public:
     /// \return 1 if successful else 0
     size_t write(uint8_t ch);
 
-    size_t write(unsigned char* s, size_t len);
+    size_t write(const unsigned char* s, size_t len);
     size_t write(const char* s);
 
     // These are not usually in TTYSerial but we
@@ -99,9 +137,18 @@ protected:
     bool setBaud(int baud);
 
 private:
+    size_t txSend(const unsigned char* s, size_t len);
+
     const char* _deviceName;
     int         _device; // file desriptor
     int         _baud;
+
+    uint8_t     _rx[TTYSERIAL_RX_BUFSIZE];
+    size_t      _rxHead; // next byte to read
+    size_t      _rxTail; // end of received data
+    uint8_t     _tx[TTYSERIAL_TX_BUFSIZE];
+    size_t      _txLen;
+    unsigned long _overruns; // driver count at the last updateStats()
 };
 
 #endif
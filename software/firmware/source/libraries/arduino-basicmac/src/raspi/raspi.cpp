@@ -11,9 +11,12 @@
 #include "raspi.h"
 
 //Initialize the values for sanity
-static uint64_t epochMilli ;
 static uint64_t epochMicro ;
 
+// Trace replay runs millis() and micros() off a virtual clock
+static bool     virtualClock = false ;
+static uint64_t virtualMicro ;
+
 SPIClass::SPIClass(uint8_t spi_bus)
     :_spi_num(spi_bus)
 {}
@@ -144,31 +147,47 @@ unsigned char digitalRead(unsigned char pin) {
   return bcm2835_gpio_lev(pin);
 }
 
+static uint64_t monotonicMicros() {
+  struct timespec ts ;
+  clock_gettime (CLOCK_MONOTONIC, &ts) ;
+  return (uint64_t)ts.tv_sec * (uint64_t)1000000 + (uint64_t)(ts.tv_nsec / 1000) ;
+}
+
 //Initialize a timestamp for millis/micros calculation
 // Grabbed from WiringPi
+// CLOCK_MONOTONIC, so that a step of the system time does not move
+// the time slots, and kernel event timestamps can be converted
 void initialiseEpoch() {
-  struct timeval tv ;
-  gettimeofday (&tv, NULL) ;
-  epochMilli = (uint64_t)tv.tv_sec * (uint64_t)1000    + (uint64_t)(tv.tv_usec / 1000) ;
-  epochMicro = (uint64_t)tv.tv_sec * (uint64_t)1000000 + (uint64_t)(tv.tv_usec) ;
+  epochMicro = monotonicMicros() ;
   pinMode(lmic_pins.nss, OUTPUT);
   digitalWrite(lmic_pins.nss, HIGH);
 }
 
+// us since initialiseEpoch(), millis() and micros() return this from now on
+void setVirtualMicros(uint64_t us) {
+  virtualMicro = us ;
+  virtualClock = true ;
+}
+
+// us since initialiseEpoch(), does not wrap
+uint64_t micros64() {
+  if (virtualClock) {
+    return virtualMicro ;
+  }
+  return monotonicMicros() - epochMicro ;
+}
+
+// a CLOCK_MONOTONIC timestamp (ns) of a kernel event, on the micros64() base
+uint64_t monotonicToMicros(uint64_t ns) {
+  return ns / 1000 - epochMicro ;
+}
+
 unsigned int millis() {
-  struct timeval tv ;
-  uint64_t now ;
-  gettimeofday (&tv, NULL) ;
-  now  = (uint64_t)tv.tv_sec * (uint64_t)1000 + (uint64_t)(tv.tv_usec / 1000) ;
-  return (uint32_t)(now - epochMilli) ;
+  return (uint32_t)(micros64() / 1000) ;
 }
 
 unsigned int micros() {
-  struct timeval tv ;
-  uint64_t now ;
-  gettimeofday (&tv, NULL) ;
-  now  = (uint64_t)tv.tv_sec * (uint64_t)1000000 + (uint64_t)tv.tv_usec ;
-  return (uint32_t)(now - epochMicro) ;
+  return (uint32_t)micros64() ;
 }
 
 char * getSystemTime(char * time_buff, int len) {
@@ -99,6 +99,7 @@
 #define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
 #define pgm_read_byte(addr) (*(const unsigned char *)(addr))
 #define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word(addr) (*(const unsigned short *)(addr))
 #define pgm_read_float(addr) (*(const float *)(addr))
 
 // WMath prototypes
@@ -248,6 +249,9 @@ unsigned char digitalRead(unsigned char) ;
 void          initialiseEpoch();
 unsigned int  millis();
 unsigned int  micros();
+uint64_t      micros64();
+uint64_t      monotonicToMicros(uint64_t);
+void          setVirtualMicros(uint64_t);
 
 #ifdef __cplusplus
 }
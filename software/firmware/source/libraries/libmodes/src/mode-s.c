@@ -41,6 +41,17 @@
 #define MODE_S_SHORT_MSG_BITS 56
 #define MODE_S_FULL_LEN       (MODE_S_PREAMBLE_US+MODE_S_LONG_MSG_BITS)
 
+// With an SDR attached the RPi build runs the first preamble test through
+// the starch dispatcher, which picks a SIMD kernel for the host when there
+// is one, and only looks at the candidates it returns.
+#if defined(RASPBERRY_PI) && !defined(USE_BYTE_MAG) && \
+   (defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR) || \
+    defined(ENABLE_IFILE))
+#include "sdr/starch.h"
+#define MODE_S_PREAMBLE_KERNEL
+#define MODE_S_PREAMBLE_BLOCK 4096 // samples scanned per kernel call
+#endif
+
 #ifndef HACKRF_ONE
 #define MODE_S_ICAO_CACHE_TTL 60   // Time to live of cached addresses.
 
@@ -62,6 +73,10 @@ extern mag_t maglut[129*129];
 
 static int maglut_initialized = 0;
 
+#ifndef HACKRF_ONE
+static void syndrome_init(void);
+#endif /* HACKRF_ONE */
+
 // =============================== Initialization ===========================
 
 void mode_s_init(mode_s_t *self) {
@@ -71,17 +86,27 @@ void mode_s_init(mode_s_t *self) {
   self->aggressive = 0;
   self->aircrafts = NULL;
   self->interactive_ttl = MODE_S_INTERACTIVE_TTL;
+  self->cpr_ref_valid = 0;
+  self->cpr_ref_range = MODE_S_CPR_REF_RANGE;
+  self->aircraft_count = 0;
+  self->aircraft_max = MODE_S_AIRCRAFT_MAX;
+  self->aircraft_pool = NULL;
+  self->aircraft_swept = 0;
+  memset(self->aircraft_hash, 0, sizeof(self->aircraft_hash));
+  memset(self->aircraft_wheel, 0, sizeof(self->aircraft_wheel));
 
   // Allocate the ICAO address cache. We use two uint32_t for every entry
   // because it's a addr / timestamp pair for every entry
   memset(&self->icao_cache, 0, sizeof(self->icao_cache));
 
-#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR)
+#if defined(ENABLE_RTLSDR) || defined(ENABLE_HACKRF) || defined(ENABLE_MIRISDR) || \
+    defined(ENABLE_IFILE)
   self->gain        = MODE_S_DEFAULT_GAIN;
   self->freq        = MODE_S_DEFAULT_FREQ;
   self->sample_rate = MODE_S_DEFAULT_RATE;
   self->sdr_type    = SDR_NONE;
-#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR */
+  self->sample_stamp = 0;
+#endif /* ENABLE_RTLSDR || ENABLE_HACKRF || ENABLE_MIRISDR || ENABLE_IFILE */
 
   // Populate the I/Q -> Magnitude lookup table. It is used because sqrt or
   // round may be expensive and may vary a lot depending on the libc used.
@@ -114,6 +139,10 @@ void mode_s_init(mode_s_t *self) {
     maglut_initialized = 1;
   }
 #endif /* HACKRF_ONE */
+
+#ifndef HACKRF_ONE
+  syndrome_init();
+#endif /* HACKRF_ONE */
 }
 
 // ===================== Mode S detection and decoding  =====================
@@ -152,21 +181,53 @@ uint32_t mode_s_checksum_table[] = {
   0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000
 };
 
+// Byte-wise form of the same code (generator 0x1fff409), one table lookup per
+// message byte instead of one test per bit. Only the data bytes are fed in,
+// which is equivalent to the zero tail of mode_s_checksum_table[] above.
+static const uint32_t mode_s_crc_table[256] = {
+  0x000000, 0xfff409, 0x001c1b, 0xffe812, 0x003836, 0xffcc3f, 0x00242d, 0xffd024,
+  0x00706c, 0xff8465, 0x006c77, 0xff987e, 0x00485a, 0xffbc53, 0x005441, 0xffa048,
+  0x00e0d8, 0xff14d1, 0x00fcc3, 0xff08ca, 0x00d8ee, 0xff2ce7, 0x00c4f5, 0xff30fc,
+  0x0090b4, 0xff64bd, 0x008caf, 0xff78a6, 0x00a882, 0xff5c8b, 0x00b499, 0xff4090,
+  0x01c1b0, 0xfe35b9, 0x01ddab, 0xfe29a2, 0x01f986, 0xfe0d8f, 0x01e59d, 0xfe1194,
+  0x01b1dc, 0xfe45d5, 0x01adc7, 0xfe59ce, 0x0189ea, 0xfe7de3, 0x0195f1, 0xfe61f8,
+  0x012168, 0xfed561, 0x013d73, 0xfec97a, 0x01195e, 0xfeed57, 0x010545, 0xfef14c,
+  0x015104, 0xfea50d, 0x014d1f, 0xfeb916, 0x016932, 0xfe9d3b, 0x017529, 0xfe8120,
+  0x038360, 0xfc7769, 0x039f7b, 0xfc6b72, 0x03bb56, 0xfc4f5f, 0x03a74d, 0xfc5344,
+  0x03f30c, 0xfc0705, 0x03ef17, 0xfc1b1e, 0x03cb3a, 0xfc3f33, 0x03d721, 0xfc2328,
+  0x0363b8, 0xfc97b1, 0x037fa3, 0xfc8baa, 0x035b8e, 0xfcaf87, 0x034795, 0xfcb39c,
+  0x0313d4, 0xfce7dd, 0x030fcf, 0xfcfbc6, 0x032be2, 0xfcdfeb, 0x0337f9, 0xfcc3f0,
+  0x0242d0, 0xfdb6d9, 0x025ecb, 0xfdaac2, 0x027ae6, 0xfd8eef, 0x0266fd, 0xfd92f4,
+  0x0232bc, 0xfdc6b5, 0x022ea7, 0xfddaae, 0x020a8a, 0xfdfe83, 0x021691, 0xfde298,
+  0x02a208, 0xfd5601, 0x02be13, 0xfd4a1a, 0x029a3e, 0xfd6e37, 0x028625, 0xfd722c,
+  0x02d264, 0xfd266d, 0x02ce7f, 0xfd3a76, 0x02ea52, 0xfd1e5b, 0x02f649, 0xfd0240,
+  0x0706c0, 0xf8f2c9, 0x071adb, 0xf8eed2, 0x073ef6, 0xf8caff, 0x0722ed, 0xf8d6e4,
+  0x0776ac, 0xf882a5, 0x076ab7, 0xf89ebe, 0x074e9a, 0xf8ba93, 0x075281, 0xf8a688,
+  0x07e618, 0xf81211, 0x07fa03, 0xf80e0a, 0x07de2e, 0xf82a27, 0x07c235, 0xf8363c,
+  0x079674, 0xf8627d, 0x078a6f, 0xf87e66, 0x07ae42, 0xf85a4b, 0x07b259, 0xf84650,
+  0x06c770, 0xf93379, 0x06db6b, 0xf92f62, 0x06ff46, 0xf90b4f, 0x06e35d, 0xf91754,
+  0x06b71c, 0xf94315, 0x06ab07, 0xf95f0e, 0x068f2a, 0xf97b23, 0x069331, 0xf96738,
+  0x0627a8, 0xf9d3a1, 0x063bb3, 0xf9cfba, 0x061f9e, 0xf9eb97, 0x060385, 0xf9f78c,
+  0x0657c4, 0xf9a3cd, 0x064bdf, 0xf9bfd6, 0x066ff2, 0xf99bfb, 0x0673e9, 0xf987e0,
+  0x0485a0, 0xfb71a9, 0x0499bb, 0xfb6db2, 0x04bd96, 0xfb499f, 0x04a18d, 0xfb5584,
+  0x04f5cc, 0xfb01c5, 0x04e9d7, 0xfb1dde, 0x04cdfa, 0xfb39f3, 0x04d1e1, 0xfb25e8,
+  0x046578, 0xfb9171, 0x047963, 0xfb8d6a, 0x045d4e, 0xfba947, 0x044155, 0xfbb55c,
+  0x041514, 0xfbe11d, 0x04090f, 0xfbfd06, 0x042d22, 0xfbd92b, 0x043139, 0xfbc530,
+  0x054410, 0xfab019, 0x05580b, 0xfaac02, 0x057c26, 0xfa882f, 0x05603d, 0xfa9434,
+  0x05347c, 0xfac075, 0x052867, 0xfadc6e, 0x050c4a, 0xfaf843, 0x051051, 0xfae458,
+  0x05a4c8, 0xfa50c1, 0x05b8d3, 0xfa4cda, 0x059cfe, 0xfa68f7, 0x0580e5, 0xfa74ec,
+  0x05d4a4, 0xfa20ad, 0x05c8bf, 0xfa3cb6, 0x05ec92, 0xfa189b, 0x05f089, 0xfa0480,
+};
+
 uint32_t mode_s_checksum(unsigned char *msg, int bits) {
   uint32_t crc = 0;
-  int offset = (bits == 112) ? 0 : (112-56);
+  int n = bits/8 - 3;
   int j;
 
-  for(j = 0; j < bits; j++) {
-    int byte = j/8;
-    int bit = j%8;
-    int bitmask = 1 << (7-bit);
+  for (j = 0; j < n; j++)
+    crc = (crc << 8) ^ mode_s_crc_table[((crc >> 16) ^ msg[j]) & 0xff];
 
-    // If bit is set, xor with corresponding table entry.
-    if (msg[byte] & bitmask)
-      crc ^= mode_s_checksum_table[j+offset];
-  }
-  return crc; // 24 bit checksum.
+  return crc & 0xffffff; // 24 bit checksum.
 }
 
 // Given the Downlink Format (DF) of the message, return the message length in
@@ -180,75 +241,132 @@ int mode_s_msg_len_by_type(int type) {
     return MODE_S_SHORT_MSG_BITS;
 }
 
+// Syndrome of a single bit error at position 'j' of a 112 bit message, that
+// is the difference it makes between the received and the computed CRC.
+// Data bits contribute their parity table entry, CRC bits flip themselves.
+//
+// Bit 'j' of a 56 bit message has the same syndrome as bit 'j+56' of a long
+// one, so a single table covers both message lengths.
+static uint32_t mode_s_syndrome(int j) {
+  return j < MODE_S_LONG_MSG_BITS - 24 ? mode_s_checksum_table[j] :
+                                         1UL << (MODE_S_LONG_MSG_BITS - 1 - j);
+}
+
+#ifndef HACKRF_ONE
+// Every 1 and 2 bit error pattern of a 112 bit message has a distinct
+// syndrome, so a syndrome -> error position map turns error correction into
+// a single lookup. Open addressing, entries are the two positions packed as
+// (j | i << 7); single bit errors have i == j. The syndrome is not stored, it
+// is recomputed from the positions to confirm a hit.
+#define MODE_S_SYNDROME_BITS  14
+#define MODE_S_SYNDROME_SIZE  (1 << MODE_S_SYNDROME_BITS)
+#define MODE_S_SYNDROME_EMPTY 0xffff
+
+static uint16_t syndrome_table[MODE_S_SYNDROME_SIZE];
+static int syndrome_initialized = 0;
+
+static uint32_t syndrome_hash(uint32_t syndrome) {
+  return (uint32_t)(syndrome * 0x9e3779b1U) >> (32 - MODE_S_SYNDROME_BITS);
+}
+
+static void syndrome_insert(int j, int i) {
+  uint32_t syndrome = mode_s_syndrome(j) ^ (i != j ? mode_s_syndrome(i) : 0);
+  uint32_t h = syndrome_hash(syndrome);
+
+  while (syndrome_table[h] != MODE_S_SYNDROME_EMPTY)
+    h = (h + 1) & (MODE_S_SYNDROME_SIZE - 1);
+  syndrome_table[h] = j | (i << 7);
+}
+
+static void syndrome_init(void) {
+  int j, i;
+
+  if (syndrome_initialized)
+    return;
+
+  memset(syndrome_table, 0xff, sizeof(syndrome_table));
+  for (j = 0; j < MODE_S_LONG_MSG_BITS; j++)
+    for (i = j; i < MODE_S_LONG_MSG_BITS; i++)
+      syndrome_insert(j, i);
+
+  syndrome_initialized = 1;
+}
+
+// Look up the error pattern of 'syndrome'. Returns the packed positions or
+// -1 when it is not a 1 or 2 bit error.
+static int syndrome_lookup(uint32_t syndrome) {
+  uint32_t h = syndrome_hash(syndrome);
+  uint16_t e;
+
+  while ((e = syndrome_table[h]) != MODE_S_SYNDROME_EMPTY) {
+    int j = e & 0x7f, i = e >> 7;
+
+    if ((mode_s_syndrome(j) ^ (i != j ? mode_s_syndrome(i) : 0)) == syndrome)
+      return e;
+    h = (h + 1) & (MODE_S_SYNDROME_SIZE - 1);
+  }
+  return -1;
+}
+#else
+// No room for the map on the MCU, search the syndromes instead. This is
+// still a lot cheaper than computing a CRC for every trial flip.
+static int syndrome_lookup(uint32_t syndrome) {
+  int j, i;
+
+  for (j = 0; j < MODE_S_LONG_MSG_BITS; j++) {
+    uint32_t rest = syndrome ^ mode_s_syndrome(j);
+
+    if (rest == 0)
+      return j | (j << 7);
+    for (i = j+1; i < MODE_S_LONG_MSG_BITS; i++)
+      if (mode_s_syndrome(i) == rest)
+        return j | (i << 7);
+  }
+  return -1;
+}
+#endif /* HACKRF_ONE */
+
+// Find the 'errors' (1 or 2) bits to flip so that the message passes the
+// checksum, apply them and return the error position(s) in the way the
+// fix_*() functions report them. Otherwise returns -1.
+static int fix_bit_errors(unsigned char *msg, int bits, int errors) {
+  uint32_t syndrome;
+  int e, j, i;
+
+  syndrome = (((uint32_t)msg[(bits/8)-3] << 16) |
+              ((uint32_t)msg[(bits/8)-2] << 8) |
+               (uint32_t)msg[(bits/8)-1]) ^ mode_s_checksum(msg, bits);
+  if (syndrome == 0 || (e = syndrome_lookup(syndrome)) == -1)
+    return -1;
+
+  // Translate to message positions, short messages use the tail of the table.
+  j = (e & 0x7f) - (MODE_S_LONG_MSG_BITS - bits);
+  i = (e >> 7)   - (MODE_S_LONG_MSG_BITS - bits);
+  if (j < 0 || (i == j ? 1 : 2) != errors)
+    return -1;
+
+  msg[j/8] ^= 1 << (7-(j%8));
+  if (i == j)
+    return j;
+  msg[i/8] ^= 1 << (7-(i%8));
+  // We return the two bits as a 16 bit integer by shifting 'i' on the
+  // left. This is possible since 'i' will always be non-zero as i > j.
+  return j | (i<<8);
+}
+
 // Try to fix single bit errors using the checksum. On success modifies the
 // original buffer with the fixed version, and returns the position of the
 // error bit. Otherwise if fixing failed -1 is returned.
 int fix_single_bit_errors(unsigned char *msg, int bits) {
-  int j;
-  unsigned char aux[MODE_S_LONG_MSG_BITS/8];
-
-  for (j = 0; j < bits; j++) {
-    int byte = j/8;
-    int bitmask = 1 << (7-(j%8));
-    uint32_t crc1, crc2;
-
-    memcpy(aux, msg, bits/8);
-    aux[byte] ^= bitmask; // Flip j-th bit.
-
-    crc1 = ((uint32_t)aux[(bits/8)-3] << 16) |
-           ((uint32_t)aux[(bits/8)-2] << 8) |
-            (uint32_t)aux[(bits/8)-1];
-    crc2 = mode_s_checksum(aux, bits);
-
-    if (crc1 == crc2) {
-      // The error is fixed. Overwrite the original buffer with the
-      // corrected sequence, and returns the error bit position.
-      memcpy(msg, aux, bits/8);
-      return j;
-    }
-  }
-  return -1;
+  return fix_bit_errors(msg, bits, 1);
 }
 
-// Similar to fix_single_bit_errors() but try every possible two bit
-// combination. This is very slow and should be tried only against DF17
-// messages that don't pass the checksum, and only in Aggressive Mode.
+// Similar to fix_single_bit_errors() but for every possible two bit
+// combination. It should be tried only against DF17 messages that don't
+// pass the checksum, and only in Aggressive Mode, as the odds of turning
+// noise into a bogus message are much higher.
 int fix_two_bits_errors(unsigned char *msg, int bits) {
-  int j, i;
-  unsigned char aux[MODE_S_LONG_MSG_BITS/8];
-
-  for (j = 0; j < bits; j++) {
-    int byte1 = j/8;
-    int bitmask1 = 1 << (7-(j%8));
-
-    // Don't check the same pairs multiple times, so i starts from j+1
-    for (i = j+1; i < bits; i++) {
-      int byte2 = i/8;
-      int bitmask2 = 1 << (7-(i%8));
-      uint32_t crc1, crc2;
-
-      memcpy(aux, msg, bits/8);
-
-      aux[byte1] ^= bitmask1; // Flip j-th bit.
-      aux[byte2] ^= bitmask2; // Flip i-th bit.
-
-      crc1 = ((uint32_t)aux[(bits/8)-3] << 16) |
-             ((uint32_t)aux[(bits/8)-2] << 8) |
-              (uint32_t)aux[(bits/8)-1];
-      crc2 = mode_s_checksum(aux, bits);
-
-      if (crc1 == crc2) {
-        // The error is fixed. Overwrite the original buffer with the
-        // corrected sequence, and returns the error bit position.
-        memcpy(msg, aux, bits/8);
-        // We return the two bits as a 16 bit integer by shifting 'i'
-        // on the left. This is possible since 'i' will always be
-        // non-zero because i starts from j+1.
-        return j | (i<<8);
-      }
-    }
-  }
-  return -1;
+  return fix_bit_errors(msg, bits, 2);
 }
 
 // Hash the ICAO address to index our cache of MODE_S_ICAO_CACHE_LEN elements,
@@ -637,11 +755,33 @@ void apply_phase_correction(mag_t *mag) {
 // size 'maglen' bytes. Every detected Mode S message is convert it into a
 // stream of bits and passed to the function to display it.
 void mode_s_detect(mode_s_t *self, mag_t *mag, uint32_t maglen, mode_s_callback_t cb) {
+  mode_s_detect_scan(self, mag, maglen, NULL, cb);
+}
+
+// Same as mode_s_detect(), but 'scan' (if not NULL) carries the preamble
+// candidates the producer already found while it was filling 'mag', so the
+// samples in scan->start .. scan->end-1 are not scanned a second time.
+void mode_s_detect_scan(mode_s_t *self, mag_t *mag, uint32_t maglen,
+                        const struct mode_s_preamble_scan *scan,
+                        mode_s_callback_t cb) {
   unsigned char bits[MODE_S_LONG_MSG_BITS];
   unsigned char msg[MODE_S_LONG_MSG_BITS/2];
   mag_t aux[MODE_S_LONG_MSG_BITS*2];
-  uint32_t j;
+  uint32_t j, limit = maglen - MODE_S_FULL_LEN*2;
   int use_correction = 0;
+  // Without check_crc a bad message is passed on once per preamble: the
+  // first attempt waits for the phase corrected retry and is only passed
+  // on if the retry gets nowhere.
+  struct mode_s_msg failed;
+  int has_failed = 0;
+#if defined(MODE_S_PREAMBLE_KERNEL)
+  uint32_t cand_buf[MODE_S_PREAMBLE_BLOCK];
+  const uint32_t *cand = cand_buf;
+  uint32_t cand_base = 0, scanned = 0;
+  unsigned cand_count = 0, cand_next = 0;
+#else
+  (void) scan;
+#endif
 
   // The Mode S preamble is made of impulses of 0.5 microseconds at the
   // following time offsets:
@@ -665,12 +805,57 @@ void mode_s_detect(mode_s_t *self, mag_t *mag, uint32_t maglen, mode_s_callback_
   // 7   ------------------
   // 8   --
   // 9   -------------------
-  for (j = 0; j < maglen - MODE_S_FULL_LEN*2; j++) {
+  for (j = 0; j < limit; j++) {
     int low, high, delta, i, errors;
     int good_message = 0;
 
+    if (has_failed && !use_correction) {
+      cb(self, &failed);
+      has_failed = 0;
+    }
+
     if (use_correction) goto good_preamble; // We already checked it.
 
+#if defined(MODE_S_PREAMBLE_KERNEL)
+    // Move on to the next candidate at or after j, the kernel has already
+    // done the first check below for every sample in between.
+    while (cand_next == cand_count || cand_base + cand[cand_next] < j) {
+      unsigned n;
+
+      if (cand_next < cand_count) {
+        cand_next++;
+        continue;
+      }
+      if (scanned < j)
+        scanned = j;
+      if (scanned >= limit)
+        break;
+      if (scan && scanned >= scan->start && scanned < scan->end) {
+        // Already scanned by the producer, take its list
+        cand = scan->offset;
+        cand_count = scan->count;
+        cand_base = 0;
+        cand_next = 0;
+        scanned = scan->end;
+        continue;
+      }
+      n = limit - scanned;
+      if (scan && scanned < scan->start && n > scan->start - scanned)
+        n = scan->start - scanned;
+      if (n > MODE_S_PREAMBLE_BLOCK)
+        n = MODE_S_PREAMBLE_BLOCK;
+      cand = cand_buf;
+      starch_preamble_u16(mag + scanned, n, cand_buf, &cand_count);
+      cand_base = scanned;
+      cand_next = 0;
+      scanned += n;
+    }
+    if (cand_next == cand_count)
+      break;
+    j = cand_base + cand[cand_next++];
+    if (j >= limit)
+      break;
+#else
     // First check of relations between the first 10 samples representing a
     // valid preamble. We don't even investigate further if this simple
     // test is not passed.
@@ -687,6 +872,7 @@ void mode_s_detect(mode_s_t *self, mag_t *mag, uint32_t maglen, mode_s_callback_
     {
       continue;
     }
+#endif /* MODE_S_PREAMBLE_KERNEL */
 
     // The samples between the two spikes must be < than the average of the
     // high spikes level. We don't test bits too near to the high levels as
@@ -804,7 +990,11 @@ good_preamble:
       }
 
       // Pass data to the next layer
-      if (self->check_crc == 0 || mm.crcok) {
+      if (!mm.crcok && self->check_crc == 0 && !use_correction) {
+        failed = mm;
+        has_failed = 1;
+      } else if (self->check_crc == 0 || mm.crcok) {
+        has_failed = 0;
         cb(self, &mm);
       }
     }
@@ -817,6 +1007,10 @@ good_preamble:
       use_correction = 0;
     }
   }
+
+  if (has_failed) {
+    cb(self, &failed);
+  }
 }
 
 /* ============================= Utility functions ========================== */
@@ -893,44 +1087,138 @@ char *getMEDescription(int metype, int mesub) {
 
 /* ========================= Interactive mode =============================== */
 
+/* Slot of an ICAO address in the aircraft hash table. */
+static unsigned interactiveHash(uint32_t addr) {
+    return (uint32_t) (addr * 2654435761U) >> (32 - MODE_S_AIRCRAFT_HASH_BITS);
+}
+
+/* Add / remove an aircraft to / from the expiry wheel slot of a->seen. */
+static void interactiveWheelLink(mode_s_t *self, struct mode_s_aircraft *a) {
+    struct mode_s_aircraft **slot =
+        &self->aircraft_wheel[a->seen & (MODE_S_AIRCRAFT_WHEEL - 1)];
+
+    a->wheel_prev = NULL;
+    a->wheel_next = *slot;
+    if (*slot) (*slot)->wheel_prev = a;
+    *slot = a;
+}
+
+static void interactiveWheelUnlink(mode_s_t *self, struct mode_s_aircraft *a) {
+    if (a->wheel_prev)
+        a->wheel_prev->wheel_next = a->wheel_next;
+    else
+        self->aircraft_wheel[a->seen & (MODE_S_AIRCRAFT_WHEEL - 1)] = a->wheel_next;
+    if (a->wheel_next) a->wheel_next->wheel_prev = a->wheel_prev;
+}
+
 /* Return a new aircraft structure for the interactive mode linked list
- * of aircrafts. */
-struct mode_s_aircraft *interactiveCreateAircraft(uint32_t addr) {
-    struct mode_s_aircraft *a = malloc(sizeof(*a));
-
-    if (a != NULL) {
-      a->addr = addr;
-      a->aircraft_type = 0;
-      snprintf(a->hexaddr,sizeof(a->hexaddr),"%06x",(int)addr);
-      a->flight[0] = '\0';
-      a->altitude = 0;
-      a->unit = 0;
-      a->speed = 0;
-      a->track = 0;
-      a->odd_cprlat = 0;
-      a->odd_cprlon = 0;
-      a->odd_cprtime = 0;
-      a->even_cprlat = 0;
-      a->even_cprlon = 0;
-      a->even_cprtime = 0;
-      a->lat = 0;
-      a->lon = 0;
-      a->seen = time(NULL);
-      a->messages = 0;
-      a->next = NULL;
+ * of aircrafts, taken from the pool. The pool grows by a slab of
+ * MODE_S_AIRCRAFT_SLAB entries when it runs dry. */
+struct mode_s_aircraft *interactiveCreateAircraft(mode_s_t *self, uint32_t addr) {
+    struct mode_s_aircraft *a;
+
+    if (self->aircraft_count >= self->aircraft_max ||
+        self->aircraft_count >= MODE_S_AIRCRAFT_MAX) return NULL;
+
+    if (self->aircraft_pool == NULL) {
+        struct mode_s_aircraft *slab = malloc(sizeof(*slab) * MODE_S_AIRCRAFT_SLAB);
+        int i;
+
+        if (slab == NULL) return NULL;
+        for (i = 0; i < MODE_S_AIRCRAFT_SLAB; i++) {
+            slab[i].next = self->aircraft_pool;
+            self->aircraft_pool = &slab[i];
+        }
+    }
+
+    a = self->aircraft_pool;
+    self->aircraft_pool = a->next;
+
+    a->addr = addr;
+    a->aircraft_type = 0;
+    snprintf(a->hexaddr,sizeof(a->hexaddr),"%06x",(int)addr);
+    a->flight[0] = '\0';
+    a->altitude = 0;
+    a->unit = 0;
+    a->speed = 0;
+    a->track = 0;
+    a->odd_cprlat = 0;
+    a->odd_cprlon = 0;
+    a->odd_cprtime = 0;
+    a->even_cprlat = 0;
+    a->even_cprlon = 0;
+    a->even_cprtime = 0;
+    a->lat = 0;
+    a->lon = 0;
+    a->seen_latlon = 0;
+    a->latlon_provisional = 0;
+    a->seen = time(NULL);
+    a->messages = 0;
+
+    /* Hash table, list head and expiry wheel. */
+    {
+        unsigned i = interactiveHash(addr);
+        while (self->aircraft_hash[i])
+            i = (i + 1) & (MODE_S_AIRCRAFT_HASH_SIZE - 1);
+        self->aircraft_hash[i] = a;
     }
 
+    a->prev = NULL;
+    a->next = self->aircrafts;
+    if (self->aircrafts) self->aircrafts->prev = a;
+    self->aircrafts = a;
+
+    interactiveWheelLink(self, a);
+    self->aircraft_count++;
+
     return a;
 }
 
+/* Unlink an aircraft from all the structures and return it to the pool. */
+static void interactiveFreeAircraft(mode_s_t *self, struct mode_s_aircraft *a) {
+    const unsigned mask = MODE_S_AIRCRAFT_HASH_SIZE - 1;
+    unsigned i = interactiveHash(a->addr), j, k;
+
+    while (self->aircraft_hash[i] != a)
+        i = (i + 1) & mask;
+
+    /* Backward shift deletion, so lookups never need tombstones: move up
+     * every following entry of the run whose home slot is not in (i, j]. */
+    for (j = i;;) {
+        self->aircraft_hash[i] = NULL;
+        for (;;) {
+            j = (j + 1) & mask;
+            if (self->aircraft_hash[j] == NULL) goto unhashed;
+            k = interactiveHash(self->aircraft_hash[j]->addr);
+            if (((j - k) & mask) >= ((j - i) & mask)) break;
+        }
+        self->aircraft_hash[i] = self->aircraft_hash[j];
+        i = j;
+    }
+
+unhashed:
+    if (a->prev)
+        a->prev->next = a->next;
+    else
+        self->aircrafts = a->next;
+    if (a->next) a->next->prev = a->prev;
+
+    interactiveWheelUnlink(self, a);
+    self->aircraft_count--;
+
+    a->next = self->aircraft_pool;
+    self->aircraft_pool = a;
+}
+
 /* Return the aircraft with the specified address, or NULL if no aircraft
  * exists with this address. */
 struct mode_s_aircraft *interactiveFindAircraft(mode_s_t *self, uint32_t addr) {
-    struct mode_s_aircraft *a = self->aircrafts;
+    unsigned i = interactiveHash(addr);
+    struct mode_s_aircraft *a;
 
-    while(a) {
+    while ((a = self->aircraft_hash[i]) != NULL) {
         if (a->addr == addr) return a;
-        a = a->next;
+        i = (i + 1) & (MODE_S_AIRCRAFT_HASH_SIZE - 1);
     }
     return NULL;
 }
@@ -942,68 +1230,39 @@ int cprModFunction(int a, int b) {
     return res;
 }
 
-/* The NL function uses the precomputed table from 1090-WP-9-14 */
+/* Latitudes at which the number of longitude zones NL drops by one, from
+ * 1090-WP-9-14: NL is 59 below the first entry and 59-i-1 at or above
+ * entry i, down to 1 beyond 87 degrees. */
+static const double cpr_nl_table[58] = {
+    10.47047130, 14.82817437, 18.18626357, 21.02939493, 23.54504487,
+    25.82924707, 27.93898710, 29.91135686, 31.77209708, 33.53993436,
+    35.22899598, 36.85025108, 38.41241892, 39.92256684, 41.38651832,
+    42.80914012, 44.19454951, 45.54626723, 46.86733252, 48.16039128,
+    49.42776439, 50.67150166, 51.89342469, 53.09516153, 54.27817472,
+    55.44378444, 56.59318756, 57.72747354, 58.84763776, 59.95459277,
+    61.04917774, 62.13216659, 63.20427479, 64.26616523, 65.31845310,
+    66.36171008, 67.39646774, 68.42322022, 69.44242631, 70.45451075,
+    71.45986473, 72.45884545, 73.45177442, 74.43893416, 75.42056257,
+    76.39684391, 77.36789461, 78.33374083, 79.29428225, 80.24923213,
+    81.19801349, 82.13956981, 83.07199445, 83.99173563, 84.89166191,
+    85.75541621, 86.53536998, 87.00000000
+};
+
+/* The NL function, as a binary search of the table above. */
 int cprNLFunction(double lat) {
+    int lo = 0, hi = 58;
+
     if (lat < 0) lat = -lat; /* Table is simmetric about the equator. */
-    if (lat < 10.47047130) return 59;
-    if (lat < 14.82817437) return 58;
-    if (lat < 18.18626357) return 57;
-    if (lat < 21.02939493) return 56;
-    if (lat < 23.54504487) return 55;
-    if (lat < 25.82924707) return 54;
-    if (lat < 27.93898710) return 53;
-    if (lat < 29.91135686) return 52;
-    if (lat < 31.77209708) return 51;
-    if (lat < 33.53993436) return 50;
-    if (lat < 35.22899598) return 49;
-    if (lat < 36.85025108) return 48;
-    if (lat < 38.41241892) return 47;
-    if (lat < 39.92256684) return 46;
-    if (lat < 41.38651832) return 45;
-    if (lat < 42.80914012) return 44;
-    if (lat < 44.19454951) return 43;
-    if (lat < 45.54626723) return 42;
-    if (lat < 46.86733252) return 41;
-    if (lat < 48.16039128) return 40;
-    if (lat < 49.42776439) return 39;
-    if (lat < 50.67150166) return 38;
-    if (lat < 51.89342469) return 37;
-    if (lat < 53.09516153) return 36;
-    if (lat < 54.27817472) return 35;
-    if (lat < 55.44378444) return 34;
-    if (lat < 56.59318756) return 33;
-    if (lat < 57.72747354) return 32;
-    if (lat < 58.84763776) return 31;
-    if (lat < 59.95459277) return 30;
-    if (lat < 61.04917774) return 29;
-    if (lat < 62.13216659) return 28;
-    if (lat < 63.20427479) return 27;
-    if (lat < 64.26616523) return 26;
-    if (lat < 65.31845310) return 25;
-    if (lat < 66.36171008) return 24;
-    if (lat < 67.39646774) return 23;
-    if (lat < 68.42322022) return 22;
-    if (lat < 69.44242631) return 21;
-    if (lat < 70.45451075) return 20;
-    if (lat < 71.45986473) return 19;
-    if (lat < 72.45884545) return 18;
-    if (lat < 73.45177442) return 17;
-    if (lat < 74.43893416) return 16;
-    if (lat < 75.42056257) return 15;
-    if (lat < 76.39684391) return 14;
-    if (lat < 77.36789461) return 13;
-    if (lat < 78.33374083) return 12;
-    if (lat < 79.29428225) return 11;
-    if (lat < 80.24923213) return 10;
-    if (lat < 81.19801349) return 9;
-    if (lat < 82.13956981) return 8;
-    if (lat < 83.07199445) return 7;
-    if (lat < 83.99173563) return 6;
-    if (lat < 84.89166191) return 5;
-    if (lat < 85.75541621) return 4;
-    if (lat < 86.53536998) return 3;
-    if (lat < 87.00000000) return 2;
-    else return 1;
+
+    /* Number of boundaries at or below lat. */
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (lat < cpr_nl_table[mid])
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return 59 - lo;
 }
 
 int cprNFunction(double lat, int isodd) {
@@ -1016,58 +1275,112 @@ double cprDlonFunction(double lat, int isodd) {
     return 360.0 / cprNFunction(lat, isodd);
 }
 
+/* floor(x / 131072 + 0.5) for the 17 bit CPR fractions, in integers. */
+static int cprRound17(long x) {
+    x += 65536;
+    return (int) (x >= 0 ? x >> 17 : -((-x + 131071) >> 17));
+}
+
 /* This algorithm comes from:
  * http://www.lll.lu/~edward/edward/adsb/DecodingADSBposition.html.
  *
  *
  * A few remarks:
  * 1) 131072 is 2^17 since CPR latitude and longitude are encoded in 17 bits.
- * 2) We assume that we always received the odd packet as last packet for
- *    simplicity. This may provide a position that is less fresh of a few
- *    seconds.
+ * 2) The zone indices are computed in integers, only the final position
+ *    is a double.
+ *
+ * Returns 0 on success, -1 if the two messages are in different zones.
  */
-void decodeCPR(struct mode_s_aircraft *a) {
+int decodeCPR(struct mode_s_aircraft *a) {
     const double AirDlat0 = 360.0 / 60;
     const double AirDlat1 = 360.0 / 59;
-    double lat0 = a->even_cprlat;
-    double lat1 = a->odd_cprlat;
-    double lon0 = a->even_cprlon;
-    double lon1 = a->odd_cprlon;
+    long lat0 = a->even_cprlat;
+    long lat1 = a->odd_cprlat;
+    long lon0 = a->even_cprlon;
+    long lon1 = a->odd_cprlon;
+    double rlat, lon;
+    int odd = a->odd_cprtime >= a->even_cprtime;
+    int nl, ni, m;
 
     /* Compute the Latitude Index "j" */
-    int j = floor(((59*lat0 - 60*lat1) / 131072) + 0.5);
-    double rlat0 = AirDlat0 * (cprModFunction(j,60) + lat0 / 131072);
-    double rlat1 = AirDlat1 * (cprModFunction(j,59) + lat1 / 131072);
+    int j = cprRound17(59*lat0 - 60*lat1);
+    double rlat0 = AirDlat0 * (cprModFunction(j,60) + lat0 / 131072.0);
+    double rlat1 = AirDlat1 * (cprModFunction(j,59) + lat1 / 131072.0);
 
     if (rlat0 >= 270) rlat0 -= 360;
     if (rlat1 >= 270) rlat1 -= 360;
 
     /* Check that both are in the same latitude zone, or abort. */
-    if (cprNLFunction(rlat0) != cprNLFunction(rlat1)) return;
-
-    /* Compute ni and the longitude index m */
-    if (a->even_cprtime > a->odd_cprtime) {
-        /* Use even packet. */
-        int ni = cprNFunction(rlat0,0);
-        int m = floor((((lon0 * (cprNLFunction(rlat0)-1)) -
-                        (lon1 * cprNLFunction(rlat0))) / 131072) + 0.5);
-        a->lon = cprDlonFunction(rlat0,0) * (cprModFunction(m,ni)+lon0/131072);
-        a->lat = rlat0;
-    } else {
-        /* Use odd packet. */
-        int ni = cprNFunction(rlat1,1);
-        int m = floor((((lon0 * (cprNLFunction(rlat1)-1)) -
-                        (lon1 * cprNLFunction(rlat1))) / 131072.0) + 0.5);
-        a->lon = cprDlonFunction(rlat1,1) * (cprModFunction(m,ni)+lon1/131072);
-        a->lat = rlat1;
-    }
-    if (a->lon > 180) a->lon -= 360;
+    nl = cprNLFunction(rlat0);
+    if (nl != cprNLFunction(rlat1)) return -1;
+
+    /* Compute ni and the longitude index m, from the latest packet. */
+    rlat = odd ? rlat1 : rlat0;
+    ni = nl - odd;
+    if (ni < 1) ni = 1;
+    m = cprRound17(lon0 * (nl-1) - lon1 * nl);
+    lon = (360.0 / ni) * (cprModFunction(m,ni) + (odd ? lon1 : lon0) / 131072.0);
+    if (lon > 180) lon -= 360;
+
+    a->lat = rlat;
+    a->lon = lon;
+    a->seen_latlon = odd ? a->odd_cprtime : a->even_cprtime;
+    a->latlon_provisional = 0;
+    return 0;
+}
+
+/* Decode a single CPR message relative to a reference position, which
+ * is unambiguous as long as the aircraft is within half a zone (about
+ * 180 NM) of it. Returns 0 on success, -1 if the result is not in range. */
+int decodeCPRrelative(struct mode_s_aircraft *a, int fflag,
+                      double reflat, double reflon) {
+    double AirDlat = fflag ? 360.0 / 59 : 360.0 / 60;
+    double AirDlon;
+    double fraction_lat = (fflag ? a->odd_cprlat : a->even_cprlat) / 131072.0;
+    double fraction_lon = (fflag ? a->odd_cprlon : a->even_cprlon) / 131072.0;
+    double rlat, rlon;
+    int j, m;
+
+    /* Latitude zone nearest to the reference. */
+    j = (int) floor(reflat / AirDlat) +
+        (int) floor(0.5 + (reflat - AirDlat * floor(reflat / AirDlat)) / AirDlat - fraction_lat);
+    rlat = AirDlat * (j + fraction_lat);
+    if (rlat >= 270) rlat -= 360;
+    if (rlat < -90 || rlat > 90 || fabs(rlat - reflat) > AirDlat / 2) return -1;
+
+    /* Same for the longitude, with the zone width at that latitude. */
+    AirDlon = cprDlonFunction(rlat, fflag);
+    m = (int) floor(reflon / AirDlon) +
+        (int) floor(0.5 + (reflon - AirDlon * floor(reflon / AirDlon)) / AirDlon - fraction_lon);
+    rlon = AirDlon * (m + fraction_lon);
+    if (rlon > 180) rlon -= 360;
+    if (rlon < -180) rlon += 360;
+    if (fabs(rlon - reflon) > AirDlon / 2 &&
+        fabs(rlon - reflon) < 360 - AirDlon / 2) return -1;
+
+    a->lat = rlat;
+    a->lon = rlon;
+    a->seen_latlon = fflag ? a->odd_cprtime : a->even_cprtime;
+    return 0;
+}
+
+/* Rough distance in NM, good enough to tell a few dozen from a few hundred. */
+static double cprRangeNM(double lat1, double lon1, double lat2, double lon2) {
+    double dlat = lat2 - lat1;
+    double dlon = lon2 - lon1;
+
+    if (dlon > 180) dlon -= 360;
+    if (dlon < -180) dlon += 360;
+    dlon *= cos((lat1 + lat2) / 2 * M_PI / 180);
+    return 60 * sqrt(dlat * dlat + dlon * dlon);
 }
 
 /* Receive new messages and populate the interactive mode with more info. */
 struct mode_s_aircraft *interactiveReceiveData(mode_s_t *self, struct mode_s_msg *mm) {
     uint32_t addr;
-    struct mode_s_aircraft *a, *aux;
+    struct mode_s_aircraft *a;
+    time_t now = time(NULL);
 
     if (self->check_crc && mm->crcok == 0) return NULL;
     addr = (mm->aa1 << 16) | (mm->aa2 << 8) | mm->aa3;
@@ -1075,31 +1388,14 @@ struct mode_s_aircraft *interactiveReceiveData(mode_s_t *self, struct mode_s_msg
     /* Loookup our aircraft or create a new one. */
     a = interactiveFindAircraft(self, addr);
     if (!a) {
-        a = interactiveCreateAircraft(addr);
+        a = interactiveCreateAircraft(self, addr);
         if (a == NULL) return a;
-
-        a->next = self->aircrafts;
-        self->aircrafts = a;
-    } else {
-        /* If it is an already known aircraft, move it on head
-         * so we keep aircrafts ordered by received message time.
-         *
-         * However move it on head only if at least one second elapsed
-         * since the aircraft that is currently on head sent a message,
-         * othewise with multiple aircrafts at the same time we have an
-         * useless shuffle of positions on the screen. */
-        if (0 && self->aircrafts != a && (time(NULL) - a->seen) >= 1) {
-            aux = self->aircrafts;
-            while(aux->next != a) aux = aux->next;
-            /* Now we are a node before the aircraft to remove. */
-            aux->next = aux->next->next; /* removed. */
-            /* Add on head */
-            a->next = self->aircrafts;
-            self->aircrafts = a;
-        }
+    } else if (a->seen != now) {
+        interactiveWheelUnlink(self, a);
+        a->seen = now;
+        interactiveWheelLink(self, a);
     }
 
-    a->seen = time(NULL);
     a->messages++;
 
     if (mm->msgtype == 0 || mm->msgtype == 4 || mm->msgtype == 20) {
@@ -1122,9 +1418,23 @@ struct mode_s_aircraft *interactiveReceiveData(mode_s_t *self, struct mode_s_msg
                 a->even_cprtime = mstime();
             }
             /* If the two data is less than 10 seconds apart, compute
-             * the position. */
-            if (abs((long) (a->even_cprtime - a->odd_cprtime)) <= 10000) {
-                decodeCPR(a);
+             * the position. Otherwise resolve this message alone, close
+             * to the last known position of the aircraft, or else to
+             * the receiver's own one. Beyond cpr_ref_range from the
+             * receiver that is only a guess, kept provisional until a
+             * pair confirms it and never used as a reference itself. */
+            if (!a->even_cprtime || !a->odd_cprtime ||
+                abs((long) (a->even_cprtime - a->odd_cprtime)) > 10000 ||
+                decodeCPR(a) != 0) {
+                if (a->seen_latlon && !a->latlon_provisional &&
+                    (long) (mstime() - a->seen_latlon) <= MODE_S_CPR_LOCAL_AGE) {
+                    decodeCPRrelative(a, mm->fflag, a->lat, a->lon);
+                } else if (self->cpr_ref_valid &&
+                           decodeCPRrelative(a, mm->fflag, self->cpr_ref_lat, self->cpr_ref_lon) == 0) {
+                    a->latlon_provisional =
+                        cprRangeNM(self->cpr_ref_lat, self->cpr_ref_lon, a->lat, a->lon) >
+                        self->cpr_ref_range;
+                }
             }
         } else if (mm->metype == 19) {
             if (mm->mesub == 1 || mm->mesub == 2) {
@@ -1137,26 +1447,32 @@ struct mode_s_aircraft *interactiveReceiveData(mode_s_t *self, struct mode_s_msg
 }
 
 /* When in interactive mode If we don't receive new nessages within
- * MODES_INTERACTIVE_TTL seconds we remove the aircraft from the list. */
+ * MODES_INTERACTIVE_TTL seconds we remove the aircraft from the list.
+ * Only the wheel slots of the seconds that went stale since the last
+ * call are visited. */
 void interactiveRemoveStaleAircrafts(mode_s_t *self) {
-    struct mode_s_aircraft *a = self->aircrafts;
-    struct mode_s_aircraft *prev = NULL;
     time_t now = time(NULL);
+    time_t limit = now - self->interactive_ttl - 1; /* Last stale second. */
+    time_t t;
 
-    while(a) {
-        if ((now - a->seen) > self->interactive_ttl) {
-            struct mode_s_aircraft *next = a->next;
-            /* Remove the element from the linked list, with care
-             * if we are removing the first element. */
-            free(a);
-            if (!prev)
-                self->aircrafts = next;
-            else
-                prev->next = next;
+    if (limit < self->aircraft_swept) {
+        /* The clock went back. */
+        self->aircraft_swept = limit;
+        return;
+    }
+    if (limit - self->aircraft_swept > MODE_S_AIRCRAFT_WHEEL)
+        self->aircraft_swept = limit - MODE_S_AIRCRAFT_WHEEL;
+
+    for (t = self->aircraft_swept + 1; t <= limit; t++) {
+        struct mode_s_aircraft *a = self->aircraft_wheel[t & (MODE_S_AIRCRAFT_WHEEL - 1)];
+
+        while (a) {
+            struct mode_s_aircraft *next = a->wheel_next;
+            /* The slot also holds later seconds that map onto it. */
+            if ((now - a->seen) > self->interactive_ttl)
+                interactiveFreeAircraft(self, a);
             a = next;
-        } else {
-            prev = a;
-            a = a->next;
         }
     }
+    self->aircraft_swept = limit;
 }
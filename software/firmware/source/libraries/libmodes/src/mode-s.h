@@ -62,6 +62,9 @@ typedef unsigned long time_t;
 #include <unistd.h>
 
 #define MODE_S_INTERACTIVE_TTL 60 /* TTL before being removed */
+/* 8192 slots, up to 4096 aircraft: as many as a SoftRF traffic table can
+ * take at run time, aircraft_max brings it down to the configured size */
+#define MODE_S_AIRCRAFT_HASH_BITS 13
 typedef long long ms_time_t;
 
 #else
@@ -75,6 +78,7 @@ extern time_t now_C();
 
 #define USE_BYTE_MAG
 #define MODE_S_INTERACTIVE_TTL 10 /* TTL before being removed */
+#define MODE_S_AIRCRAFT_HASH_BITS 6 /* 64 slots, up to 32 aircraft */
 
 #ifdef DFU_MODE
 #ifdef MAGLUT_IN_ROM
@@ -94,6 +98,24 @@ typedef uint8_t mag_t;
 typedef uint16_t mag_t;
 #endif
 
+/* Interactive mode aircraft table: open addressing on the ICAO address,
+ * kept at most half full. Entries come from a pool that grows in slabs
+ * and are never returned to the heap. Expiry goes through a wheel of
+ * one second slots indexed by the time of the last message. */
+#define MODE_S_AIRCRAFT_HASH_SIZE  (1 << MODE_S_AIRCRAFT_HASH_BITS)
+#define MODE_S_AIRCRAFT_MAX        (MODE_S_AIRCRAFT_HASH_SIZE / 2)
+#define MODE_S_AIRCRAFT_SLAB       16 /* entries allocated at once */
+#define MODE_S_AIRCRAFT_WHEEL      64 /* seconds, power of two required */
+
+/* A previous position of the same aircraft is used as the reference for
+ * single message CPR decoding for up to this long (ms). */
+#define MODE_S_CPR_LOCAL_AGE       60000
+
+/* A single message resolved against the receiver's position is trusted
+ * up to this far from it (NM), well inside the half zone (about 180 NM)
+ * where that resolution stops being unambiguous. */
+#define MODE_S_CPR_REF_RANGE       100
+
 
 /* Structure used to describe an aircraft in iteractive mode. */
 struct mode_s_aircraft {
@@ -115,7 +137,12 @@ struct mode_s_aircraft {
     int even_cprlon;
     double lat, lon;    /* Coordinated obtained from CPR encoded data. */
     ms_time_t odd_cprtime, even_cprtime;
+    ms_time_t seen_latlon; /* Time of the message lat/lon came from, 0 if none. */
+    int latlon_provisional; /* lat/lon is a receiver relative guess beyond
+                               cpr_ref_range, not confirmed by an even/odd pair. */
     struct mode_s_aircraft *next; /* Next aircraft in our linked list. */
+    struct mode_s_aircraft *prev; /* Previous one, NULL for the head. */
+    struct mode_s_aircraft *wheel_next, *wheel_prev; /* Expiry wheel slot. */
 };
 
 typedef enum {
@@ -135,6 +162,16 @@ typedef struct {
   /* Interactive mode */
   struct mode_s_aircraft *aircrafts;
   int interactive_ttl; /* Interactive mode: TTL before deletion. */
+  int aircraft_count;  /* Number of entries in the aircrafts list. */
+  int aircraft_max;    /* No new entries beyond this, MODE_S_AIRCRAFT_MAX at most. */
+  struct mode_s_aircraft *aircraft_pool; /* Free entries. */
+  struct mode_s_aircraft *aircraft_hash[MODE_S_AIRCRAFT_HASH_SIZE];
+  struct mode_s_aircraft *aircraft_wheel[MODE_S_AIRCRAFT_WHEEL];
+  time_t aircraft_swept; /* Wheel slots are expired up to this second. */
+  /* Reference position (receiver's own) for single message CPR decoding. */
+  int cpr_ref_valid;
+  double cpr_ref_lat, cpr_ref_lon;
+  double cpr_ref_range; /* NM, see MODE_S_CPR_REF_RANGE */
 
 #if defined(ENABLE_RTLSDR)  || defined(ENABLE_HACKRF) || \
     defined(ENABLE_MIRISDR) || defined(RASPBERRY_PI)
@@ -160,6 +197,8 @@ typedef struct {
 
   float adaptive_range_target;
 
+  uint64_t sample_stamp; // system time (ms) of the buffer being demodulated
+
 #ifndef __cplusplus
   atomic_int exit;     // Exit from the main loop when true (2 = unclean exit)
 #endif /* __cplusplus */
@@ -213,6 +252,14 @@ struct mode_s_msg {
 
 typedef void (*mode_s_callback_t)(mode_s_t *self, struct mode_s_msg *mm);
 
+// Preamble candidates found by the sample producer (see convert_block()).
+// The list is complete for offsets start .. end-1 of the magnitude buffer.
+struct mode_s_preamble_scan {
+  const uint32_t *offset;     // Candidate offsets, ascending.
+  unsigned count;
+  uint32_t start, end;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -220,6 +267,8 @@ extern "C" {
 void mode_s_init(mode_s_t *self);
 void mode_s_compute_magnitude_vector(unsigned char *data, mag_t *mag, uint32_t size);
 void mode_s_detect(mode_s_t *self, mag_t *mag, uint32_t maglen, mode_s_callback_t);
+void mode_s_detect_scan(mode_s_t *self, mag_t *mag, uint32_t maglen,
+                        const struct mode_s_preamble_scan *scan, mode_s_callback_t);
 void mode_s_decode(mode_s_t *self, struct mode_s_msg *mm, unsigned char *msg);
 
 struct mode_s_aircraft* interactiveReceiveData(mode_s_t *self, struct mode_s_msg *mm);
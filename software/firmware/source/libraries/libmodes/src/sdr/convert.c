@@ -124,4 +124,64 @@ void cleanup_converter(struct converter_state *state)
     MODES_NOTUSED(state);
 }
 
+// Samples converted per step of convert_block(): the IQ input, the
+// magnitudes and the preamble scan over them all stay in L1/L2 cache.
+#define CONVERT_BLOCK_SAMPLES 4096
+
+void convert_block(iq_convert_fn converter,
+                   struct converter_state *state,
+                   input_format_t format,
+                   void *iq_data,
+                   struct mag_buf *buf,
+                   unsigned nsamples)
+{
+    unsigned bytes_per_sample = (format == INPUT_UC8 ? 2 : 4);
+    uint16_t *mag_data = &buf->data[buf->overlap];
+    double level_sum = 0, power_sum = 0;
+    uint32_t found[CONVERT_BLOCK_SAMPLES];
+    bool scanning = true;
+
+    buf->preambleCount = 0;
+    buf->preambleStart = buf->preambleEnd = buf->overlap;
+
+    for (unsigned done = 0; done < nsamples; ) {
+        unsigned n = nsamples - done;
+        if (n > CONVERT_BLOCK_SAMPLES)
+            n = CONVERT_BLOCK_SAMPLES;
+
+        double level, power;
+        converter((uint8_t *) iq_data + done * bytes_per_sample, mag_data + done, n, state, &level, &power);
+        level_sum += level * n;
+        power_sum += power * n;
+        done += n;
+
+        // Scan every offset whose 10 preamble samples are now converted,
+        // while they are still in cache
+        unsigned from = buf->preambleEnd;
+        unsigned to = buf->overlap + done;
+        if (!scanning || to < from + 9 + 1)
+            continue;
+        to -= 9;
+
+        unsigned count;
+        starch_preamble_u16(&buf->data[from], to - from, found, &count);
+        if (count > buf->preambleLength - buf->preambleCount) {
+            // Too noisy; leave the rest to the demodulator
+            scanning = false;
+            continue;
+        }
+
+        uint32_t *out = &buf->preamble[buf->preambleCount];
+        for (unsigned i = 0; i < count; ++i)
+            out[i] = from + found[i];
+        buf->preambleCount += count;
+        buf->preambleEnd = to;
+    }
+
+    if (nsamples) {
+        buf->mean_level = level_sum / nsamples;
+        buf->mean_power = power_sum / nsamples;
+    }
+}
+
 #endif /* RASPBERRY_PI */
@@ -37,4 +37,17 @@ iq_convert_fn init_converter(input_format_t format,
 
 void cleanup_converter(struct converter_state *state);
 
+// Convert nsamples of IQ data into buf->data, starting after the overlap,
+// and fill buf->mean_level / buf->mean_power. The work is done in
+// cache-sized steps, each followed by the first preamble scan over the
+// magnitudes it just produced; the candidates are left in buf->preamble
+// for the demodulator.
+struct mag_buf;
+void convert_block(iq_convert_fn converter,
+                   struct converter_state *state,
+                   input_format_t format,
+                   void *iq_data,
+                   struct mag_buf *buf,
+                   unsigned nsamples);
+
 #endif
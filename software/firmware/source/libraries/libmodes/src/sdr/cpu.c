@@ -44,6 +44,10 @@ int cpu_supports_avx2(void)
 {
 #ifdef CPU_FEATURES_ARCH_X86
     return x86_info()->features.avx2;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    // no cpu_features, ask the compiler runtime
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
 #else
     return 0;
 #endif
@@ -75,6 +79,9 @@ int cpu_supports_armv7_neon_vfpv4(void)
 {
 #ifdef CPU_FEATURES_ARCH_ARM
     return arm_info()->architecture >= 7 && arm_info()->features.neon && arm_info()->features.vfpv4 && arm_info()->features.vfpd32;
+#elif defined(__ARM_NEON) && defined(__ARM_FEATURE_FMA)
+    // no cpu_features, but the whole program is built for neon-vfpv4 then
+    return 1;
 #else
     return 0;
 #endif
@@ -1,6 +1,7 @@
 #if defined(RASPBERRY_PI)
 
-/* starch generated code. Do not edit. */
+/* starch generated code, extended by hand with the preamble_u16 kernels
+ * and the x86_avx2 flavor. There is no generator in this tree. */
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -1145,6 +1146,168 @@ starch_mean_power_u16_aligned_regentry starch_mean_power_u16_aligned_registry[]
 };
 
 
+/* dispatcher / registry for preamble_u16 */
+
+starch_preamble_u16_regentry * starch_preamble_u16_select() {
+    for (starch_preamble_u16_regentry *entry = starch_preamble_u16_registry;
+         entry->name;
+         ++entry)
+    {
+        if (entry->flavor_supported && !(entry->flavor_supported()))
+            continue;
+        return entry;
+    }
+    return NULL;
+}
+
+static void starch_preamble_u16_dispatch ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 ) {
+    starch_preamble_u16_regentry *entry = starch_preamble_u16_select();
+    if (!entry)
+        abort();
+
+    starch_preamble_u16 = entry->callable;
+    starch_preamble_u16 ( arg0, arg1, arg2, arg3 );
+}
+
+starch_preamble_u16_ptr starch_preamble_u16 = starch_preamble_u16_dispatch;
+
+void starch_preamble_u16_set_wisdom (const char * const * received_wisdom)
+{
+    /* re-rank the registry based on received wisdom */
+    starch_preamble_u16_regentry *entry;
+    for (entry = starch_preamble_u16_registry; entry->name; ++entry) {
+        const char * const *search;
+        for (search = received_wisdom; *search; ++search) {
+            if (!strcmp(*search, entry->name)) {
+                break;
+            }
+        }
+        if (*search) {
+            /* matches an entry in the wisdom list, order by position in the list */
+            entry->rank = search - received_wisdom;
+        } else {
+            /* no match, rank after all possible matches, retaining existing order */
+            entry->rank = (search - received_wisdom) + (entry - starch_preamble_u16_registry);
+        }
+    }
+
+    /* re-sort based on the new ranking */
+    qsort(starch_preamble_u16_registry, entry - starch_preamble_u16_registry, sizeof(starch_preamble_u16_regentry), starch_regentry_rank_compare);
+
+    /* reset the implementation pointer so the next call will re-select */
+    starch_preamble_u16 = starch_preamble_u16_dispatch;
+}
+
+starch_preamble_u16_regentry starch_preamble_u16_registry[] = {
+  
+#ifdef STARCH_MIX_AARCH64
+    { 0, "neon_armv8_neon_simd", "armv8_neon_simd", starch_preamble_u16_neon_armv8_neon_simd, cpu_supports_armv8_simd },
+    { 1, "generic_armv8_neon_simd", "armv8_neon_simd", starch_preamble_u16_generic_armv8_neon_simd, cpu_supports_armv8_simd },
+    { 2, "generic_generic", "generic", starch_preamble_u16_generic_generic, NULL },
+#endif /* STARCH_MIX_AARCH64 */
+  
+#ifdef STARCH_MIX_ARM
+    { 0, "neon_armv7a_neon_vfpv4", "armv7a_neon_vfpv4", starch_preamble_u16_neon_armv7a_neon_vfpv4, cpu_supports_armv7_neon_vfpv4 },
+    { 1, "generic_generic", "generic", starch_preamble_u16_generic_generic, NULL },
+    { 2, "generic_armv7a_neon_vfpv4", "armv7a_neon_vfpv4", starch_preamble_u16_generic_armv7a_neon_vfpv4, cpu_supports_armv7_neon_vfpv4 },
+#endif /* STARCH_MIX_ARM */
+  
+#ifdef STARCH_MIX_GENERIC
+    { 0, "generic_generic", "generic", starch_preamble_u16_generic_generic, NULL },
+#endif /* STARCH_MIX_GENERIC */
+  
+#ifdef STARCH_MIX_X86
+    { 0, "avx2_x86_avx2", "x86_avx2", starch_preamble_u16_avx2_x86_avx2, cpu_supports_avx2 },
+    { 1, "generic_x86_avx2", "x86_avx2", starch_preamble_u16_generic_x86_avx2, cpu_supports_avx2 },
+    { 2, "generic_generic", "generic", starch_preamble_u16_generic_generic, NULL },
+#endif /* STARCH_MIX_X86 */
+    { 0, NULL, NULL, NULL, NULL }
+};
+
+/* dispatcher / registry for preamble_u16_aligned */
+
+starch_preamble_u16_aligned_regentry * starch_preamble_u16_aligned_select() {
+    for (starch_preamble_u16_aligned_regentry *entry = starch_preamble_u16_aligned_registry;
+         entry->name;
+         ++entry)
+    {
+        if (entry->flavor_supported && !(entry->flavor_supported()))
+            continue;
+        return entry;
+    }
+    return NULL;
+}
+
+static void starch_preamble_u16_aligned_dispatch ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 ) {
+    starch_preamble_u16_aligned_regentry *entry = starch_preamble_u16_aligned_select();
+    if (!entry)
+        abort();
+
+    starch_preamble_u16_aligned = entry->callable;
+    starch_preamble_u16_aligned ( arg0, arg1, arg2, arg3 );
+}
+
+starch_preamble_u16_aligned_ptr starch_preamble_u16_aligned = starch_preamble_u16_aligned_dispatch;
+
+void starch_preamble_u16_aligned_set_wisdom (const char * const * received_wisdom)
+{
+    /* re-rank the registry based on received wisdom */
+    starch_preamble_u16_aligned_regentry *entry;
+    for (entry = starch_preamble_u16_aligned_registry; entry->name; ++entry) {
+        const char * const *search;
+        for (search = received_wisdom; *search; ++search) {
+            if (!strcmp(*search, entry->name)) {
+                break;
+            }
+        }
+        if (*search) {
+            /* matches an entry in the wisdom list, order by position in the list */
+            entry->rank = search - received_wisdom;
+        } else {
+            /* no match, rank after all possible matches, retaining existing order */
+            entry->rank = (search - received_wisdom) + (entry - starch_preamble_u16_aligned_registry);
+        }
+    }
+
+    /* re-sort based on the new ranking */
+    qsort(starch_preamble_u16_aligned_registry, entry - starch_preamble_u16_aligned_registry, sizeof(starch_preamble_u16_aligned_regentry), starch_regentry_rank_compare);
+
+    /* reset the implementation pointer so the next call will re-select */
+    starch_preamble_u16_aligned = starch_preamble_u16_aligned_dispatch;
+}
+
+starch_preamble_u16_aligned_regentry starch_preamble_u16_aligned_registry[] = {
+  
+#ifdef STARCH_MIX_AARCH64
+    { 0, "neon_armv8_neon_simd_aligned", "armv8_neon_simd", starch_preamble_u16_aligned_neon_armv8_neon_simd, cpu_supports_armv8_simd },
+    { 1, "generic_armv8_neon_simd_aligned", "armv8_neon_simd", starch_preamble_u16_aligned_generic_armv8_neon_simd, cpu_supports_armv8_simd },
+    { 2, "neon_armv8_neon_simd", "armv8_neon_simd", starch_preamble_u16_neon_armv8_neon_simd, cpu_supports_armv8_simd },
+    { 3, "generic_armv8_neon_simd", "armv8_neon_simd", starch_preamble_u16_generic_armv8_neon_simd, cpu_supports_armv8_simd },
+    { 4, "generic_generic", "generic", starch_preamble_u16_generic_generic, NULL },
+#endif /* STARCH_MIX_AARCH64 */
+  
+#ifdef STARCH_MIX_ARM
+    { 0, "neon_armv7a_neon_vfpv4_aligned", "armv7a_neon_vfpv4", starch_preamble_u16_aligned_neon_armv7a_neon_vfpv4, cpu_supports_armv7_neon_vfpv4 },
+    { 1, "neon_armv7a_neon_vfpv4", "armv7a_neon_vfpv4", starch_preamble_u16_neon_armv7a_neon_vfpv4, cpu_supports_armv7_neon_vfpv4 },
+    { 2, "generic_generic", "generic", starch_preamble_u16_generic_generic, NULL },
+    { 3, "generic_armv7a_neon_vfpv4_aligned", "armv7a_neon_vfpv4", starch_preamble_u16_aligned_generic_armv7a_neon_vfpv4, cpu_supports_armv7_neon_vfpv4 },
+    { 4, "generic_armv7a_neon_vfpv4", "armv7a_neon_vfpv4", starch_preamble_u16_generic_armv7a_neon_vfpv4, cpu_supports_armv7_neon_vfpv4 },
+#endif /* STARCH_MIX_ARM */
+  
+#ifdef STARCH_MIX_GENERIC
+    { 0, "generic_generic", "generic", starch_preamble_u16_generic_generic, NULL },
+#endif /* STARCH_MIX_GENERIC */
+  
+#ifdef STARCH_MIX_X86
+    { 0, "avx2_x86_avx2_aligned", "x86_avx2", starch_preamble_u16_aligned_avx2_x86_avx2, cpu_supports_avx2 },
+    { 1, "avx2_x86_avx2", "x86_avx2", starch_preamble_u16_avx2_x86_avx2, cpu_supports_avx2 },
+    { 2, "generic_generic", "generic", starch_preamble_u16_generic_generic, NULL },
+    { 3, "generic_x86_avx2_aligned", "x86_avx2", starch_preamble_u16_aligned_generic_x86_avx2, cpu_supports_avx2 },
+    { 4, "generic_x86_avx2", "x86_avx2", starch_preamble_u16_generic_x86_avx2, cpu_supports_avx2 },
+#endif /* STARCH_MIX_X86 */
+    { 0, NULL, NULL, NULL, NULL }
+};
+
 int starch_read_wisdom (const char * path)
 {
     FILE *fp = fopen(path, "r");
@@ -1200,6 +1363,14 @@ int starch_read_wisdom (const char * path)
     for (starch_mean_power_u16_aligned_regentry *entry = starch_mean_power_u16_aligned_registry; entry->name; ++entry) {
         entry->rank = 0;
     }
+    int rank_preamble_u16 = 0;
+    for (starch_preamble_u16_regentry *entry = starch_preamble_u16_registry; entry->name; ++entry) {
+        entry->rank = 0;
+    }
+    int rank_preamble_u16_aligned = 0;
+    for (starch_preamble_u16_aligned_regentry *entry = starch_preamble_u16_aligned_registry; entry->name; ++entry) {
+        entry->rank = 0;
+    }
 
     char linebuf[512];
     while (fgets(linebuf, sizeof(linebuf), fp)) {
@@ -1341,6 +1512,24 @@ int starch_read_wisdom (const char * path)
             }
             continue;
         }
+        if (!strcmp(name, "preamble_u16")) {
+            for (starch_preamble_u16_regentry *entry = starch_preamble_u16_registry; entry->name; ++entry) {
+                if (!strcmp(impl, entry->name)) {
+                    entry->rank = ++rank_preamble_u16;
+                    break;
+                }
+            }
+            continue;
+        }
+        if (!strcmp(name, "preamble_u16_aligned")) {
+            for (starch_preamble_u16_aligned_regentry *entry = starch_preamble_u16_aligned_registry; entry->name; ++entry) {
+                if (!strcmp(impl, entry->name)) {
+                    entry->rank = ++rank_preamble_u16_aligned;
+                    break;
+                }
+            }
+            continue;
+        }
     }
 
     if (ferror(fp)) {
@@ -1483,6 +1672,28 @@ int starch_read_wisdom (const char * path)
         /* reset the implementation pointer so the next call will re-select */
         starch_mean_power_u16_aligned = starch_mean_power_u16_aligned_dispatch;
     }
+    {
+        starch_preamble_u16_regentry *entry;
+        for (entry = starch_preamble_u16_registry; entry->name; ++entry) {
+            if (!entry->rank)
+                entry->rank = ++rank_preamble_u16;
+        }
+        qsort(starch_preamble_u16_registry, entry - starch_preamble_u16_registry, sizeof(starch_preamble_u16_regentry), starch_regentry_rank_compare);
+
+        /* reset the implementation pointer so the next call will re-select */
+        starch_preamble_u16 = starch_preamble_u16_dispatch;
+    }
+    {
+        starch_preamble_u16_aligned_regentry *entry;
+        for (entry = starch_preamble_u16_aligned_registry; entry->name; ++entry) {
+            if (!entry->rank)
+                entry->rank = ++rank_preamble_u16_aligned;
+        }
+        qsort(starch_preamble_u16_aligned_registry, entry - starch_preamble_u16_aligned_registry, sizeof(starch_preamble_u16_aligned_regentry), starch_regentry_rank_compare);
+
+        /* reset the implementation pointer so the next call will re-select */
+        starch_preamble_u16_aligned = starch_preamble_u16_aligned_dispatch;
+    }
 
     return 0;
 }
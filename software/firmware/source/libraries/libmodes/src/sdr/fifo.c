@@ -60,6 +60,15 @@ bool fifo_create(unsigned buffer_count, unsigned buffer_size, unsigned overlap)
             goto nomem;
         }
 
+        // Room for one preamble candidate per 16 samples; more than that is
+        // noise, and the demodulator then scans the rest of the buffer itself
+        newbuf->preambleLength = buffer_size / 16;
+        if (!(newbuf->preamble = calloc(newbuf->preambleLength, sizeof(newbuf->preamble[0])))) {
+            free(newbuf->data);
+            free(newbuf);
+            goto nomem;
+        }
+
         newbuf->totalLength = buffer_size;
         newbuf->next = fifo_freelist;
         fifo_freelist = newbuf;
@@ -77,6 +86,7 @@ static void free_buffer_list(struct mag_buf *head)
     while (head) {
         struct mag_buf *next = head->next;
         free(head->data);
+        free(head->preamble);
         free(head);
         head = next;
     }
@@ -161,6 +171,8 @@ struct mag_buf *fifo_acquire(uint32_t timeout_ms)
         result->sampleTimestamp = 0;
         result->sysTimestamp = 0;
         result->flags = 0;
+        result->preambleCount = 0;
+        result->preambleStart = result->preambleEnd = 0;
         result->next = NULL;
     }
 
@@ -66,6 +66,12 @@ struct mag_buf {
     double          mean_power;      // Mean of normalized (0..1) power level
     unsigned        dropped;         // (approx) number of dropped samples, if flag MAGBUF_DISCONTINUOUS is set
 
+    uint32_t       *preamble;        // Preamble candidate offsets into "data", ascending, filled by convert_block()
+    unsigned        preambleLength;  // Allocated size of "preamble"
+    unsigned        preambleCount;   // Number of valid entries in "preamble"
+    unsigned        preambleStart;   // "preamble" is complete for offsets preambleStart .. preambleEnd-1;
+    unsigned        preambleEnd;     // empty if the producer did not scan the buffer
+
     struct mag_buf *next;            // linked list forward link
 };
 
@@ -109,6 +115,7 @@ struct mag_buf *fifo_acquire(uint32_t timeout_ms);
 //   buf->mean_level (if flags & HAS_METRICS)
 //   buf->mean_power (if flags & HAS_METRICS)
 //   buf->dropped    (if flags & DISCONTINUOUS)
+//   buf->preamble*  (if filled with convert_block(), otherwise left empty)
 void fifo_enqueue(struct mag_buf *buf);
 
 // Get a buffer from the tail of the FIFO.
@@ -21,6 +21,7 @@
 #include "impl/magnitude_sc16q11.c"
 #include "impl/magnitude_uc8.c"
 #include "impl/mean_power_u16.c"
+#include "impl/preamble_u16.c"
 
 
 #undef STARCH_ALIGNMENT
@@ -41,5 +42,6 @@
 #include "impl/magnitude_sc16q11.c"
 #include "impl/magnitude_uc8.c"
 #include "impl/mean_power_u16.c"
+#include "impl/preamble_u16.c"
 
 #endif /* RASPBERRY_PI */
@@ -20,5 +20,6 @@
 #include "impl/magnitude_sc16q11.c"
 #include "impl/magnitude_uc8.c"
 #include "impl/mean_power_u16.c"
+#include "impl/preamble_u16.c"
 
 #endif /* RASPBERRY_PI */
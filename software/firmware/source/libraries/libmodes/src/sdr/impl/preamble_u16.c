@@ -0,0 +1,152 @@
+#if defined(RASPBERRY_PI)
+
+/*
+ * Scan a buffer of uint16_t magnitude values for Mode S preamble candidates:
+ * offsets where the first 10 samples have the high/low relations of the
+ * 1090ES preamble at 2 MHz (pulses at samples 0, 2, 7 and 9).
+ *
+ * Writes the offsets of all candidates in [0, len) to out, in ascending
+ * order, and their number to out_count. out must have room for len entries.
+ * The input is read up to in[len + 8], the caller must provide that.
+ *
+ * This is only the cheap first filter, the level checks and bit slicing
+ * are left to the caller.
+ */
+
+#define PREAMBLE_MATCH(_m)                                            \
+    ((_m)[0] > (_m)[1] && (_m)[1] < (_m)[2] && (_m)[2] > (_m)[3] &&   \
+     (_m)[3] < (_m)[0] && (_m)[4] < (_m)[0] && (_m)[5] < (_m)[0] &&   \
+     (_m)[6] < (_m)[0] && (_m)[7] > (_m)[8] && (_m)[8] < (_m)[9] &&   \
+     (_m)[9] > (_m)[6])
+
+void STARCH_IMPL(preamble_u16, generic) (const uint16_t *in, unsigned len, uint32_t *out, unsigned *out_count)
+{
+    const uint16_t * restrict in_align = STARCH_ALIGNED(in);
+
+    unsigned count = 0;
+    for (unsigned i = 0; i < len; ++i) {
+        if (PREAMBLE_MATCH(in_align + i))
+            out[count++] = i;
+    }
+
+    *out_count = count;
+}
+
+#ifdef STARCH_FEATURE_NEON
+
+#include <arm_neon.h>
+
+void STARCH_IMPL_REQUIRES(preamble_u16, neon, STARCH_FEATURE_NEON) (const uint16_t *in, unsigned len, uint32_t *out, unsigned *out_count)
+{
+    const uint16_t * restrict in_align = STARCH_ALIGNED(in);
+
+    unsigned count = 0;
+    unsigned i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        const uint16_t *p = in_align + i;
+        uint16x8_t m0 = vld1q_u16(p + 0);
+        uint16x8_t m1 = vld1q_u16(p + 1);
+        uint16x8_t m2 = vld1q_u16(p + 2);
+        uint16x8_t m3 = vld1q_u16(p + 3);
+        uint16x8_t m4 = vld1q_u16(p + 4);
+        uint16x8_t m5 = vld1q_u16(p + 5);
+        uint16x8_t m6 = vld1q_u16(p + 6);
+        uint16x8_t m7 = vld1q_u16(p + 7);
+        uint16x8_t m8 = vld1q_u16(p + 8);
+        uint16x8_t m9 = vld1q_u16(p + 9);
+
+        uint16x8_t match = vandq_u16(vcgtq_u16(m0, m1), vcltq_u16(m1, m2));
+        match = vandq_u16(match, vcgtq_u16(m2, m3));
+        match = vandq_u16(match, vcltq_u16(m3, m0));
+        match = vandq_u16(match, vcltq_u16(m4, m0));
+        match = vandq_u16(match, vcltq_u16(m5, m0));
+        match = vandq_u16(match, vcltq_u16(m6, m0));
+        match = vandq_u16(match, vcgtq_u16(m7, m8));
+        match = vandq_u16(match, vcltq_u16(m8, m9));
+        match = vandq_u16(match, vcgtq_u16(m9, m6));
+
+        // one byte per lane, mostly all zero
+        uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(match)), 0);
+        while (bits) {
+            unsigned lane = __builtin_ctzll(bits) >> 3;
+            out[count++] = i + lane;
+            bits &= ~((uint64_t) 0xFF << (lane << 3));
+        }
+    }
+
+    for (; i < len; ++i) {
+        if (PREAMBLE_MATCH(in_align + i))
+            out[count++] = i;
+    }
+
+    *out_count = count;
+}
+
+#endif /* STARCH_FEATURE_NEON */
+
+#ifdef STARCH_FEATURE_AVX2
+
+#include <immintrin.h>
+
+void STARCH_IMPL_REQUIRES(preamble_u16, avx2, STARCH_FEATURE_AVX2) (const uint16_t *in, unsigned len, uint32_t *out, unsigned *out_count)
+{
+    const uint16_t * restrict in_align = STARCH_ALIGNED(in);
+
+    // AVX2 only has signed 16-bit compares, flip the sign bits first
+    const __m256i bias = _mm256_set1_epi16((short) 0x8000);
+
+    unsigned count = 0;
+    unsigned i = 0;
+
+#define LOAD_BIASED(_k) _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (p + (_k))), bias)
+#define GT(_a,_b) _mm256_cmpgt_epi16((_a), (_b))
+
+    for (; i + 16 <= len; i += 16) {
+        const uint16_t *p = in_align + i;
+        __m256i m0 = LOAD_BIASED(0);
+        __m256i m1 = LOAD_BIASED(1);
+        __m256i m2 = LOAD_BIASED(2);
+        __m256i m3 = LOAD_BIASED(3);
+        __m256i m4 = LOAD_BIASED(4);
+        __m256i m5 = LOAD_BIASED(5);
+        __m256i m6 = LOAD_BIASED(6);
+        __m256i m7 = LOAD_BIASED(7);
+        __m256i m8 = LOAD_BIASED(8);
+        __m256i m9 = LOAD_BIASED(9);
+
+        __m256i match = _mm256_and_si256(GT(m0, m1), GT(m2, m1));
+        match = _mm256_and_si256(match, GT(m2, m3));
+        match = _mm256_and_si256(match, GT(m0, m3));
+        match = _mm256_and_si256(match, GT(m0, m4));
+        match = _mm256_and_si256(match, GT(m0, m5));
+        match = _mm256_and_si256(match, GT(m0, m6));
+        match = _mm256_and_si256(match, GT(m7, m8));
+        match = _mm256_and_si256(match, GT(m9, m8));
+        match = _mm256_and_si256(match, GT(m9, m6));
+
+        // two mask bits per lane
+        uint32_t bits = (uint32_t) _mm256_movemask_epi8(match);
+        while (bits) {
+            unsigned lane = __builtin_ctz(bits) >> 1;
+            out[count++] = i + lane;
+            bits &= ~(3U << (lane << 1));
+        }
+    }
+
+#undef LOAD_BIASED
+#undef GT
+
+    for (; i < len; ++i) {
+        if (PREAMBLE_MATCH(in_align + i))
+            out[count++] = i;
+    }
+
+    *out_count = count;
+}
+
+#endif /* STARCH_FEATURE_AVX2 */
+
+#undef PREAMBLE_MATCH
+
+#endif /* RASPBERRY_PI */
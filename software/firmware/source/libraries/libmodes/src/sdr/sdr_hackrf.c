@@ -266,7 +266,7 @@ static int handle_hackrf_samples(hackrf_transfer *transfer)
         dropped = samples_read - to_convert;
     }
 
-    HackRF.converter(buf, &outbuf->data[outbuf->overlap], to_convert, HackRF.converter_state, &outbuf->mean_level, &outbuf->mean_power);
+    convert_block(HackRF.converter, HackRF.converter_state, INPUT_UC8, buf, outbuf, to_convert);
     outbuf->validLength = outbuf->overlap + to_convert;
 
     // Push to the demodulation thread
@@ -200,7 +200,6 @@ void ifileRun()
 
         // Compute the sample timestamp and system time for the start of the block
         outbuf->sampleTimestamp = sampleCounter * 12e6 / state.sample_rate;
-        outbuf->sysTimestamp = mstime();
 
         unsigned bytes_wanted = (outbuf->totalLength - outbuf->overlap) * ifile.bytes_per_sample;
         if (bytes_wanted > ifile.bufsize)
@@ -223,7 +222,7 @@ void ifileRun()
         unsigned samples_read = bytes_read / ifile.bytes_per_sample;
 
         // Convert the new data
-        ifile.converter(ifile.readbuf, &outbuf->data[outbuf->overlap], samples_read, ifile.converter_state, &outbuf->mean_level, &outbuf->mean_power);
+        convert_block(ifile.converter, ifile.converter_state, ifile.input_format, ifile.readbuf, outbuf, samples_read);
         outbuf->validLength = outbuf->overlap + samples_read;
         outbuf->flags = 0;
 
@@ -237,6 +236,9 @@ void ifileRun()
             normalize_timespec(&next_buffer_delivery);
         }
 
+        // The block is "received" now, after any throttling delay
+        outbuf->sysTimestamp = mstime();
+
         // Push the new data to the FIFO
         fifo_enqueue(outbuf);
         sampleCounter += samples_read;
@@ -234,7 +234,7 @@ static void miriCallback(unsigned char *buf, uint32_t len, void *ctx)
         dropped = samples_read - to_convert;
     }
 
-    MIRI.converter(buf, &outbuf->data[outbuf->overlap], to_convert, MIRI.converter_state, &outbuf->mean_level, &outbuf->mean_power);
+    convert_block(MIRI.converter, MIRI.converter_state, INPUT_SC16, buf, outbuf, to_convert);
     outbuf->validLength = outbuf->overlap + to_convert;
 
     // Push to the demodulation thread
@@ -365,7 +365,7 @@ static void rtlsdrCallback(unsigned char *buf, uint32_t len, void *ctx)
     buf = RTLSDR.bounce_buffer;
 #endif
 
-    RTLSDR.converter(buf, &outbuf->data[outbuf->overlap], to_convert, RTLSDR.converter_state, &outbuf->mean_level, &outbuf->mean_power);
+    convert_block(RTLSDR.converter, RTLSDR.converter_state, INPUT_UC8, buf, outbuf, to_convert);
     outbuf->validLength = outbuf->overlap + to_convert;
 
     // Push to the demodulation thread
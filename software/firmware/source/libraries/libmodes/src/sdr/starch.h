@@ -1,5 +1,6 @@
 
-/* starch generated code. Do not edit. */
+/* starch generated code, extended by hand with the preamble_u16 kernels
+ * and the x86_avx2 flavor. There is no generator in this tree. */
 
 #include "dsp-types.h"
 #include "cpu.h"
@@ -225,6 +226,36 @@ extern starch_count_above_u16_aligned_regentry starch_count_above_u16_aligned_re
 starch_count_above_u16_aligned_regentry * starch_count_above_u16_aligned_select();
 void starch_count_above_u16_aligned_set_wisdom( const char * const * received_wisdom );
 
+typedef void (* starch_preamble_u16_ptr) ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
+extern starch_preamble_u16_ptr starch_preamble_u16;
+
+typedef struct {
+    int rank;
+    const char *name;
+    const char *flavor;
+    starch_preamble_u16_ptr callable;
+    int (*flavor_supported)();
+} starch_preamble_u16_regentry;
+
+extern starch_preamble_u16_regentry starch_preamble_u16_registry[];
+starch_preamble_u16_regentry * starch_preamble_u16_select();
+void starch_preamble_u16_set_wisdom( const char * const * received_wisdom );
+
+typedef void (* starch_preamble_u16_aligned_ptr) ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
+extern starch_preamble_u16_aligned_ptr starch_preamble_u16_aligned;
+
+typedef struct {
+    int rank;
+    const char *name;
+    const char *flavor;
+    starch_preamble_u16_aligned_ptr callable;
+    int (*flavor_supported)();
+} starch_preamble_u16_aligned_regentry;
+
+extern starch_preamble_u16_aligned_regentry starch_preamble_u16_aligned_registry[];
+starch_preamble_u16_aligned_regentry * starch_preamble_u16_aligned_select();
+void starch_preamble_u16_aligned_set_wisdom( const char * const * received_wisdom );
+
 /* flavors and prototypes */
 
 #ifdef STARCH_FLAVOR_ARMV7A_NEON_VFPV4
@@ -273,6 +304,10 @@ void starch_magnitude_sc16_exact_float_armv7a_neon_vfpv4 ( const sc16_t * arg0,
 void starch_magnitude_sc16_aligned_exact_float_armv7a_neon_vfpv4 ( const sc16_t * arg0, uint16_t * arg1, unsigned arg2 );
 void starch_magnitude_sc16_neon_vrsqrte_armv7a_neon_vfpv4 ( const sc16_t * arg0, uint16_t * arg1, unsigned arg2 );
 void starch_magnitude_sc16_aligned_neon_vrsqrte_armv7a_neon_vfpv4 ( const sc16_t * arg0, uint16_t * arg1, unsigned arg2 );
+void starch_preamble_u16_generic_armv7a_neon_vfpv4 ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
+void starch_preamble_u16_aligned_generic_armv7a_neon_vfpv4 ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
+void starch_preamble_u16_neon_armv7a_neon_vfpv4 ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
+void starch_preamble_u16_aligned_neon_armv7a_neon_vfpv4 ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
 #endif /* STARCH_FLAVOR_ARMV7A_NEON_VFPV4 */
 
 int starch_read_wisdom (const char * path);
@@ -323,6 +358,10 @@ void starch_magnitude_sc16_exact_float_armv8_neon_simd ( const sc16_t * arg0, ui
 void starch_magnitude_sc16_aligned_exact_float_armv8_neon_simd ( const sc16_t * arg0, uint16_t * arg1, unsigned arg2 );
 void starch_magnitude_sc16_neon_vrsqrte_armv8_neon_simd ( const sc16_t * arg0, uint16_t * arg1, unsigned arg2 );
 void starch_magnitude_sc16_aligned_neon_vrsqrte_armv8_neon_simd ( const sc16_t * arg0, uint16_t * arg1, unsigned arg2 );
+void starch_preamble_u16_generic_armv8_neon_simd ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
+void starch_preamble_u16_aligned_generic_armv8_neon_simd ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
+void starch_preamble_u16_neon_armv8_neon_simd ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
+void starch_preamble_u16_aligned_neon_armv8_neon_simd ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
 #endif /* STARCH_FLAVOR_ARMV8_NEON_SIMD */
 
 int starch_read_wisdom (const char * path);
@@ -344,6 +383,7 @@ void starch_magnitude_sc16q11_12bit_table_generic ( const sc16_t * arg0, uint16_
 void starch_count_above_u16_generic_generic ( const uint16_t * arg0, unsigned arg1, uint16_t arg2, unsigned * arg3 );
 void starch_magnitude_sc16_exact_u32_generic ( const sc16_t * arg0, uint16_t * arg1, unsigned arg2 );
 void starch_magnitude_sc16_exact_float_generic ( const sc16_t * arg0, uint16_t * arg1, unsigned arg2 );
+void starch_preamble_u16_generic_generic ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
 #endif /* STARCH_FLAVOR_GENERIC */
 
 int starch_read_wisdom (const char * path);
@@ -382,6 +422,10 @@ void starch_magnitude_sc16_exact_u32_x86_avx2 ( const sc16_t * arg0, uint16_t *
 void starch_magnitude_sc16_aligned_exact_u32_x86_avx2 ( const sc16_t * arg0, uint16_t * arg1, unsigned arg2 );
 void starch_magnitude_sc16_exact_float_x86_avx2 ( const sc16_t * arg0, uint16_t * arg1, unsigned arg2 );
 void starch_magnitude_sc16_aligned_exact_float_x86_avx2 ( const sc16_t * arg0, uint16_t * arg1, unsigned arg2 );
+void starch_preamble_u16_generic_x86_avx2 ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
+void starch_preamble_u16_aligned_generic_x86_avx2 ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
+void starch_preamble_u16_avx2_x86_avx2 ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
+void starch_preamble_u16_aligned_avx2_x86_avx2 ( const uint16_t * arg0, unsigned arg1, uint32_t * arg2, unsigned * arg3 );
 #endif /* STARCH_FLAVOR_X86_AVX2 */
 
 int starch_read_wisdom (const char * path);
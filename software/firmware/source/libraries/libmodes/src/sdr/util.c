@@ -167,7 +167,17 @@ void *readerThreadEntryPoint(void *arg)
     return NULL;
 }
 
-void ModeS_demod_loop(mode_s_callback_t cb)
+// Ask the sample source to stop and wait for the reader thread to finish
+void ModeS_stop(void)
+{
+    if (!state.exit)
+        state.exit = 1;
+
+    pthread_join(state.reader_thread, NULL);
+}
+
+// Returns false once the sample source has stopped and the FIFO is drained
+bool ModeS_demod_loop(mode_s_callback_t cb)
 {
    if (!state.exit) {
         // get the next sample buffer off the FIFO; wait only up to 100ms
@@ -179,11 +189,19 @@ void ModeS_demod_loop(mode_s_callback_t cb)
             uint16_t *mag = buf->data;
             uint32_t mlen = buf->validLength - buf->overlap;
 
-            mode_s_detect(&state, mag, mlen, cb);
+            struct mode_s_preamble_scan scan = {
+                buf->preamble, buf->preambleCount, buf->preambleStart, buf->preambleEnd
+            };
+
+            state.sample_stamp = buf->sysTimestamp;
+
+            mode_s_detect_scan(&state, mag, mlen, &scan, cb);
 
             // Return the buffer to the FIFO freelist for reuse
             fifo_release(buf);
         }
     }
+
+    return !state.exit;
 }
 #endif /* RASPBERRY_PI */
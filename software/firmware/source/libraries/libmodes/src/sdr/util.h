@@ -23,6 +23,10 @@
 #include <stdint.h>
 #include <pthread.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
 /* Returns system time in milliseconds */
 uint64_t mstime(void);
 
@@ -66,4 +70,8 @@ void set_thread_name(const char *name);
  */
 int join_thread(pthread_t thread, void **retval, uint32_t timeout_ms);
 
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
 #endif
@@ -0,0 +1,151 @@
+// Part of dump1090, a Mode S message decoder for RTLSDR devices.
+//
+// wisdom.c: starch implementation selection
+//
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#if defined(RASPBERRY_PI)
+
+#include "sdr/common.h"
+#include "sdr/wisdom.h"
+
+#include <time.h>
+
+#define WISDOM_SAMPLES  MODES_MAG_BUF_SAMPLES
+#define WISDOM_RUNS     5
+#define WISDOM_ENTRIES  16
+
+typedef struct {
+    const char *name;
+    uint64_t ns;
+} wisdom_result;
+
+static uint64_t wisdom_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int wisdom_compare(const void *l, const void *r)
+{
+    const wisdom_result *left = l, *right = r;
+    return (left->ns > right->ns) - (left->ns < right->ns);
+}
+
+// Best of WISDOM_RUNS for every usable implementation of _fn, then apply
+// the ranking and append it to the wisdom file.
+#define WISDOM_BENCHMARK(_fn, _args)                                        \
+    do {                                                                    \
+        wisdom_result results[WISDOM_ENTRIES];                              \
+        const char *names[WISDOM_ENTRIES + 1];                              \
+        unsigned count = 0;                                                 \
+        for (starch_##_fn##_regentry *entry = starch_##_fn##_registry;      \
+             entry->name && count < WISDOM_ENTRIES; ++entry) {              \
+            if (entry->flavor_supported && !entry->flavor_supported())      \
+                continue;                                                   \
+            uint64_t best = UINT64_MAX;                                     \
+            for (int run = 0; run < WISDOM_RUNS; ++run) {                   \
+                uint64_t start = wisdom_clock();                            \
+                entry->callable _args;                                      \
+                uint64_t elapsed = wisdom_clock() - start;                  \
+                if (elapsed < best)                                         \
+                    best = elapsed;                                         \
+            }                                                               \
+            results[count].name = entry->name;                              \
+            results[count].ns = best;                                       \
+            ++count;                                                        \
+        }                                                                   \
+        qsort(results, count, sizeof(results[0]), wisdom_compare);         \
+        for (unsigned i = 0; i < count; ++i) {                              \
+            names[i] = results[i].name;                                     \
+            if (fp)                                                         \
+                fprintf(fp, "%-28s %-40s # %llu ns\n", #_fn, names[i],     \
+                        (unsigned long long) results[i].ns);                \
+        }                                                                   \
+        names[count] = NULL;                                                \
+        starch_##_fn##_set_wisdom(names);                                   \
+    } while (0)
+
+int wisdom_setup(const char *path)
+{
+    if (starch_read_wisdom(path) == 0) {
+        fprintf(stderr, "Using starch wisdom from %s\n", path);
+        return 0;
+    }
+
+    fprintf(stderr, "No starch wisdom in %s, benchmarking DSP kernels...\n", path);
+
+    // Sized for the largest input (sc16, 4 bytes per sample) and aligned
+    // so that the _aligned variants can be timed on the same buffers.
+    void *in = NULL, *mag = NULL;
+    uint32_t *offsets = NULL;
+    if (posix_memalign(&in, 32, WISDOM_SAMPLES * sizeof(sc16_t) + 64) ||
+        posix_memalign(&mag, 32, (WISDOM_SAMPLES + 16) * sizeof(uint16_t)) ||
+        !(offsets = malloc(WISDOM_SAMPLES * sizeof(uint32_t)))) {
+        free(in);
+        free(mag);
+        fprintf(stderr, "Out of memory benchmarking DSP kernels\n");
+        return -1;
+    }
+
+    // noise-like input
+    uint8_t *bytes = in;
+    uint32_t seed = 0x1090;
+    for (unsigned i = 0; i < WISDOM_SAMPLES * sizeof(sc16_t) + 64; ++i) {
+        seed = seed * 1103515245 + 12345;
+        bytes[i] = seed >> 16;
+    }
+    uint16_t *mag16 = mag;
+    const uc8_t *uc8 = in;
+    const sc16_t *sc16 = in;
+    unsigned found;
+    double level, power;
+
+    FILE *fp = fopen(path, "w");
+    if (fp)
+        fprintf(fp, "# starch wisdom, fastest first. Delete to benchmark again.\n");
+
+    WISDOM_BENCHMARK(magnitude_uc8, (uc8, mag16, WISDOM_SAMPLES));
+    WISDOM_BENCHMARK(magnitude_uc8_aligned, (uc8, mag16, WISDOM_SAMPLES));
+    WISDOM_BENCHMARK(magnitude_power_uc8, (uc8, mag16, WISDOM_SAMPLES, &level, &power));
+    WISDOM_BENCHMARK(magnitude_power_uc8_aligned, (uc8, mag16, WISDOM_SAMPLES, &level, &power));
+    WISDOM_BENCHMARK(magnitude_sc16, (sc16, mag16, WISDOM_SAMPLES));
+    WISDOM_BENCHMARK(magnitude_sc16_aligned, (sc16, mag16, WISDOM_SAMPLES));
+    WISDOM_BENCHMARK(magnitude_sc16q11, (sc16, mag16, WISDOM_SAMPLES));
+    WISDOM_BENCHMARK(magnitude_sc16q11_aligned, (sc16, mag16, WISDOM_SAMPLES));
+    WISDOM_BENCHMARK(mean_power_u16, (mag16, WISDOM_SAMPLES, &level, &power));
+    WISDOM_BENCHMARK(mean_power_u16_aligned, (mag16, WISDOM_SAMPLES, &level, &power));
+
+    // noise with the occasional strong pulse, so that the preamble scan
+    // sees a realistic mix of rejects and candidates
+    for (unsigned i = 0; i < WISDOM_SAMPLES + 16; ++i)
+        mag16[i] = (bytes[i] < 16) ? 40000 + bytes[i * 2 + 1] : bytes[i * 2] * 32;
+
+    WISDOM_BENCHMARK(preamble_u16, (mag16, WISDOM_SAMPLES, offsets, &found));
+    WISDOM_BENCHMARK(preamble_u16_aligned, (mag16, WISDOM_SAMPLES, offsets, &found));
+
+    if (fp) {
+        fclose(fp);
+    } else {
+        fprintf(stderr, "Unable to save starch wisdom to %s: %s\n", path, strerror(errno));
+    }
+
+    free(offsets);
+    free(mag);
+    free(in);
+    return 1;
+}
+
+#endif /* RASPBERRY_PI */
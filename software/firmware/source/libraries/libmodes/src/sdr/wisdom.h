@@ -0,0 +1,37 @@
+// Part of dump1090, a Mode S message decoder for RTLSDR devices.
+//
+// wisdom.h: starch implementation selection (header)
+//
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DUMP1090_WISDOM_H
+#define DUMP1090_WISDOM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define WISDOM_DEFAULT_PATH "/var/tmp/softrf.wisdom"
+
+// Load the starch wisdom file at 'path'. If there is none, time every
+// implementation of the DSP kernels this host can run, rank them fastest
+// first and save the result to 'path' for the next start.
+// Returns 0 when loaded, 1 when benchmarked, -1 on error.
+int wisdom_setup(const char *path);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
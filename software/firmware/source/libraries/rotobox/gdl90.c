@@ -419,6 +419,13 @@ void print_gdl90_traffic_report(gdl90_msg_traffic_report_t *decodedMsg) {
 bool decode_gdl90_traffic_report(gdl_message_t *rawMsg, gdl90_msg_traffic_report_t *decodedMsg) {
     bool rval = gdl90_verifyCrc(rawMsg, GDL90_MSG_LEN_TRAFFIC_REPORT);
 
+    parse_gdl90_traffic_report(rawMsg, decodedMsg);
+
+    return rval;
+}
+
+// Same as above, for a message with the CRC already checked
+void parse_gdl90_traffic_report(gdl_message_t *rawMsg, gdl90_msg_traffic_report_t *decodedMsg) {
     decodedMsg->trafficAlertStatus = GDL90_DECODE_TRAFFIC_ALERT(rawMsg->data);
     decodedMsg->addressType = GDL90_DECODE_ADDRESS_TYPE(rawMsg->data);
     decodedMsg->address = GDL90_DECODE_ADDRESS(rawMsg->data);
@@ -443,8 +450,6 @@ bool decode_gdl90_traffic_report(gdl_message_t *rawMsg, gdl90_msg_traffic_report
     }
 
     decodedMsg->emergencyCode = GDL90_DECODE_EMERGENCY_CODE(rawMsg->data);
-
-    return rval;
 }
 
 void encode_gdl90_traffic_report(gdl_message_t *rawMsg, gdl90_msg_traffic_report_t *decodedMsg) {
@@ -542,12 +547,17 @@ void encode_gdl90_traffic_report(gdl_message_t *rawMsg, gdl90_msg_traffic_report
 
 bool decode_gdl90_ownship_geo_altitude(gdl_message_t *rawMsg, gdl90_msg_ownship_geo_altitude *decodedMsg) {
     bool rval = gdl90_verifyCrc(rawMsg, GDL90_MSG_LEN_OWNSHIP_GEOMETRIC);
+
+    parse_gdl90_ownship_geo_altitude(rawMsg, decodedMsg);
+
+    return rval;
+}
+
+void parse_gdl90_ownship_geo_altitude(gdl_message_t *rawMsg, gdl90_msg_ownship_geo_altitude *decodedMsg) {
     // pg 34 of GDL90 ICD
     decodedMsg->ownshipGeoAltitude = ((int16_t)((rawMsg->data[0] << 8) + rawMsg->data[1])) * GDL90_GEO_ALTITUDE_FACTOR;
     decodedMsg->verticalWarningIndicator = (bool)(rawMsg->data[2] >> 7);
     decodedMsg->verticalFigureOfMerit = (float)((rawMsg->data[2] << 8) + (rawMsg->data[3]) & 0x7FFF);
-
-    return rval;
 }
 
 void print_gdl90_ownship_geo_altitude(gdl90_msg_ownship_geo_altitude *decodedMsg) {
@@ -576,6 +586,12 @@ void encode_gdl90_ownship_geo_altitude(gdl_message_t *rawMsg, gdl90_msg_ownship_
 bool decode_gdl90_heartbeat(gdl_message_t *rawMsg, gdl90_msg_heartbeat *decodedMsg) {
     bool rval = gdl90_verifyCrc(rawMsg, GDL90_MSG_LEN_HEARTBEAT);
 
+    parse_gdl90_heartbeat(rawMsg, decodedMsg);
+
+    return rval;
+}
+
+void parse_gdl90_heartbeat(gdl_message_t *rawMsg, gdl90_msg_heartbeat *decodedMsg) {
     decodedMsg->gpsPosValid = (bool)(rawMsg->data[0] >> 7);
     decodedMsg->maintReq = (bool)(rawMsg->data[0] >> 6);
     decodedMsg->ident = (bool)(rawMsg->data[0] >> 5);
@@ -593,8 +609,6 @@ bool decode_gdl90_heartbeat(gdl_message_t *rawMsg, gdl90_msg_heartbeat *decodedM
                                         (rawMsg->data[2]        << 8) +
                                         rawMsg->data[3]);
     decodedMsg->messageCounts = (uint16_t)((rawMsg->data[4] << 8) + rawMsg->data[5]);
-
-    return rval;
 }
 
 void print_gdl90_heartbeat(gdl90_msg_heartbeat *decodedMsg) {
@@ -251,11 +251,14 @@ void gdl90_insertCrc(gdl_message_t *rawMsg, uint32_t length);
 void decode_gdl90_message(gdl_message_t *rawMsg);
 void print_gdl90_traffic_report(gdl90_msg_traffic_report_t *decodedMsg);
 bool decode_gdl90_traffic_report(gdl_message_t *rawMsg, gdl90_msg_traffic_report_t *decodedMsg);
+void parse_gdl90_traffic_report(gdl_message_t *rawMsg, gdl90_msg_traffic_report_t *decodedMsg);
 void encode_gdl90_traffic_report(gdl_message_t *rawMsg, gdl90_msg_traffic_report_t *decodedMsg);
 bool decode_gdl90_ownship_geo_altitude(gdl_message_t *rawMsg, gdl90_msg_ownship_geo_altitude *decodedMsg);
+void parse_gdl90_ownship_geo_altitude(gdl_message_t *rawMsg, gdl90_msg_ownship_geo_altitude *decodedMsg);
 void encode_gdl90_ownship_geo_altitude(gdl_message_t *rawMsg, gdl90_msg_ownship_geo_altitude *decodedMsg);
 void print_gdl90_ownship_geo_altitude(gdl90_msg_ownship_geo_altitude *decodedMsg);
 bool decode_gdl90_heartbeat(gdl_message_t *rawMsg, gdl90_msg_heartbeat *decodedMsg);
+void parse_gdl90_heartbeat(gdl_message_t *rawMsg, gdl90_msg_heartbeat *decodedMsg);
 void print_gdl90_heartbeat(gdl90_msg_heartbeat *decodedMsg);
 void encode_gdl90_heartbeat(gdl_message_t *rawMsg, gdl90_msg_heartbeat *decodedMsg);
 void encode_gdl90_uplink_data(gdl_message_t *rawMsg, uint8_t *payload, uint16_t payload_size);
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+
+'''
+    Builds the SkyView aircraft registry (acreg.bin) out of the
+    fln.db, ogn.db and icao.db files made by fln.sh, ogn.sh and icao.sh.
+
+    Usage: acreg.py [--fln fln.db] [--ogn ogn.db] [--icao icao.db] [-o acreg.bin]
+
+    The layout is described in SkyView/RegistryHelper.h.
+'''
+
+import argparse
+import sqlite3
+import struct
+
+MAGIC        = b'SRFA'
+VERSION      = 1
+SECTOR       = 512
+RECORD       = struct.Struct('<L12s16s32s')
+KEYS_PER_SEC = SECTOR // 4
+RECS_PER_SEC = SECTOR // RECORD.size
+TOP_MAX      = 4096
+NO_KEY       = 0xFFFFFFFF
+
+# same values as DB_FLN, DB_OGN, DB_ICAO in SkyView.h
+DB_FLN       = 2
+DB_OGN       = 3
+DB_ICAO      = 4
+
+# registration, tail and type columns, as in the SQLite lookups
+SOURCES = {
+    DB_FLN:  "select id, registration, tail, type from aircrafts",
+    DB_OGN:  "select id, acreg, accn, acmodel from devices",
+    DB_ICAO: "select id, registration, owner, type from aircrafts",
+}
+
+def text(value):
+    return (value or '').encode('utf-8', 'replace')
+
+def load(db, filename, records):
+    conn = sqlite3.connect(filename)
+    for (id, reg, tail, model) in conn.execute(SOURCES[db]):
+        try:
+            key = (db << 24) | (int(id) & 0xFFFFFF)
+        except (TypeError, ValueError):
+            continue
+        if key not in records:
+            records[key] = (text(reg), text(tail), text(model))
+    conn.close()
+
+def pad(data):
+    return data + b'\xff' * (-len(data) % SECTOR)
+
+def build(records, filename):
+    keys = sorted(records)
+
+    data = b''.join(RECORD.pack(k, *records[k]) for k in keys)
+    data = pad(data)
+
+    sectors = len(data) // SECTOR
+    first = [keys[s * RECS_PER_SEC] for s in range(sectors)]
+    index = pad(struct.pack('<%dL' % len(first), *first))
+
+    top = first[::KEYS_PER_SEC]
+    if not top or len(top) > TOP_MAX:
+        raise SystemExit('acreg: %d records do not fit' % len(keys))
+    top_bin = pad(struct.pack('<%dL' % len(top), *top))
+
+    top_offset   = SECTOR
+    index_offset = top_offset + len(top_bin)
+    data_offset  = index_offset + len(index)
+
+    header = struct.pack('<4sHHLLLLL', MAGIC, VERSION, RECORD.size, len(keys),
+                         top_offset, len(top), index_offset, data_offset)
+
+    with open(filename, 'wb') as f:
+        f.write(header + b'\0' * (SECTOR - len(header)))
+        f.write(top_bin)
+        f.write(index)
+        f.write(data)
+
+    print('%s: %d records, %d bytes' % (filename, len(keys),
+                                        data_offset + len(data)))
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--fln')
+    parser.add_argument('--ogn')
+    parser.add_argument('--icao')
+    parser.add_argument('-o', '--output', default='acreg.bin')
+    args = parser.parse_args()
+
+    records = {}
+    for (db, filename) in ((DB_FLN, args.fln), (DB_OGN, args.ogn),
+                           (DB_ICAO, args.icao)):
+        if filename:
+            load(db, filename, records)
+
+    build(records, args.output)
+
+if __name__ == '__main__':
+    main()